@@ -0,0 +1,232 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __H2D_KELLY_ADAPT_SOLVER_H
+#define __H2D_KELLY_ADAPT_SOLVER_H
+
+#include "adapt_solver.h"
+#include "kelly_error_calculator.h"
+#include "../refinement_selectors/smoothness_selector.h"
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    /// A complete adaptivity solver driven by an explicit (residual) error estimator.
+    /// \ingroup g_adapt
+    /// Unlike AdaptSolver, no reference mesh and no reference space are ever created, and nothing is assembled
+    /// or solved on them: in each step only the coarse problem is solved, the element errors are estimated
+    /// by the passed KellyErrorCalculator from the coarse solution, and the refinement type
+    /// (for hpAdaptivity) is chosen by a SmoothnessSelector from the decay of the solution coefficients.
+    /// SolverType is LinearSolver<Scalar>, NewtonSolver<Scalar> or PicardSolver<Scalar>.
+    /// Typical usage:
+    /// KellyErrorCalculator<double> error_calculator(AbsoluteError, 1);
+    /// AdaptStoppingCriterionSingleElement<double> stoppingCriterion(0.5);
+    /// AdaptSolverCriterionErrorThreshold global_criterion(1e-3);
+    /// KellyAdaptSolver<double, LinearSolver<double> > adaptSolver(space, wf, &error_calculator, &stoppingCriterion, &global_criterion);
+    /// adaptSolver.solve(hpAdaptivity);
+    /// MeshFunctionSharedPtr<double> sln = adaptSolver.get_sln(0);
+    template<typename Scalar, typename SolverType>
+    class KellyAdaptSolver :
+      public Hermes::Mixins::TimeMeasurable,
+      public Hermes::Mixins::Loggable,
+      public Hermes::Mixins::StateQueryable
+    {
+    public:
+      /// Constructor.
+      /// \param[in] smoothness_threshold See SmoothnessSelector.
+      KellyAdaptSolver(std::vector<SpaceSharedPtr<Scalar> > initial_spaces, WeakFormSharedPtr<Scalar> wf, KellyErrorCalculator<Scalar>* error_calculator, AdaptivityStoppingCriterion<Scalar>* stopping_criterion_single_step, AdaptSolverCriterion* stopping_criterion_global, double smoothness_threshold = 1.0)
+        : spaces(initial_spaces), wf(wf), error_calculator(error_calculator), stopping_criterion_single_step(stopping_criterion_single_step), stopping_criterion_global(stopping_criterion_global), smoothness_threshold(smoothness_threshold)
+      {
+        this->init();
+      }
+
+      KellyAdaptSolver(SpaceSharedPtr<Scalar> initial_space, WeakFormSharedPtr<Scalar> wf, KellyErrorCalculator<Scalar>* error_calculator, AdaptivityStoppingCriterion<Scalar>* stopping_criterion_single_step, AdaptSolverCriterion* stopping_criterion_global, double smoothness_threshold = 1.0)
+        : wf(wf), error_calculator(error_calculator), stopping_criterion_single_step(stopping_criterion_single_step), stopping_criterion_global(stopping_criterion_global), smoothness_threshold(smoothness_threshold)
+      {
+        this->spaces.push_back(initial_space);
+        this->init();
+      }
+
+      /// Destruct this instance.
+      virtual ~KellyAdaptSolver()
+      {
+        this->free_selectors();
+        delete this->solver;
+      }
+
+      /// The main method - solve.
+      /// The passed spaces are refined in place.
+      void solve(AdaptivityType adaptivityType)
+      {
+        this->check();
+        this->tick();
+
+        this->slns.clear();
+        for (unsigned char i = 0; i < this->spaces.size(); i++)
+          this->slns.push_back(MeshFunctionSharedPtr<Scalar>(new Solution<Scalar>(this->spaces[i]->get_mesh())));
+
+        this->init_selectors(adaptivityType);
+        Adapt<Scalar> adaptivity(this->spaces, this->error_calculator, this->stopping_criterion_single_step);
+        adaptivity.set_verbose_output(this->get_verbose_output());
+
+        this->adaptivity_step = 1;
+        while (true)
+        {
+          this->info("\tKellyAdaptSolver: step %i, ndofs: %i.", this->adaptivity_step, Space<Scalar>::get_num_dofs(this->spaces));
+
+          // Solve on the coarse spaces only.
+          this->solver->set_spaces(this->spaces);
+          this->solver->solve();
+          Solution<Scalar>::vector_to_solutions(this->solver->get_sln_vector(), this->spaces, this->slns);
+
+          // Estimate the error.
+          this->error_calculator->calculate_errors(this->slns, true);
+          double error = std::sqrt(this->error_calculator->get_total_error_squared()) * (this->error_calculator->get_error_type() == AbsoluteError ? 1. : 100.);
+          this->info("\tKellyAdaptSolver: estimated error: %g.", error);
+          if (this->stopping_criterion_global->done(error, this->adaptivity_step))
+            break;
+
+          // Adapt.
+          for (unsigned char i = 0; i < this->smoothness_selectors.size(); i++)
+          {
+            this->smoothness_selectors[i]->set_space(this->spaces[i]);
+            this->smoothness_selectors[i]->set_coefficient_vector(this->solver->get_sln_vector());
+          }
+          if (adaptivity.adapt(this->selectors))
+          {
+            this->warn("\tKellyAdaptSolver: no element was refined, stopping.");
+            break;
+          }
+
+          this->adaptivity_step++;
+        }
+
+        this->free_selectors();
+        this->tick();
+        this->info("\tKellyAdaptSolver: finished in %s.", this->accumulated_str().c_str());
+      }
+
+      /// Get the solutions.
+      std::vector<MeshFunctionSharedPtr<Scalar> > get_slns()
+      {
+        return this->slns;
+      }
+
+      /// Get i-th solution.
+      MeshFunctionSharedPtr<Scalar> get_sln(int index)
+      {
+        return this->slns[index];
+      }
+
+      /// Getters.
+      SolverType* get_solver()
+      {
+        return this->solver;
+      }
+      std::vector<SpaceSharedPtr<Scalar> > get_spaces()
+      {
+        return this->spaces;
+      }
+      unsigned short get_adaptivity_steps() const
+      {
+        return this->adaptivity_step;
+      }
+
+      /// See Hermes::Mixins::Loggable.
+      virtual void set_verbose_output(bool to_set)
+      {
+        Hermes::Mixins::Loggable::set_verbose_output(to_set);
+        this->solver->set_verbose_output(to_set);
+      }
+
+    protected:
+      /// State querying helpers.
+      virtual bool isOkay() const
+      {
+        if (this->spaces.empty())
+          throw Exceptions::Exception("KellyAdaptSolver: no spaces.");
+        if (!this->error_calculator || !this->stopping_criterion_single_step || !this->stopping_criterion_global)
+          throw Exceptions::Exception("KellyAdaptSolver: error calculator and stopping criteria have to be set.");
+        if (this->error_calculator->get_component_count() != (int)this->spaces.size())
+          throw Exceptions::LengthException(0, this->error_calculator->get_component_count(), this->spaces.size());
+        return true;
+      }
+      inline std::string getClassName() const { return "KellyAdaptSolver"; }
+
+      /// Common code for the constructors.
+      void init()
+      {
+        this->solver = new SolverType();
+        this->solver->set_weak_formulation(this->wf);
+        this->adaptivity_step = 0;
+      }
+
+      /// Selector creation according to the adaptivity type.
+      void init_selectors(AdaptivityType adaptivityType)
+      {
+        for (unsigned char i = 0; i < this->spaces.size(); i++)
+        {
+          if (adaptivityType == hAdaptivity)
+            this->selectors.push_back(new RefinementSelectors::HOnlySelector<Scalar>());
+          else if (adaptivityType == pAdaptivity)
+            this->selectors.push_back(new RefinementSelectors::POnlySelector<Scalar>(H2DRS_DEFAULT_ORDER, 1, 1));
+          else
+          {
+            RefinementSelectors::SmoothnessSelector<Scalar>* selector = new RefinementSelectors::SmoothnessSelector<Scalar>(this->spaces[i], this->smoothness_threshold);
+            this->smoothness_selectors.push_back(selector);
+            this->selectors.push_back(selector);
+          }
+        }
+      }
+
+      void free_selectors()
+      {
+        for (unsigned char i = 0; i < this->selectors.size(); i++)
+          delete this->selectors[i];
+        this->selectors.clear();
+        this->smoothness_selectors.clear();
+      }
+
+      /// Spaces - refined in place.
+      std::vector<SpaceSharedPtr<Scalar> > spaces;
+      /// Weak form.
+      WeakFormSharedPtr<Scalar> wf;
+      /// Error estimator.
+      KellyErrorCalculator<Scalar>* error_calculator;
+      /// Stopping criterion for each refinement step.
+      AdaptivityStoppingCriterion<Scalar>* stopping_criterion_single_step;
+      /// The stopping criterion for the loop to stop - the quantity measured is the estimated total error.
+      AdaptSolverCriterion* stopping_criterion_global;
+      /// See SmoothnessSelector.
+      double smoothness_threshold;
+
+      /// Solutions.
+      std::vector<MeshFunctionSharedPtr<Scalar> > slns;
+
+      /// Selectors (one per component) - owned.
+      std::vector<RefinementSelectors::Selector<Scalar>*> selectors;
+      /// Those of selectors that need the coefficient vector.
+      std::vector<RefinementSelectors::SmoothnessSelector<Scalar>*> smoothness_selectors;
+
+      /// Solver.
+      SolverType* solver;
+
+      /// Adaptivity steps counter.
+      unsigned short adaptivity_step;
+    };
+  }
+}
+#endif
@@ -0,0 +1,236 @@
+/// This file is part of Hermes2D.
+///
+/// Hermes2D is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 2 of the License, or
+/// (at your option) any later version.
+///
+/// Hermes2D is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY;without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with Hermes2D. If not, see <http:///www.gnu.org/licenses/>.
+
+#ifndef __H2D_DG_CONNECTIVITY_H
+#define __H2D_DG_CONNECTIVITY_H
+
+#include "interface_edge_cache.h"
+#include "space/space.h"
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    /// Persistent DG connectivity of a mesh and spaces defined on it.
+    ///
+    /// Holds the list of interior faces (inner edge segments, each one exactly once - see InterfaceSegment) with
+    /// the neighbor elements, the transformation chains and the orientation of the quadrature points,
+    /// and the assembly lists of all active elements in all spaces, so that the extended assembly list
+    /// of a face is just the central and the neighbor element's list.
+    /// Nothing of this has to be searched again as long as the mesh and the spaces do not change - e.g. in all time steps
+    /// of a time-dependent problem. After an adaptivity step, only the faces of the changed elements are searched again,
+    /// see InterfaceEdgeCache.
+    /// The faces are also colored - no two faces of one color share an element, so that the faces of one color
+    /// can be assembled in parallel without write conflicts (for spaces with element-local DOFs).
+    /// All the spaces have to be defined on the same mesh.
+    template<typename Scalar>
+    class DGConnectivity
+    {
+    public:
+      DGConnectivity() : mesh_seq(0), spaces_size(0), max_element_id(0)
+      {
+      }
+
+      /// Brings the structure up to date with the spaces.
+      /// \return True if anything changed.
+      bool update(const std::vector<SpaceSharedPtr<Scalar> >& spaces)
+      {
+        if (spaces.empty())
+          throw Exceptions::Exception("DGConnectivity: no spaces.");
+        MeshSharedPtr mesh = spaces[0]->get_mesh();
+        for (unsigned int i = 1; i < spaces.size(); i++)
+          if (spaces[i]->get_mesh().get() != mesh.get())
+            throw Exceptions::Exception("DGConnectivity: all spaces have to be defined on the same mesh.");
+
+        bool changed = (this->mesh.get() != mesh.get() || this->mesh_seq != mesh->get_seq() || this->space_seqs.size() != spaces.size());
+        for (unsigned int i = 0; !changed && i < spaces.size(); i++)
+          changed = (this->space_seqs[i] != spaces[i]->get_seq());
+        if (!changed)
+          return false;
+
+        this->mesh = mesh;
+        this->mesh_seq = mesh->get_seq();
+        this->edge_cache.update(mesh);
+
+        this->spaces_size = spaces.size();
+        this->space_seqs.resize(this->spaces_size);
+        for (unsigned int i = 0; i < this->spaces_size; i++)
+          this->space_seqs[i] = spaces[i]->get_seq();
+
+        // Assembly lists of all active elements in all spaces, flattened.
+        int max_id = this->max_element_id = mesh->get_max_element_id();
+        this->al_offsets.assign(this->spaces_size * max_id, 0);
+        this->al_counts.assign(this->spaces_size * max_id, 0);
+        this->idx.clear();
+        this->dof.clear();
+        this->coef.clear();
+        AsmList<Scalar> al;
+        for (unsigned int space_i = 0; space_i < this->spaces_size; space_i++)
+        {
+          Element* e;
+          for_all_active_elements(e, mesh)
+          {
+            spaces[space_i]->get_element_assembly_list(e, &al);
+            this->al_offsets[space_i * max_id + e->id] = this->idx.size();
+            this->al_counts[space_i * max_id + e->id] = al.cnt;
+            this->idx.insert(this->idx.end(), al.idx, al.idx + al.cnt);
+            this->dof.insert(this->dof.end(), al.dof, al.dof + al.cnt);
+            this->coef.insert(this->coef.end(), al.coef, al.coef + al.cnt);
+          }
+        }
+
+        this->color_faces();
+
+        return true;
+      }
+
+      /// The mesh.
+      MeshSharedPtr get_mesh() const
+      {
+        return this->mesh;
+      }
+
+      /// Number of interior faces.
+      unsigned int get_num_faces() const
+      {
+        return this->edge_cache.get_segments().size();
+      }
+
+      /// One interior face.
+      const InterfaceSegment& get_face(unsigned int face) const
+      {
+        return this->edge_cache.get_segments()[face];
+      }
+
+      /// Number of face colors.
+      unsigned int get_num_colors() const
+      {
+        return this->colors.size();
+      }
+
+      /// Indices of the faces of one color.
+      const std::vector<unsigned int>& get_color(unsigned int color) const
+      {
+        return this->colors[color];
+      }
+
+      /// Length of the assembly list of an element in a space.
+      unsigned short get_al_cnt(unsigned char space_i, int element_id) const
+      {
+        return this->al_counts[space_i * this->max_element_id + element_id];
+      }
+      /// Shape function indices of an element in a space.
+      const int* get_al_idx(unsigned char space_i, int element_id) const
+      {
+        return this->idx.data() + this->al_offsets[space_i * this->max_element_id + element_id];
+      }
+      /// DOFs of an element in a space.
+      const int* get_al_dof(unsigned char space_i, int element_id) const
+      {
+        return this->dof.data() + this->al_offsets[space_i * this->max_element_id + element_id];
+      }
+      /// Coefficients of an element in a space.
+      const Scalar* get_al_coef(unsigned char space_i, int element_id) const
+      {
+        return this->coef.data() + this->al_offsets[space_i * this->max_element_id + element_id];
+      }
+
+      /// Creates the sparse structure of the matrix - all couplings within elements and across interior faces.
+      /// \param[in] ndof Size of the matrix.
+      void create_sparse_structure(SparseMatrix<Scalar>* mat, int ndof) const
+      {
+        mat->free();
+        mat->prealloc(ndof);
+
+        Element* e;
+        for_all_active_elements(e, this->mesh)
+          this->pre_add_couplings(mat, e->id, e->id);
+
+        for (unsigned int face = 0; face < this->get_num_faces(); face++)
+        {
+          const InterfaceSegment& segment = this->get_face(face);
+          this->pre_add_couplings(mat, segment.central_id, segment.neighbor_id);
+          this->pre_add_couplings(mat, segment.neighbor_id, segment.central_id);
+        }
+
+        mat->alloc();
+      }
+
+    protected:
+      /// Greedy coloring - every face gets the lowest color not used by a face of its central or neighbor element.
+      void color_faces()
+      {
+        this->colors.clear();
+        std::vector<std::vector<unsigned short> > element_colors(this->max_element_id);
+        for (unsigned int face = 0; face < this->get_num_faces(); face++)
+        {
+          const InterfaceSegment& segment = this->get_face(face);
+          std::vector<unsigned short>& central_colors = element_colors[segment.central_id];
+          std::vector<unsigned short>& neighbor_colors = element_colors[segment.neighbor_id];
+          unsigned short color = 0;
+          while (std::find(central_colors.begin(), central_colors.end(), color) != central_colors.end() || std::find(neighbor_colors.begin(), neighbor_colors.end(), color) != neighbor_colors.end())
+            color++;
+          central_colors.push_back(color);
+          neighbor_colors.push_back(color);
+          if (color == this->colors.size())
+            this->colors.push_back(std::vector<unsigned int>());
+          this->colors[color].push_back(face);
+        }
+      }
+
+      void pre_add_couplings(SparseMatrix<Scalar>* mat, int row_element_id, int col_element_id) const
+      {
+        for (unsigned char space_i = 0; space_i < this->spaces_size; space_i++)
+        {
+          const int* row_dofs = this->get_al_dof(space_i, row_element_id);
+          unsigned short row_cnt = this->get_al_cnt(space_i, row_element_id);
+          for (unsigned char space_j = 0; space_j < this->spaces_size; space_j++)
+          {
+            const int* col_dofs = this->get_al_dof(space_j, col_element_id);
+            unsigned short col_cnt = this->get_al_cnt(space_j, col_element_id);
+            for (unsigned short i = 0; i < row_cnt; i++)
+            {
+              if (row_dofs[i] < 0)
+                continue;
+              for (unsigned short j = 0; j < col_cnt; j++)
+                if (col_dofs[j] >= 0)
+                  mat->pre_add_ij(row_dofs[i], col_dofs[j]);
+            }
+          }
+        }
+      }
+
+      MeshSharedPtr mesh;
+      /// Seq of the mesh at the last update(), meaningful only if the mesh is set.
+      unsigned mesh_seq;
+      std::vector<int> space_seqs;
+      unsigned int spaces_size;
+      int max_element_id;
+
+      /// Faces.
+      InterfaceEdgeCache<Scalar> edge_cache;
+      /// Face indices by colors.
+      std::vector<std::vector<unsigned int> > colors;
+
+      /// Assembly lists, indexed by [space_i * max_element_id + element_id].
+      std::vector<unsigned int> al_offsets;
+      std::vector<unsigned short> al_counts;
+      std::vector<int> idx;
+      std::vector<int> dof;
+      std::vector<Scalar> coef;
+    };
+  }
+}
+#endif
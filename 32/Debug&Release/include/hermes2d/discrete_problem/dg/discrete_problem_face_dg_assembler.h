@@ -0,0 +1,530 @@
+/// This file is part of Hermes2D.
+///
+/// Hermes2D is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 2 of the License, or
+/// (at your option) any later version.
+///
+/// Hermes2D is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY;without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with Hermes2D. If not, see <http:///www.gnu.org/licenses/>.
+
+#ifndef __H2D_DISCRETE_PROBLEM_FACE_DG_ASSEMBLER_H
+#define __H2D_DISCRETE_PROBLEM_FACE_DG_ASSEMBLER_H
+
+#include "dg_connectivity.h"
+#include "discrete_problem_dg_assembler.h"
+#include "function/solution.h"
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    /// Face-based assembling of DG forms.
+    ///
+    /// An alternative to the element-based DG assembling of DiscreteProblem (DiscreteProblemDGAssembler). The loop goes
+    /// over the interior faces of a DGConnectivity, every face is visited exactly once, and the contributions
+    /// to both adjacent elements are assembled at once:
+    /// - MatrixFormDG forms are evaluated once per face on the extended shapeset (shape functions of both elements),
+    /// - VectorFormDG forms are evaluated with the test functions of the central and then of the neighbor element,
+    ///   the traces of the previous iterations and of the external functions are evaluated only once for both.
+    /// The DGConnectivity is built once for a mesh and spaces and it is reused in all subsequent assemblings
+    /// (time steps, nonlinear iterations) - no neighbor search is done unless the mesh or the spaces change.
+    ///
+    /// Only the DG forms of the weak formulation are assembled (added to the passed matrix / vector), the volumetric
+    /// and surface forms are assembled by DiscreteProblem. The sparse structure from create_sparse_structure() contains
+    /// all the couplings within elements, so a matrix assembled by DiscreteProblem can be added to the one assembled here
+    /// by SparseMatrix::add_sparse_matrix().
+    ///
+    /// If all the spaces are L2 spaces (DOFs local to elements), the faces are assembled in parallel, color by color
+    /// (see DGConnectivity) - the faces of one color do not share any element, so no two threads write to the same
+    /// matrix / vector entry. Each thread uses its own clones of the DG forms (Form::clone() has to be implemented
+    /// as for the parallel DiscreteProblem), WeakForm::set_active_DG_state() is then not called.
+    /// Other spaces are assembled sequentially.
+    ///
+    /// Limitations: all spaces have to be defined on the same mesh, DOFs of the Dirichlet lift are skipped (DG spaces
+    /// typically do not have any), UExtFunctions (WeakForm::set_u_ext_fn(), Form::set_u_ext_fn()) are not supported
+    /// and an exception is thrown if any are set. Form scaling factors are applied the same way as in DiscreteProblem.
+    /// The integration order is DiscreteProblemDGAssembler::dg_order.
+    template<typename Scalar>
+    class DiscreteProblemFaceDGAssembler :
+      public Hermes::Mixins::TimeMeasurable,
+      public Hermes::Mixins::Loggable,
+      public Hermes::Mixins::StateQueryable
+    {
+    public:
+      /// Constructor for multiple components / equations.
+      DiscreteProblemFaceDGAssembler(WeakFormSharedPtr<Scalar> wf, std::vector<SpaceSharedPtr<Scalar> > spaces) : wf(wf), spaces(spaces)
+      {
+      }
+
+      /// Constructor for one equation.
+      DiscreteProblemFaceDGAssembler(WeakFormSharedPtr<Scalar> wf, SpaceSharedPtr<Scalar> space) : wf(wf)
+      {
+        this->spaces.push_back(space);
+      }
+
+      /// Sets new spaces (the connectivity is updated in the next assembling).
+      void set_spaces(std::vector<SpaceSharedPtr<Scalar> > spaces)
+      {
+        this->spaces = spaces;
+      }
+
+      /// Set the weak forms.
+      void set_weak_formulation(WeakFormSharedPtr<Scalar> wf)
+      {
+        this->wf = wf;
+      }
+
+      /// Creates the sparse structure of the matrix, see the class description.
+      void create_sparse_structure(SparseMatrix<Scalar>* mat)
+      {
+        this->check();
+        this->connectivity.update(this->spaces);
+        this->connectivity.create_sparse_structure(mat, Space<Scalar>::get_num_dofs(this->spaces));
+      }
+
+      /// Assembles the DG forms and adds them to mat / rhs.
+      /// \param[in] coeff_vec Previous iteration, may be nullptr for linear forms.
+      /// \param[in] mat Matrix, may be nullptr. Its structure has to contain the face couplings, see create_sparse_structure().
+      /// \param[in] rhs Right-hand side, may be nullptr.
+      void assemble(Scalar* coeff_vec, SparseMatrix<Scalar>* mat, Vector<Scalar>* rhs = nullptr)
+      {
+        this->check();
+        this->tick();
+        if (this->connectivity.update(this->spaces))
+        {
+          this->tick();
+          this->info("\tDiscreteProblemFaceDGAssembler: connectivity updated (%i faces) in %s.", this->connectivity.get_num_faces(), this->last_str().c_str());
+        }
+
+        // Previous iterations.
+        std::vector<MeshFunctionSharedPtr<Scalar> > u_ext;
+        if (coeff_vec)
+        {
+          for (unsigned int i = 0; i < this->spaces.size(); i++)
+            u_ext.push_back(MeshFunctionSharedPtr<Scalar>(new Solution<Scalar>(this->spaces[i]->get_mesh())));
+          Solution<Scalar>::vector_to_solutions(coeff_vec, this->spaces, u_ext);
+        }
+
+        int num_threads_used = std::max<int>(1, HermesCommonApi.get_integral_param_value(numThreads));
+        if (num_threads_used == 1 || !this->element_local_dofs())
+        {
+          FaceAssemblyData data(this->spaces, u_ext, this->wf, false);
+          for (unsigned int face = 0; face < this->connectivity.get_num_faces(); face++)
+            this->assemble_face(&data, this->connectivity.get_face(face), mat, rhs);
+        }
+        else
+          this->assemble_colored(u_ext, mat, rhs, num_threads_used);
+
+        this->tick();
+        this->info("\tDiscreteProblemFaceDGAssembler: assembled in %s.", this->last_str().c_str());
+      }
+
+      /// Assembles the DG vector forms and adds them to rhs.
+      void assemble(Scalar* coeff_vec, Vector<Scalar>* rhs)
+      {
+        this->assemble(coeff_vec, nullptr, rhs);
+      }
+
+      /// The connectivity.
+      const DGConnectivity<Scalar>& get_connectivity() const
+      {
+        return this->connectivity;
+      }
+
+    protected:
+      /// State querying helpers.
+      virtual bool isOkay() const
+      {
+        if (!this->wf)
+          throw Exceptions::NullException(0);
+        if (this->spaces.empty())
+          throw Exceptions::Exception("DiscreteProblemFaceDGAssembler: no spaces.");
+        if (this->wf->get_neq() != this->spaces.size())
+          throw Exceptions::LengthException(1, this->spaces.size(), this->wf->get_neq());
+        bool u_ext_fn_set = !this->wf->u_ext_fn.empty();
+        for (unsigned int i = 0; i < this->wf->mfDG.size(); i++)
+          u_ext_fn_set = u_ext_fn_set || !this->wf->mfDG[i]->u_ext_fn.empty();
+        for (unsigned int i = 0; i < this->wf->vfDG.size(); i++)
+          u_ext_fn_set = u_ext_fn_set || !this->wf->vfDG[i]->u_ext_fn.empty();
+        if (u_ext_fn_set)
+          throw Exceptions::Exception("DiscreteProblemFaceDGAssembler: UExtFunctions are not supported.");
+        return true;
+      }
+      inline std::string getClassName() const { return "DiscreteProblemFaceDGAssembler"; }
+
+      /// True if the DOFs of all spaces belong to single elements (faces of one color then do not share DOFs).
+      bool element_local_dofs() const
+      {
+        for (unsigned int i = 0; i < this->spaces.size(); i++)
+          if (this->spaces[i]->get_type() != HERMES_L2_SPACE && this->spaces[i]->get_type() != HERMES_L2_MARKERWISE_CONST_SPACE)
+            return false;
+        return true;
+      }
+
+      /// Parallel assembling, color by color.
+      void assemble_colored(const std::vector<MeshFunctionSharedPtr<Scalar> >& u_ext, SparseMatrix<Scalar>* mat, Vector<Scalar>* rhs, int num_threads_used)
+      {
+        std::string exceptionMessageCaughtInParallelBlock;
+#pragma omp parallel num_threads(num_threads_used)
+        {
+          FaceAssemblyData* data = nullptr;
+          try
+          {
+            data = new FaceAssemblyData(this->spaces, u_ext, this->wf, true);
+          }
+          catch (std::exception& exception)
+          {
+#pragma omp critical (exceptionMessageCaughtInParallelBlock)
+            exceptionMessageCaughtInParallelBlock = exception.what();
+          }
+
+          // All threads have to reach the barrier at the end of each color.
+          for (unsigned int color = 0; color < this->connectivity.get_num_colors(); color++)
+          {
+            const std::vector<unsigned int>& faces = this->connectivity.get_color(color);
+#pragma omp for schedule(dynamic, 64)
+            for (int i = 0; i < (int)faces.size(); i++)
+            {
+              if (!exceptionMessageCaughtInParallelBlock.empty())
+                continue;
+              try
+              {
+                this->assemble_face(data, this->connectivity.get_face(faces[i]), mat, rhs);
+              }
+              catch (std::exception& exception)
+              {
+#pragma omp critical (exceptionMessageCaughtInParallelBlock)
+                exceptionMessageCaughtInParallelBlock = exception.what();
+              }
+            }
+          }
+
+          delete data;
+        }
+
+        if (!exceptionMessageCaughtInParallelBlock.empty())
+          throw Exceptions::Exception(exceptionMessageCaughtInParallelBlock.c_str());
+      }
+
+      /// Data used in assembling of one face, side 0 is the central element, side 1 the neighbor.
+      class FaceAssemblyData
+      {
+      public:
+        /// \param[in] clone_forms Use thread-private clones of the DG forms.
+        FaceAssemblyData(const std::vector<SpaceSharedPtr<Scalar> >& spaces, const std::vector<MeshFunctionSharedPtr<Scalar> >& u_ext, WeakFormSharedPtr<Scalar> wf, bool clone_forms) : spaces_size(spaces.size()), own_forms(clone_forms)
+        {
+          this->mfDG = wf->get_mfDG();
+          this->vfDG = wf->get_vfDG();
+          if (this->own_forms)
+          {
+            for (unsigned int i = 0; i < this->mfDG.size(); i++)
+              this->mfDG[i] = this->mfDG[i]->clone();
+            for (unsigned int i = 0; i < this->vfDG.size(); i++)
+              this->vfDG[i] = this->vfDG[i]->clone();
+          }
+
+          for (unsigned char side = 0; side < 2; side++)
+          {
+            this->refmap[side].set_quad_2d(&g_quad_2d_std);
+            this->shapes[side].resize(this->spaces_size);
+            this->shapes_ready[side].resize(this->spaces_size);
+            for (unsigned char space_i = 0; space_i < this->spaces_size; space_i++)
+              this->pss[side].push_back(new PrecalcShapeset(spaces[space_i]->get_shapeset()));
+            this->u_ext_values[side].resize(u_ext.size());
+          }
+          for (unsigned int i = 0; i < u_ext.size(); i++)
+            this->u_ext_fns.push_back(this->clone(u_ext[i].get()));
+        }
+
+        ~FaceAssemblyData()
+        {
+          if (this->own_forms)
+          {
+            for (unsigned int i = 0; i < this->mfDG.size(); i++)
+              delete this->mfDG[i];
+            for (unsigned int i = 0; i < this->vfDG.size(); i++)
+              delete this->vfDG[i];
+          }
+          for (unsigned char side = 0; side < 2; side++)
+            for (unsigned char space_i = 0; space_i < this->spaces_size; space_i++)
+              delete this->pss[side][space_i];
+          for (typename std::map<MeshFunction<Scalar>*, MeshFunction<Scalar>*>::iterator it = this->clones.begin(); it != this->clones.end(); it++)
+            delete it->second;
+        }
+
+        /// Thread-private copy of a mesh function.
+        MeshFunction<Scalar>* clone(MeshFunction<Scalar>* fn)
+        {
+          typename std::map<MeshFunction<Scalar>*, MeshFunction<Scalar>*>::iterator it = this->clones.find(fn);
+          if (it != this->clones.end())
+            return it->second;
+          MeshFunction<Scalar>* cloned = fn->clone();
+          cloned->set_quad_2d(&g_quad_2d_std);
+          this->clones[fn] = cloned;
+          return cloned;
+        }
+
+        unsigned char spaces_size;
+
+        /// DG forms - the weak formulation's, or clones.
+        std::vector<MatrixFormDG<Scalar>*> mfDG;
+        std::vector<VectorFormDG<Scalar>*> vfDG;
+        bool own_forms;
+
+        /// Elements, edges, transformations.
+        Element* e[2];
+        unsigned char edge[2];
+        const InterfaceSegment* face;
+
+        /// Quadrature and geometry.
+        unsigned short eo[2];
+        unsigned char np;
+        RefMap refmap[2];
+        GeomSurf<double> geometry[2];
+        double wt[2][H2D_MAX_INTEGRATION_POINTS_COUNT];
+
+        /// Shape functions, per side and space.
+        std::vector<PrecalcShapeset*> pss[2];
+        std::vector<std::vector<Func<double> > > shapes[2];
+        std::vector<bool> shapes_ready[2];
+
+        /// Previous iterations.
+        std::vector<MeshFunction<Scalar>*> u_ext_fns;
+        std::vector<Func<Scalar> > u_ext_values[2];
+
+        /// External functions - values of the current form.
+        std::vector<Func<Scalar> > ext_values[2];
+
+        std::map<MeshFunction<Scalar>*, MeshFunction<Scalar>*> clones;
+      };
+
+      /// Sets the active element (with the transformations of the face) to a transformable.
+      template<typename T>
+      void set_side(FaceAssemblyData* data, unsigned char side, T* tr)
+      {
+        tr->set_active_element(data->e[side]);
+        if (side == 1)
+          for (unsigned char level = 0; level < data->face->neighbor_n_trans; level++)
+            tr->push_transform(data->face->neighbor_transformations[level]);
+      }
+
+      /// Traces of a mesh function on one side of the face.
+      void init_side_fn(FaceAssemblyData* data, unsigned char side, MeshFunction<Scalar>* fn, Func<Scalar>* values)
+      {
+        this->set_side(data, side, fn);
+        init_fn_preallocated(values, fn, data->eo[side]);
+      }
+
+      /// Shape functions of a space on one side of the face.
+      void init_shapes(FaceAssemblyData* data, unsigned char side, unsigned char space_i)
+      {
+        if (data->shapes_ready[side][space_i])
+          return;
+
+        int element_id = data->e[side]->id;
+        unsigned short cnt = this->connectivity.get_al_cnt(space_i, element_id);
+        const int* idx = this->connectivity.get_al_idx(space_i, element_id);
+        PrecalcShapeset* pss = data->pss[side][space_i];
+        this->set_side(data, side, pss);
+        data->shapes[side][space_i].resize(cnt);
+        for (unsigned short k = 0; k < cnt; k++)
+        {
+          pss->set_active_shape(idx[k]);
+          init_fn_preallocated(&data->shapes[side][space_i][k], pss, &data->refmap[side], data->eo[side]);
+        }
+        data->shapes_ready[side][space_i] = true;
+      }
+
+      /// Discontinuous views of the traces, own_side is the central one.
+      void init_discontinuous_fns(FaceAssemblyData* data, unsigned char own_side, std::vector<Func<Scalar> >* values, DiscontinuousFunc<Scalar>** fns)
+      {
+        for (unsigned int i = 0; i < values[0].size(); i++)
+          fns[i] = new DiscontinuousFunc<Scalar>(&values[own_side][i], &values[1 - own_side][i], data->face->orientation);
+      }
+
+      /// The Func instances are owned by FaceAssemblyData, not by the discontinuous functions.
+      template<typename T>
+      static void delete_discontinuous_fn(DiscontinuousFunc<T>* fn)
+      {
+        fn->fn_central = nullptr;
+        fn->fn_neighbor = nullptr;
+        delete fn;
+      }
+
+      /// Values of the external functions of a form on both sides.
+      void init_ext(FaceAssemblyData* data, const std::vector<MeshFunctionSharedPtr<Scalar> >& ext)
+      {
+        for (unsigned char side = 0; side < 2; side++)
+        {
+          data->ext_values[side].resize(ext.size());
+          for (unsigned int i = 0; i < ext.size(); i++)
+            this->init_side_fn(data, side, data->clone(ext[i].get()), &data->ext_values[side][i]);
+        }
+      }
+
+      /// Assembles one face.
+      void assemble_face(FaceAssemblyData* data, const InterfaceSegment& face, SparseMatrix<Scalar>* mat, Vector<Scalar>* rhs)
+      {
+        bool assemble_matrix = mat && !data->mfDG.empty();
+        bool assemble_rhs = rhs && !data->vfDG.empty();
+        if (!assemble_matrix && !assemble_rhs)
+          return;
+
+        Mesh* mesh = this->connectivity.get_mesh().get();
+        data->face = &face;
+        data->e[0] = mesh->get_element_fast(face.central_id);
+        data->e[1] = mesh->get_element_fast(face.neighbor_id);
+        data->edge[0] = face.central_edge;
+        data->edge[1] = face.neighbor_edge;
+
+        // Quadrature and geometry.
+        Quad2D* quad = &g_quad_2d_std;
+        int order = std::min<int>(DiscreteProblemDGAssembler<Scalar>::dg_order, std::min(quad->get_max_order(data->e[0]->get_mode()), quad->get_max_order(data->e[1]->get_mode())));
+        for (unsigned char side = 0; side < 2; side++)
+        {
+          ElementMode2D mode = data->e[side]->get_mode();
+          this->set_side(data, side, &data->refmap[side]);
+          data->eo[side] = quad->get_edge_points(data->edge[side], order, mode);
+          data->np = quad->get_num_points(data->eo[side], mode);
+          double3* pt = quad->get_points(data->eo[side], mode);
+          double3* tan;
+          init_geom_surf_allocated(data->geometry[side], &data->refmap[side], data->edge[side], data->e[side]->en[data->edge[side]]->marker, data->eo[side], tan);
+          for (unsigned char i = 0; i < data->np; i++)
+            data->wt[side][i] = pt[i][2] * tan[i][2];
+          for (unsigned char space_i = 0; space_i < data->spaces_size; space_i++)
+            data->shapes_ready[side][space_i] = false;
+          for (unsigned int i = 0; i < data->u_ext_fns.size(); i++)
+            this->init_side_fn(data, side, data->u_ext_fns[i], &data->u_ext_values[side][i]);
+        }
+
+        DiscontinuousFunc<Scalar>* u_ext[H2D_MAX_COMPONENTS];
+        Element* elements[H2D_MAX_COMPONENTS];
+
+        // Matrix forms - once per face, from the central element.
+        if (assemble_matrix)
+        {
+          for (unsigned char space_i = 0; space_i < data->spaces_size; space_i++)
+            elements[space_i] = data->e[0];
+          if (!data->own_forms)
+            this->wf->set_active_DG_state(elements, data->edge[0]);
+          this->init_discontinuous_fns(data, 0, data->u_ext_values, u_ext);
+          InterfaceGeom<double> geometry(&data->geometry[0], data->e[0], data->e[1]);
+
+          for (unsigned int form_i = 0; form_i < data->mfDG.size(); form_i++)
+          {
+            MatrixFormDG<Scalar>* mf = data->mfDG[form_i];
+            std::vector<MeshFunctionSharedPtr<Scalar> > form_ext = mf->get_ext().empty() ? this->wf->get_ext() : mf->get_ext();
+            this->init_ext(data, form_ext);
+            std::vector<DiscontinuousFunc<Scalar>*> ext(form_ext.size() + 1, nullptr);
+            this->init_discontinuous_fns(data, 0, data->ext_values, ext.data());
+
+            // Extended shapesets of the test (v) and basis (u) functions.
+            std::vector<DiscontinuousFunc<double>*> v_fns, u_fns;
+            std::vector<int> v_dofs, u_dofs;
+            std::vector<Scalar> v_coefs, u_coefs;
+            this->init_extended_shapeset(data, mf->i, v_fns, v_dofs, v_coefs);
+            this->init_extended_shapeset(data, mf->j, u_fns, u_dofs, u_coefs);
+
+            for (unsigned int i = 0; i < v_fns.size(); i++)
+            {
+              if (v_dofs[i] < 0)
+                continue;
+              for (unsigned int j = 0; j < u_fns.size(); j++)
+              {
+                if (u_dofs[j] < 0)
+                  continue;
+                Scalar val = mf->value(data->np, data->wt[0], data->u_ext_fns.empty() ? nullptr : u_ext, u_fns[j], v_fns[i], &geometry, ext.data()) * mf->scaling_factor * u_coefs[j] * v_coefs[i];
+                mat->add(v_dofs[i], u_dofs[j], val);
+              }
+            }
+
+            for (unsigned int i = 0; i < v_fns.size(); i++)
+              delete_discontinuous_fn(v_fns[i]);
+            for (unsigned int j = 0; j < u_fns.size(); j++)
+              delete_discontinuous_fn(u_fns[j]);
+            for (unsigned int i = 0; i < form_ext.size(); i++)
+              delete_discontinuous_fn(ext[i]);
+          }
+
+          for (unsigned int i = 0; i < data->u_ext_fns.size(); i++)
+            delete_discontinuous_fn(u_ext[i]);
+        }
+
+        // Vector forms - the test functions of the central, and of the neighbor element.
+        if (assemble_rhs)
+        {
+          for (unsigned char side = 0; side < 2; side++)
+          {
+            for (unsigned char space_i = 0; space_i < data->spaces_size; space_i++)
+              elements[space_i] = data->e[side];
+            if (!data->own_forms)
+              this->wf->set_active_DG_state(elements, data->edge[side]);
+            this->init_discontinuous_fns(data, side, data->u_ext_values, u_ext);
+            InterfaceGeom<double> geometry(&data->geometry[side], data->e[side], data->e[1 - side]);
+
+            for (unsigned int form_i = 0; form_i < data->vfDG.size(); form_i++)
+            {
+              VectorFormDG<Scalar>* vf = data->vfDG[form_i];
+              std::vector<MeshFunctionSharedPtr<Scalar> > form_ext = vf->get_ext().empty() ? this->wf->get_ext() : vf->get_ext();
+              this->init_ext(data, form_ext);
+              std::vector<DiscontinuousFunc<Scalar>*> ext(form_ext.size() + 1, nullptr);
+              this->init_discontinuous_fns(data, side, data->ext_values, ext.data());
+
+              this->init_shapes(data, side, vf->i);
+              int element_id = data->e[side]->id;
+              unsigned short cnt = this->connectivity.get_al_cnt(vf->i, element_id);
+              const int* dof = this->connectivity.get_al_dof(vf->i, element_id);
+              const Scalar* coef = this->connectivity.get_al_coef(vf->i, element_id);
+              for (unsigned short k = 0; k < cnt; k++)
+              {
+                if (dof[k] < 0)
+                  continue;
+                Scalar val = vf->value(data->np, data->wt[side], data->u_ext_fns.empty() ? nullptr : u_ext, &data->shapes[side][vf->i][k], &geometry, ext.data()) * vf->scaling_factor * coef[k];
+                rhs->add(dof[k], val);
+              }
+
+              for (unsigned int i = 0; i < form_ext.size(); i++)
+                delete_discontinuous_fn(ext[i]);
+            }
+
+            for (unsigned int i = 0; i < data->u_ext_fns.size(); i++)
+              delete_discontinuous_fn(u_ext[i]);
+          }
+        }
+      }
+
+      /// Shape functions of a space on both elements of the face, extended by zero to the other element.
+      void init_extended_shapeset(FaceAssemblyData* data, unsigned char space_i, std::vector<DiscontinuousFunc<double>*>& fns, std::vector<int>& dofs, std::vector<Scalar>& coefs)
+      {
+        for (unsigned char side = 0; side < 2; side++)
+        {
+          this->init_shapes(data, side, space_i);
+          int element_id = data->e[side]->id;
+          unsigned short cnt = this->connectivity.get_al_cnt(space_i, element_id);
+          const int* dof = this->connectivity.get_al_dof(space_i, element_id);
+          const Scalar* coef = this->connectivity.get_al_coef(space_i, element_id);
+          for (unsigned short k = 0; k < cnt; k++)
+          {
+            fns.push_back(new DiscontinuousFunc<double>(&data->shapes[side][space_i][k], side == 1, data->face->orientation));
+            dofs.push_back(dof[k]);
+            coefs.push_back(coef[k]);
+          }
+        }
+      }
+
+      /// Weak formulation.
+      WeakFormSharedPtr<Scalar> wf;
+      /// Spaces.
+      std::vector<SpaceSharedPtr<Scalar> > spaces;
+      /// Faces, assembly lists.
+      DGConnectivity<Scalar> connectivity;
+    };
+  }
+}
+#endif
@@ -0,0 +1,308 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __H2D_INTERFACE_EDGE_CACHE_H
+#define __H2D_INTERFACE_EDGE_CACHE_H
+
+#include "neighbor_search.h"
+#include "mesh/mesh_util.h"
+#include "quadrature/quad_all.h"
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    /// One segment of an inner edge shared by exactly two active elements.
+    /// The segment is stored from the side of the smaller element (for elements of the same size, from the side
+    /// of the one with the lower id), so that the central element never needs to be transformed and
+    /// the (bigger) neighbor is transformed by neighbor_transformations to the part matching the central edge.
+    struct InterfaceSegment
+    {
+      /// Id of the central element.
+      int central_id;
+      /// Local number of the edge on the central element.
+      unsigned char central_edge;
+      /// Id of the neighbor element.
+      int neighbor_id;
+      /// Local number of the edge on the neighbor element.
+      unsigned char neighbor_edge;
+      /// Relative orientation of the neighbor edge (true - reversed).
+      bool orientation;
+      /// Number of transformations of the neighbor element.
+      unsigned char neighbor_n_trans;
+      /// Transformations of the neighbor element.
+      unsigned char neighbor_transformations[Transformable::H2D_MAX_TRN_LEVEL];
+    };
+
+    /// Cache of inner edge segments of a mesh, built by NeighborSearch.
+    /// Every interior segment is listed exactly once (see InterfaceSegment), so that an edge-based evaluation
+    /// visits it once and distributes the result to both adjacent elements.
+    /// When the mesh changes (its seq changes), only the elements that are new or whose neighborhood
+    /// changed are processed again - those not touched by the refinement keep their segments and areas.
+    /// The cache holds the mesh until free() is called or another mesh is passed to update().
+    /// Usage:
+    /// InterfaceEdgeCache<double> cache;
+    /// cache.update(mesh);
+    /// const std::vector<InterfaceSegment>& segments = cache.get_segments();
+    template<typename Scalar>
+    class InterfaceEdgeCache
+    {
+    public:
+      InterfaceEdgeCache() : mesh_seq(0), rebuilt_element_count(0)
+      {
+      }
+
+      /// Brings the cache up to date with the mesh.
+      void update(MeshSharedPtr mesh)
+      {
+        if (mesh == this->mesh && mesh->get_seq() == this->mesh_seq)
+          return;
+
+        if (mesh != this->mesh)
+          this->entries.clear();
+        this->mesh = mesh;
+        this->mesh_seq = mesh->get_seq();
+
+        int max_id = mesh->get_max_element_id();
+        this->entries.resize(max_id);
+
+        // Find the elements to process, drop the entries of elements that are not active anymore.
+        std::vector<Element*> to_rebuild;
+        for (int id = 0; id < max_id; id++)
+        {
+          Element* e = mesh->get_element_fast(id);
+          if (!e->used || !e->active)
+          {
+            this->entries[id].free();
+            continue;
+          }
+          if (!this->entries[id].is_valid(mesh.get(), e))
+            to_rebuild.push_back(e);
+        }
+
+        int num_threads_used = std::max<int>(1, HermesCommonApi.get_integral_param_value(numThreads));
+        std::string exceptionMessageCaughtInParallelBlock;
+#pragma omp parallel num_threads(num_threads_used)
+        {
+          RefMap refmap;
+          refmap.set_quad_2d(&g_quad_2d_std);
+#pragma omp for schedule(dynamic, 64)
+          for (int i = 0; i < (int)to_rebuild.size(); i++)
+          {
+            if (!exceptionMessageCaughtInParallelBlock.empty())
+              continue;
+            try
+            {
+              this->build_entry(mesh, to_rebuild[i], &refmap);
+            }
+            catch (std::exception& exception)
+            {
+#pragma omp critical (exceptionMessageCaughtInParallelBlock)
+              exceptionMessageCaughtInParallelBlock = exception.what();
+            }
+          }
+        }
+        if (!exceptionMessageCaughtInParallelBlock.empty())
+        {
+          this->free();
+          throw Exceptions::Exception(exceptionMessageCaughtInParallelBlock.c_str());
+        }
+        this->rebuilt_element_count = to_rebuild.size();
+
+        this->segments.clear();
+        Element* e;
+        for_all_active_elements(e, mesh)
+          this->segments.insert(this->segments.end(), this->entries[e->id].segments.begin(), this->entries[e->id].segments.end());
+      }
+
+      /// All inner edge segments, each one listed once.
+      const std::vector<InterfaceSegment>& get_segments() const
+      {
+        return this->segments;
+      }
+
+      /// Area of an active element.
+      double get_element_area(int element_id) const
+      {
+        return this->entries[element_id].area;
+      }
+
+      /// Number of elements processed by the last update() - for performance measurements.
+      unsigned int get_rebuilt_element_count() const
+      {
+        return this->rebuilt_element_count;
+      }
+
+      /// Drops all the cached data.
+      void free()
+      {
+        this->entries.clear();
+        this->segments.clear();
+        this->mesh.reset();
+        this->mesh_seq = 0;
+      }
+
+    protected:
+      /// Identification of an element by its id and vertices - the id of a removed element may be reused.
+      struct ElementSignature
+      {
+        void set(Element* e)
+        {
+          this->id = e->id;
+          for (int i = 0; i < H2D_MAX_NUMBER_VERTICES; i++)
+            this->vertex_ids[i] = (i < e->get_nvert()) ? e->vn[i]->id : -1;
+        }
+
+        bool matches(Element* e) const
+        {
+          if (!e->used || !e->active)
+            return false;
+          for (int i = 0; i < H2D_MAX_NUMBER_VERTICES; i++)
+            if (this->vertex_ids[i] != ((i < e->get_nvert()) ? e->vn[i]->id : -1))
+              return false;
+          return true;
+        }
+
+        int id;
+        int vertex_ids[H2D_MAX_NUMBER_VERTICES];
+      };
+
+      /// Data of one active element.
+      struct ElementEntry
+      {
+        ElementEntry() : valid(false), area(0.)
+        {
+        }
+
+        void free()
+        {
+          this->valid = false;
+          this->neighbors.clear();
+          this->segments.clear();
+        }
+
+        /// The entry is valid if neither the element nor any of its neighbors changed.
+        bool is_valid(Mesh* mesh, Element* e) const
+        {
+          if (!this->valid || !this->signature.matches(e))
+            return false;
+          for (unsigned int i = 0; i < this->neighbors.size(); i++)
+          {
+            if (this->neighbors[i].id >= mesh->get_max_element_id())
+              return false;
+            if (!this->neighbors[i].matches(mesh->get_element_fast(this->neighbors[i].id)))
+              return false;
+          }
+          return true;
+        }
+
+        bool valid;
+        ElementSignature signature;
+        /// All elements adjacent through inner edges.
+        std::vector<ElementSignature> neighbors;
+        /// Segments stored from the side of this element.
+        std::vector<InterfaceSegment> segments;
+        double area;
+      };
+
+      /// Processes one element.
+      void build_entry(MeshSharedPtr mesh, Element* e, RefMap* refmap)
+      {
+        ElementEntry& entry = this->entries[e->id];
+        entry.free();
+        entry.signature.set(e);
+        entry.area = this->calculate_area(e, refmap);
+
+        for (unsigned char edge = 0; edge < e->get_nvert(); edge++)
+        {
+          if (e->en[edge]->bnd)
+            continue;
+
+          NeighborSearch<Scalar> ns(e, mesh);
+          ns.set_active_edge(edge);
+          const std::vector<Element*>* neighbors = ns.get_neighbors();
+          for (unsigned int i = 0; i < neighbors->size(); i++)
+          {
+            ElementSignature signature;
+            signature.set((*neighbors)[i]);
+            entry.neighbors.push_back(signature);
+          }
+
+          // The segments of a bigger central element are stored from the sides of its (smaller) neighbors.
+          if (ns.get_num_neighbors() != 1)
+            continue;
+
+          ns.set_active_segment(0);
+          Element* neighbor = ns.get_neighb_el();
+          unsigned int n_trans = 0;
+          if (ns.neighbor_transformations_size > 0 && ns.neighbor_transformations[0])
+            n_trans = ns.get_neighbor_n_trans(0);
+          if (!n_trans && neighbor->id < e->id)
+            continue;
+
+          InterfaceSegment segment;
+          segment.central_id = e->id;
+          segment.central_edge = edge;
+          segment.neighbor_id = neighbor->id;
+          segment.neighbor_edge = ns.get_neighbor_edge().local_num_of_edge;
+          segment.orientation = ns.get_neighbor_edge().orientation;
+          segment.neighbor_n_trans = n_trans;
+          for (unsigned int level = 0; level < n_trans; level++)
+            segment.neighbor_transformations[level] = ns.get_neighbor_transformations(0, level);
+          entry.segments.push_back(segment);
+        }
+
+        entry.valid = true;
+      }
+
+      /// Area of an element.
+      double calculate_area(Element* e, RefMap* refmap)
+      {
+        refmap->set_active_element(e);
+        Quad2D* quad = refmap->get_quad_2d();
+        ElementMode2D mode = e->get_mode();
+        unsigned short order = std::min<unsigned short>(20, quad->get_max_order(mode));
+        double3* pt = quad->get_points(order, mode);
+        unsigned char np = quad->get_num_points(order, mode);
+
+        double area = 0.;
+        if (refmap->is_jacobian_const())
+        {
+          for (unsigned char i = 0; i < np; i++)
+            area += pt[i][2];
+          area *= refmap->get_const_jacobian();
+        }
+        else
+        {
+          double* jacobian = refmap->get_jacobian(order);
+          for (unsigned char i = 0; i < np; i++)
+            area += pt[i][2] * jacobian[i];
+        }
+        return area;
+      }
+
+      /// The mesh the cache belongs to - held, so that another mesh allocated at the same address can not be taken for it.
+      MeshSharedPtr mesh;
+      /// Seq of the mesh at the last update(), meaningful only if the mesh is set.
+      unsigned mesh_seq;
+      /// Indexed by element ids.
+      std::vector<ElementEntry> entries;
+      /// Flat list of all segments.
+      std::vector<InterfaceSegment> segments;
+      unsigned int rebuilt_element_count;
+    };
+  }
+}
+#endif
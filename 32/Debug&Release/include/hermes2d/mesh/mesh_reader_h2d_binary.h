@@ -0,0 +1,529 @@
+// This file is part of Hermes2D
+//
+// Hermes2D is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D; if not, see <http://www.gnu.prg/licenses/>.
+
+#ifndef _MESH_READER_H2D_BINARY_H_
+#define _MESH_READER_H2D_BINARY_H_
+
+#include "mesh_reader.h"
+
+#if defined(WIN32) || defined(_WINDOWS)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    /// Read-only memory mapping of a whole file.
+    class MeshMappedFile
+    {
+    public:
+      MeshMappedFile(const char *filename) : data(nullptr), size(0)
+      {
+#if defined(WIN32) || defined(_WINDOWS)
+        this->mapping = nullptr;
+        this->file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (this->file == INVALID_HANDLE_VALUE)
+          throw Exceptions::MeshLoadFailureException("Mesh file %s could not be opened.", filename);
+        LARGE_INTEGER file_size;
+        GetFileSizeEx(this->file, &file_size);
+        this->size = (size_t)file_size.QuadPart;
+        if (this->size > 0)
+        {
+          this->mapping = CreateFileMappingA(this->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+          if (this->mapping != nullptr)
+            this->data = (const char*)MapViewOfFile(this->mapping, FILE_MAP_READ, 0, 0, 0);
+        }
+#else
+        this->file = open(filename, O_RDONLY);
+        if (this->file < 0)
+          throw Exceptions::MeshLoadFailureException("Mesh file %s could not be opened.", filename);
+        struct stat file_stat;
+        fstat(this->file, &file_stat);
+        this->size = (size_t)file_stat.st_size;
+        if (this->size > 0)
+        {
+          void* mapped = mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, this->file, 0);
+          if (mapped != MAP_FAILED)
+            this->data = (const char*)mapped;
+        }
+#endif
+        if (this->data == nullptr)
+        {
+          this->unmap();
+          throw Exceptions::MeshLoadFailureException("Mesh file %s could not be mapped to memory.", filename);
+        }
+      }
+
+      ~MeshMappedFile()
+      {
+        this->unmap();
+      }
+
+      const char* data;
+      size_t size;
+
+    private:
+      void unmap()
+      {
+#if defined(WIN32) || defined(_WINDOWS)
+        if (this->data)
+          UnmapViewOfFile(this->data);
+        if (this->mapping)
+          CloseHandle(this->mapping);
+        if (this->file != INVALID_HANDLE_VALUE)
+          CloseHandle(this->file);
+        this->mapping = nullptr;
+        this->file = INVALID_HANDLE_VALUE;
+#else
+        if (this->data)
+          munmap((void*)this->data, this->size);
+        if (this->file >= 0)
+          close(this->file);
+        this->file = -1;
+#endif
+        this->data = nullptr;
+      }
+
+#if defined(WIN32) || defined(_WINDOWS)
+      HANDLE file;
+      HANDLE mapping;
+#else
+      int file;
+#endif
+    };
+
+    /// Mesh reader from the flat binary format.
+    ///
+    /// The file is memory-mapped and the mesh is built in one pass over contiguous arrays,
+    /// there is no parsing and no lookup of vertex / element ids (ids are the array indices).
+    /// Layout (native byte order, every array starts at an offset aligned to 8 bytes):<br>
+    /// - header (MeshBinaryHeader),<br>
+    /// - vertices: num_vertices x double2,<br>
+    /// - elements: num_elements x int4 (vertex indices, the fourth is -1 for triangles),<br>
+    /// - element markers: num_elements x int (indices into the element marker table),<br>
+    /// - edges: num_edges x int2 (vertex indices of edges with a marker),<br>
+    /// - edge markers: num_edges x int (indices into the boundary marker table),<br>
+    /// - arcs: num_arcs x MeshBinaryArc,<br>
+    /// - refinements: num_refinements x int2 (element id, refinement type; -1 stands for unrefinement),<br>
+    /// - marker tables: num_element_markers, then num_boundary_markers strings, each as an unsigned int length followed by the characters.<br>
+    /// Curved edges are limited to circular arcs, NURBS are not supported.
+    ///
+    /// Typical usage (conversion from XML, then fast loading):
+    /// MeshSharedPtr mesh(new Mesh);
+    /// Hermes::Hermes2D::MeshReaderH2DXML xml_loader;
+    /// Hermes::Hermes2D::MeshReaderH2DBinary binary_loader;
+    /// binary_loader.convert(xml_loader, "domain.xml", "domain.h2db");
+    /// try
+    /// {
+    ///&nbsp;binary_loader.load("domain.h2db", mesh);
+    /// }
+    /// catch(Exceptions::MeshLoadFailureException& e)
+    /// {
+    ///&nbsp;e.print_msg();
+    ///&nbsp;return -1;
+    /// }
+    ///
+    class MeshReaderH2DBinary : public MeshReader
+    {
+    public:
+      /// Version of the format written by save().
+      static const unsigned int version = 1;
+
+      struct MeshBinaryHeader
+      {
+        char magic[8];
+        unsigned int version;
+        unsigned int header_size;
+        unsigned int num_vertices;
+        unsigned int num_elements;
+        unsigned int num_edges;
+        unsigned int num_arcs;
+        unsigned int num_refinements;
+        unsigned int num_element_markers;
+        unsigned int num_boundary_markers;
+        unsigned int reserved;
+        uint64_t vertices_offset;
+        uint64_t elements_offset;
+        uint64_t element_markers_offset;
+        uint64_t edges_offset;
+        uint64_t edge_markers_offset;
+        uint64_t arcs_offset;
+        uint64_t refinements_offset;
+        uint64_t markers_offset;
+        uint64_t file_size;
+      };
+
+      struct MeshBinaryArc
+      {
+        int p1;
+        int p2;
+        double angle;
+      };
+
+      MeshReaderH2DBinary() {}
+      virtual ~MeshReaderH2DBinary() {}
+
+      /// This method loads a single mesh from a file.
+      virtual void load(const char *filename, MeshSharedPtr mesh)
+      {
+        if (!mesh)
+          throw Exceptions::NullException(2);
+
+        MeshMappedFile file(filename);
+        this->load(file.data, file.size, mesh, filename);
+      }
+
+      /// This method loads a single mesh from a memory buffer in this format (see save(MeshSharedPtr, std::vector<char>&)).
+      /// \param[in] filename Name of the buffer in error messages.
+      void load(const char* data, size_t size, MeshSharedPtr mesh, const char *filename = "(memory)")
+      {
+        if (!mesh)
+          throw Exceptions::NullException(3);
+
+        const MeshBinaryHeader* header = this->check_header(data, size, filename);
+
+        const double2* vertices = (const double2*)(data + header->vertices_offset);
+        const int4* elements = (const int4*)(data + header->elements_offset);
+        const int* element_markers = (const int*)(data + header->element_markers_offset);
+        const int2* edges = (const int2*)(data + header->edges_offset);
+        const int* edge_markers = (const int*)(data + header->edge_markers_offset);
+        const MeshBinaryArc* arcs = (const MeshBinaryArc*)(data + header->arcs_offset);
+        const int2* refinements = (const int2*)(data + header->refinements_offset);
+
+        mesh->free();
+        int hash_size = HashTable::H2D_DEFAULT_HASH_SIZE;
+        while (hash_size < 4 * (int)header->num_vertices)
+          hash_size *= 2;
+        mesh->init(hash_size);
+
+        // Marker tables, the only strings in the file.
+        std::vector<int> element_internal_markers, boundary_internal_markers;
+        const char* marker_data = data + header->markers_offset;
+        for (unsigned int i = 0; i < header->num_element_markers + header->num_boundary_markers; i++)
+        {
+          unsigned int length;
+          if (marker_data + sizeof(unsigned int) > data + size)
+            throw Exceptions::MeshLoadFailureException("Mesh file %s: the marker table is truncated.", filename);
+          memcpy(&length, marker_data, sizeof(unsigned int));
+          marker_data += sizeof(unsigned int);
+          if (marker_data + length > data + size)
+            throw Exceptions::MeshLoadFailureException("Mesh file %s: the marker table is truncated.", filename);
+          std::string marker(marker_data, length);
+          marker_data += length;
+          if (i < header->num_element_markers)
+            element_internal_markers.push_back(mesh->element_markers_conversion.insert_marker(marker));
+          else
+            boundary_internal_markers.push_back(mesh->boundary_markers_conversion.insert_marker(marker));
+        }
+
+        // Vertices.
+        Array<Node>& nodes = mesh->get_nodes();
+        for (unsigned int vertex_i = 0; vertex_i < header->num_vertices; vertex_i++)
+        {
+          Node* node = nodes.add();
+          node->ref = TOP_LEVEL_REF;
+          node->type = HERMES_TYPE_VERTEX;
+          node->bnd = 0;
+          node->p1 = node->p2 = -1;
+          node->next_hash = nullptr;
+          node->x = vertices[vertex_i][0];
+          node->y = vertices[vertex_i][1];
+        }
+        mesh->ntopvert = header->num_vertices;
+
+        // Elements.
+        int num_vertices = header->num_vertices;
+        for (unsigned int element_i = 0; element_i < header->num_elements; element_i++)
+        {
+          const int* v = elements[element_i];
+          int nvert = v[3] == -1 ? 3 : 4;
+          for (int j = 0; j < nvert; j++)
+            if (v[j] < 0 || v[j] >= num_vertices)
+              throw Exceptions::MeshLoadFailureException("Mesh file %s: element #%d refers to the vertex %d, there are %d vertices.", filename, element_i, v[j], num_vertices);
+          if (element_markers[element_i] < 0 || element_markers[element_i] >= (int)header->num_element_markers)
+            throw Exceptions::MeshLoadFailureException("Mesh file %s: element #%d has the marker index %d out of range.", filename, element_i, element_markers[element_i]);
+
+          int marker = element_internal_markers[element_markers[element_i]];
+          if (nvert == 3)
+          {
+            Node *v0 = &nodes[v[0]], *v1 = &nodes[v[1]], *v2 = &nodes[v[2]];
+            Mesh::check_triangle(element_i, v0, v1, v2);
+            mesh->create_triangle(marker, v0, v1, v2, nullptr);
+          }
+          else
+          {
+            Node *v0 = &nodes[v[0]], *v1 = &nodes[v[1]], *v2 = &nodes[v[2]], *v3 = &nodes[v[3]];
+            Mesh::check_quad(element_i, v0, v1, v2, v3);
+            mesh->create_quad(marker, v0, v1, v2, v3, nullptr);
+          }
+        }
+        mesh->nbase = mesh->nactive = mesh->ninitial = header->num_elements;
+
+        // Edge markers.
+        for (unsigned int edge_i = 0; edge_i < header->num_edges; edge_i++)
+        {
+          int v1 = edges[edge_i][0], v2 = edges[edge_i][1];
+          Node* en = (v1 >= 0 && v1 < num_vertices && v2 >= 0 && v2 < num_vertices) ? mesh->peek_edge_node(v1, v2) : nullptr;
+          if (en == nullptr)
+            throw Exceptions::MeshLoadFailureException("Mesh file %s: edge #%d (%d-%d) does not exist.", filename, edge_i, v1, v2);
+          if (edge_markers[edge_i] < 0 || edge_markers[edge_i] >= (int)header->num_boundary_markers)
+            throw Exceptions::MeshLoadFailureException("Mesh file %s: edge #%d has the marker index %d out of range.", filename, edge_i, edge_markers[edge_i]);
+
+          int marker = boundary_internal_markers[edge_markers[edge_i]];
+          en->marker = marker;
+          // Negative markers are reserved for inner edges in DG.
+          if (marker > 0)
+          {
+            nodes[v1].bnd = 1;
+            nodes[v2].bnd = 1;
+            en->bnd = 1;
+          }
+        }
+
+        Node* en;
+        for_all_edge_nodes(en, mesh)
+          if (en->ref < 2 && en->marker == 0)
+            this->warn("Boundary edge node does not have a boundary marker.");
+
+        // Curves.
+        if (header->num_arcs > 0)
+        {
+          for (unsigned int arc_i = 0; arc_i < header->num_arcs; arc_i++)
+          {
+            Node* arc_en;
+            Arc* arc = MeshUtil::load_arc(mesh, arc_i, &arc_en, arcs[arc_i].p1, arcs[arc_i].p2, arcs[arc_i].angle);
+            MeshUtil::assign_curve(arc_en, arc, arcs[arc_i].p1, arcs[arc_i].p2);
+          }
+
+          Element* e;
+          for_all_used_elements(e, mesh)
+            if (e->cm != nullptr)
+              e->cm->update_refmap_coeffs(e);
+        }
+
+        mesh->seq = g_mesh_seq++;
+        mesh->initial_single_check();
+
+        // Refinements.
+        for (unsigned int refinement_i = 0; refinement_i < header->num_refinements; refinement_i++)
+        {
+          if (refinements[refinement_i][1] == -1)
+            mesh->unrefine_element_id(refinements[refinement_i][0]);
+          else
+            mesh->refine_element_id(refinements[refinement_i][0], refinements[refinement_i][1]);
+        }
+      }
+
+      /// This method saves a single mesh to a file.
+      /// The base mesh and the refinements are saved, as by the other mesh readers.
+      void save(const char *filename, MeshSharedPtr mesh)
+      {
+        std::vector<char> buffer;
+        this->save(mesh, buffer);
+
+        FILE* f = fopen(filename, "wb");
+        if (f == nullptr)
+          throw Exceptions::Exception("MeshReaderH2DBinary: could not open %s for writing.", filename);
+        bool failed = fwrite(buffer.data(), 1, buffer.size(), f) != buffer.size();
+        failed = fclose(f) != 0 || failed;
+        if (failed)
+          throw Exceptions::Exception("MeshReaderH2DBinary: writing %s failed.", filename);
+      }
+
+      /// This method saves a single mesh to a memory buffer, with the same contents as the file.
+      void save(MeshSharedPtr mesh, std::vector<char>& buffer)
+      {
+        if (!mesh)
+          throw Exceptions::NullException(1);
+
+        // Vertices (top-level vertex nodes have the ids 0, ..., ntopvert - 1).
+        std::vector<double> vertices(2 * mesh->ntopvert);
+        for (int vertex_i = 0; vertex_i < mesh->ntopvert; vertex_i++)
+        {
+          Node* node = mesh->get_node(vertex_i);
+          vertices[2 * vertex_i] = node->x;
+          vertices[2 * vertex_i + 1] = node->y;
+        }
+
+        std::vector<int> elements, element_markers, edges, edge_markers, refinements;
+        std::vector<MeshBinaryArc> arcs;
+        std::vector<std::string> element_marker_table, boundary_marker_table;
+        std::map<int, int> element_marker_indices, boundary_marker_indices;
+        std::set<int> edges_done, arcs_done;
+
+        Element* e;
+        for (int element_i = 0; element_i < mesh->get_num_base_elements(); element_i++)
+        {
+          e = mesh->get_element_fast(element_i);
+          if (!e->used)
+            throw Exceptions::Exception("MeshReaderH2DBinary: base element %d is not used, the element ids would not be preserved.", element_i);
+
+          for (int j = 0; j < 4; j++)
+            elements.push_back(j < e->get_nvert() ? e->vn[j]->id : -1);
+          element_markers.push_back(this->marker_index(element_marker_indices, element_marker_table, mesh->get_element_markers_conversion().get_user_marker(e->marker).marker, e->marker));
+
+          for (unsigned char j = 0; j < e->get_nvert(); j++)
+          {
+            Node* en = MeshUtil::get_base_edge_node(e, j);
+            int p1 = e->vn[j]->id, p2 = e->vn[e->next_vert(j)]->id;
+            if (en->marker != 0 && edges_done.insert(en->id).second)
+            {
+              edges.push_back(p1);
+              edges.push_back(p2);
+              edge_markers.push_back(this->marker_index(boundary_marker_indices, boundary_marker_table, mesh->get_boundary_markers_conversion().get_user_marker(en->marker).marker, en->marker));
+            }
+
+            if (e->cm != nullptr && e->cm->toplevel && e->cm->curves[j] != nullptr && arcs_done.insert(en->id).second)
+            {
+              if (e->cm->curves[j]->type != ArcType)
+                throw Exceptions::Exception("MeshReaderH2DBinary: only circular arcs are supported, element %d has a NURBS edge.", element_i);
+              MeshBinaryArc arc = { p1, p2, ((Arc*)e->cm->curves[j])->angle };
+              arcs.push_back(arc);
+            }
+          }
+        }
+
+        for (unsigned int i = 0; i < mesh->refinements.size(); i++)
+        {
+          refinements.push_back(mesh->refinements[i].first);
+          refinements.push_back(mesh->refinements[i].second);
+        }
+
+        std::vector<char> markers;
+        for (unsigned int i = 0; i < element_marker_table.size() + boundary_marker_table.size(); i++)
+        {
+          const std::string& marker = i < element_marker_table.size() ? element_marker_table[i] : boundary_marker_table[i - element_marker_table.size()];
+          unsigned int length = marker.length();
+          markers.insert(markers.end(), (const char*)&length, (const char*)&length + sizeof(unsigned int));
+          markers.insert(markers.end(), marker.begin(), marker.end());
+        }
+
+        MeshBinaryHeader header;
+        memset(&header, 0, sizeof(MeshBinaryHeader));
+        memcpy(header.magic, "H2DBMESH", 8);
+        header.version = version;
+        header.header_size = sizeof(MeshBinaryHeader);
+        header.num_vertices = mesh->ntopvert;
+        header.num_elements = element_markers.size();
+        header.num_edges = edge_markers.size();
+        header.num_arcs = arcs.size();
+        header.num_refinements = mesh->refinements.size();
+        header.num_element_markers = element_marker_table.size();
+        header.num_boundary_markers = boundary_marker_table.size();
+
+        uint64_t offset = this->align(sizeof(MeshBinaryHeader));
+        header.vertices_offset = offset;
+        offset = this->align(offset + vertices.size() * sizeof(double));
+        header.elements_offset = offset;
+        offset = this->align(offset + elements.size() * sizeof(int));
+        header.element_markers_offset = offset;
+        offset = this->align(offset + element_markers.size() * sizeof(int));
+        header.edges_offset = offset;
+        offset = this->align(offset + edges.size() * sizeof(int));
+        header.edge_markers_offset = offset;
+        offset = this->align(offset + edge_markers.size() * sizeof(int));
+        header.arcs_offset = offset;
+        offset = this->align(offset + arcs.size() * sizeof(MeshBinaryArc));
+        header.refinements_offset = offset;
+        offset = this->align(offset + refinements.size() * sizeof(int));
+        header.markers_offset = offset;
+        header.file_size = offset + markers.size();
+
+        buffer.assign(header.file_size, 0);
+        memcpy(buffer.data(), &header, sizeof(MeshBinaryHeader));
+        this->copy_array(buffer, header.vertices_offset, vertices.data(), vertices.size() * sizeof(double));
+        this->copy_array(buffer, header.elements_offset, elements.data(), elements.size() * sizeof(int));
+        this->copy_array(buffer, header.element_markers_offset, element_markers.data(), element_markers.size() * sizeof(int));
+        this->copy_array(buffer, header.edges_offset, edges.data(), edges.size() * sizeof(int));
+        this->copy_array(buffer, header.edge_markers_offset, edge_markers.data(), edge_markers.size() * sizeof(int));
+        this->copy_array(buffer, header.arcs_offset, arcs.data(), arcs.size() * sizeof(MeshBinaryArc));
+        this->copy_array(buffer, header.refinements_offset, refinements.data(), refinements.size() * sizeof(int));
+        this->copy_array(buffer, header.markers_offset, markers.data(), markers.size());
+      }
+
+      /// Converts a mesh file of another format (XML, BSON, H2D) to this one.
+      /// \param[in] reader The reader of the source format.
+      void convert(MeshReader& reader, const char *source_filename, const char *target_filename)
+      {
+        MeshSharedPtr mesh(new Mesh);
+        reader.load(source_filename, mesh);
+        this->save(target_filename, mesh);
+      }
+
+    protected:
+      const MeshBinaryHeader* check_header(const char* data, size_t size, const char *filename)
+      {
+        if (size < sizeof(MeshBinaryHeader))
+          throw Exceptions::MeshLoadFailureException("Mesh file %s is too short for the binary mesh format.", filename);
+        const MeshBinaryHeader* header = (const MeshBinaryHeader*)data;
+        if (memcmp(header->magic, "H2DBMESH", 8))
+          throw Exceptions::MeshLoadFailureException("Mesh file %s is not in the binary mesh format.", filename);
+        if (header->version == 0 || header->version > version)
+          throw Exceptions::MeshLoadFailureException("Mesh file %s has the version %u, the highest supported version is %u.", filename, header->version, version);
+        if (header->file_size > size)
+          throw Exceptions::MeshLoadFailureException("Mesh file %s is truncated (%llu bytes instead of %llu).", filename, (unsigned long long)size, (unsigned long long)header->file_size);
+
+        uint64_t ends[8][2] = {
+          { header->vertices_offset, header->num_vertices * (uint64_t)sizeof(double2) },
+          { header->elements_offset, header->num_elements * (uint64_t)sizeof(int4) },
+          { header->element_markers_offset, header->num_elements * (uint64_t)sizeof(int) },
+          { header->edges_offset, header->num_edges * (uint64_t)sizeof(int2) },
+          { header->edge_markers_offset, header->num_edges * (uint64_t)sizeof(int) },
+          { header->arcs_offset, header->num_arcs * (uint64_t)sizeof(MeshBinaryArc) },
+          { header->refinements_offset, header->num_refinements * (uint64_t)sizeof(int2) },
+          { header->markers_offset, 0 } };
+        for (int i = 0; i < 8; i++)
+          if (ends[i][0] % 8 || ends[i][0] < header->header_size || ends[i][0] + ends[i][1] > header->file_size)
+            throw Exceptions::MeshLoadFailureException("Mesh file %s is corrupt, array #%d is out of the file.", filename, i);
+        return header;
+      }
+
+      int marker_index(std::map<int, int>& indices, std::vector<std::string>& table, const std::string& user_marker, int internal_marker)
+      {
+        std::map<int, int>::iterator it = indices.find(internal_marker);
+        if (it != indices.end())
+          return it->second;
+        indices.insert(std::pair<int, int>(internal_marker, table.size()));
+        table.push_back(user_marker);
+        return table.size() - 1;
+      }
+
+      static uint64_t align(uint64_t offset)
+      {
+        return (offset + 7) & ~(uint64_t)7;
+      }
+
+      void copy_array(std::vector<char>& buffer, uint64_t offset, const void* data, size_t size)
+      {
+        if (size > 0)
+          memcpy(buffer.data() + offset, data, size);
+      }
+    };
+  }
+}
+#endif
@@ -0,0 +1,178 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __H2D_REFINEMENT_SMOOTHNESS_SELECTOR_H
+#define __H2D_REFINEMENT_SMOOTHNESS_SELECTOR_H
+
+#include "selector.h"
+#include "../space/space.h"
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    namespace RefinementSelectors
+    {
+      /// A selector that chooses between H- and P-refinement using a local smoothness indicator. \ingroup g_selectors
+      /** The selector does not need any reference solution. For the element being refined it takes the coefficients of
+      *  the (hierarchic) shape functions of the coarse solution, groups them by polynomial order and fits
+      *  the decay of their magnitude a_k ~ C exp(-sigma * k) over the highest orders.
+      *  A fast decay (sigma >= smoothness_threshold) indicates a locally smooth (analytic) solution, and the order
+      *  is increased, otherwise the element is split. Elements of order 1 do not carry any decay information
+      *  and are p-refined (unless the maximum order has been reached).
+      *  The coefficient vector has to be passed through set_coefficient_vector() before every adaptivity step,
+      *  the indices are the global DOF numbers, i.e. the vector as returned by the solver.
+      *  One instance serves one component (one space). */
+      template<typename Scalar>
+      class SmoothnessSelector : public Selector < Scalar >
+      {
+      public:
+        /// Constructor.
+        /** \param[in] space The (coarse) space of the component this selector serves.
+        *  \param[in] smoothness_threshold The decay rate above which the solution is considered smooth.
+        *  \param[in] max_order A maximum order used by this selector. If it is ::H2DRS_DEFAULT_ORDER, a maximum supported order is used. */
+        SmoothnessSelector(SpaceSharedPtr<Scalar> space, double smoothness_threshold = 1.0, int max_order = H2DRS_DEFAULT_ORDER)
+          : Selector<Scalar>(1, max_order), space(space), coeff_vec(nullptr), smoothness_threshold(smoothness_threshold)
+        {
+        }
+
+        /// Sets the coefficient vector of the solution whose elements are being refined.
+        void set_coefficient_vector(const Scalar* coeff_vec)
+        {
+          this->coeff_vec = coeff_vec;
+        }
+
+        /// Sets the space (after the space is replaced in the adaptivity loop).
+        void set_space(SpaceSharedPtr<Scalar> space)
+        {
+          this->space = space;
+        }
+
+        /// Returns the estimated decay rate of the coefficients on the element, see the class description.
+        /// std::numeric_limits<double>::max() is returned if the highest-order coefficients vanish, a negative value if there is not enough information.
+        double get_smoothness(Element* element)
+        {
+          if (!this->coeff_vec)
+            throw Exceptions::Exception("SmoothnessSelector: the coefficient vector has not been set.");
+
+          int order = this->space->get_element_order(element->id);
+          int max_order = std::max(H2D_GET_H_ORDER(order), H2D_GET_V_ORDER(order));
+          if (max_order < 2)
+            return -1.;
+
+          double energy[H2D_NUM_SHAPES_SIZE + 1];
+          int count[H2D_NUM_SHAPES_SIZE + 1];
+          memset(energy, 0, (H2D_NUM_SHAPES_SIZE + 1) * sizeof(double));
+          memset(count, 0, (H2D_NUM_SHAPES_SIZE + 1) * sizeof(int));
+
+          AsmList<Scalar> al;
+          this->space->get_element_assembly_list(element, &al);
+          Shapeset* shapeset = this->space->get_shapeset();
+          for (unsigned short i = 0; i < al.cnt; i++)
+          {
+            // Dirichlet lift.
+            if (al.dof[i] < 0)
+              continue;
+            int shape_order = shapeset->get_order(al.idx[i], element->get_mode());
+            int k = std::min<int>(std::max(H2D_GET_H_ORDER(shape_order), H2D_GET_V_ORDER(shape_order)), H2D_NUM_SHAPES_SIZE);
+            energy[k] += Hermes::sqr(al.coef[i] * this->coeff_vec[al.dof[i]]);
+            count[k]++;
+          }
+
+          double total_energy = 0.;
+          for (int k = 0; k <= H2D_NUM_SHAPES_SIZE; k++)
+            total_energy += energy[k];
+
+          // Least squares fit of log(a_k) = log(C) - sigma * k over (at most) three highest orders.
+          double sum_k = 0., sum_kk = 0., sum_log = 0., sum_k_log = 0.;
+          int points = 0;
+          for (int k = std::max(1, max_order - 2); k <= std::min(max_order, H2D_NUM_SHAPES_SIZE); k++)
+          {
+            if (!count[k])
+              continue;
+            double amplitude = std::sqrt(energy[k] / count[k]);
+            if (amplitude < Hermes::HermesSqrtEpsilon * std::sqrt(total_energy))
+            {
+              if (k == max_order)
+                return std::numeric_limits<double>::max();
+              continue;
+            }
+            double log_amplitude = std::log(amplitude);
+            sum_k += k;
+            sum_kk += k * k;
+            sum_log += log_amplitude;
+            sum_k_log += k * log_amplitude;
+            points++;
+          }
+          if (points < 2)
+            return -1.;
+
+          double denominator = points * sum_kk - sum_k * sum_k;
+          return -(points * sum_k_log - sum_k * sum_log) / denominator;
+        }
+
+      protected:
+        /// Selects a refinement.
+        /** Selects either a P-refinement (increase of both directional orders by one) or an H-refinement keeping the orders,
+        *  see the class description. For details, see Selector::select_refinement.
+        *  There is no reference solution, the passed one is not used. */
+        virtual bool select_refinement(Element* element, int quad_order, MeshFunction<Scalar>*, ElementToRefine& refinement)
+        {
+          int max_allowed_order = this->max_order;
+          if (this->max_order == H2DRS_DEFAULT_ORDER)
+            max_allowed_order = H2DRS_MAX_ORDER;
+
+          int order_h = H2D_GET_H_ORDER(quad_order), order_v = H2D_GET_V_ORDER(quad_order);
+          if (element->is_triangle())
+            order_v = order_h;
+
+          double smoothness = this->get_smoothness(element);
+          bool p_refinement = (smoothness < 0. || smoothness >= this->smoothness_threshold);
+          if (std::max(order_h, order_v) >= max_allowed_order)
+            p_refinement = false;
+
+          if (p_refinement)
+          {
+            refinement.split = H2D_REFINEMENT_P;
+            if (element->is_triangle())
+              refinement.refinement_polynomial_order[0] = order_h + 1;
+            else
+              refinement.refinement_polynomial_order[0] = H2D_MAKE_QUAD_ORDER(order_h + 1, order_v + 1);
+            refinement.refinement_polynomial_order[1] = refinement.refinement_polynomial_order[2] = refinement.refinement_polynomial_order[3] = 0;
+          }
+          else
+          {
+            refinement.split = H2D_REFINEMENT_H;
+            for (int i = 0; i < H2D_MAX_ELEMENT_SONS; i++)
+              refinement.refinement_polynomial_order[i] = quad_order;
+          }
+          ElementToRefine::copy_orders(refinement.best_refinement_polynomial_order_type[refinement.split], refinement.refinement_polynomial_order);
+
+          return true;
+        }
+
+        /// The space of the component.
+        SpaceSharedPtr<Scalar> space;
+        /// The coefficient vector (not owned).
+        const Scalar* coeff_vec;
+        /// See the class description.
+        double smoothness_threshold;
+
+        template<typename T> friend class Adapt;
+      };
+    }
+  }
+}
+#endif
@@ -0,0 +1,194 @@
+// This file is part of Hermes2D
+//
+// Copyright (c) 2009 hp-FEM group at the University of Nevada, Reno (UNR).
+// Email: hpfem-group@unr.edu, home page: http://www.hpfem.org/.
+//
+// Hermes2D is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published
+// by the Free Software Foundation; either version 2 of the License,
+// or (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+/*! \file inexact_newton_solver.h
+\brief Inexact Newton's method with adaptive linear tolerances.
+*/
+#ifndef __H2D_SOLVER_INEXACT_NEWTON_H_
+#define __H2D_SOLVER_INEXACT_NEWTON_H_
+
+#include "newton_solver.h"
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    /// Inexact Newton's method.<br>
+    /// The linear system of each Newton step is solved only to the relative tolerance eta_k (the forcing term),
+    /// chosen by the Eisenstat-Walker formula (choice 2) from the residual norms of the current and the previous step:<br>
+    /// eta_k = gamma * (||F_k|| / ||F_k-1||)^alpha,<br>
+    /// safeguarded against a too fast decrease (eta_k >= gamma * eta_k-1^alpha whenever gamma * eta_k-1^alpha > 0.1),
+    /// against oversolving close to the solution (eta_k >= 0.5 * tol / ||F_k|| for the ResidualNormAbsolute tolerance), and bounded
+    /// by [eta_min, eta_max]. The first step uses eta_0.<br>
+    /// The tolerance is set to the linear matrix solver if it is an iterative one (LoopSolver), direct solvers are not affected.<br>
+    /// The numbers of linear iterations of all Newton steps are available through the output parameter linear_iterations().<br>
+    /// Typical usage:<br>
+    /// Hermes::Hermes2D::InexactNewtonSolver<double> newton_solver(wf, space);<br>
+    /// newton_solver.set_forcing_term_parameters(0.5, 0.9, 2.0);<br>
+    /// newton_solver.solve();<br>
+    template<typename Scalar>
+    class InexactNewtonSolver : public NewtonSolver < Scalar >
+    {
+    public:
+      InexactNewtonSolver() : NewtonSolver<Scalar>()
+      {
+        this->init_inexact_newton();
+      }
+      InexactNewtonSolver(DiscreteProblem<Scalar>* dp) : NewtonSolver<Scalar>(dp)
+      {
+        this->init_inexact_newton();
+      }
+      InexactNewtonSolver(WeakFormSharedPtr<Scalar> wf, SpaceSharedPtr<Scalar> space) : NewtonSolver<Scalar>(wf, space)
+      {
+        this->init_inexact_newton();
+      }
+      InexactNewtonSolver(WeakFormSharedPtr<Scalar> wf, std::vector<SpaceSharedPtr<Scalar> > spaces) : NewtonSolver<Scalar>(wf, spaces)
+      {
+        this->init_inexact_newton();
+      }
+
+      /// Turn the adaptive linear tolerances on / off.
+      /// Default: on.
+      void set_adaptive_linear_tolerance(bool to_set = true)
+      {
+        this->adaptive_linear_tolerance = to_set;
+      }
+
+      /// Set the Eisenstat-Walker parameters.
+      /// Default: 0.5, 0.9, 2.0.
+      /// \param[in] eta_0 The forcing term of the first step.
+      /// \param[in] gamma In (0, 1].
+      /// \param[in] alpha In (1, 2].
+      void set_forcing_term_parameters(double eta_0, double gamma, double alpha)
+      {
+        if (gamma <= 0. || gamma > 1.)
+          throw Exceptions::ValueException("gamma", gamma, 0., 1.);
+        if (alpha <= 1. || alpha > 2.)
+          throw Exceptions::ValueException("alpha", alpha, 1., 2.);
+        this->eta_0 = eta_0;
+        this->gamma = gamma;
+        this->alpha = alpha;
+      }
+
+      /// Set the bounds of the forcing term.
+      /// Default: 1e-10, 0.9.
+      void set_forcing_term_bounds(double eta_min, double eta_max)
+      {
+        if (eta_max <= 0. || eta_max >= 1.)
+          throw Exceptions::ValueException("eta_max", eta_max, 0., 1.);
+        if (eta_min <= 0. || eta_min > eta_max)
+          throw Exceptions::ValueException("eta_min", eta_min, 0., eta_max);
+        this->eta_min = eta_min;
+        this->eta_max = eta_max;
+      }
+
+      /// Forcing terms of the last solve(), per Newton step.
+      const std::vector<double>& get_forcing_terms() const
+      {
+        return this->forcing_terms;
+      }
+
+      /// Linear iterations of the last solve(), per Newton step.
+      const std::vector<unsigned int>& get_linear_iterations() const
+      {
+        return this->linear_iterations_value;
+      }
+
+      virtual void init_solving(Scalar* coeff_vec)
+      {
+        NewtonSolver<Scalar>::init_solving(coeff_vec);
+        this->forcing_terms.clear();
+        this->linear_iterations_value.clear();
+        this->set_parameter_value(this->p_linear_iterations, &this->linear_iterations_value);
+      }
+
+      inline std::string getClassName() const { return "InexactNewtonSolver"; }
+
+    protected:
+      void init_inexact_newton()
+      {
+        this->adaptive_linear_tolerance = true;
+        this->eta_0 = 0.5;
+        this->gamma = 0.9;
+        this->alpha = 2.0;
+        this->eta_min = 1e-10;
+        this->eta_max = 0.9;
+      }
+
+      /// Calculates the forcing term of the current step and stores it in forcing_terms.
+      double update_forcing_term()
+      {
+        const std::vector<double>& residual_norms = this->get_parameter_value(this->residual_norms());
+        double eta = this->eta_0;
+        if (!this->forcing_terms.empty() && residual_norms.size() > 1)
+        {
+          double residual_norm = residual_norms[residual_norms.size() - 1];
+          double previous_residual_norm = residual_norms[residual_norms.size() - 2];
+          double eta_previous = this->forcing_terms.back();
+          eta = this->gamma * std::pow(residual_norm / previous_residual_norm, this->alpha);
+
+          double safeguard = this->gamma * std::pow(eta_previous, this->alpha);
+          if (safeguard > 0.1)
+            eta = std::max(eta, safeguard);
+          eta = std::min(eta, this->eta_max);
+
+          // ResidualNormAbsolute.
+          if (this->tolerance_set[3] && residual_norm > 0.)
+            eta = std::max(eta, 0.5 * this->tolerance[3] / residual_norm);
+        }
+        eta = std::max(std::min(eta, this->eta_max), this->eta_min);
+        this->forcing_terms.push_back(eta);
+        return eta;
+      }
+
+      virtual void solve_linear_system()
+      {
+        LoopSolver<Scalar>* loop_solver = dynamic_cast<LoopSolver<Scalar>*>(this->linear_matrix_solver);
+        if (this->adaptive_linear_tolerance && loop_solver)
+        {
+          double eta = this->update_forcing_term();
+          loop_solver->set_tolerance(eta, RelativeTolerance);
+          this->info("\tInexactNewtonSolver: linear tolerance %g.", eta);
+        }
+
+        NewtonSolver<Scalar>::solve_linear_system();
+
+        if (loop_solver)
+        {
+          this->linear_iterations_value.push_back(loop_solver->get_num_iters());
+          this->info("\tInexactNewtonSolver: %i linear iterations.", loop_solver->get_num_iters());
+        }
+      }
+
+      /// Adaptive tolerances.
+      bool adaptive_linear_tolerance;
+      double eta_0;
+      double gamma;
+      double alpha;
+      double eta_min;
+      double eta_max;
+      std::vector<double> forcing_terms;
+
+      /// For derived classes - read-only access.
+      const OutputParameterUnsignedIntVector& linear_iterations() const { return this->p_linear_iterations; };
+      OutputParameterUnsignedIntVector p_linear_iterations;
+      std::vector<unsigned int> linear_iterations_value;
+    };
+  }
+}
+#endif
@@ -514,6 +514,18 @@ namespace Hermes
       friend class DiscreteProblemThreadAssembler < Scalar > ;
       friend class DiscreteProblemIntegrationOrderCalculator < Scalar > ;
     };
+
+    /// \brief Returns the numbers of basis functions of the spaces, i.e. the sizes of the blocks (fields) of the matrices assembled
+    /// on these spaces, as the DOFs are assigned space by space (see Space::assign_dofs()).
+    /// Used e.g. for BlockParalutionLinearMatrixSolver.
+    template<typename Scalar>
+    std::vector<int> get_block_sizes(std::vector<SpaceSharedPtr<Scalar> > spaces)
+    {
+      std::vector<int> block_sizes;
+      for (unsigned int i = 0; i < spaces.size(); i++)
+        block_sizes.push_back(spaces[i]->get_num_dofs());
+      return block_sizes;
+    }
   }
 }
 #endif
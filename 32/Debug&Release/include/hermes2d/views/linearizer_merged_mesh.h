@@ -0,0 +1,291 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __H2D_LINEARIZER_MERGED_MESH_H
+#define __H2D_LINEARIZER_MERGED_MESH_H
+
+#include "linearizer.h"
+#include <algorithm>
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    namespace Views
+    {
+      /// \brief Single compact indexed triangle mesh merged from the per-thread data of a LinearizerMultidimensional.
+      ///
+      /// Every thread of the linearizer has its own vertex hash, so the vertices on the boundaries between the states processed
+      /// by different threads are duplicated. merge() copies the data once (under lock_data()), and then in parallel:<br>
+      /// - hashes the vertices and distributes them to buckets,<br>
+      /// - finds the duplicates in each bucket - vertices equal in the coordinates and all the values, so that the double vertices
+      /// of discontinuous solutions stay separate,<br>
+      /// - compacts the vertices and renumbers the triangles,<br>
+      /// - calculates the min / max value as a reduction over the compacted vertices (magnitude for vector data).<br>
+      /// The result does not depend on the number of threads, and it is owned by this instance,
+      /// so that its consumers need no locking of the linearizer.
+      /// The linearizer has to be created with the FileExport output type (vertices and triangle indices).
+      template<typename LinearizerDataDimensions>
+      class LinearizerMergedMesh : public Hermes::Mixins::Loggable
+      {
+      public:
+        typedef typename LinearizerDataDimensions::vertex_t vertex_t;
+
+        LinearizerMergedMesh() : duplicate_count(0), min_value(0.), max_value(0.)
+        {
+        }
+
+        /// Merges the data of a processed linearizer.
+        void merge(const LinearizerMultidimensional<LinearizerDataDimensions>& linearizer)
+        {
+          std::vector<double> raw_vertices;
+          this->copy(linearizer, raw_vertices);
+
+          int raw_vertex_count = raw_vertices.size() / stride;
+          int num_threads_used = std::max<int>(1, HermesCommonApi.get_integral_param_value(numThreads));
+          // Chunks of the vertex array - the unit of the parallel loops, independent of the threads.
+          int chunk_count = std::max<int>(1, std::min<int>(raw_vertex_count / 4096, 16 * num_threads_used));
+          int bucket_count = 4 * chunk_count;
+
+          // 1. Hashes and bucket histograms.
+          std::vector<unsigned int> hashes(raw_vertex_count);
+          std::vector<int> bucket_counts(chunk_count * bucket_count, 0);
+#pragma omp parallel for num_threads(num_threads_used)
+          for (int chunk = 0; chunk < chunk_count; chunk++)
+          {
+            for (int i = chunk_begin(chunk, chunk_count, raw_vertex_count); i < chunk_begin(chunk + 1, chunk_count, raw_vertex_count); i++)
+            {
+              hashes[i] = hash(&raw_vertices[i * stride]);
+              bucket_counts[chunk * bucket_count + hashes[i] % bucket_count]++;
+            }
+          }
+
+          // 2. Scatter to buckets, in the order of the vertices within each bucket.
+          std::vector<int> bucket_starts(bucket_count + 1, 0);
+          std::vector<int> scatter_offsets(chunk_count * bucket_count);
+          for (int bucket = 0, offset = 0; bucket < bucket_count; bucket++)
+          {
+            bucket_starts[bucket] = offset;
+            for (int chunk = 0; chunk < chunk_count; chunk++)
+            {
+              scatter_offsets[chunk * bucket_count + bucket] = offset;
+              offset += bucket_counts[chunk * bucket_count + bucket];
+            }
+          }
+          bucket_starts[bucket_count] = raw_vertex_count;
+
+          std::vector<int> bucketed(raw_vertex_count);
+#pragma omp parallel for num_threads(num_threads_used)
+          for (int chunk = 0; chunk < chunk_count; chunk++)
+          {
+            int* offsets = &scatter_offsets[chunk * bucket_count];
+            for (int i = chunk_begin(chunk, chunk_count, raw_vertex_count); i < chunk_begin(chunk + 1, chunk_count, raw_vertex_count); i++)
+              bucketed[offsets[hashes[i] % bucket_count]++] = i;
+          }
+
+          // 3. Duplicates - every vertex points to the first one equal to it.
+          std::vector<int> representatives(raw_vertex_count);
+#pragma omp parallel for num_threads(num_threads_used) schedule(dynamic)
+          for (int bucket = 0; bucket < bucket_count; bucket++)
+          {
+            int* begin = bucketed.data() + bucket_starts[bucket];
+            int* end = bucketed.data() + bucket_starts[bucket + 1];
+            std::stable_sort(begin, end, [&hashes](int a, int b) { return hashes[a] < hashes[b]; });
+            for (int* run = begin; run < end;)
+            {
+              int* run_end = run;
+              while (run_end < end && hashes[*run_end] == hashes[*run])
+                run_end++;
+              for (int* i = run; i < run_end; i++)
+              {
+                representatives[*i] = *i;
+                for (int* j = run; j < i; j++)
+                {
+                  if (representatives[*j] == *j && equal(&raw_vertices[*i * stride], &raw_vertices[*j * stride]))
+                  {
+                    representatives[*i] = *j;
+                    break;
+                  }
+                }
+              }
+              run = run_end;
+            }
+          }
+
+          // 4. Compaction - new indices by a prefix sum over the chunks.
+          std::vector<int> chunk_unique_counts(chunk_count + 1, 0);
+#pragma omp parallel for num_threads(num_threads_used)
+          for (int chunk = 0; chunk < chunk_count; chunk++)
+          {
+            for (int i = chunk_begin(chunk, chunk_count, raw_vertex_count); i < chunk_begin(chunk + 1, chunk_count, raw_vertex_count); i++)
+            {
+              if (representatives[i] == i)
+                chunk_unique_counts[chunk + 1]++;
+            }
+          }
+          for (int chunk = 0; chunk < chunk_count; chunk++)
+            chunk_unique_counts[chunk + 1] += chunk_unique_counts[chunk];
+
+          int vertex_count = chunk_unique_counts[chunk_count];
+          this->duplicate_count = raw_vertex_count - vertex_count;
+          this->vertices.resize(vertex_count * stride);
+          std::vector<int> new_indices(raw_vertex_count);
+#pragma omp parallel for num_threads(num_threads_used)
+          for (int chunk = 0; chunk < chunk_count; chunk++)
+          {
+            int new_index = chunk_unique_counts[chunk];
+            for (int i = chunk_begin(chunk, chunk_count, raw_vertex_count); i < chunk_begin(chunk + 1, chunk_count, raw_vertex_count); i++)
+            {
+              if (representatives[i] == i)
+              {
+                std::copy(&raw_vertices[i * stride], &raw_vertices[i * stride] + stride, &this->vertices[new_index * stride]);
+                new_indices[i] = new_index++;
+              }
+            }
+          }
+          // Representatives precede their duplicates, but may be in other chunks - a separate pass.
+#pragma omp parallel for num_threads(num_threads_used)
+          for (int i = 0; i < raw_vertex_count; i++)
+          {
+            if (representatives[i] != i)
+              new_indices[i] = new_indices[representatives[i]];
+          }
+
+          // 5. Triangles.
+          int triangle_count = this->triangles.size() / 3;
+#pragma omp parallel for num_threads(num_threads_used)
+          for (int i = 0; i < triangle_count * 3; i++)
+            this->triangles[i] = new_indices[this->triangles[i]];
+
+          // 6. Min / max - a reduction over the chunks.
+          this->min_value = std::numeric_limits<double>::max();
+          this->max_value = -std::numeric_limits<double>::max();
+          std::vector<double> chunk_min(chunk_count, std::numeric_limits<double>::max());
+          std::vector<double> chunk_max(chunk_count, -std::numeric_limits<double>::max());
+#pragma omp parallel for num_threads(num_threads_used)
+          for (int chunk = 0; chunk < chunk_count; chunk++)
+          {
+            for (int i = chunk_begin(chunk, chunk_count, vertex_count); i < chunk_begin(chunk + 1, chunk_count, vertex_count); i++)
+            {
+              double value = this->value(i);
+              chunk_min[chunk] = std::min(chunk_min[chunk], value);
+              chunk_max[chunk] = std::max(chunk_max[chunk], value);
+            }
+          }
+          for (int chunk = 0; chunk < chunk_count; chunk++)
+          {
+            this->min_value = std::min(this->min_value, chunk_min[chunk]);
+            this->max_value = std::max(this->max_value, chunk_max[chunk]);
+          }
+          if (vertex_count == 0)
+            this->min_value = this->max_value = 0.;
+
+          this->info("LinearizerMergedMesh: %i vertices (%i duplicates removed), %i triangles.", vertex_count, this->duplicate_count, triangle_count);
+        }
+
+        /// Vertices: (x, y, value) for scalars, (x, y, value_x, value_y) for vectors.
+        const vertex_t* get_vertices() const { return (const vertex_t*)this->vertices.data(); }
+        int get_vertex_count() const { return this->vertices.size() / stride; }
+        /// Triangles as indices into get_vertices().
+        const triangle_indices_t* get_triangles() const { return (const triangle_indices_t*)this->triangles.data(); }
+        int get_triangle_count() const { return this->triangles.size() / 3; }
+        /// Triangle markers, ordering equal to get_triangles().
+        const int* get_triangle_markers() const { return this->triangle_markers.data(); }
+
+        /// Number of the vertices removed as duplicates by the last merge().
+        int get_duplicate_count() const { return this->duplicate_count; }
+
+        double get_min_value() const { return this->min_value; }
+        double get_max_value() const { return this->max_value; }
+
+        inline std::string getClassName() const { return "LinearizerMergedMesh"; }
+
+      protected:
+        typedef typename LinearizerMultidimensional<LinearizerDataDimensions>::template Iterator<vertex_t> VertexIterator;
+        typedef typename LinearizerMultidimensional<LinearizerDataDimensions>::template Iterator<triangle_indices_t> TriangleIterator;
+
+        /// Doubles per vertex.
+        static const int stride = LinearizerDataDimensions::dimension + 2;
+
+        /// The only part under the lock of the linearizer.
+        void copy(const LinearizerMultidimensional<LinearizerDataDimensions>& linearizer, std::vector<double>& raw_vertices)
+        {
+          linearizer.lock_data();
+          raw_vertices.resize(linearizer.get_vertex_count() * stride);
+          this->triangles.resize(linearizer.get_triangle_index_count() * 3);
+          this->triangle_markers.resize(linearizer.get_triangle_index_count());
+
+          double* vertex = raw_vertices.data();
+          for (VertexIterator it = linearizer.vertices_begin(); !it.end; ++it, vertex += stride)
+            std::copy(it.get(), it.get() + stride, vertex);
+
+          // The indices given by the iterator are global (the same ones the legacy VTK output writes).
+          int* triangle = this->triangles.data();
+          int* marker = this->triangle_markers.data();
+          for (TriangleIterator it = linearizer.triangle_indices_begin(); !it.end; ++it, triangle += 3)
+          {
+            std::copy(it.get(), it.get() + 3, triangle);
+            *marker++ = it.get_marker();
+          }
+          linearizer.unlock_data();
+        }
+
+        static int chunk_begin(int chunk, int chunk_count, int size)
+        {
+          return (int)((long long)size * chunk / chunk_count);
+        }
+
+        /// FNV-1a of the bytes, with -0.0 taken as 0.0 (equal values have equal hashes).
+        static unsigned int hash(const double* vertex)
+        {
+          unsigned int hash = 2166136261u;
+          for (int i = 0; i < stride; i++)
+          {
+            double value = vertex[i] == 0. ? 0. : vertex[i];
+            const unsigned char* bytes = (const unsigned char*)&value;
+            for (unsigned int j = 0; j < sizeof(double); j++)
+              hash = (hash ^ bytes[j]) * 16777619u;
+          }
+          return hash;
+        }
+
+        static bool equal(const double* a, const double* b)
+        {
+          for (int i = 0; i < stride; i++)
+          {
+            if (a[i] != b[i])
+              return false;
+          }
+          return true;
+        }
+
+        double value(int i) const
+        {
+          const double* vertex = &this->vertices[i * stride];
+          if (LinearizerDataDimensions::dimension == 1)
+            return vertex[2];
+          return std::sqrt(vertex[2] * vertex[2] + vertex[stride - 1] * vertex[stride - 1]);
+        }
+
+        std::vector<double> vertices;
+        std::vector<int> triangles;
+        std::vector<int> triangle_markers;
+        int duplicate_count;
+        double min_value, max_value;
+      };
+    }
+  }
+}
+#endif
@@ -0,0 +1,371 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __H2D_LINEARIZER_VTU_H
+#define __H2D_LINEARIZER_VTU_H
+
+#include "linearizer.h"
+#include <zlib.h>
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    namespace Views
+    {
+      /// \brief Binary VTU (VTK XML unstructured grid) output of a LinearizerMultidimensional (link with zlib.lib).
+      ///
+      /// Unlike save_solution_vtk() (legacy ASCII), the data is written as raw binary appended data,
+      /// optionally compressed by zlib (vtkZLibDataCompressor) block by block.
+      /// The data is read by the iterators of the linearizer, i.e. directly from the buffers of its threads,
+      /// and written through a buffer of one block - nothing of the size of the output is allocated.<br>
+      /// Output: points (x, y, and the value in the 3D mode for scalars), triangles, point data (the value, or the vector padded by zero),
+      /// cell data (triangle markers).<br>
+      /// The linearizer has to be created with the FileExport output type.
+      template<typename LinearizerDataDimensions>
+      class LinearizerVTUWriter : public Hermes::Mixins::Loggable
+      {
+      public:
+        /// Constructor.
+        /// \param[in] compress Compress the data by zlib.
+        /// \param[in] mode_3D For scalars, the value is used as the z-coordinate.
+        /// \param[in] block_size Size of the blocks (the buffer, and the compression unit).
+        LinearizerVTUWriter(bool compress = false, bool mode_3D = false, unsigned int block_size = 1 << 20) : compress(compress), mode_3D(mode_3D), block_size(block_size), file(nullptr)
+        {
+        }
+
+        /// Save the data of a processed linearizer.
+        void save(const LinearizerMultidimensional<LinearizerDataDimensions>& linearizer, const char* filename, const char* quantity_name)
+        {
+          this->file = fopen(filename, "wb");
+          if (this->file == nullptr)
+            throw Exceptions::Exception("LinearizerVTUWriter: could not open %s for writing.", filename);
+
+          linearizer.lock_data();
+          try
+          {
+            this->write(linearizer, quantity_name);
+          }
+          catch (std::exception&)
+          {
+            linearizer.unlock_data();
+            fclose(this->file);
+            this->file = nullptr;
+            throw;
+          }
+          linearizer.unlock_data();
+
+          bool failed = ferror(this->file) != 0;
+          if (fclose(this->file) != 0 || failed)
+          {
+            this->file = nullptr;
+            throw Exceptions::Exception("LinearizerVTUWriter: writing %s failed.", filename);
+          }
+          this->file = nullptr;
+        }
+
+        /// Process and save one MeshFunction (Solution, Filter).
+        /// Scalar linearizers only.
+        void save_solution(MeshFunctionSharedPtr<double> sln, const char* filename, const char* quantity_name, int item = H2D_FN_VAL_0)
+        {
+          LinearizerMultidimensional<LinearizerDataDimensions> linearizer(FileExport);
+          linearizer.process_solution(sln, item);
+          this->save(linearizer, filename, quantity_name);
+        }
+
+        inline std::string getClassName() const { return "LinearizerVTUWriter"; }
+
+      protected:
+        typedef typename LinearizerDataDimensions::vertex_t vertex_t;
+        typedef typename LinearizerMultidimensional<LinearizerDataDimensions>::template Iterator<vertex_t> VertexIterator;
+        typedef typename LinearizerMultidimensional<LinearizerDataDimensions>::template Iterator<triangle_indices_t> TriangleIterator;
+
+        /// The appended arrays.
+        enum Array
+        {
+          ArrayValues,
+          ArrayMarkers,
+          ArrayPoints,
+          ArrayConnectivity,
+          ArrayOffsets,
+          ArrayTypes,
+          ArrayCount
+        };
+
+        void write(const LinearizerMultidimensional<LinearizerDataDimensions>& linearizer, const char* quantity_name)
+        {
+          int vertex_count = linearizer.get_vertex_count();
+          int triangle_count = linearizer.get_triangle_index_count();
+          int value_components = LinearizerDataDimensions::dimension == 1 ? 1 : 3;
+
+          // XML part - the offsets are not known (compression) and are written as placeholders of a fixed width.
+          fprintf(this->file, "<?xml version=\"1.0\"?>\n");
+          fprintf(this->file, "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" byte_order=\"%s\" header_type=\"UInt64\"%s>\n",
+            little_endian() ? "LittleEndian" : "BigEndian", this->compress ? " compressor=\"vtkZLibDataCompressor\"" : "");
+          fprintf(this->file, "  <UnstructuredGrid>\n");
+          fprintf(this->file, "    <Piece NumberOfPoints=\"%i\" NumberOfCells=\"%i\">\n", vertex_count, triangle_count);
+          fprintf(this->file, "      <PointData %s=\"%s\">\n", value_components == 1 ? "Scalars" : "Vectors", quantity_name);
+          this->write_array_element("Float64", quantity_name, value_components, ArrayValues);
+          fprintf(this->file, "      </PointData>\n");
+          fprintf(this->file, "      <CellData Scalars=\"marker\">\n");
+          this->write_array_element("Int32", "marker", 1, ArrayMarkers);
+          fprintf(this->file, "      </CellData>\n");
+          fprintf(this->file, "      <Points>\n");
+          this->write_array_element("Float64", "Points", 3, ArrayPoints);
+          fprintf(this->file, "      </Points>\n");
+          fprintf(this->file, "      <Cells>\n");
+          this->write_array_element("Int32", "connectivity", 1, ArrayConnectivity);
+          this->write_array_element("Int32", "offsets", 1, ArrayOffsets);
+          this->write_array_element("UInt8", "types", 1, ArrayTypes);
+          fprintf(this->file, "      </Cells>\n");
+          fprintf(this->file, "    </Piece>\n");
+          fprintf(this->file, "  </UnstructuredGrid>\n");
+          fprintf(this->file, "  <AppendedData encoding=\"raw\">\n_");
+          this->appended_start = tell(this->file);
+
+          // Appended data.
+          this->begin_array(ArrayValues, (unsigned long long)vertex_count * value_components * sizeof(double));
+          for (VertexIterator it = linearizer.vertices_begin(); !it.end; ++it)
+          {
+            vertex_t& vertex = it.get();
+            if (value_components == 1)
+              this->append((double)vertex[2]);
+            else
+            {
+              this->append((double)vertex[2]);
+              this->append((double)vertex[LinearizerDataDimensions::dimension + 1]);
+              this->append(0.);
+            }
+          }
+          this->end_array();
+
+          this->begin_array(ArrayMarkers, (unsigned long long)triangle_count * sizeof(int));
+          for (TriangleIterator it = linearizer.triangle_indices_begin(); !it.end; ++it)
+            this->append(it.get_marker());
+          this->end_array();
+
+          this->begin_array(ArrayPoints, (unsigned long long)vertex_count * 3 * sizeof(double));
+          for (VertexIterator it = linearizer.vertices_begin(); !it.end; ++it)
+          {
+            vertex_t& vertex = it.get();
+            this->append((double)vertex[0]);
+            this->append((double)vertex[1]);
+            this->append(this->mode_3D && LinearizerDataDimensions::dimension == 1 ? (double)vertex[2] : 0.);
+          }
+          this->end_array();
+
+          // The indices given by the iterator are global (the same ones the legacy VTK output writes).
+          this->begin_array(ArrayConnectivity, (unsigned long long)triangle_count * 3 * sizeof(int));
+          for (TriangleIterator it = linearizer.triangle_indices_begin(); !it.end; ++it)
+          {
+            triangle_indices_t& triangle = it.get();
+            this->append(triangle[0]);
+            this->append(triangle[1]);
+            this->append(triangle[2]);
+          }
+          this->end_array();
+
+          this->begin_array(ArrayOffsets, (unsigned long long)triangle_count * sizeof(int));
+          for (int i = 1; i <= triangle_count; i++)
+            this->append(3 * i);
+          this->end_array();
+
+          // VTK_TRIANGLE
+          this->begin_array(ArrayTypes, (unsigned long long)triangle_count);
+          for (int i = 0; i < triangle_count; i++)
+            this->append((unsigned char)5);
+          this->end_array();
+
+          fprintf(this->file, "\n  </AppendedData>\n</VTKFile>\n");
+
+          // Offsets of the arrays.
+          long long end = tell(this->file);
+          for (int i = 0; i < ArrayCount; i++)
+          {
+            seek(this->file, this->offset_positions[i]);
+            fprintf(this->file, "%020llu", this->array_offsets[i]);
+          }
+          seek(this->file, end);
+        }
+
+        void write_array_element(const char* type, const char* name, int components, Array array)
+        {
+          fprintf(this->file, "        <DataArray type=\"%s\" Name=\"%s\" NumberOfComponents=\"%i\" format=\"appended\" offset=\"", type, name, components);
+          this->offset_positions[array] = tell(this->file);
+          fprintf(this->file, "%020llu\"/>\n", 0ULL);
+        }
+
+        /// Starts an appended array of the given (uncompressed) size in bytes.
+        void begin_array(Array array, unsigned long long size)
+        {
+          this->array_start = tell(this->file);
+          this->array_offsets[array] = this->array_start - this->appended_start;
+          this->array_size = size;
+          this->buffer.clear();
+          this->buffer.reserve(this->block_size);
+          this->compressed_sizes.clear();
+
+          if (this->compress)
+          {
+            // Placeholder of the header: number of blocks, block size, size of the last block, compressed sizes.
+            unsigned long long blocks = (size + this->block_size - 1) / this->block_size;
+            std::vector<unsigned long long> header(3 + blocks, 0);
+            this->write_raw(header.data(), header.size() * sizeof(unsigned long long));
+          }
+          else
+            this->write_raw(&size, sizeof(unsigned long long));
+        }
+
+        template<typename T>
+        void append(T value)
+        {
+          const char* bytes = (const char*)&value;
+          this->buffer.insert(this->buffer.end(), bytes, bytes + sizeof(T));
+          if (this->buffer.size() >= this->block_size)
+            this->write_block();
+        }
+
+        void write_block()
+        {
+          if (this->buffer.empty())
+            return;
+          size_t size = std::min<size_t>(this->buffer.size(), this->block_size);
+          if (this->compress)
+          {
+            uLongf compressed_size = compressBound((uLong)size);
+            this->compressed.resize(compressed_size);
+            if (compress2((Bytef*)this->compressed.data(), &compressed_size, (const Bytef*)this->buffer.data(), (uLong)size, Z_DEFAULT_COMPRESSION) != Z_OK)
+              throw Exceptions::Exception("LinearizerVTUWriter: zlib compression failed.");
+            this->write_raw(this->compressed.data(), compressed_size);
+            this->compressed_sizes.push_back(compressed_size);
+          }
+          else
+            this->write_raw(this->buffer.data(), size);
+          this->buffer.erase(this->buffer.begin(), this->buffer.begin() + size);
+        }
+
+        void end_array()
+        {
+          this->write_block();
+          if (this->compress)
+          {
+            unsigned long long blocks = this->compressed_sizes.size();
+            std::vector<unsigned long long> header(3 + blocks);
+            header[0] = blocks;
+            header[1] = this->block_size;
+            header[2] = this->array_size % this->block_size;
+            for (unsigned long long i = 0; i < blocks; i++)
+              header[3 + i] = this->compressed_sizes[i];
+
+            long long end = tell(this->file);
+            seek(this->file, this->array_start);
+            this->write_raw(header.data(), header.size() * sizeof(unsigned long long));
+            seek(this->file, end);
+          }
+        }
+
+        void write_raw(const void* data, size_t size)
+        {
+          if (size > 0 && fwrite(data, 1, size, this->file) != size)
+            throw Exceptions::Exception("LinearizerVTUWriter: writing failed.");
+        }
+
+        static bool little_endian()
+        {
+          int one = 1;
+          return *(char*)&one == 1;
+        }
+
+        /// 64-bit file positions (outputs over 2 GB).
+        static long long tell(FILE* f)
+        {
+#if defined(WIN32) || defined(_WINDOWS)
+          return _ftelli64(f);
+#else
+          return ftello(f);
+#endif
+        }
+        static void seek(FILE* f, long long position)
+        {
+#if defined(WIN32) || defined(_WINDOWS)
+          _fseeki64(f, position, SEEK_SET);
+#else
+          fseeko(f, position, SEEK_SET);
+#endif
+        }
+
+        bool compress;
+        bool mode_3D;
+        unsigned int block_size;
+
+        FILE* file;
+        long long appended_start;
+        long long offset_positions[ArrayCount];
+        unsigned long long array_offsets[ArrayCount];
+
+        /// The current array.
+        long long array_start;
+        unsigned long long array_size;
+        std::vector<char> buffer;
+        std::vector<char> compressed;
+        std::vector<unsigned long long> compressed_sizes;
+      };
+
+      /// \brief ParaView collection (.pvd) of the VTU files of a transient calculation.
+      /// The collection file is rewritten after each step, so that it is valid also during the calculation.
+      class LinearizerVTUTimeSeries
+      {
+      public:
+        /// \param[in] filename The collection file, the step files are referenced relative to its directory.
+        LinearizerVTUTimeSeries(const char* filename) : filename(filename)
+        {
+        }
+
+        /// Adds a step written to the file vtu_filename.
+        void add(double time, const char* vtu_filename)
+        {
+          this->times.push_back(time);
+          this->files.push_back(vtu_filename);
+
+          FILE* f = fopen(this->filename.c_str(), "w");
+          if (f == nullptr)
+            throw Exceptions::Exception("LinearizerVTUTimeSeries: could not open %s for writing.", this->filename.c_str());
+          fprintf(f, "<?xml version=\"1.0\"?>\n");
+          fprintf(f, "<VTKFile type=\"Collection\" version=\"0.1\">\n");
+          fprintf(f, "  <Collection>\n");
+          for (unsigned int i = 0; i < this->times.size(); i++)
+            fprintf(f, "    <DataSet timestep=\"%.17g\" group=\"\" part=\"0\" file=\"%s\"/>\n", this->times[i], this->files[i].c_str());
+          fprintf(f, "  </Collection>\n");
+          fprintf(f, "</VTKFile>\n");
+          fclose(f);
+        }
+
+        /// Writes the linearizer to vtu_filename and adds it as a step.
+        template<typename LinearizerDataDimensions>
+        void add(double time, LinearizerVTUWriter<LinearizerDataDimensions>& writer, const LinearizerMultidimensional<LinearizerDataDimensions>& linearizer, const char* vtu_filename, const char* quantity_name)
+        {
+          writer.save(linearizer, vtu_filename, quantity_name);
+          this->add(time, vtu_filename);
+        }
+
+      protected:
+        std::string filename;
+        std::vector<double> times;
+        std::vector<std::string> files;
+      };
+    }
+  }
+}
+#endif
@@ -0,0 +1,330 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __H2D_SOLUTION_OUTPUT_QUEUE_H
+#define __H2D_SOLUTION_OUTPUT_QUEUE_H
+
+#include "linearizer.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    namespace Views
+    {
+      /// What SolutionOutputQueue does with a snapshot.
+      enum SolutionOutputType
+      {
+        /// Solution::save().
+        SolutionOutputXML,
+#ifdef WITH_BSON
+        /// Solution::save_bson().
+        SolutionOutputBSON,
+#endif
+        /// Linearizer::save_solution_vtk() (real solutions only).
+        SolutionOutputVTK,
+        /// Linearizer::save_solution_tecplot() (real solutions only).
+        SolutionOutputTecplot
+      };
+
+      /// \brief Solution output overlapping with the calculation.
+      ///
+      /// add() only copies the coefficient vector (and remembers the spaces with their sequence numbers);
+      /// the solutions are then built, linearized and written by background threads.
+      /// The copies are limited by the number of pending snapshots and by their total size, add() blocks while either limit
+      /// is reached (the default of two snapshots is double buffering - one being written, one being filled).
+      /// The coefficient buffers of written snapshots are reused.<br>
+      /// Only the coefficients are copied, the snapshots refer to the spaces and their meshes, which the background threads
+      /// use when writing. So neither the spaces (assign_dofs(), set_uniform_order(), adaptivity) nor their meshes (refinements,
+      /// loading) may change until flush() returns. A change is detected by the sequence numbers of the spaces and meshes,
+      /// the snapshot is not written then and the error is reported.<br>
+      /// An error of a background thread (an exception thrown while writing) is thrown by the next call of add() or flush();
+      /// the other snapshots are written regardless.
+      ///
+      /// Typical usage:<br>
+      /// SolutionOutputQueue<double> output;<br>
+      /// for (int ts = 1; ...)<br>
+      /// {<br>
+      ///   newton.solve(coeff_vec);<br>
+      ///   sprintf(filename, "Solution-%i.vtk", ts);<br>
+      ///   output.add(space, newton.get_sln_vector(), SolutionOutputVTK, filename, "u");<br>
+      /// }<br>
+      /// output.flush();
+      template<typename Scalar>
+      class SolutionOutputQueue : public Hermes::Mixins::Loggable
+      {
+      public:
+        /// Constructor.
+        /// \param[in] num_threads Number of the writing threads.
+        /// \param[in] max_pending Maximum number of snapshots not written yet.
+        /// \param[in] max_pending_bytes Maximum size of the coefficient vectors not written yet (one snapshot is always allowed).
+        SolutionOutputQueue(int num_threads = 1, int max_pending = 2, size_t max_pending_bytes = 256 * 1024 * 1024) : max_pending(max_pending), max_pending_bytes(max_pending_bytes),
+          pending(0), pending_bytes(0), stop(false), snapshots_written(0), blocked_adds(0)
+        {
+          if (num_threads < 1)
+            throw Exceptions::ValueException("num_threads", num_threads, 1);
+          if (max_pending < 1)
+            throw Exceptions::ValueException("max_pending", max_pending, 1);
+          for (int i = 0; i < num_threads; i++)
+            this->workers.push_back(std::thread(&SolutionOutputQueue<Scalar>::work, this));
+        }
+
+        /// Writes all pending snapshots.
+        virtual ~SolutionOutputQueue()
+        {
+          {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->stop = true;
+          }
+          this->condition.notify_all();
+          for (unsigned int i = 0; i < this->workers.size(); i++)
+            this->workers[i].join();
+          for (unsigned int i = 0; i < this->queue.size(); i++)
+            delete this->queue[i];
+          for (unsigned int i = 0; i < this->free_snapshots.size(); i++)
+            delete this->free_snapshots[i];
+        }
+
+        /// Adds a snapshot of one solution.
+        /// \param[in] coefficient_vector The coefficient vector (e.g. NewtonSolver::get_sln_vector()), copied.
+        /// \param[in] filename The output file.
+        /// \param[in] quantity_name The name of the quantity (VTK, Tecplot).
+        /// \param[in] item The item of the solution (VTK, Tecplot).
+        void add(SpaceSharedPtr<Scalar> space, const Scalar* coefficient_vector, SolutionOutputType type, const char* filename, const char* quantity_name = "", int item = H2D_FN_VAL_0)
+        {
+          this->add(std::vector<SpaceSharedPtr<Scalar> >(1, space), coefficient_vector, type, std::vector<std::string>(1, filename), quantity_name, item);
+        }
+
+        /// Adds a snapshot of a system, one file per space.
+        /// \param[in] coefficient_vector The coefficient vector of all spaces, copied.
+        void add(std::vector<SpaceSharedPtr<Scalar> > spaces, const Scalar* coefficient_vector, SolutionOutputType type, std::vector<std::string> filenames, const char* quantity_name = "", int item = H2D_FN_VAL_0)
+        {
+          if (coefficient_vector == nullptr)
+            throw Exceptions::NullException(2);
+          if (filenames.size() != spaces.size())
+            throw Exceptions::LengthException(4, filenames.size(), spaces.size());
+          if ((type == SolutionOutputVTK || type == SolutionOutputTecplot) && !linearizable((Scalar*)nullptr))
+            throw Exceptions::Exception("SolutionOutputQueue: VTK and Tecplot output is available for real solutions only.");
+
+          int ndof = Space<Scalar>::get_num_dofs(spaces);
+          size_t bytes = ndof * sizeof(Scalar);
+
+          Snapshot* snapshot;
+          {
+            // Back-pressure.
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->check_error();
+            if (this->pending >= this->max_pending || (this->pending > 0 && this->pending_bytes + bytes > this->max_pending_bytes))
+            {
+              this->blocked_adds++;
+              this->condition.wait(lock, [&]() { return !this->error.empty() || (this->pending < this->max_pending && (this->pending == 0 || this->pending_bytes + bytes <= this->max_pending_bytes)); });
+              this->check_error();
+            }
+            this->pending++;
+            this->pending_bytes += bytes;
+            if (this->free_snapshots.empty())
+              snapshot = new Snapshot;
+            else
+            {
+              snapshot = this->free_snapshots.back();
+              this->free_snapshots.pop_back();
+            }
+          }
+
+          // The copy itself is outside of the lock.
+          snapshot->spaces = spaces;
+          snapshot->space_seqs.resize(spaces.size());
+          snapshot->mesh_seqs.resize(spaces.size());
+          for (unsigned int i = 0; i < spaces.size(); i++)
+          {
+            snapshot->space_seqs[i] = spaces[i]->get_seq();
+            snapshot->mesh_seqs[i] = spaces[i]->get_mesh()->get_seq();
+          }
+          snapshot->coefficients.assign(coefficient_vector, coefficient_vector + ndof);
+          snapshot->type = type;
+          snapshot->filenames = filenames;
+          snapshot->quantity_name = quantity_name;
+          snapshot->item = item;
+
+          {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->queue.push_back(snapshot);
+          }
+          this->condition.notify_all();
+        }
+
+        /// Waits until all snapshots are written.
+        void flush()
+        {
+          std::unique_lock<std::mutex> lock(this->mutex);
+          this->condition.wait(lock, [this]() { return this->pending == 0; });
+          this->check_error();
+        }
+
+        /// Number of snapshots written.
+        unsigned int get_num_written() const { return this->snapshots_written; }
+        /// Number of add() calls that had to wait for the background threads.
+        unsigned int get_num_blocked_adds() const { return this->blocked_adds; }
+
+        inline std::string getClassName() const { return "SolutionOutputQueue"; }
+
+      protected:
+        struct Snapshot
+        {
+          std::vector<SpaceSharedPtr<Scalar> > spaces;
+          std::vector<int> space_seqs;
+          std::vector<unsigned> mesh_seqs;
+          std::vector<Scalar> coefficients;
+          SolutionOutputType type;
+          std::vector<std::string> filenames;
+          std::string quantity_name;
+          int item;
+        };
+
+        /// Background thread.
+        void work()
+        {
+          while (true)
+          {
+            Snapshot* snapshot;
+            {
+              std::unique_lock<std::mutex> lock(this->mutex);
+              this->condition.wait(lock, [this]() { return this->stop || !this->queue.empty(); });
+              if (this->queue.empty())
+                return;
+              snapshot = this->queue.front();
+              this->queue.pop_front();
+            }
+
+            std::string message;
+            try
+            {
+              this->write(snapshot);
+            }
+            catch (std::exception& e)
+            {
+              message = e.what();
+            }
+
+            {
+              std::lock_guard<std::mutex> lock(this->mutex);
+              if (!message.empty() && this->error.empty())
+                this->error = message;
+              this->pending--;
+              this->pending_bytes -= snapshot->coefficients.size() * sizeof(Scalar);
+              this->snapshots_written++;
+              // Keep the buffer (its capacity) for the next add(), but not the spaces.
+              snapshot->spaces.clear();
+              this->free_snapshots.push_back(snapshot);
+            }
+            this->condition.notify_all();
+          }
+        }
+
+        /// Writes one snapshot, called by the background threads.
+        /// A derived class overriding it has to call flush() in its destructor, the threads stop only in this one.
+        virtual void write(Snapshot* snapshot)
+        {
+          for (unsigned int i = 0; i < snapshot->spaces.size(); i++)
+          {
+            if (snapshot->spaces[i]->get_seq() != snapshot->space_seqs[i])
+              throw Exceptions::Exception("SolutionOutputQueue: the space %i of '%s' changed before the output was written, call flush() before changing spaces.", i, snapshot->filenames[i].c_str());
+            if (snapshot->spaces[i]->get_mesh()->get_seq() != snapshot->mesh_seqs[i])
+              throw Exceptions::Exception("SolutionOutputQueue: the mesh of the space %i of '%s' changed before the output was written, call flush() before changing meshes.", i, snapshot->filenames[i].c_str());
+          }
+
+          std::vector<Solution<Scalar>*> solution_pointers;
+          std::vector<MeshFunctionSharedPtr<Scalar> > solutions;
+          for (unsigned int i = 0; i < snapshot->spaces.size(); i++)
+          {
+            solution_pointers.push_back(new Solution<Scalar>());
+            solutions.push_back(solution_pointers.back());
+          }
+          Solution<Scalar>::vector_to_solutions(snapshot->coefficients.data(), snapshot->spaces, solutions);
+
+          for (unsigned int i = 0; i < solutions.size(); i++)
+          {
+            const char* filename = snapshot->filenames[i].c_str();
+            switch (snapshot->type)
+            {
+            case SolutionOutputXML:
+              solution_pointers[i]->save(filename);
+              break;
+#ifdef WITH_BSON
+            case SolutionOutputBSON:
+              solution_pointers[i]->save_bson(filename);
+              break;
+#endif
+            case SolutionOutputVTK:
+            case SolutionOutputTecplot:
+              linearize(solutions[i], snapshot->type, filename, snapshot->quantity_name.c_str(), snapshot->item);
+              break;
+            }
+          }
+        }
+
+        static bool linearizable(double*) { return true; }
+        static bool linearizable(std::complex<double>*) { return false; }
+
+        /// One Linearizer per call, the Linearizer instances are not shared between the threads.
+        static void linearize(MeshFunctionSharedPtr<double> solution, SolutionOutputType type, const char* filename, const char* quantity_name, int item)
+        {
+          Linearizer linearizer(FileExport);
+          if (type == SolutionOutputVTK)
+            linearizer.save_solution_vtk(solution, filename, quantity_name, true, item);
+          else
+            linearizer.save_solution_tecplot(solution, filename, quantity_name, item);
+        }
+        static void linearize(MeshFunctionSharedPtr<std::complex<double> >, SolutionOutputType, const char*, const char*, int)
+        {
+          // Not reached, refused by add().
+        }
+
+        /// Called with the mutex locked.
+        void check_error()
+        {
+          if (!this->error.empty())
+          {
+            std::string message = this->error;
+            this->error.clear();
+            throw Exceptions::Exception("SolutionOutputQueue: writing the output failed: %s", message.c_str());
+          }
+        }
+
+        int max_pending;
+        size_t max_pending_bytes;
+
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::deque<Snapshot*> queue;
+        std::vector<Snapshot*> free_snapshots;
+        int pending;
+        size_t pending_bytes;
+        bool stop;
+        std::string error;
+
+        /// Statistics.
+        unsigned int snapshots_written;
+        unsigned int blocked_adds;
+      };
+    }
+  }
+}
+#endif
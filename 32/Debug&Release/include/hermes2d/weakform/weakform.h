@@ -27,6 +27,7 @@ namespace Hermes
     template<typename Scalar> class DiscreteProblem;
     template<typename Scalar> class DiscreteProblemSelectiveAssembler;
     template<typename Scalar> class DiscreteProblemIntegrationOrderCalculator;
+    template<typename Scalar> class DiscreteProblemFaceDGAssembler;
     template<typename Scalar> class RungeKutta;
     template<typename Scalar> class Space;
     template<typename Scalar> class MeshFunction;
@@ -240,6 +241,7 @@ namespace Hermes
       friend class DiscreteProblem < Scalar > ;
       friend class Form < Scalar > ;
       friend class DiscreteProblemDGAssembler < Scalar > ;
+      friend class DiscreteProblemFaceDGAssembler < Scalar > ;
       friend class DiscreteProblemThreadAssembler < Scalar > ;
       friend class DiscreteProblemIntegrationOrderCalculator < Scalar > ;
       friend class DiscreteProblemSelectiveAssembler < Scalar > ;
@@ -345,6 +347,7 @@ namespace Hermes
       friend class RungeKutta < Scalar > ;
       friend class DiscreteProblem < Scalar > ;
       friend class DiscreteProblemDGAssembler < Scalar > ;
+      friend class DiscreteProblemFaceDGAssembler < Scalar > ;
       friend class DiscreteProblemIntegrationOrderCalculator < Scalar > ;
       friend class DiscreteProblemSelectiveAssembler < Scalar > ;
       friend class DiscreteProblemThreadAssembler < Scalar > ;
@@ -32,10 +32,12 @@
 #include "solvers/interfaces/aztecoo_solver.h"
 #include "solvers/interfaces/epetra.h"
 #include "solvers/interfaces/mumps_solver.h"
+#include "solvers/interfaces/mumps_mixed_precision_solver.h"
 #include "solvers/interfaces/petsc_solver.h"
 #include "solvers/interfaces/umfpack_solver.h"
 #include "solvers/interfaces/superlu_solver.h"
 #include "solvers/interfaces/paralution_solver.h"
+#include "solvers/interfaces/streaming_external_solver.h"
 #include "solvers/precond.h"
 #include "solvers/interfaces/precond_ifpack.h"
 #include "solvers/interfaces/precond_ml.h"
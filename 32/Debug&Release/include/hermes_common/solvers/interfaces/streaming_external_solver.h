@@ -0,0 +1,367 @@
+// This file is part of HermesCommon
+//
+// Copyright (c) 2009 hp-FEM group at the University of Nevada, Reno (UNR).
+// Email: hpfem-group@unr.edu, home page: http://www.hpfem.org/.
+//
+// Hermes2D is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published
+// by the Free Software Foundation; either version 2 of the License,
+// or (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+/*! \file streaming_external_solver.h
+\brief External solver process connected by a binary stream.
+*/
+#ifndef __HERMES_COMMON_STREAMING_EXTERNAL_SOLVER_H_
+#define __HERMES_COMMON_STREAMING_EXTERNAL_SOLVER_H_
+#include "solvers/linear_matrix_solver.h"
+#include "algebra/cs_matrix.h"
+#include "util/memory_handling.h"
+
+#if defined(WIN32) || defined(_WINDOWS)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#endif
+
+namespace Hermes
+{
+  namespace Solvers
+  {
+    /// Message types of the StreamingExternalSolver protocol.
+    enum StreamingExternalSolverMessage
+    {
+      StreamingExternalSolverStructureAndValues = 1,
+      StreamingExternalSolverValues = 2,
+      StreamingExternalSolverQuit = 3
+    };
+
+    /// \brief External solver running as a persistent child process, connected by a binary stream.
+    /// Unlike SimpleExternalSolver, nothing is written to files and the process is started only once for all solves;
+    /// the system goes through the standard input of the child (a Unix domain socket pair on POSIX systems, an anonymous pipe on Windows)
+    /// and the solution comes back through its standard output.<br>
+    /// Protocol (all integers are 32-bit, native byte order):<br>
+    /// - request header: 'H', 'S', 'L', 'V', version (2), message type (StreamingExternalSolverMessage), size, nnz, scalar type (0 - double, 1 - complex double),
+    /// initial guess (0 - none, 1 - sent),<br>
+    /// - StreamingExternalSolverStructureAndValues: Ap (size + 1 ints), Ai (nnz ints), Ax (nnz scalars), rhs (size scalars), initial guess (size scalars, if sent),<br>
+    /// - StreamingExternalSolverValues (the structure of the last system is unchanged): Ax (nnz scalars), rhs (size scalars), initial guess (size scalars, if sent),<br>
+    /// - StreamingExternalSolverQuit: no payload, the child exits (it is killed if it does not within the stop timeout),<br>
+    /// - response: status (0 on success), then size scalars of the solution.<br>
+    /// The matrix is in the CSC format with zero-based indices.
+    template <typename Scalar>
+    class StreamingExternalSolver : public ExternalSolver < Scalar >
+    {
+    public:
+      /// Constructor.
+      /// \param[in] command The command line of the solver process.
+      StreamingExternalSolver(CSCMatrix<Scalar> *m, SimpleVector<Scalar> *rhs, std::string command) : ExternalSolver<Scalar>(m, rhs), command(command), running(false),
+        stop_timeout(5000), structure_messages(0), value_messages(0)
+      {
+#if defined(WIN32) || defined(_WINDOWS)
+        this->child_stdin = nullptr;
+        this->child_stdout = nullptr;
+        this->process = nullptr;
+#else
+        this->socket = -1;
+        this->pid = -1;
+#endif
+      }
+
+      virtual ~StreamingExternalSolver()
+      {
+        this->stop();
+      }
+
+      virtual void free()
+      {
+        free_with_check(this->sln);
+      }
+
+      virtual void solve()
+      {
+        this->solve(nullptr);
+      }
+
+      /// The initial guess (if any) is passed to the process, which may ignore it.
+      virtual void solve(Scalar* initial_guess)
+      {
+        this->tick();
+        if (!this->running)
+          this->start();
+
+        int size = this->m->get_size();
+        int nnz = this->m->get_nnz();
+        bool values_only = this->structure_unchanged();
+
+        int header[10] = { 'H', 'S', 'L', 'V', 2, values_only ? StreamingExternalSolverValues : StreamingExternalSolverStructureAndValues, size, nnz, sizeof(Scalar) == sizeof(double) ? 0 : 1,
+          initial_guess ? 1 : 0 };
+        this->write(header, sizeof(header));
+        if (!values_only)
+        {
+          this->write(this->m->get_Ap(), (size + 1) * sizeof(int));
+          this->write(this->m->get_Ai(), nnz * sizeof(int));
+          this->sent_Ap.assign(this->m->get_Ap(), this->m->get_Ap() + size + 1);
+          this->sent_Ai.assign(this->m->get_Ai(), this->m->get_Ai() + nnz);
+          this->structure_messages++;
+        }
+        else
+          this->value_messages++;
+        this->write(this->m->get_Ax(), nnz * sizeof(Scalar));
+        this->write(this->rhs->v, size * sizeof(Scalar));
+        if (initial_guess)
+          this->write(initial_guess, size * sizeof(Scalar));
+
+        int status;
+        this->read(&status, sizeof(int));
+        if (status != 0)
+        {
+          // The process may be in any state, the next solve starts a new one.
+          this->stop();
+          throw Exceptions::LinearMatrixSolverException("StreamingExternalSolver: the solver process returned the status %i.", status);
+        }
+
+        free_with_check(this->sln);
+        this->sln = malloc_with_check<StreamingExternalSolver<Scalar>, Scalar>(size, this);
+        this->read(this->sln, size * sizeof(Scalar));
+
+        this->tick();
+        this->time = this->accumulated();
+      }
+
+      /// Numbers of the systems sent with the structure, and of those sent as values only.
+      unsigned int get_num_structure_messages() const { return this->structure_messages; }
+      unsigned int get_num_value_messages() const { return this->value_messages; }
+
+      /// Time (in milliseconds) stop() waits for the process to quit before killing it.
+      void set_stop_timeout(unsigned int milliseconds) { this->stop_timeout = milliseconds; }
+
+      /// Asks the process to quit and waits for it (at most the stop timeout, then the process is killed).
+      void stop()
+      {
+        if (!this->running)
+          return;
+        this->running = false;
+        this->sent_Ap.clear();
+        this->sent_Ai.clear();
+
+#if defined(WIN32) || defined(_WINDOWS)
+        int header[10] = { 'H', 'S', 'L', 'V', 2, StreamingExternalSolverQuit, 0, 0, 0, 0 };
+        DWORD written;
+        WriteFile(this->child_stdin, header, sizeof(header), &written, nullptr);
+        CloseHandle(this->child_stdin);
+        CloseHandle(this->child_stdout);
+        if (WaitForSingleObject(this->process, this->stop_timeout) != WAIT_OBJECT_0)
+        {
+          TerminateProcess(this->process, 1);
+          WaitForSingleObject(this->process, INFINITE);
+        }
+        CloseHandle(this->process);
+        this->child_stdin = nullptr;
+        this->child_stdout = nullptr;
+        this->process = nullptr;
+#else
+        int header[10] = { 'H', 'S', 'L', 'V', 2, StreamingExternalSolverQuit, 0, 0, 0, 0 };
+        ::send(this->socket, header, sizeof(header), MSG_NOSIGNAL);
+        ::close(this->socket);
+        int status;
+        unsigned int waited = 0;
+        while (::waitpid(this->pid, &status, WNOHANG) == 0)
+        {
+          if (waited >= this->stop_timeout)
+          {
+            ::kill(this->pid, SIGKILL);
+            ::waitpid(this->pid, &status, 0);
+            break;
+          }
+          ::usleep(10000);
+          waited += 10;
+        }
+        this->socket = -1;
+        this->pid = -1;
+#endif
+      }
+
+    protected:
+      /// True if the matrix has the structure of the last one sent.
+      bool structure_unchanged()
+      {
+        int size = this->m->get_size();
+        int nnz = this->m->get_nnz();
+        if ((int)this->sent_Ap.size() != size + 1 || (int)this->sent_Ai.size() != nnz)
+          return false;
+        return memcmp(this->sent_Ap.data(), this->m->get_Ap(), (size + 1) * sizeof(int)) == 0
+          && memcmp(this->sent_Ai.data(), this->m->get_Ai(), nnz * sizeof(int)) == 0;
+      }
+
+#if defined(WIN32) || defined(_WINDOWS)
+      void start()
+      {
+        SECURITY_ATTRIBUTES security_attributes;
+        security_attributes.nLength = sizeof(SECURITY_ATTRIBUTES);
+        security_attributes.bInheritHandle = TRUE;
+        security_attributes.lpSecurityDescriptor = nullptr;
+
+        HANDLE stdin_read, stdout_write;
+        if (!CreatePipe(&stdin_read, &this->child_stdin, &security_attributes, 0) || !CreatePipe(&this->child_stdout, &stdout_write, &security_attributes, 0))
+          throw Exceptions::LinearMatrixSolverException("StreamingExternalSolver: pipes could not be created.");
+        SetHandleInformation(this->child_stdin, HANDLE_FLAG_INHERIT, 0);
+        SetHandleInformation(this->child_stdout, HANDLE_FLAG_INHERIT, 0);
+
+        STARTUPINFOA startup_info;
+        ZeroMemory(&startup_info, sizeof(STARTUPINFOA));
+        startup_info.cb = sizeof(STARTUPINFOA);
+        startup_info.hStdInput = stdin_read;
+        startup_info.hStdOutput = stdout_write;
+        startup_info.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+        startup_info.dwFlags |= STARTF_USESTDHANDLES;
+
+        PROCESS_INFORMATION process_information;
+        std::vector<char> command_line(this->command.begin(), this->command.end());
+        command_line.push_back('\0');
+        BOOL created = CreateProcessA(nullptr, command_line.data(), nullptr, nullptr, TRUE, 0, nullptr, nullptr, &startup_info, &process_information);
+        CloseHandle(stdin_read);
+        CloseHandle(stdout_write);
+        if (!created)
+        {
+          CloseHandle(this->child_stdin);
+          CloseHandle(this->child_stdout);
+          throw Exceptions::LinearMatrixSolverException("StreamingExternalSolver: the process '%s' could not be started.", this->command.c_str());
+        }
+        CloseHandle(process_information.hThread);
+        this->process = process_information.hProcess;
+        this->running = true;
+      }
+
+      void write(const void* data, size_t length)
+      {
+        const char* buffer = (const char*)data;
+        while (length > 0)
+        {
+          DWORD written;
+          if (!WriteFile(this->child_stdin, buffer, (DWORD)length, &written, nullptr))
+            this->fail("write");
+          buffer += written;
+          length -= written;
+        }
+      }
+
+      void read(void* data, size_t length)
+      {
+        char* buffer = (char*)data;
+        while (length > 0)
+        {
+          DWORD read_length;
+          if (!ReadFile(this->child_stdout, buffer, (DWORD)length, &read_length, nullptr) || read_length == 0)
+            this->fail("read");
+          buffer += read_length;
+          length -= read_length;
+        }
+      }
+#else
+      void start()
+      {
+        int sockets[2];
+        if (::socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0)
+          throw Exceptions::LinearMatrixSolverException("StreamingExternalSolver: the socket pair could not be created.");
+
+        this->pid = ::fork();
+        if (this->pid < 0)
+        {
+          ::close(sockets[0]);
+          ::close(sockets[1]);
+          throw Exceptions::LinearMatrixSolverException("StreamingExternalSolver: the process '%s' could not be started.", this->command.c_str());
+        }
+        if (this->pid == 0)
+        {
+          ::close(sockets[0]);
+          ::dup2(sockets[1], 0);
+          ::dup2(sockets[1], 1);
+          ::close(sockets[1]);
+          ::execl("/bin/sh", "sh", "-c", this->command.c_str(), (char*)nullptr);
+          ::_exit(127);
+        }
+        ::close(sockets[1]);
+        this->socket = sockets[0];
+        this->running = true;
+      }
+
+      void write(const void* data, size_t length)
+      {
+        const char* buffer = (const char*)data;
+        while (length > 0)
+        {
+          ssize_t written = ::send(this->socket, buffer, length, MSG_NOSIGNAL);
+          if (written < 0 && errno == EINTR)
+            continue;
+          if (written <= 0)
+            this->fail("write");
+          buffer += written;
+          length -= written;
+        }
+      }
+
+      void read(void* data, size_t length)
+      {
+        char* buffer = (char*)data;
+        while (length > 0)
+        {
+          ssize_t read_length = ::recv(this->socket, buffer, length, 0);
+          if (read_length < 0 && errno == EINTR)
+            continue;
+          if (read_length <= 0)
+            this->fail("read");
+          buffer += read_length;
+          length -= read_length;
+        }
+      }
+#endif
+
+      void fail(const char* operation)
+      {
+        this->stop();
+        throw Exceptions::LinearMatrixSolverException("StreamingExternalSolver: %s from / to the process '%s' failed.", operation, this->command.c_str());
+      }
+
+      /// Command line of the process.
+      std::string command;
+      bool running;
+      unsigned int stop_timeout;
+
+#if defined(WIN32) || defined(_WINDOWS)
+      HANDLE child_stdin;
+      HANDLE child_stdout;
+      HANDLE process;
+#else
+      int socket;
+      pid_t pid;
+#endif
+
+      /// The structure of the last system sent.
+      std::vector<int> sent_Ap;
+      std::vector<int> sent_Ai;
+
+      /// Statistics.
+      unsigned int structure_messages;
+      unsigned int value_messages;
+    };
+  }
+}
+#endif
@@ -239,6 +239,17 @@ void BaseMatrix<ValueType>::ReadFileCSR(const std::string filename) {
 
 }
 
+template <typename ValueType>
+void BaseMatrix<ValueType>::MapFileCSR(const std::string filename, const bool verify) {
+
+  LOG_INFO("BaseMatrix<ValueType>::MapFileCSR(const std::string, const bool)");
+  LOG_INFO("Matrix format=" << _matrix_format_names[this->get_mat_format()]);
+  this->info();
+  LOG_INFO("The function is not implemented (yet)!");
+  FATAL_ERROR(__FILE__, __LINE__);
+
+}
+
 template <typename ValueType>
 void BaseMatrix<ValueType>::WriteFileCSR(const std::string filename) const {
 
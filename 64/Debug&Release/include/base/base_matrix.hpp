@@ -289,6 +289,9 @@ public:
   virtual void ReadFileCSR(const std::string filename);
   /// Write matrix to CSR (PARALUTION binary format) file
   virtual void WriteFileCSR(const std::string filename) const;
+  /// Attach a memory-mapped CSR (PARALUTION binary format) file,
+  /// verify the checksum if verify is true
+  virtual void MapFileCSR(const std::string filename, const bool verify);
 
   /// Perform symbolic computation (structure only) of |this|^p
   virtual void SymbolicPower(const int p);
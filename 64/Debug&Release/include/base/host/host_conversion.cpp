@@ -30,6 +30,7 @@
 #include "../../utils/allocate_free.hpp"
 #include <assert.h>
 #include <stdlib.h>
+#include <atomic>
 
 #include "../../utils/log.hpp"
 
@@ -524,6 +525,7 @@ void hyb_to_csr(const int omp_threads,
 // - adopted interface
 // - Bubble sort each column after convertion
 // - OpenMP pragma for
+// - Parallel atomic histogram and scatter, insertion sort by (col, COO index)
 // ----------------------------------------------------------
 template <typename ValueType, typename IndexType>
 void coo_to_csr(const int omp_threads,
@@ -545,58 +547,59 @@ void coo_to_csr(const int omp_threads,
   set_to_zero_host(nnz, dst->col);
   set_to_zero_host(nnz, dst->val);  
 
-  // compute nnz entries per row of CSR
-  for (IndexType n = 0; n < nnz; ++n)
-    dst->row_offset[src.row[n]] = dst->row_offset[src.row[n]] + 1;
-
-  
-  // cumsum the num_entries per row to get dst->row_offsets[]
-  IndexType cumsum = 0;
-  for(IndexType i = 0; i < nrow; ++i) {
-    IndexType temp = dst->row_offset[i];
-    dst->row_offset[i] = cumsum;
-    cumsum += temp;
+  // Count the entries per row (in row_offset[row+1]) and sum them up
+#pragma omp parallel for
+  for (IndexType n = 0; n < nnz; ++n) {
+#pragma omp atomic
+    ++dst->row_offset[src.row[n]+1];
   }
 
-  dst->row_offset[nrow] = cumsum;
+  for (IndexType i = 0; i < nrow; ++i)
+    dst->row_offset[i+1] += dst->row_offset[i];
 
-  // write Aj,Ax IndexTypeo dst->column_indices,dst->values
-  for(IndexType n = 0; n < nnz; ++n) {
-    IndexType row  = src.row[n];
-    IndexType dest = dst->row_offset[row];
-      
-    dst->col[dest] = src.col[n];
-    dst->val[dest] = src.val[n];
-    
-    dst->row_offset[row] = dst->row_offset[row] + 1;
-  }
+  // Scatter the COO indices of the entries to their rows; the order within
+  // a row depends on the threads, it is restored by the sort below
+  std::atomic<IndexType> *row_cursor = new std::atomic<IndexType>[nrow];
 
-  IndexType last = 0; 
-  for(IndexType i = 0; i <= nrow; ++i) {
-    IndexType temp = dst->row_offset[i];
-    dst->row_offset[i]  = last;
-    last   = temp;
-  }
-  
-  // Sorting the col (per row)
-  // Bubble sort algorithm
+#pragma omp parallel for
+  for (IndexType i = 0; i < nrow; ++i)
+    row_cursor[i].store(dst->row_offset[i], std::memory_order_relaxed);
+
+#pragma omp parallel for
+  for (IndexType n = 0; n < nnz; ++n)
+    dst->col[row_cursor[src.row[n]].fetch_add(1, std::memory_order_relaxed)] = n;
+
+  delete[] row_cursor;
+
+  // Sort each row by the column, equal columns in the COO order (insertion
+  // sort - as the former stable bubble sort), and gather the entries
 
 #pragma omp parallel for      
-  for (IndexType i=0; i<nrow; ++i)
-    for (IndexType j=dst->row_offset[i]; j<dst->row_offset[i+1]; ++j)
-      for (IndexType jj=dst->row_offset[i]; jj<dst->row_offset[i+1]-1; ++jj)
-        if (dst->col[jj] > dst->col[jj+1]) {
-          //swap elements
+  for (IndexType i=0; i<nrow; ++i) {
 
-          IndexType ind = dst->col[jj];
-          ValueType val = dst->val[jj];
+    for (IndexType j=dst->row_offset[i]+1; j<dst->row_offset[i+1]; ++j) {
 
-          dst->col[jj] = dst->col[jj+1];
-          dst->val[jj] = dst->val[jj+1];          
+      IndexType n = dst->col[j];
+      IndexType ind = src.col[n];
 
-          dst->col[jj+1] = ind;
-          dst->val[jj+1] = val;
-        }
+      IndexType jj = j;
+      for (; (jj > dst->row_offset[i]) &&
+             ((src.col[dst->col[jj-1]] > ind) ||
+              ((src.col[dst->col[jj-1]] == ind) && (dst->col[jj-1] > n))); --jj)
+        dst->col[jj] = dst->col[jj-1];
+
+      dst->col[jj] = n;
+    }
+
+    for (IndexType j=dst->row_offset[i]; j<dst->row_offset[i+1]; ++j) {
+
+      IndexType n = dst->col[j];
+      dst->col[j] = src.col[n];
+      dst->val[j] = src.val[n];
+
+    }
+
+  }
   
 }
 
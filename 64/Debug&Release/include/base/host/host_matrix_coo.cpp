@@ -38,6 +38,7 @@
 #include "../backend_manager.hpp"
 #include "../../utils/log.hpp"
 #include "../../utils/allocate_free.hpp"
+#include "../../utils/ascii_io.hpp"
 #include "../matrix_formats_ind.hpp"
 
 extern "C" {
@@ -305,6 +306,40 @@ bool HostMatrixCOO<ValueType>::ConvertFrom(const BaseMatrix<ValueType> &mat) {
 
 }
 
+// Count the entries (and for symmetric matrices the off-diagonal entries)
+// in the lines [begin, end) of a Matrix Market file, stop after max_entries
+static bool mtx_count_entries(const char *begin, const char *end, const bool sym,
+                              const int max_entries, int *entries, int *off_diag) {
+
+  *entries = 0;
+  *off_diag = 0;
+
+  for (const char *pos = begin; (pos < end) && (*entries < max_entries); pos = ascii_next_line(pos, end)) {
+
+    const char *line_end = ascii_line_end(pos, end);
+    const char *p = skip_ascii_blanks(pos, line_end);
+
+    // skip empty lines and comments
+    if ((p == line_end) || (*p == '%'))
+      continue;
+
+    if (sym == true) {
+      int row, col;
+      if ((parse_ascii_int(&p, line_end, &row) == false) ||
+          (parse_ascii_int(&p, line_end, &col) == false))
+        return false;
+
+      if (row != col)
+        ++(*off_diag);
+    }
+
+    ++(*entries);
+  }
+
+  return true;
+
+}
+
 template <typename ValueType>
 void HostMatrixCOO<ValueType>::ReadFileMTX(const std::string filename) { 
 
@@ -347,9 +382,8 @@ void HostMatrixCOO<ValueType>::ReadFileMTX(const std::string filename) {
     FATAL_ERROR(__FILE__, __LINE__);
   }
 
-  nnz = fnz ; 
+  fclose(f);
 
-  /* reseve memory for matrices */
   if(mm_is_symmetric(matcode)) {
 
     if (N != M) {
@@ -358,44 +392,150 @@ void HostMatrixCOO<ValueType>::ReadFileMTX(const std::string filename) {
       FATAL_ERROR(__FILE__, __LINE__);
     }
 
-    nnz = 2*(nnz - N) + N;
     sym = true ;
   }
 
+  // The entries are parsed in parallel from a (memory-mapped) view of the file;
+  // each thread takes a block of lines, the entries keep the order of the file
+  ParalutionMappedFile file;
+
+  if (file.Open(filename) == false) {
+    LOG_INFO("ReadFileMTX cannot read file " << filename);
+    FATAL_ERROR(__FILE__, __LINE__);
+  }
+
+  const char *data = file.get_data();
+  const char *data_end = data + file.get_size();
+
+  // skip the banner, the comments and the size (as mm_read_mtx_crd_size() does,
+  // the three numbers may follow blank lines and be spread over several lines)
+  const char *pos = ascii_next_line(data, data_end);
+  while ((pos < data_end) && (*pos == '%'))
+    pos = ascii_next_line(pos, data_end);
+
+  int size_val[3];
+  bool size_found = true;
+  const char *line_end = ascii_line_end(pos, data_end);
+
+  for (int k=0; (k<3) && (size_found == true); ++k) {
+
+    // move to the next number, skipping blank and comment lines
+    pos = skip_ascii_blanks(pos, line_end);
+    while (((pos == line_end) || (*pos == '%')) && (line_end < data_end)) {
+      pos = skip_ascii_blanks(line_end + 1, data_end);
+      line_end = ascii_line_end(pos, data_end);
+    }
+
+    size_found = parse_ascii_int(&pos, line_end, &size_val[k]);
+  }
+
+  if ((size_found == false) ||
+      (size_val[0] != M) || (size_val[1] != N) || (size_val[2] != fnz)) {
+    LOG_INFO("ReadFileMTX the size has to precede the entries");
+    FATAL_ERROR(__FILE__, __LINE__);
+  }
+
+  const size_t data_begin = ascii_next_line(pos, data_end) - data;
+
+  const int num_chunks = (this->local_backend_.OpenMP_threads > 1) ? this->local_backend_.OpenMP_threads : 1;
+  size_t *bounds = new size_t[num_chunks+1];
+  int *entries = new int[num_chunks+1];
+  int *off_diag = new int[num_chunks+1];
+  bool valid = true;
+
+  split_ascii_lines(data, data_begin, file.get_size(), num_chunks, bounds);
+
+  _set_omp_backend_threads(this->local_backend_, fnz);
+
+  // count the entries of each block
+#pragma omp parallel for reduction(&&:valid)
+  for (int i=0; i<num_chunks; ++i)
+    if (mtx_count_entries(data + bounds[i], data + bounds[i+1], sym, fnz,
+                          &entries[i+1], &off_diag[i+1]) == false)
+      valid = false;
+
+  if (valid == false) {
+    LOG_INFO("ReadFileMTX invalid entry in file " << filename);
+    FATAL_ERROR(__FILE__, __LINE__);
+  }
+
+  // entries following the first fnz entries are ignored
+  entries[0] = 0;
+  off_diag[0] = 0;
+  for (int i=0; i<num_chunks; ++i) {
+
+    if (entries[i] + entries[i+1] > fnz)
+      mtx_count_entries(data + bounds[i], data + bounds[i+1], sym, fnz - entries[i],
+                        &entries[i+1], &off_diag[i+1]);
+
+    entries[i+1] += entries[i];
+    off_diag[i+1] += off_diag[i];
+  }
+
+  if (entries[num_chunks] != fnz) {
+    LOG_INFO("ReadFileMTX the file contains " << entries[num_chunks] << " entries instead of " << fnz);
+    FATAL_ERROR(__FILE__, __LINE__);
+  }
+
+  // each off-diagonal entry of a symmetric matrix is stored twice
+  nnz = fnz + off_diag[num_chunks];
+
   this->AllocateCOO(nnz,M,N);
 
-  int ii=0;
-  int col, row;
-  double val;
-  int ret;
-  for (int i=0; i<fnz; ++i) {
-    ret = fscanf(f, "%d %d %lg\n", &row, &col, &val);
-    if (!ret) FATAL_ERROR(__FILE__, __LINE__);
+#pragma omp parallel for reduction(&&:valid)
+  for (int i=0; i<num_chunks; ++i) {
 
-    row--; /* adjust from 1-based to 0-based */
-    col--;
+    const char *chunk_end = data + bounds[i+1];
+    int n = entries[i];
+    int ii = n + off_diag[i];
 
-    assert (ret == 3);
+    for (const char *line = data + bounds[i]; (line < chunk_end) && (n < fnz); line = ascii_next_line(line, chunk_end)) {
 
-    //    LOG_INFO(row << " " << col << " " << val);
+      const char *line_end = ascii_line_end(line, chunk_end);
+      const char *p = skip_ascii_blanks(line, line_end);
 
-    this->mat_.row[ii] = row;
-    this->mat_.col[ii] = col;
-    this->mat_.val[ii] = ValueType(val);
+      if ((p == line_end) || (*p == '%'))
+        continue;
 
-    if (sym && (row!=col)) {
-      ++ii;
-      this->mat_.row[ii] = col;
-      this->mat_.col[ii] = row;
+      int col, row;
+      double val;
+
+      if ((parse_ascii_int(&p, line_end, &row) == false) ||
+          (parse_ascii_int(&p, line_end, &col) == false) ||
+          (parse_ascii_double(&p, line_end, &val) == false)) {
+        valid = false;
+        break;
+      }
+
+      row--; /* adjust from 1-based to 0-based */
+      col--;
+
+      this->mat_.row[ii] = row;
+      this->mat_.col[ii] = col;
       this->mat_.val[ii] = ValueType(val);
+
+      if (sym && (row!=col)) {
+        ++ii;
+        this->mat_.row[ii] = col;
+        this->mat_.col[ii] = row;
+        this->mat_.val[ii] = ValueType(val);
+      }
+
+      ++ii;
+      ++n;
     }
-      
-    ++ii;
   }
 
-  LOG_INFO("ReadFileMTX: filename="<< filename << "; done");
+  delete[] bounds;
+  delete[] entries;
+  delete[] off_diag;
 
-  fclose(f);
+  if (valid == false) {
+    LOG_INFO("ReadFileMTX invalid entry in file " << filename);
+    FATAL_ERROR(__FILE__, __LINE__);
+  }
+
+  LOG_INFO("ReadFileMTX: filename="<< filename << "; done");
 
 }
 
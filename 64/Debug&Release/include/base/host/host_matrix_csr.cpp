@@ -37,6 +37,7 @@
 #include "../../utils/log.hpp"
 #include "../../utils/allocate_free.hpp"
 #include "../../utils/math_functions.hpp"
+#include "../../utils/ascii_io.hpp"
 #include "../matrix_formats_ind.hpp"
 
 #include <assert.h>
@@ -45,6 +46,7 @@
 #include <fstream>
 #include <algorithm>
 #include <limits>
+#include <stdint.h>
 
 #ifdef _OPENMP
   #include <omp.h>
@@ -81,6 +83,7 @@ HostMatrixCSR<ValueType>::HostMatrixCSR(const Paralution_Backend_Descriptor loca
   this->mat_.row_offset = NULL;  
   this->mat_.col        = NULL;  
   this->mat_.val        = NULL;
+  this->mapped_file_    = NULL;
   this->set_backend(local_backend); 
   
 #ifdef SUPPORT_MKL
@@ -107,9 +110,23 @@ void HostMatrixCSR<ValueType>::Clear() {
 
   if (this->nnz_ > 0) {
 
-    free_host(&this->mat_.row_offset);
-    free_host(&this->mat_.col);
-    free_host(&this->mat_.val);
+    if (this->mapped_file_ != NULL) {
+
+      // the arrays belong to the mapped file
+      delete this->mapped_file_;
+      this->mapped_file_ = NULL;
+
+      this->mat_.row_offset = NULL;
+      this->mat_.col = NULL;
+      this->mat_.val = NULL;
+
+    } else {
+
+      free_host(&this->mat_.row_offset);
+      free_host(&this->mat_.col);
+      free_host(&this->mat_.val);
+
+    }
     
     this->nrow_ = 0;
     this->ncol_ = 0;
@@ -290,6 +307,8 @@ void HostMatrixCSR<ValueType>::LeaveDataPtrCSR(int **row_offset, int **col, Valu
   assert(this->ncol_ > 0);
   assert(this->nnz_ > 0);
 
+  this->DetachMappedFile();
+
   // see free_host function for details
   *row_offset = this->mat_.row_offset;
   *col = this->mat_.col;
@@ -395,6 +414,176 @@ void HostMatrixCSR<ValueType>::CopyTo(BaseMatrix<ValueType> *mat) const {
 
 }
 
+// CSR (PARALUTION binary format) file, version 1:
+// the header is followed by the row_offset, col and val arrays,
+// each one starting at a 64 byte aligned offset (for mapping the file)
+static const char csr_file_magic[8] = { 'P', 'A', 'R', 'A', 'C', 'S', 'R', '\0' };
+static const uint32_t csr_file_version = 1;
+static const uint32_t csr_file_endianness = 0x01020304;
+static const uint64_t csr_file_alignment = 64;
+
+struct ParalutionCSRFileHeader {
+
+  char magic[8];
+  uint32_t version;
+  // csr_file_endianness in the byte order of the writer
+  uint32_t endianness;
+  uint32_t index_size;
+  // 1 - float, 2 - double
+  uint32_t value_type;
+  // col is sorted within each row
+  uint32_t sorted;
+  uint32_t reserved;
+  int64_t nrow;
+  int64_t ncol;
+  int64_t nnz;
+  uint64_t row_offset_pos;
+  uint64_t col_pos;
+  uint64_t val_pos;
+  // see csr_file_checksum()
+  uint64_t checksum;
+
+};
+
+static uint32_t csr_file_value_type(const float*) { return 1; }
+static uint32_t csr_file_value_type(const double*) { return 2; }
+
+static uint64_t csr_file_value_size(const uint32_t value_type) {
+  return (value_type == 1) ? sizeof(float) : sizeof(double);
+}
+
+static uint64_t csr_file_align(const uint64_t pos) {
+  return ((pos + csr_file_alignment - 1) / csr_file_alignment) * csr_file_alignment;
+}
+
+// Reverse the byte order of size-byte elements
+static void csr_file_swap_bytes(char *data, const int n, const int size) {
+
+#pragma omp parallel for
+  for (int i=0; i<n; ++i)
+    std::reverse(data + size_t(i)*size, data + size_t(i+1)*size);
+
+}
+
+static void csr_file_swap_header(ParalutionCSRFileHeader *header) {
+
+  csr_file_swap_bytes((char*) &header->version, 6, sizeof(uint32_t));
+  csr_file_swap_bytes((char*) &header->nrow, 7, sizeof(uint64_t));
+
+}
+
+// FNV-1a of 64KB blocks, summed with odd weights - computed in parallel
+static uint64_t csr_file_checksum(const char *data, const uint64_t size) {
+
+  const uint64_t block_size = 65536;
+  const int nblocks = int((size + block_size - 1) / block_size);
+  uint64_t checksum = 0;
+
+#pragma omp parallel for reduction(+:checksum)
+  for (int b=0; b<nblocks; ++b) {
+
+    const uint64_t begin = b*block_size;
+    const uint64_t end = std::min(begin + block_size, size);
+
+    uint64_t hash = 14695981039346656037ULL;
+    for (uint64_t i=begin; i<end; ++i) {
+      hash ^= (unsigned char) data[i];
+      hash *= 1099511628211ULL;
+    }
+
+    checksum += hash * (2*uint64_t(b) + 1);
+  }
+
+  return checksum;
+
+}
+
+// Checksum of the three arrays, as stored in the file
+static uint64_t csr_file_checksum(const char *row_offset, const uint64_t row_offset_size,
+                                  const char *col, const uint64_t col_size,
+                                  const char *val, const uint64_t val_size) {
+
+  const uint64_t prime = 1099511628211ULL;
+
+  return (csr_file_checksum(row_offset, row_offset_size) * prime +
+          csr_file_checksum(col, col_size)) * prime +
+          csr_file_checksum(val, val_size);
+
+}
+
+// Check the header, return true if the byte order of the file has to be swapped
+static bool csr_file_check_header(ParalutionCSRFileHeader *header, const uint64_t file_size,
+                                  const std::string filename) {
+
+  bool swap = false;
+
+  if (header->endianness != csr_file_endianness) {
+
+    csr_file_swap_header(header);
+
+    if (header->endianness != csr_file_endianness) {
+      LOG_INFO("ReadFileCSR invalid header in file " << filename);
+      FATAL_ERROR(__FILE__, __LINE__);
+    }
+
+    swap = true;
+  }
+
+  if (header->version > csr_file_version) {
+    LOG_INFO("ReadFileCSR file " << filename << " has version " << header->version
+             << ", supported up to " << csr_file_version);
+    FATAL_ERROR(__FILE__, __LINE__);
+  }
+
+  if ((header->index_size != sizeof(int)) ||
+      ((header->value_type != 1) && (header->value_type != 2)) ||
+      (header->nrow < 0) || (header->ncol < 0) || (header->nnz < 0) ||
+      (header->nrow > std::numeric_limits<int>::max()) ||
+      (header->ncol > std::numeric_limits<int>::max()) ||
+      (header->nnz > std::numeric_limits<int>::max())) {
+    LOG_INFO("ReadFileCSR unsupported index/value type or size in file " << filename);
+    FATAL_ERROR(__FILE__, __LINE__);
+  }
+
+  // positions and sizes are checked separately - their sum may overflow
+  const uint64_t row_offset_size = (header->nrow+1)*sizeof(int);
+  const uint64_t col_size = header->nnz*sizeof(int);
+  const uint64_t val_size = header->nnz*csr_file_value_size(header->value_type);
+
+  if ((header->row_offset_pos > file_size) || (row_offset_size > file_size - header->row_offset_pos) ||
+      (header->col_pos > file_size) || (col_size > file_size - header->col_pos) ||
+      (header->val_pos > file_size) || (val_size > file_size - header->val_pos)) {
+    LOG_INFO("ReadFileCSR file " << filename << " is truncated");
+    FATAL_ERROR(__FILE__, __LINE__);
+  }
+
+  return swap;
+
+}
+
+// Sort the col (per row) - stable as the former bubble sort
+template <typename ValueType>
+static void csr_sort_columns(const int nrow, const int *row_offset, int *col, ValueType *val) {
+
+#pragma omp parallel for
+  for (int i=0; i<nrow; ++i)
+    for (int j=row_offset[i]+1; j<row_offset[i+1]; ++j) {
+
+      int ind = col[j];
+      ValueType v = val[j];
+
+      int jj = j;
+      for (; (jj > row_offset[i]) && (col[jj-1] > ind); --jj) {
+        col[jj] = col[jj-1];
+        val[jj] = val[jj-1];
+      }
+
+      col[jj] = ind;
+      val[jj] = v;
+    }
+
+}
+
 template <typename ValueType>
 void HostMatrixCSR<ValueType>::ReadFileCSR(const std::string filename) { 
 
@@ -402,44 +591,226 @@ void HostMatrixCSR<ValueType>::ReadFileCSR(const std::string filename) {
 
   std::ifstream out(filename.c_str(), std::ios::in | std::ios::binary);
 
-  int nrow;
-  int ncol;
-  int nnz;
+  if (!out.is_open()) {
+    LOG_INFO("ReadFileCSR cannot open file " << filename);
+    FATAL_ERROR(__FILE__, __LINE__);
+  }
+
+  ParalutionCSRFileHeader header;
+  memset(&header, 0, sizeof(header));
+  out.read((char*)&header, sizeof(header));
+
+  if ((out.gcount() < std::streamsize(sizeof(header))) ||
+      (memcmp(header.magic, csr_file_magic, sizeof(csr_file_magic)) != 0)) {
+
+    // Headerless file (before version 1)
+    out.clear();
+    out.seekg(0, std::ios_base::beg);
+
+    int nrow;
+    int ncol;
+    int nnz;
+
+    out.read((char*)&nrow, sizeof(int));
+    out.read((char*)&ncol, sizeof(int));
+    out.read((char*)&nnz, sizeof(int));
+
+    this->AllocateCSR(nnz, nrow, ncol);
+
+    out.read((char*)this->mat_.row_offset, (nrow+1)*sizeof(int));
+    out.read((char*)this->mat_.col, nnz*sizeof(int));
+    out.read((char*)this->mat_.val, nnz*sizeof(ValueType));
+
+    out.close();
 
-  out.read((char*)&nrow, sizeof(int));
-  out.read((char*)&ncol, sizeof(int));
-  out.read((char*)&nnz, sizeof(int));
+    _set_omp_backend_threads(this->local_backend_, nrow);
+
+    csr_sort_columns(nrow, this->mat_.row_offset, this->mat_.col, this->mat_.val);
+
+    LOG_INFO("ReadFileCSR: filename="<< filename << "; done");
+
+    return;
+  }
+
+  out.seekg(0, std::ios_base::end);
+  const uint64_t file_size = uint64_t(out.tellg());
+
+  const bool swap = csr_file_check_header(&header, file_size, filename);
+
+  const int nrow = int(header.nrow);
+  const int ncol = int(header.ncol);
+  const int nnz = int(header.nnz);
+  const uint64_t value_size = csr_file_value_size(header.value_type);
 
   this->AllocateCSR(nnz, nrow, ncol);
 
+  if (nnz == 0) {
+    out.close();
+    LOG_INFO("ReadFileCSR: filename="<< filename << "; done");
+    return;
+  }
+
+  // values of another type are converted after the checksum
+  const bool convert = (header.value_type != csr_file_value_type(this->mat_.val));
+  char *val = (char*) this->mat_.val;
+  if (convert == true)
+    val = new char[size_t(nnz*value_size)];
+
+  out.seekg(std::streamoff(header.row_offset_pos), std::ios_base::beg);
   out.read((char*)this->mat_.row_offset, (nrow+1)*sizeof(int));
+  out.seekg(std::streamoff(header.col_pos), std::ios_base::beg);
   out.read((char*)this->mat_.col, nnz*sizeof(int));
-  out.read((char*)this->mat_.val, nnz*sizeof(ValueType));
+  out.seekg(std::streamoff(header.val_pos), std::ios_base::beg);
+  out.read(val, nnz*value_size);
+
+  const bool read_ok = !out.fail();
+  out.close();
+
+  _set_omp_backend_threads(this->local_backend_, nnz);
+
+  if ((read_ok == false) ||
+      (csr_file_checksum((const char*)this->mat_.row_offset, (nrow+1)*sizeof(int),
+                         (const char*)this->mat_.col, nnz*sizeof(int),
+                         val, nnz*value_size) != header.checksum)) {
+    if (convert == true)
+      delete[] val;
+    LOG_INFO("ReadFileCSR checksum mismatch in file " << filename);
+    FATAL_ERROR(__FILE__, __LINE__);
+  }
+
+  if (swap == true) {
+    csr_file_swap_bytes((char*)this->mat_.row_offset, nrow+1, sizeof(int));
+    csr_file_swap_bytes((char*)this->mat_.col, nnz, sizeof(int));
+    csr_file_swap_bytes(val, nnz, int(value_size));
+  }
+
+  if (convert == true) {
+
+    if (header.value_type == 1) {
+      const float *file_val = (const float*) val;
+#pragma omp parallel for
+      for (int i=0; i<nnz; ++i)
+        this->mat_.val[i] = ValueType(file_val[i]);
+    } else {
+      const double *file_val = (const double*) val;
+#pragma omp parallel for
+      for (int i=0; i<nnz; ++i)
+        this->mat_.val[i] = ValueType(file_val[i]);
+    }
+
+    delete[] val;
+  }
+
+  if (header.sorted == 0) {
+    _set_omp_backend_threads(this->local_backend_, nrow);
+    csr_sort_columns(nrow, this->mat_.row_offset, this->mat_.col, this->mat_.val);
+  }
 
   LOG_INFO("ReadFileCSR: filename="<< filename << "; done");
 
-  out.close();
+}
 
-  // Sorting the col (per row)
-  // Bubble sort algorithm
+template <typename ValueType>
+void HostMatrixCSR<ValueType>::MapFileCSR(const std::string filename, const bool verify) {
 
- #pragma omp parallel for      
-  for (int i=0; i<nrow; ++i)
-    for (int j=this->mat_.row_offset[i]; j<this->mat_.row_offset[i+1]; ++j)
-      for (int jj=this->mat_.row_offset[i]; jj<this->mat_.row_offset[i+1]-1; ++jj)
-        if (this->mat_.col[jj] > this->mat_.col[jj+1]) {
-          //swap elements
+  LOG_INFO("MapFileCSR: filename="<< filename << "; mapping...");
 
-          int ind = this->mat_.col[jj];
-          ValueType val = this->mat_.val[jj];
+  this->Clear();
 
-          this->mat_.col[jj] = this->mat_.col[jj+1];
-          this->mat_.val[jj] = this->mat_.val[jj+1];          
+  // Copy-on-write view - the pages are shared through the page cache
+  // until the matrix modifies them, the file is never changed
+  ParalutionMappedFile *file = new ParalutionMappedFile;
 
-          this->mat_.col[jj+1] = ind;
-          this->mat_.val[jj+1] = val;
-        }
+  if (file->Open(filename, true) == false) {
+    delete file;
+    LOG_INFO("MapFileCSR cannot open file " << filename);
+    FATAL_ERROR(__FILE__, __LINE__);
+  }
+
+  ParalutionCSRFileHeader header;
+
+  if ((file->get_size() < sizeof(header)) ||
+      (memcmp(file->get_data(), csr_file_magic, sizeof(csr_file_magic)) != 0)) {
+    delete file;
+    LOG_INFO("MapFileCSR headerless file, reading it");
+    this->ReadFileCSR(filename);
+    return;
+  }
+
+  memcpy(&header, file->get_data(), sizeof(header));
+
+  const bool swap = csr_file_check_header(&header, file->get_size(), filename);
+
+  // the arrays can be used only in the native layout and without conversion
+  if ((swap == true) || (header.nnz == 0) ||
+      (header.value_type != csr_file_value_type(this->mat_.val))) {
+    delete file;
+    LOG_INFO("MapFileCSR byte order or value type differ, reading the file");
+    this->ReadFileCSR(filename);
+    return;
+  }
+
+  char *data = file->get_writable_data();
 
+  // verifying reads the whole file (and loads it to the page cache)
+  if (verify == true) {
+
+    _set_omp_backend_threads(this->local_backend_, int(header.nnz));
+
+    if (csr_file_checksum(data + header.row_offset_pos, (header.nrow+1)*sizeof(int),
+                          data + header.col_pos, header.nnz*sizeof(int),
+                          data + header.val_pos, header.nnz*sizeof(ValueType)) != header.checksum) {
+      delete file;
+      LOG_INFO("MapFileCSR checksum mismatch in file " << filename);
+      FATAL_ERROR(__FILE__, __LINE__);
+    }
+
+  }
+
+  this->mat_.row_offset = (int*) (data + header.row_offset_pos);
+  this->mat_.col = (int*) (data + header.col_pos);
+  this->mat_.val = (ValueType*) (data + header.val_pos);
+
+  this->nrow_ = int(header.nrow);
+  this->ncol_ = int(header.ncol);
+  this->nnz_  = int(header.nnz);
+
+  this->mapped_file_ = file;
+
+  if (header.sorted == 0) {
+    _set_omp_backend_threads(this->local_backend_, this->nrow_);
+    csr_sort_columns(this->nrow_, this->mat_.row_offset, this->mat_.col, this->mat_.val);
+  }
+
+  LOG_INFO("MapFileCSR: filename="<< filename << "; done");
+
+}
+
+template <typename ValueType>
+void HostMatrixCSR<ValueType>::DetachMappedFile(void) {
+
+  if (this->mapped_file_ == NULL)
+    return;
+
+  // the matrix takes the arrays over - copy them to the host memory
+  int *row_offset = NULL;
+  int *col = NULL;
+  ValueType *val = NULL;
+
+  allocate_host(this->nrow_+1, &row_offset);
+  allocate_host(this->nnz_, &col);
+  allocate_host(this->nnz_, &val);
+
+  memcpy(row_offset, this->mat_.row_offset, (this->nrow_+1)*sizeof(int));
+  memcpy(col, this->mat_.col, this->nnz_*sizeof(int));
+  memcpy(val, this->mat_.val, this->nnz_*sizeof(ValueType));
+
+  delete this->mapped_file_;
+  this->mapped_file_ = NULL;
+
+  this->mat_.row_offset = row_offset;
+  this->mat_.col = col;
+  this->mat_.val = val;
 
 }
 
@@ -450,12 +821,60 @@ void HostMatrixCSR<ValueType>::WriteFileCSR(const std::string filename) const {
 
   std::ofstream out(filename.c_str(), std::ios::out | std::ios::binary);
 
-  out.write((char*)&this->nrow_, sizeof(int));
-  out.write((char*)&this->ncol_, sizeof(int));
-  out.write((char*)&this->nnz_, sizeof(int));
-  out.write((char*)this->mat_.row_offset, (this->nrow_+1)*sizeof(int));
-  out.write((char*)this->mat_.col, this->nnz_*sizeof(int));
-  out.write((char*)this->mat_.val, this->nnz_*sizeof(ValueType));
+  if (!out.is_open()) {
+    LOG_INFO("WriteFileCSR cannot open file " << filename);
+    FATAL_ERROR(__FILE__, __LINE__);
+  }
+
+  const uint64_t row_offset_size = (this->nnz_ > 0) ? (this->nrow_+1)*sizeof(int) : 0;
+  const uint64_t col_size = this->nnz_*sizeof(int);
+  const uint64_t val_size = this->nnz_*sizeof(ValueType);
+
+  ParalutionCSRFileHeader header;
+  memset(&header, 0, sizeof(header));
+
+  memcpy(header.magic, csr_file_magic, sizeof(csr_file_magic));
+  header.version = csr_file_version;
+  header.endianness = csr_file_endianness;
+  header.index_size = sizeof(int);
+  header.value_type = csr_file_value_type(this->mat_.val);
+  header.nrow = this->nrow_;
+  header.ncol = this->ncol_;
+  header.nnz = this->nnz_;
+  header.row_offset_pos = csr_file_align(sizeof(header));
+  header.col_pos = csr_file_align(header.row_offset_pos + row_offset_size);
+  header.val_pos = csr_file_align(header.col_pos + col_size);
+
+  _set_omp_backend_threads(this->local_backend_, this->nnz_);
+
+  header.checksum = csr_file_checksum((const char*)this->mat_.row_offset, row_offset_size,
+                                      (const char*)this->mat_.col, col_size,
+                                      (const char*)this->mat_.val, val_size);
+
+  bool sorted = true;
+  if (this->nnz_ > 0) {
+#pragma omp parallel for reduction(&&:sorted)
+    for (int i=0; i<this->nrow_; ++i)
+      for (int j=this->mat_.row_offset[i]+1; j<this->mat_.row_offset[i+1]; ++j)
+        if (this->mat_.col[j-1] > this->mat_.col[j])
+          sorted = false;
+  }
+  header.sorted = sorted ? 1 : 0;
+
+  const char padding[csr_file_alignment] = { 0 };
+
+  out.write((char*)&header, sizeof(header));
+  out.write(padding, header.row_offset_pos - sizeof(header));
+  out.write((char*)this->mat_.row_offset, row_offset_size);
+  out.write(padding, header.col_pos - header.row_offset_pos - row_offset_size);
+  out.write((char*)this->mat_.col, col_size);
+  out.write(padding, header.val_pos - header.col_pos - col_size);
+  out.write((char*)this->mat_.val, val_size);
+
+  if (out.fail()) {
+    LOG_INFO("WriteFileCSR cannot write file " << filename);
+    FATAL_ERROR(__FILE__, __LINE__);
+  }
 
   LOG_INFO("WriteFileCSR: filename="<< filename << "; done");
 
@@ -2800,6 +3219,8 @@ bool HostMatrixCSR<ValueType>::Permute(const BaseVector<int> &permutation) {
 
   if( this->nnz_ > 0 ) {
 
+    this->DetachMappedFile();
+
     const HostVector<int> *cast_perm = dynamic_cast<const HostVector<int>*>(&permutation);
     assert(cast_perm != NULL);
 
@@ -3571,6 +3992,8 @@ bool HostMatrixCSR<ValueType>::FSAI(const int power, const BaseMatrix<ValueType>
 template <typename ValueType>
 void HostMatrixCSR<ValueType>::SPAI(void) {
 
+  this->DetachMappedFile();
+
   int nrow = this->nrow_;
   int nnz  = this->nnz_;
 
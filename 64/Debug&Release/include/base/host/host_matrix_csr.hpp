@@ -33,6 +33,8 @@
 
 namespace paralution {
 
+class ParalutionMappedFile;
+
 template <typename ValueType>
 class HostMatrixCSR : public HostMatrix<ValueType> {
   
@@ -127,6 +129,7 @@ public:
 
   virtual void ReadFileCSR(const std::string);
   virtual void WriteFileCSR(const std::string) const;
+  virtual void MapFileCSR(const std::string, const bool);
 
   virtual bool CreateFromMap(const BaseVector<int> &map, const int n, const int m);
 
@@ -183,6 +186,11 @@ private:
 
   MatrixCSR<ValueType, int> mat_;
 
+  // Mapped file holding the arrays (MapFileCSR), NULL for host memory
+  ParalutionMappedFile *mapped_file_;
+  // Copy the mapped arrays to host memory
+  void DetachMappedFile(void);
+
   friend class BaseVector<ValueType>;
   friend class HostVector<ValueType>;
   friend class HostMatrixCOO<ValueType>;
@@ -30,6 +30,7 @@
 #include "../../utils/log.hpp"
 #include "../../utils/allocate_free.hpp"
 #include "../../utils/math_functions.hpp"
+#include "../../utils/ascii_io.hpp"
 
 #include <typeinfo>
 #include <stdlib.h>
@@ -313,83 +314,93 @@ void HostVector<ValueType>::SetRandom(const ValueType a, const ValueType b, cons
 
 }
 
-template <typename ValueType>
-void HostVector<ValueType>::ReadFileASCII(const std::string filename) {
+// Convert one line as atof() does
+static void ascii_line_value(const char *line, const char *line_end, double *val) {
 
-  std::ifstream file;
-  std::string line;
-  int n = 0;
+  if (parse_ascii_double(&line, line_end, val) == false)
+    *val = 0.0;
 
-  LOG_INFO("ReadFileASCII: filename="<< filename << "; reading...");
+}
 
-  file.open((char*)filename.c_str(), std::ifstream::in);
-   
-  if (!file.is_open()) {
-    LOG_INFO("Can not open vector file [read]:" << filename);
-    FATAL_ERROR(__FILE__, __LINE__);
-  }
+// Convert one line as atof() does
+static void ascii_line_value(const char *line, const char *line_end, float *val) {
 
-  this->Clear();
-  
-  // get the size of the vector
-  while (std::getline(file, line))
-    ++n;
+  double tmp;
+  ascii_line_value(line, line_end, &tmp);
+  *val = float(tmp);
 
-  this->Allocate(n);
+}
 
-  file.clear();
-  file.seekg(0, std::ios_base::beg);
-  n = 0 ;
+// Convert one line as atoi() does
+static void ascii_line_value(const char *line, const char *line_end, int *val) {
 
-  while (std::getline(file, line)) {
-    
-    this->vec_[n] = ValueType(atof(line.c_str()));
-    ++n;
-    
-  }
+  if (parse_ascii_int(&line, line_end, val) == false)
+    *val = 0;
 
-  file.close();
+}
 
-  LOG_INFO("ReadFileASCII: filename="<< filename << "; done");
+// Count the lines in [begin, end)
+static int ascii_count_lines(const char *begin, const char *end) {
+
+  int n = 0;
+
+  for (const char *line = begin; line < end; line = ascii_next_line(line, end))
+    ++n;
+
+  return n;
 
 }
 
-template <>
-void HostVector<int>::ReadFileASCII(const std::string filename) {
+template <typename ValueType>
+void HostVector<ValueType>::ReadFileASCII(const std::string filename) {
 
-  std::ifstream file;
-  std::string line;
-  int n = 0;
+  ParalutionMappedFile file;
 
   LOG_INFO("ReadFileASCII: filename="<< filename << "; reading...");
 
-  file.open((char*)filename.c_str(), std::ifstream::in);
-   
-  if (!file.is_open()) {
+  if (file.Open(filename) == false) {
     LOG_INFO("Can not open vector file [read]:" << filename);
     FATAL_ERROR(__FILE__, __LINE__);
   }
 
   this->Clear();
-  
+
+  // One value per line - each thread counts and then converts a block of lines
+  const char *data = file.get_data();
+  const int num_chunks = (this->local_backend_.OpenMP_threads > 1) ? this->local_backend_.OpenMP_threads : 1;
+  size_t *bounds = new size_t[num_chunks+1];
+  int *offset = new int[num_chunks+1];
+
+  split_ascii_lines(data, 0, file.get_size(), num_chunks, bounds);
+
+  _set_omp_backend_threads(this->local_backend_,
+                           (file.get_size() < size_t(std::numeric_limits<int>::max())) ? int(file.get_size()) : std::numeric_limits<int>::max());
+
   // get the size of the vector
-  while (std::getline(file, line))
-    ++n;
+#pragma omp parallel for
+  for (int i=0; i<num_chunks; ++i)
+    offset[i+1] = ascii_count_lines(data + bounds[i], data + bounds[i+1]);
 
-  this->Allocate(n);
+  offset[0] = 0;
+  for (int i=0; i<num_chunks; ++i)
+    offset[i+1] += offset[i];
 
-  file.clear();
-  file.seekg(0, std::ios_base::beg);
-  n = 0 ;
+  this->Allocate(offset[num_chunks]);
 
-  while (std::getline(file, line)) {
-    
-    this->vec_[n] = atoi(line.c_str());
-    ++n;
-    
+#pragma omp parallel for
+  for (int i=0; i<num_chunks; ++i) {
+
+    const char *chunk_end = data + bounds[i+1];
+    int n = offset[i];
+
+    for (const char *line = data + bounds[i]; line < chunk_end; line = ascii_next_line(line, chunk_end)) {
+      ascii_line_value(line, ascii_line_end(line, chunk_end), &this->vec_[n]);
+      ++n;
+    }
   }
 
-  file.close();
+  delete[] bounds;
+  delete[] offset;
 
   LOG_INFO("ReadFileASCII: filename="<< filename << "; done");
 
@@ -788,6 +788,33 @@ void LocalMatrix<ValueType>::ReadFileCSR(const std::string filename) {
 
 }
 
+template <typename ValueType>
+void LocalMatrix<ValueType>::MapFileCSR(const std::string filename, const bool verify) {
+
+  LOG_DEBUG(this, "LocalMatrix::MapFileCSR()",
+            filename << " verify=" << verify);
+
+  // Only CSR host can map
+
+  this->Clear();
+
+  bool on_host = this->is_host();
+  if (on_host == false)
+    this->MoveToHost();
+
+  const unsigned int mat_format = this->get_format();
+  this->ConvertToCSR();
+  this->matrix_host_->MapFileCSR(filename, verify);
+  this->ConvertTo(mat_format);
+
+  // no Check() - the arrays are loaded on first use
+  this->object_name_ = filename; 
+
+  if (on_host == false)
+    this->MoveToAccelerator();
+
+}
+
 template <typename ValueType>
 void LocalMatrix<ValueType>::WriteFileCSR(const std::string filename) const {
 
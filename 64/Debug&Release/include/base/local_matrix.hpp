@@ -257,6 +257,11 @@ public:
   void ReadFileCSR(const std::string filename);
   /// Write matrix to CSR (PARALUTION binary format) file
   void WriteFileCSR(const std::string filename) const;
+  /// Read matrix from CSR (PARALUTION binary format) file by mapping it
+  /// into memory - a CSR matrix on the host uses the (copy-on-write)
+  /// mapped arrays directly, the pages are shared through the page cache;
+  /// the checksum is verified (the whole file is read once) unless verify is false
+  void MapFileCSR(const std::string filename, const bool verify=true);
   
   virtual void MoveToAccelerator(void);
   virtual void MoveToAcceleratorAsync(void);
@@ -0,0 +1,336 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __H2D_KELLY_ERROR_CALCULATOR_H
+#define __H2D_KELLY_ERROR_CALCULATOR_H
+
+#include "error_calculator.h"
+#include "../interface_edge_cache.h"
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    /// Kelly-type interface estimator - the squared jump of the normal derivative across an inner edge.
+    /// \ingroup g_adapt
+    /// The form acts on the coarse solution only (there is no reference solution), and it is scaled by the edge
+    /// length (the sum of the surface weights) times scaling_const, which gives the classical
+    /// h / (24 K) * || [du/dn] ||^2 contribution of the Kelly estimator for -K \Delta u = f.
+    template<typename Scalar>
+    class KellyJumpNormFormDG : public NormFormDG < Scalar >
+    {
+    public:
+      /// Constructor.
+      /// \param[in] i Component.
+      /// \param[in] scaling_const Constant multiplying the edge contribution.
+      KellyJumpNormFormDG(int i, double scaling_const) : NormFormDG<Scalar>(i, i), scaling_const(scaling_const)
+      {
+        this->functionType = CoarseSolutions;
+      }
+
+      /// NormFormDG has no virtual destructor, the owner deletes the forms through this type.
+      virtual ~KellyJumpNormFormDG()
+      {
+      }
+
+      virtual Scalar value(int n, double *wt, DiscontinuousFunc<Scalar> *u, DiscontinuousFunc<Scalar> *, GeomSurf<double> *e) const
+      {
+        double edge_length = 0.;
+        for (int i = 0; i < n; i++)
+          edge_length += wt[i];
+
+        double result = 0.;
+        for (int i = 0; i < n; i++)
+        {
+          Scalar jump = e->nx[i] * (u->dx[i] - u->dx_neighbor[i]) + e->ny[i] * (u->dy[i] - u->dy_neighbor[i]);
+          result += wt[i] * Hermes::sqr(jump);
+        }
+
+        return this->scaling_const * edge_length * result;
+      }
+
+    protected:
+      /// Scaling, see the class description.
+      double scaling_const;
+    };
+
+    /// Carrier of the edge-based interface estimates into the element-based ErrorCalculator.
+    /// \ingroup g_adapt
+    /// The edge contributions are evaluated beforehand by KellyErrorCalculator (each interior edge once) and stored
+    /// as densities (element estimate / element area), this form only integrates the density over the element,
+    /// which gives the right result also when only a part of the element is traversed (multi-mesh).
+    template<typename Scalar>
+    class KellyInterfaceNormFormVol : public NormFormVol < Scalar >
+    {
+    public:
+      /// Constructor.
+      /// \param[in] i Component.
+      /// \param[in] densities Densities indexed by element ids, owned by the caller.
+      KellyInterfaceNormFormVol(int i, const std::vector<double>* densities) : NormFormVol<Scalar>(i, i), densities(densities)
+      {
+        this->functionType = CoarseSolutions;
+      }
+
+      /// NormFormVol has no virtual destructor, the owner deletes the forms through this type.
+      virtual ~KellyInterfaceNormFormVol()
+      {
+      }
+
+      virtual Scalar value(int n, double *wt, Func<Scalar> *, Func<Scalar> *, GeomVol<double> *e) const
+      {
+        if (e->id >= (int)this->densities->size())
+          return Scalar(0);
+
+        double area = 0.;
+        for (int i = 0; i < n; i++)
+          area += wt[i];
+        return Scalar(area * (*this->densities)[e->id]);
+      }
+
+    protected:
+      const std::vector<double>* densities;
+    };
+
+    /// Explicit residual (Kelly-type) a-posteriori error estimator.
+    /// \ingroup g_adapt
+    /// Computes element error indicators from the (coarse) solution only, so no reference mesh / reference space
+    /// and no solve on them is ever needed.
+    /// By default, the estimator consists of the jumps of the normal derivative across inner edges,
+    /// which is the original Kelly estimator for the Laplace equation.
+    /// The jumps are evaluated edge-based: every interior edge segment is visited exactly once (in parallel),
+    /// and its contribution is added to both adjacent elements. The neighbor data (see InterfaceEdgeCache) are kept
+    /// between adaptivity steps, only elements created or touched by the refinement are searched again.
+    /// Alternatively (edge_based_interface_estimation == false), the jumps are evaluated by KellyJumpNormFormDG from both
+    /// sides of every edge; the resulting estimates are the same.
+    /// Problem-specific element residuals (f + K \Delta u, ...) and boundary residuals (g - K du/dn on Neumann
+    /// boundaries, ...) are added through ErrorCalculator::add_error_form(); such forms should evaluate
+    /// the coarse solutions (NormForm::functionType == CoarseSolutions).
+    /// Usage:
+    /// KellyErrorCalculator<double> error_calculator(AbsoluteError, 1);
+    /// error_calculator.calculate_errors(sln);
+    /// Adapt<double> adaptivity(space, &error_calculator);
+    template<typename Scalar>
+    class KellyErrorCalculator : public ErrorCalculator < Scalar >
+    {
+    public:
+      /// Constructor.
+      /// \param[in] errorType Absolute / relative error. The norms used for relative errors are evaluated by
+      /// the (user-added) forms from the very same solutions.
+      /// \param[in] component_count Number of solution components.
+      /// \param[in] const_by_laplacian For the equation -K \Delta u = f, this is K.
+      /// \param[in] use_default_interface_forms Estimate the jumps of the normal derivative for every component.
+      /// \param[in] edge_based_interface_estimation Evaluate the jumps edge-based, see the class description.
+      KellyErrorCalculator(CalculatedErrorType errorType, int component_count, double const_by_laplacian = 1.0, bool use_default_interface_forms = true, bool edge_based_interface_estimation = true)
+        : ErrorCalculator<Scalar>(errorType), interface_scaling_const(1. / (24. * const_by_laplacian)), edge_based_interface_estimation(use_default_interface_forms && edge_based_interface_estimation)
+      {
+        this->component_count = component_count;
+        if (this->edge_based_interface_estimation)
+        {
+          this->interface_densities.resize(component_count);
+          for (int i = 0; i < component_count; i++)
+          {
+            this->interface_caches.push_back(new InterfaceEdgeCache<Scalar>());
+            KellyInterfaceNormFormVol<Scalar>* form = new KellyInterfaceNormFormVol<Scalar>(i, &this->interface_densities[i]);
+            this->add_error_form(form);
+            this->own_vol_forms.push_back(form);
+          }
+        }
+        else if (use_default_interface_forms)
+        {
+          for (int i = 0; i < component_count; i++)
+          {
+            KellyJumpNormFormDG<Scalar>* form = new KellyJumpNormFormDG<Scalar>(i, this->interface_scaling_const);
+            this->add_error_form(form);
+            this->own_forms.push_back(form);
+          }
+        }
+      }
+
+      virtual ~KellyErrorCalculator()
+      {
+        for (unsigned int i = 0; i < this->own_forms.size(); i++)
+          delete this->own_forms[i];
+        for (unsigned int i = 0; i < this->own_vol_forms.size(); i++)
+          delete this->own_vol_forms[i];
+        for (unsigned int i = 0; i < this->interface_caches.size(); i++)
+          delete this->interface_caches[i];
+      }
+
+      using ErrorCalculator<Scalar>::calculate_errors;
+
+      /// Calculates the error estimates of the passed solutions.
+      /// \param[in] sort_and_store If true, these errors are going to be sorted, stored and used for the purposes of adaptivity.
+      void calculate_errors(std::vector<MeshFunctionSharedPtr<Scalar> > solutions, bool sort_and_store = true)
+      {
+        if (this->edge_based_interface_estimation)
+          this->calculate_interface_estimates(solutions);
+        ErrorCalculator<Scalar>::calculate_errors(solutions, solutions, sort_and_store);
+      }
+
+      /// Calculates the error estimates of the passed solution.
+      /// \param[in] sort_and_store If true, these errors are going to be sorted, stored and used for the purposes of adaptivity.
+      void calculate_errors(MeshFunctionSharedPtr<Scalar> solution, bool sort_and_store = true)
+      {
+        std::vector<MeshFunctionSharedPtr<Scalar> > solutions;
+        solutions.push_back(solution);
+        this->calculate_errors(solutions, sort_and_store);
+      }
+
+      /// Absolute / relative error.
+      CalculatedErrorType get_error_type() const
+      {
+        return this->errorType;
+      }
+
+      /// The cache of the inner edges of the i-th component (nullptr if the interfaces are not estimated edge-based).
+      const InterfaceEdgeCache<Scalar>* get_interface_cache(int component) const
+      {
+        return this->edge_based_interface_estimation ? this->interface_caches[component] : nullptr;
+      }
+
+    protected:
+      inline std::string getClassName() const { return "KellyErrorCalculator"; }
+
+      /// Edge-based evaluation of the jumps of the normal derivatives, the results are stored in interface_densities.
+      void calculate_interface_estimates(std::vector<MeshFunctionSharedPtr<Scalar> >& solutions)
+      {
+        if ((int)solutions.size() != this->component_count)
+          throw Exceptions::LengthException(0, solutions.size(), this->component_count);
+
+        int num_threads_used = std::max<int>(1, HermesCommonApi.get_integral_param_value(numThreads));
+        for (int component = 0; component < this->component_count; component++)
+        {
+          MeshSharedPtr mesh = solutions[component]->get_mesh();
+          InterfaceEdgeCache<Scalar>* cache = this->interface_caches[component];
+          cache->update(mesh);
+          const std::vector<InterfaceSegment>& segments = cache->get_segments();
+
+          std::vector<double>& densities = this->interface_densities[component];
+          densities.assign(mesh->get_max_element_id(), 0.);
+
+          std::string exceptionMessageCaughtInParallelBlock;
+#pragma omp parallel num_threads(num_threads_used)
+          {
+            MeshFunction<Scalar>* fn = solutions[component]->clone();
+            fn->set_quad_2d(&g_quad_2d_std);
+            std::vector<double> thread_estimates(densities.size(), 0.);
+
+#pragma omp for schedule(dynamic, 256)
+            for (int i = 0; i < (int)segments.size(); i++)
+            {
+              if (!exceptionMessageCaughtInParallelBlock.empty())
+                continue;
+              try
+              {
+                double estimate = this->evaluate_interface_segment(fn, mesh.get(), segments[i]);
+                thread_estimates[segments[i].central_id] += estimate;
+                thread_estimates[segments[i].neighbor_id] += estimate;
+              }
+              catch (std::exception& exception)
+              {
+#pragma omp critical (exceptionMessageCaughtInParallelBlock)
+                exceptionMessageCaughtInParallelBlock = exception.what();
+              }
+            }
+
+#pragma omp critical (interface_estimates)
+            for (unsigned int id = 0; id < densities.size(); id++)
+              densities[id] += thread_estimates[id];
+
+            delete fn;
+          }
+          if (!exceptionMessageCaughtInParallelBlock.empty())
+            throw Exceptions::Exception(exceptionMessageCaughtInParallelBlock.c_str());
+
+          Element* e;
+          for_all_active_elements(e, mesh)
+            densities[e->id] /= cache->get_element_area(e->id);
+        }
+      }
+
+      /// The jump estimate h / (24 K) * || [du/dn] ||^2 on one segment.
+      double evaluate_interface_segment(MeshFunction<Scalar>* fn, Mesh* mesh, const InterfaceSegment& segment)
+      {
+        Element* central = mesh->get_element_fast(segment.central_id);
+        Element* neighbor = mesh->get_element_fast(segment.neighbor_id);
+        Quad2D* quad = fn->get_quad_2d();
+
+        // Integration order.
+        fn->set_active_element(neighbor);
+        for (unsigned char level = 0; level < segment.neighbor_n_trans; level++)
+          fn->push_transform(segment.neighbor_transformations[level]);
+        int neighbor_order = fn->get_edge_fn_order(segment.neighbor_edge);
+        fn->set_active_element(central);
+        int central_order = fn->get_edge_fn_order(segment.central_edge);
+        int order = 2 * std::max(central_order, neighbor_order) + fn->get_refmap()->get_inv_ref_order();
+        order = std::min<int>(order, std::min(quad->get_max_order(central->get_mode()), quad->get_max_order(neighbor->get_mode())));
+
+        // Central element.
+        unsigned short eo = quad->get_edge_points(segment.central_edge, order, central->get_mode());
+        unsigned char np = quad->get_num_points(eo, central->get_mode());
+        double3* pt = quad->get_points(eo, central->get_mode());
+        fn->set_quad_order(eo, H2D_FN_DX_0 | H2D_FN_DY_0);
+
+        GeomSurf<double> geometry;
+        double3* tan;
+        init_geom_surf_allocated(geometry, fn->get_refmap(), segment.central_edge, central->en[segment.central_edge]->marker, eo, tan);
+
+        double wt[H2D_MAX_INTEGRATION_POINTS_COUNT];
+        Scalar normal_derivative[H2D_MAX_INTEGRATION_POINTS_COUNT];
+        const Scalar* dx = fn->get_dx_values();
+        const Scalar* dy = fn->get_dy_values();
+        double edge_length = 0.;
+        for (unsigned char i = 0; i < np; i++)
+        {
+          wt[i] = pt[i][2] * tan[i][2];
+          edge_length += wt[i];
+          normal_derivative[i] = geometry.nx[i] * dx[i] + geometry.ny[i] * dy[i];
+        }
+
+        // Neighbor, the normal is the one of the central element.
+        fn->set_active_element(neighbor);
+        for (unsigned char level = 0; level < segment.neighbor_n_trans; level++)
+          fn->push_transform(segment.neighbor_transformations[level]);
+        fn->set_quad_order(quad->get_edge_points(segment.neighbor_edge, order, neighbor->get_mode()), H2D_FN_DX_0 | H2D_FN_DY_0);
+        dx = fn->get_dx_values();
+        dy = fn->get_dy_values();
+
+        double result = 0.;
+        for (unsigned char i = 0; i < np; i++)
+        {
+          unsigned char neighbor_i = segment.orientation ? np - 1 - i : i;
+          Scalar jump = normal_derivative[i] - (geometry.nx[i] * dx[neighbor_i] + geometry.ny[i] * dy[neighbor_i]);
+          result += wt[i] * Hermes::sqr(jump);
+        }
+
+        return this->interface_scaling_const * edge_length * result;
+      }
+
+      /// Scaling of the interface jumps.
+      double interface_scaling_const;
+      /// See the class description.
+      bool edge_based_interface_estimation;
+
+      /// Edge-based interface estimation - caches and results (densities) per component.
+      std::vector<InterfaceEdgeCache<Scalar>*> interface_caches;
+      std::vector<std::vector<double> > interface_densities;
+
+      /// Forms created by this instance.
+      std::vector<KellyJumpNormFormDG<Scalar>*> own_forms;
+      std::vector<KellyInterfaceNormFormVol<Scalar>*> own_vol_forms;
+    };
+  }
+}
+#endif
@@ -0,0 +1,701 @@
+// This file is part of Hermes2D
+//
+// Copyright (c) 2009 hp-FEM group at the University of Nevada, Reno (UNR).
+// Email: hpfem-group@unr.edu, home page: http://hpfem.org/.
+//
+// Hermes2D is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published
+// by the Free Software Foundation; either version 2 of the License,
+// or (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+/*! \file calculation_continuity_hdf5.h
+\brief Calculation continuity (checkpointing) in one HDF5 file.
+*/
+#ifndef __H2D_CALCULATION_CONTINUITY_HDF5_H
+#define __H2D_CALCULATION_CONTINUITY_HDF5_H
+
+#include "function/solution.h"
+#include "mesh/mesh_reader_h2d_binary.h"
+#include "space/space_description.h"
+#include "hdf5_mutex.h"
+
+#include <hdf5.h>
+#include <pthread.h>
+#include <deque>
+#include <algorithm>
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    /// \brief Checkpointing of a calculation into one HDF5 file (link with hdf5.lib).
+    ///
+    /// Replaces the per-entity XML / BSON files of CalculationContinuity: each record is one group "/record_<number>" with
+    /// - attributes time, number, time_step, time_step_n_minus_one, error,<br>
+    /// - datasets mesh_<i> (the mesh in the MeshReaderH2DBinary format, as bytes),<br>
+    /// - datasets space_<i> (encoded orders indexed by element id, -1 for inactive elements; attributes type and mesh index),<br>
+    /// - dataset coefficients (the coefficient vector of all spaces, complex numbers as pairs of doubles).<br>
+    /// All datasets are chunked and deflate-compressed. The root group holds the attribute last_record,
+    /// so that restarting reads only the last record (load_last_record()).<br>
+    /// With asynchronous writes, add_record() only takes the (in-memory) record, and it is written by a background thread.
+    /// The HDF5 library of this bundle is not thread-safe, so all HDF5 calls are serialized by hdf5_monitor();
+    /// other HDF5 users (e.g. MATIO) must not run concurrently with the writer thread.<br>
+    /// The C API is used rather than the C++ one (cpp/H5Cpp.h): hdf5_cpp.dll passes std::string and exceptions across the DLL boundary,
+    /// and the bundle has one build of it for both the Debug and the Release runtime.
+    ///
+    /// Typical usage:<br>
+    /// CalculationContinuityHDF5<double> continuity("checkpoint.h5");<br>
+    /// if (continuity.have_record_available())<br>
+    /// {<br>
+    ///   CalculationContinuityHDF5<double>::Record* record = continuity.load_last_record();<br>
+    ///   record->load_mesh(mesh);<br>
+    ///   space = record->load_spaces(std::vector<MeshSharedPtr>(1, mesh), std::vector<EssentialBCs<double>*>(1, &bcs))[0];<br>
+    ///   record->load_solution(sln, space);<br>
+    /// }<br>
+    /// ...<br>
+    /// CalculationContinuityHDF5<double>::Record* record = new CalculationContinuityHDF5<double>::Record(time, step);<br>
+    /// record->save_mesh(mesh);<br>
+    /// record->save_space(space);<br>
+    /// record->save_coefficient_vector(newton.get_sln_vector(), space->get_num_dofs());<br>
+    /// continuity.add_record(record);<br>
+    template<typename Scalar>
+    class CalculationContinuityHDF5 : public Hermes::Mixins::Loggable
+    {
+    public:
+      /// One record of the calculation, held in memory. Saving only copies the data (cheap), loading builds the objects.
+      class Record
+      {
+      public:
+        Record(double time, unsigned int number) : time(time), number(number), time_step(0.), time_step_n_minus_one(0.), error(0.) {}
+
+        /// Saves vector of meshes.
+        void save_meshes(std::vector<MeshSharedPtr> meshes)
+        {
+          for (unsigned int i = 0; i < meshes.size(); i++)
+            this->save_mesh(meshes[i]);
+        }
+        /// Saves one mesh.
+        void save_mesh(MeshSharedPtr mesh)
+        {
+          MeshReaderH2DBinary writer;
+          this->meshes.push_back(std::vector<char>());
+          writer.save(mesh, this->meshes.back());
+          this->saved_meshes.push_back(mesh.get());
+        }
+
+        /// Saves vector of spaces.
+        /// The meshes of the spaces have to be saved first (save_meshes()).
+        void save_spaces(std::vector<SpaceSharedPtr<Scalar> > spaces)
+        {
+          for (unsigned int i = 0; i < spaces.size(); i++)
+            this->save_space(spaces[i]);
+        }
+        /// Saves one space.
+        void save_space(SpaceSharedPtr<Scalar> space)
+        {
+          MeshSharedPtr mesh = space->get_mesh();
+          int mesh_index = std::find(this->saved_meshes.begin(), this->saved_meshes.end(), mesh.get()) - this->saved_meshes.begin();
+          if (mesh_index == (int)this->saved_meshes.size())
+            throw Exceptions::Exception("CalculationContinuityHDF5::Record: the mesh of the space has to be saved before the space.");
+
+          this->spaces.push_back(SpaceDescription<Scalar>(space, mesh_index));
+        }
+
+        /// Saves the coefficient vector of all spaces (as the solvers return it).
+        void save_coefficient_vector(const Scalar* coefficient_vector, int ndof)
+        {
+          this->coefficients.assign(coefficient_vector, coefficient_vector + ndof);
+        }
+
+        /// Saves the time step length.
+        void save_time_step_length(double time_step_length_to_save) { this->time_step = time_step_length_to_save; }
+        void save_time_step_length_n_minus_one(double time_step_length_to_save) { this->time_step_n_minus_one = time_step_length_to_save; }
+
+        /// Saves the spatial error estimate.
+        void save_error(double error) { this->error = error; }
+
+        /// Loads vector of meshes.
+        void load_meshes(std::vector<MeshSharedPtr> meshes)
+        {
+          if (meshes.size() != this->meshes.size())
+            throw Exceptions::LengthException(1, meshes.size(), this->meshes.size());
+          MeshReaderH2DBinary reader;
+          for (unsigned int i = 0; i < meshes.size(); i++)
+            reader.load(this->meshes[i].data(), this->meshes[i].size(), meshes[i], "checkpoint");
+        }
+        /// Loads one mesh.
+        void load_mesh(MeshSharedPtr mesh)
+        {
+          this->load_meshes(std::vector<MeshSharedPtr>(1, mesh));
+        }
+
+        /// Loads vector of spaces.
+        /// \param[in] meshes The meshes loaded by load_meshes().
+        /// \param[in] essential_bcs Either empty, or one (possibly nullptr) per space.
+        /// \param[in] shapesets Either empty, or one (possibly nullptr) per space.
+        std::vector<SpaceSharedPtr<Scalar> > load_spaces(std::vector<MeshSharedPtr> meshes, std::vector<EssentialBCs<Scalar>*> essential_bcs = std::vector<EssentialBCs<Scalar>*>(), std::vector<Shapeset*> shapesets = std::vector<Shapeset*>())
+        {
+          if (meshes.size() != this->meshes.size())
+            throw Exceptions::LengthException(1, meshes.size(), this->meshes.size());
+          if (!essential_bcs.empty() && essential_bcs.size() != this->spaces.size())
+            throw Exceptions::LengthException(2, essential_bcs.size(), this->spaces.size());
+          if (!shapesets.empty() && shapesets.size() != this->spaces.size())
+            throw Exceptions::LengthException(3, shapesets.size(), this->spaces.size());
+
+          std::vector<SpaceSharedPtr<Scalar> > loaded_spaces;
+          for (unsigned int i = 0; i < this->spaces.size(); i++)
+          {
+            const SpaceDescription<Scalar>& description = this->spaces[i];
+            EssentialBCs<Scalar>* bcs = essential_bcs.empty() ? nullptr : essential_bcs[i];
+            Shapeset* shapeset = shapesets.empty() ? nullptr : shapesets[i];
+            loaded_spaces.push_back(description.create_space(meshes[description.mesh], bcs, shapeset));
+          }
+          return loaded_spaces;
+        }
+
+        /// Loads the coefficient vector.
+        const std::vector<Scalar>& load_coefficient_vector() const
+        {
+          return this->coefficients;
+        }
+
+        /// Loads vector of solutions from the coefficient vector.
+        void load_solutions(std::vector<MeshFunctionSharedPtr<Scalar> > solutions, std::vector<SpaceSharedPtr<Scalar> > spaces)
+        {
+          if (Space<Scalar>::get_num_dofs(spaces) != (int)this->coefficients.size())
+            throw Exceptions::LengthException(2, Space<Scalar>::get_num_dofs(spaces), this->coefficients.size());
+          Solution<Scalar>::vector_to_solutions(this->coefficients.data(), spaces, solutions);
+        }
+        /// Loads one solution.
+        void load_solution(MeshFunctionSharedPtr<Scalar> solution, SpaceSharedPtr<Scalar> space)
+        {
+          this->load_solutions(std::vector<MeshFunctionSharedPtr<Scalar> >(1, solution), std::vector<SpaceSharedPtr<Scalar> >(1, space));
+        }
+
+        /// Loads the time step length.
+        void load_time_step_length(double & time_step_length) const { time_step_length = this->time_step; }
+        void load_time_step_length_n_minus_one(double & time_step_length) const { time_step_length = this->time_step_n_minus_one; }
+
+        /// Loads the spatial error estimate.
+        void load_error(double & error) const { error = this->error; }
+
+        /// Returns time.
+        double get_time() const { return this->time; }
+
+        /// Returns the number of the current record.
+        unsigned int get_number() const { return this->number; }
+
+      private:
+        double time;
+        unsigned int number;
+        double time_step;
+        double time_step_n_minus_one;
+        double error;
+
+        std::vector<std::vector<char> > meshes;
+        /// Only for matching spaces to meshes while saving.
+        std::vector<Mesh*> saved_meshes;
+        std::vector<SpaceDescription<Scalar> > spaces;
+        std::vector<Scalar> coefficients;
+
+        friend class CalculationContinuityHDF5 < Scalar > ;
+      };
+
+      /// Constructor.
+      /// \param[in] filename The HDF5 file, created by the first add_record() if it does not exist.
+      /// \param[in] asynchronous Write the records by a background thread.
+      CalculationContinuityHDF5(const char* filename, bool asynchronous = true) : filename(filename), asynchronous(asynchronous), stop(false), writing(false), last_record(nullptr)
+      {
+        pthread_mutex_init(&this->queue_mutex, nullptr);
+        pthread_cond_init(&this->queue_condition, nullptr);
+        if (this->asynchronous && pthread_create(&this->writer, nullptr, &CalculationContinuityHDF5<Scalar>::write_records, this) != 0)
+        {
+          pthread_cond_destroy(&this->queue_condition);
+          pthread_mutex_destroy(&this->queue_mutex);
+          throw Exceptions::Exception("CalculationContinuityHDF5: could not start the writer thread.");
+        }
+      }
+
+      virtual ~CalculationContinuityHDF5()
+      {
+        if (this->asynchronous)
+        {
+          pthread_mutex_lock(&this->queue_mutex);
+          this->stop = true;
+          pthread_cond_broadcast(&this->queue_condition);
+          pthread_mutex_unlock(&this->queue_mutex);
+          pthread_join(this->writer, nullptr);
+        }
+        pthread_cond_destroy(&this->queue_condition);
+        pthread_mutex_destroy(&this->queue_mutex);
+        for (unsigned int i = 0; i < this->queue.size(); i++)
+          delete this->queue[i];
+        delete this->last_record;
+      }
+
+      /// Adds a record, the record is deleted after being written.
+      void add_record(Record* record)
+      {
+        if (!this->asynchronous)
+        {
+          this->write_record(record);
+          delete record;
+          return;
+        }
+        pthread_mutex_lock(&this->queue_mutex);
+        std::string error = this->take_writer_error();
+        if (error.empty())
+        {
+          this->queue.push_back(record);
+          pthread_cond_broadcast(&this->queue_condition);
+        }
+        pthread_mutex_unlock(&this->queue_mutex);
+        if (!error.empty())
+        {
+          delete record;
+          throw Exceptions::Exception("CalculationContinuityHDF5: writing a record failed: %s", error.c_str());
+        }
+      }
+
+      /// Waits until all added records are written.
+      void flush()
+      {
+        if (!this->asynchronous)
+          return;
+        pthread_mutex_lock(&this->queue_mutex);
+        while (!this->queue.empty() || this->writing)
+          pthread_cond_wait(&this->queue_condition, &this->queue_mutex);
+        std::string error = this->take_writer_error();
+        pthread_mutex_unlock(&this->queue_mutex);
+        if (!error.empty())
+          throw Exceptions::Exception("CalculationContinuityHDF5: writing a record failed: %s", error.c_str());
+      }
+
+      /// If there is a record in the file.
+      bool have_record_available()
+      {
+        this->flush();
+        if (!file_exists(this->filename.c_str()))
+          return false;
+        hdf5_monitor().enter();
+        hid_t file = H5Fopen(this->filename.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+        bool available = file >= 0 && H5Aexists(file, "last_record") > 0;
+        if (file >= 0)
+          H5Fclose(file);
+        hdf5_monitor().leave();
+        if (file < 0)
+          throw Exceptions::IOException(Exceptions::IOException::Read, this->filename);
+        return available;
+      }
+
+      /// Loads the last record, reading only its group.
+      /// The returned record is owned by this instance (valid until the next load).
+      Record* load_last_record()
+      {
+        this->flush();
+        int number = -1;
+        hdf5_monitor().enter();
+        try
+        {
+          hid_t file = this->open_file(H5F_ACC_RDONLY);
+          try
+          {
+            if (H5Aexists(file, "last_record") > 0)
+              this->read_attribute(file, "last_record", H5T_NATIVE_INT, &number);
+          }
+          catch (std::exception&)
+          {
+            H5Fclose(file);
+            throw;
+          }
+          H5Fclose(file);
+        }
+        catch (std::exception&)
+        {
+          hdf5_monitor().leave();
+          throw;
+        }
+        hdf5_monitor().leave();
+        if (number < 0)
+          throw Exceptions::Exception("CalculationContinuityHDF5: there is no record in %s.", this->filename.c_str());
+        return this->load_record(number);
+      }
+
+      /// Loads the record with the given number.
+      Record* load_record(unsigned int number)
+      {
+        this->flush();
+        Record* record;
+        hdf5_monitor().enter();
+        try
+        {
+          record = this->read_record(number);
+        }
+        catch (std::exception&)
+        {
+          hdf5_monitor().leave();
+          throw;
+        }
+        hdf5_monitor().leave();
+
+        delete this->last_record;
+        this->last_record = record;
+        return record;
+      }
+
+      inline std::string getClassName() const { return "CalculationContinuityHDF5"; }
+
+    protected:
+      /// Background thread.
+      static void* write_records(void* data)
+      {
+        CalculationContinuityHDF5<Scalar>* continuity = (CalculationContinuityHDF5<Scalar>*)data;
+        while (true)
+        {
+          pthread_mutex_lock(&continuity->queue_mutex);
+          while (!continuity->stop && continuity->queue.empty())
+            pthread_cond_wait(&continuity->queue_condition, &continuity->queue_mutex);
+          if (continuity->queue.empty())
+          {
+            pthread_mutex_unlock(&continuity->queue_mutex);
+            return nullptr;
+          }
+          Record* record = continuity->queue.front();
+          continuity->queue.pop_front();
+          continuity->writing = true;
+          pthread_mutex_unlock(&continuity->queue_mutex);
+
+          std::string error;
+          try
+          {
+            continuity->write_record(record);
+          }
+          catch (std::exception& e)
+          {
+            error = e.what();
+          }
+          delete record;
+
+          pthread_mutex_lock(&continuity->queue_mutex);
+          if (!error.empty())
+            continuity->writer_error = error;
+          continuity->writing = false;
+          pthread_cond_broadcast(&continuity->queue_condition);
+          pthread_mutex_unlock(&continuity->queue_mutex);
+        }
+      }
+
+      /// Called with queue_mutex locked, returns and clears the error of the writer thread.
+      std::string take_writer_error()
+      {
+        std::string error = this->writer_error;
+        this->writer_error.clear();
+        return error;
+      }
+
+      /// Reads the record with the given number, called within hdf5_monitor().
+      Record* read_record(unsigned int number)
+      {
+        hid_t file = this->open_file(H5F_ACC_RDONLY);
+        std::string group_name = record_name(number);
+        hid_t group = H5Lexists(file, group_name.c_str(), H5P_DEFAULT) > 0 ? H5Gopen2(file, group_name.c_str(), H5P_DEFAULT) : -1;
+        if (group < 0)
+        {
+          H5Fclose(file);
+          throw Exceptions::Exception("CalculationContinuityHDF5: there is no record %u in %s.", number, this->filename.c_str());
+        }
+
+        Record* record = new Record(0., number);
+        try
+        {
+          this->read_attribute(group, "time", H5T_NATIVE_DOUBLE, &record->time);
+          this->read_attribute(group, "time_step", H5T_NATIVE_DOUBLE, &record->time_step);
+          this->read_attribute(group, "time_step_n_minus_one", H5T_NATIVE_DOUBLE, &record->time_step_n_minus_one);
+          this->read_attribute(group, "error", H5T_NATIVE_DOUBLE, &record->error);
+
+          for (int i = 0; H5Lexists(group, indexed_name("mesh_", i).c_str(), H5P_DEFAULT) > 0; i++)
+          {
+            record->meshes.push_back(std::vector<char>());
+            this->read_dataset(group, indexed_name("mesh_", i).c_str(), H5T_NATIVE_CHAR, record->meshes.back());
+          }
+          for (int i = 0; H5Lexists(group, indexed_name("space_", i).c_str(), H5P_DEFAULT) > 0; i++)
+          {
+            SpaceDescription<Scalar> data;
+            hid_t dataset = this->read_dataset(group, indexed_name("space_", i).c_str(), H5T_NATIVE_INT, data.orders, false);
+            try
+            {
+              this->read_attribute(dataset, "type", H5T_NATIVE_INT, &data.type);
+              this->read_attribute(dataset, "mesh", H5T_NATIVE_INT, &data.mesh);
+            }
+            catch (std::exception&)
+            {
+              H5Dclose(dataset);
+              throw;
+            }
+            H5Dclose(dataset);
+            record->spaces.push_back(data);
+          }
+          if (H5Lexists(group, "coefficients", H5P_DEFAULT) > 0)
+          {
+            std::vector<double> coefficients;
+            this->read_dataset(group, "coefficients", H5T_NATIVE_DOUBLE, coefficients);
+            to_scalars(coefficients, record->coefficients);
+          }
+        }
+        catch (std::exception&)
+        {
+          delete record;
+          H5Gclose(group);
+          H5Fclose(file);
+          throw;
+        }
+
+        H5Gclose(group);
+        H5Fclose(file);
+        return record;
+      }
+
+      void write_record(Record* record)
+      {
+        hdf5_monitor().enter();
+        try
+        {
+          hid_t file = file_exists(this->filename.c_str()) ? this->open_file(H5F_ACC_RDWR) : H5Fcreate(this->filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+          if (file < 0)
+            throw Exceptions::IOException(Exceptions::IOException::Write, this->filename);
+          try
+          {
+            this->write_record(file, record);
+          }
+          catch (std::exception&)
+          {
+            H5Fclose(file);
+            throw;
+          }
+          if (H5Fclose(file) < 0)
+            throw Exceptions::IOException(Exceptions::IOException::Write, this->filename);
+        }
+        catch (std::exception&)
+        {
+          hdf5_monitor().leave();
+          throw;
+        }
+        hdf5_monitor().leave();
+      }
+
+      /// Writes the record group and the attribute last_record, called within hdf5_monitor().
+      void write_record(hid_t file, Record* record)
+      {
+        // A record with the same number is replaced.
+        std::string group_name = record_name(record->number);
+        if (H5Lexists(file, group_name.c_str(), H5P_DEFAULT) > 0 && H5Ldelete(file, group_name.c_str(), H5P_DEFAULT) < 0)
+          throw Exceptions::IOException(Exceptions::IOException::Write, this->filename);
+        hid_t group = H5Gcreate2(file, group_name.c_str(), H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+        if (group < 0)
+          throw Exceptions::IOException(Exceptions::IOException::Write, this->filename);
+
+        try
+        {
+          this->write_attribute(group, "time", H5T_NATIVE_DOUBLE, &record->time);
+          this->write_attribute(group, "number", H5T_NATIVE_UINT, &record->number);
+          this->write_attribute(group, "time_step", H5T_NATIVE_DOUBLE, &record->time_step);
+          this->write_attribute(group, "time_step_n_minus_one", H5T_NATIVE_DOUBLE, &record->time_step_n_minus_one);
+          this->write_attribute(group, "error", H5T_NATIVE_DOUBLE, &record->error);
+
+          for (unsigned int i = 0; i < record->meshes.size(); i++)
+            H5Dclose(this->write_dataset(group, indexed_name("mesh_", i).c_str(), H5T_NATIVE_CHAR, record->meshes[i].data(), record->meshes[i].size()));
+          for (unsigned int i = 0; i < record->spaces.size(); i++)
+          {
+            hid_t dataset = this->write_dataset(group, indexed_name("space_", i).c_str(), H5T_NATIVE_INT, record->spaces[i].orders.data(), record->spaces[i].orders.size());
+            try
+            {
+              this->write_attribute(dataset, "type", H5T_NATIVE_INT, &record->spaces[i].type);
+              this->write_attribute(dataset, "mesh", H5T_NATIVE_INT, &record->spaces[i].mesh);
+            }
+            catch (std::exception&)
+            {
+              H5Dclose(dataset);
+              throw;
+            }
+            H5Dclose(dataset);
+          }
+          if (!record->coefficients.empty())
+          {
+            std::vector<double> coefficients;
+            to_doubles(record->coefficients, coefficients);
+            H5Dclose(this->write_dataset(group, "coefficients", H5T_NATIVE_DOUBLE, coefficients.data(), coefficients.size()));
+          }
+        }
+        catch (std::exception&)
+        {
+          H5Gclose(group);
+          throw;
+        }
+
+        H5Gclose(group);
+        int number = record->number;
+        this->write_attribute(file, "last_record", H5T_NATIVE_INT, &number);
+      }
+
+      hid_t open_file(unsigned int flags)
+      {
+        hid_t file = H5Fopen(this->filename.c_str(), flags, H5P_DEFAULT);
+        if (file < 0)
+          throw Exceptions::IOException(flags == H5F_ACC_RDONLY ? Exceptions::IOException::Read : Exceptions::IOException::Write, this->filename);
+        return file;
+      }
+
+      /// Complex numbers are stored as (real, imaginary) pairs of doubles.
+      static void to_doubles(const std::vector<double>& scalars, std::vector<double>& values)
+      {
+        values = scalars;
+      }
+      static void to_doubles(const std::vector<std::complex<double> >& scalars, std::vector<double>& values)
+      {
+        values.resize(2 * scalars.size());
+        for (unsigned int i = 0; i < scalars.size(); i++)
+        {
+          values[2 * i] = scalars[i].real();
+          values[2 * i + 1] = scalars[i].imag();
+        }
+      }
+      static void to_scalars(const std::vector<double>& values, std::vector<double>& scalars)
+      {
+        scalars = values;
+      }
+      static void to_scalars(const std::vector<double>& values, std::vector<std::complex<double> >& scalars)
+      {
+        if (values.size() % 2)
+          throw Exceptions::Exception("CalculationContinuityHDF5: complex coefficients stored as %u doubles.", (unsigned int)values.size());
+        scalars.resize(values.size() / 2);
+        for (unsigned int i = 0; i < scalars.size(); i++)
+          scalars[i] = std::complex<double>(values[2 * i], values[2 * i + 1]);
+      }
+
+      static bool file_exists(const char* filename)
+      {
+        FILE* f = fopen(filename, "rb");
+        if (f == nullptr)
+          return false;
+        fclose(f);
+        return true;
+      }
+
+      static std::string record_name(unsigned int number)
+      {
+        char name[32];
+        sprintf(name, "record_%u", number);
+        return name;
+      }
+
+      static std::string indexed_name(const char* prefix, int index)
+      {
+        char name[32];
+        sprintf(name, "%s%i", prefix, index);
+        return name;
+      }
+
+      /// Scalar attribute, replaced if it exists.
+      void write_attribute(hid_t object, const char* name, hid_t type, const void* value)
+      {
+        if (H5Aexists(object, name) > 0 && H5Adelete(object, name) < 0)
+          throw Exceptions::IOException(Exceptions::IOException::Write, this->filename);
+        hid_t space = H5Screate(H5S_SCALAR);
+        hid_t attribute = H5Acreate2(object, name, type, space, H5P_DEFAULT, H5P_DEFAULT);
+        herr_t status = attribute < 0 ? -1 : H5Awrite(attribute, type, value);
+        if (attribute >= 0)
+          H5Aclose(attribute);
+        H5Sclose(space);
+        if (status < 0)
+          throw Exceptions::IOException(Exceptions::IOException::Write, this->filename);
+      }
+
+      void read_attribute(hid_t object, const char* name, hid_t type, void* value)
+      {
+        hid_t attribute = H5Aopen(object, name, H5P_DEFAULT);
+        if (attribute < 0)
+          throw Exceptions::Exception("CalculationContinuityHDF5: the attribute %s is missing.", name);
+        herr_t status = H5Aread(attribute, type, value);
+        H5Aclose(attribute);
+        if (status < 0)
+          throw Exceptions::IOException(Exceptions::IOException::Read, this->filename);
+      }
+
+      /// One-dimensional chunked and compressed dataset.
+      hid_t write_dataset(hid_t group, const char* name, hid_t type, const void* data, size_t size)
+      {
+        hsize_t dims[1] = { size };
+        hid_t space = H5Screate_simple(1, dims, nullptr);
+        hid_t properties = H5Pcreate(H5P_DATASET_CREATE);
+        if (size > 0)
+        {
+          hsize_t chunk[1] = { std::min<hsize_t>(size, 1 << 16) };
+          H5Pset_chunk(properties, 1, chunk);
+          H5Pset_shuffle(properties);
+          H5Pset_deflate(properties, 4);
+        }
+        hid_t dataset = H5Dcreate2(group, name, type, space, H5P_DEFAULT, properties, H5P_DEFAULT);
+        herr_t status = dataset < 0 ? -1 : 0;
+        if (dataset >= 0 && size > 0)
+          status = H5Dwrite(dataset, type, H5S_ALL, H5S_ALL, H5P_DEFAULT, data);
+        H5Pclose(properties);
+        H5Sclose(space);
+        if (status < 0)
+        {
+          if (dataset >= 0)
+            H5Dclose(dataset);
+          throw Exceptions::IOException(Exceptions::IOException::Write, this->filename);
+        }
+        return dataset;
+      }
+
+      /// \return The dataset if close == false.
+      template<typename T>
+      hid_t read_dataset(hid_t group, const char* name, hid_t type, std::vector<T>& data, bool close = true)
+      {
+        hid_t dataset = H5Dopen2(group, name, H5P_DEFAULT);
+        if (dataset < 0)
+          throw Exceptions::Exception("CalculationContinuityHDF5: the dataset %s is missing.", name);
+        hid_t space = H5Dget_space(dataset);
+        hsize_t dims[1] = { 0 };
+        herr_t status = H5Sget_simple_extent_dims(space, dims, nullptr);
+        if (status >= 0)
+        {
+          data.resize(dims[0]);
+          if (dims[0] > 0)
+            status = H5Dread(dataset, type, H5S_ALL, H5S_ALL, H5P_DEFAULT, data.data());
+        }
+        H5Sclose(space);
+        if (close || status < 0)
+          H5Dclose(dataset);
+        if (status < 0)
+          throw Exceptions::IOException(Exceptions::IOException::Read, this->filename);
+        return close ? -1 : dataset;
+      }
+
+      std::string filename;
+      bool asynchronous;
+
+      /// Writer thread and its queue.
+      pthread_t writer;
+      pthread_mutex_t queue_mutex;
+      pthread_cond_t queue_condition;
+      std::deque<Record*> queue;
+      bool stop;
+      bool writing;
+      std::string writer_error;
+
+      /// The last loaded record.
+      Record* last_record;
+    };
+  }
+}
+#endif
@@ -0,0 +1,531 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __H2D_SOLUTION_TIME_SERIES_H
+#define __H2D_SOLUTION_TIME_SERIES_H
+
+#include "solution.h"
+#include "../mesh/mesh_reader_h2d_binary.h"
+#include "../space/space_description.h"
+#include <zlib.h>
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    /// Encoding of one step of a solution time series (flags).
+    enum SolutionTimeSeriesEncoding
+    {
+      /// The step is XOR-ed with the previous one (bitwise, per 8-byte word).
+      SolutionTimeSeriesDelta = 1,
+      /// The bytes of the words are grouped (all first bytes, all second bytes, ...).
+      SolutionTimeSeriesShuffle = 2,
+      /// zlib compressed.
+      SolutionTimeSeriesZlib = 4
+    };
+
+    /// Header of the solution time series file.
+    struct SolutionTimeSeriesHeader
+    {
+      /// "H2DTSERS"
+      char magic[8];
+      int version;
+      /// sizeof(Scalar)
+      int scalar_size;
+      int ndof;
+      int keyframe_interval;
+      unsigned long long description_offset;
+      unsigned long long description_size;
+      unsigned long long index_offset;
+      int step_count;
+      int reserved;
+    };
+
+    /// Index table entry of the solution time series file.
+    struct SolutionTimeSeriesIndexEntry
+    {
+      unsigned long long offset;
+      unsigned long long size;
+      double time;
+      /// SolutionTimeSeriesEncoding flags.
+      int encoding;
+      int reserved;
+    };
+
+    /// Common part of SolutionTimeSeriesWriter and SolutionTimeSeriesReader.
+    class SolutionTimeSeriesFile
+    {
+    protected:
+      static const int version = 1;
+
+      /// 64-bit file positions (series over 2 GB).
+      static void seek(FILE* f, long long position)
+      {
+#if defined(WIN32) || defined(_WINDOWS)
+        _fseeki64(f, position, SEEK_SET);
+#else
+        fseeko(f, position, SEEK_SET);
+#endif
+      }
+
+      /// Groups the bytes of 8-byte words.
+      static void shuffle(const unsigned char* in, unsigned char* out, size_t words)
+      {
+        for (size_t i = 0; i < words; i++)
+          for (int b = 0; b < 8; b++)
+            out[b * words + i] = in[i * 8 + b];
+      }
+      static void unshuffle(const unsigned char* in, unsigned char* out, size_t words)
+      {
+        for (size_t i = 0; i < words; i++)
+          for (int b = 0; b < 8; b++)
+            out[i * 8 + b] = in[b * words + i];
+      }
+    };
+
+    /// \brief Writer of a time series of solutions on fixed spaces (link with zlib.lib).
+    ///
+    /// Unlike Solution::save() per time step (XML / BSON, the mesh and space in every file), the meshes (MeshReaderH2DBinary format)
+    /// and the spaces (SpaceDescription) are stored once, and every step is only the binary coefficient vector.
+    /// The vector is optionally XOR-ed with the previous step (slowly varying data give mostly zero high-order bytes),
+    /// byte-shuffled and zlib-compressed; every keyframe_interval-th step is stored without the delta, so that reading a step
+    /// needs at most keyframe_interval - 1 previous steps.<br>
+    /// File: SolutionTimeSeriesHeader, the description (meshes, spaces), the steps, and the index table (SolutionTimeSeriesIndexEntry per step)
+    /// with the offsets of the steps for random access. The index is written by flush() and by the destructor, new steps overwrite it.
+    template<typename Scalar>
+    class SolutionTimeSeriesWriter : public SolutionTimeSeriesFile, public Hermes::Mixins::Loggable
+    {
+    public:
+      /// Constructor - writes the header and the description.
+      /// \param[in] spaces The spaces, they must not change while steps are added.
+      /// \param[in] delta XOR the steps with the previous ones.
+      /// \param[in] compress zlib compression (with byte shuffling).
+      /// \param[in] keyframe_interval Every keyframe_interval-th step is stored without the delta.
+      SolutionTimeSeriesWriter(const char* filename, std::vector<SpaceSharedPtr<Scalar> > spaces, bool delta = true, bool compress = true, int keyframe_interval = 32)
+        : filename(filename), spaces(spaces), delta(delta), compress(compress), index_written(false)
+      {
+        if (keyframe_interval < 1)
+          throw Exceptions::ValueException("keyframe_interval", keyframe_interval, 1);
+
+        // Description.
+        std::vector<char> description;
+        std::vector<Mesh*> meshes;
+        std::vector<std::vector<char> > mesh_buffers;
+        std::vector<SpaceDescription<Scalar> > space_descriptions;
+        MeshReaderH2DBinary mesh_writer;
+        for (unsigned int i = 0; i < spaces.size(); i++)
+        {
+          MeshSharedPtr mesh = spaces[i]->get_mesh();
+          int mesh_index = std::find(meshes.begin(), meshes.end(), mesh.get()) - meshes.begin();
+          if (mesh_index == (int)meshes.size())
+          {
+            meshes.push_back(mesh.get());
+            mesh_buffers.push_back(std::vector<char>());
+            mesh_writer.save(mesh, mesh_buffers.back());
+          }
+          space_descriptions.push_back(SpaceDescription<Scalar>(spaces[i], mesh_index));
+          this->space_seqs.push_back(spaces[i]->get_seq());
+        }
+        append_value(description, (int)mesh_buffers.size());
+        for (unsigned int i = 0; i < mesh_buffers.size(); i++)
+        {
+          append_value(description, (unsigned long long)mesh_buffers[i].size());
+          description.insert(description.end(), mesh_buffers[i].begin(), mesh_buffers[i].end());
+        }
+        append_value(description, (int)space_descriptions.size());
+        for (unsigned int i = 0; i < space_descriptions.size(); i++)
+        {
+          append_value(description, space_descriptions[i].type);
+          append_value(description, space_descriptions[i].mesh);
+          append_value(description, (int)space_descriptions[i].orders.size());
+          const char* orders = (const char*)space_descriptions[i].orders.data();
+          description.insert(description.end(), orders, orders + space_descriptions[i].orders.size() * sizeof(int));
+        }
+
+        memset(&this->header, 0, sizeof(SolutionTimeSeriesHeader));
+        memcpy(this->header.magic, "H2DTSERS", 8);
+        this->header.version = version;
+        this->header.scalar_size = sizeof(Scalar);
+        this->header.ndof = Space<Scalar>::get_num_dofs(spaces);
+        this->header.keyframe_interval = keyframe_interval;
+        this->header.description_offset = sizeof(SolutionTimeSeriesHeader);
+        this->header.description_size = description.size();
+        this->header.index_offset = this->header.description_offset + description.size();
+
+        this->file = fopen(filename, "wb");
+        if (this->file == nullptr)
+          throw Exceptions::Exception("SolutionTimeSeriesWriter: could not open %s for writing.", filename);
+        try
+        {
+          this->write(&this->header, sizeof(SolutionTimeSeriesHeader));
+          this->write(description.data(), description.size());
+          this->flush();
+        }
+        catch (std::exception&)
+        {
+          fclose(this->file);
+          throw;
+        }
+      }
+
+      /// Writes the index.
+      virtual ~SolutionTimeSeriesWriter()
+      {
+        try
+        {
+          this->flush();
+        }
+        catch (std::exception& e)
+        {
+          this->warn("SolutionTimeSeriesWriter: %s", e.what());
+        }
+        fclose(this->file);
+      }
+
+      /// Adds a step.
+      /// \param[in] coefficient_vector The coefficient vector of all spaces (as the solvers return it).
+      void add(double time, const Scalar* coefficient_vector)
+      {
+        for (unsigned int i = 0; i < this->spaces.size(); i++)
+        {
+          if (this->spaces[i]->get_seq() != this->space_seqs[i])
+            throw Exceptions::Exception("SolutionTimeSeriesWriter: the space %i changed, a time series needs fixed spaces.", i);
+        }
+
+        size_t size = this->header.ndof * sizeof(Scalar);
+        size_t words = size / 8;
+        SolutionTimeSeriesIndexEntry entry;
+        memset(&entry, 0, sizeof(SolutionTimeSeriesIndexEntry));
+        entry.offset = this->header.index_offset;
+        entry.time = time;
+
+        // Delta.
+        const unsigned char* data = (const unsigned char*)coefficient_vector;
+        bool keyframe = !this->delta || this->index.size() % this->header.keyframe_interval == 0;
+        if (!keyframe)
+        {
+          this->encoded.resize(size);
+          const unsigned long long* current = (const unsigned long long*)coefficient_vector;
+          const unsigned long long* previous = (const unsigned long long*)this->previous.data();
+          unsigned long long* xored = (unsigned long long*)this->encoded.data();
+          for (size_t i = 0; i < words; i++)
+            xored[i] = current[i] ^ previous[i];
+          data = this->encoded.data();
+          entry.encoding |= SolutionTimeSeriesDelta;
+        }
+        if (this->delta)
+          this->previous.assign((const unsigned char*)coefficient_vector, (const unsigned char*)coefficient_vector + size);
+
+        // Shuffle and compression, only if it pays off.
+        if (this->compress && size > 0)
+        {
+          this->shuffled.resize(size);
+          shuffle(data, this->shuffled.data(), words);
+          uLongf compressed_size = compressBound((uLong)size);
+          this->compressed.resize(compressed_size);
+          if (compress2(this->compressed.data(), &compressed_size, this->shuffled.data(), (uLong)size, Z_DEFAULT_COMPRESSION) != Z_OK)
+            throw Exceptions::Exception("SolutionTimeSeriesWriter: zlib compression failed.");
+          if (compressed_size < size)
+          {
+            data = this->compressed.data();
+            size = compressed_size;
+            entry.encoding |= SolutionTimeSeriesShuffle | SolutionTimeSeriesZlib;
+          }
+        }
+
+        seek(this->file, entry.offset);
+        this->write(data, size);
+        entry.size = size;
+        this->index.push_back(entry);
+        this->header.index_offset = entry.offset + size;
+        this->index_written = false;
+      }
+
+      /// Writes the index and the header, the file is then complete (and stays open for further steps).
+      void flush()
+      {
+        if (this->index_written)
+          return;
+        this->header.step_count = this->index.size();
+        seek(this->file, this->header.index_offset);
+        this->write(this->index.data(), this->index.size() * sizeof(SolutionTimeSeriesIndexEntry));
+        seek(this->file, 0);
+        this->write(&this->header, sizeof(SolutionTimeSeriesHeader));
+        if (fflush(this->file) != 0)
+          throw Exceptions::Exception("SolutionTimeSeriesWriter: writing %s failed.", this->filename.c_str());
+        this->index_written = true;
+      }
+
+      /// Number of the steps.
+      int get_step_count() const { return this->index.size(); }
+
+      inline std::string getClassName() const { return "SolutionTimeSeriesWriter"; }
+
+    protected:
+      template<typename T>
+      static void append_value(std::vector<char>& buffer, T value)
+      {
+        const char* bytes = (const char*)&value;
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+      }
+
+      void write(const void* data, size_t size)
+      {
+        if (size > 0 && fwrite(data, 1, size, this->file) != size)
+          throw Exceptions::Exception("SolutionTimeSeriesWriter: writing %s failed.", this->filename.c_str());
+      }
+
+      std::string filename;
+      std::vector<SpaceSharedPtr<Scalar> > spaces;
+      std::vector<int> space_seqs;
+      bool delta;
+      bool compress;
+
+      FILE* file;
+      SolutionTimeSeriesHeader header;
+      std::vector<SolutionTimeSeriesIndexEntry> index;
+      bool index_written;
+
+      /// Buffers.
+      std::vector<unsigned char> previous;
+      std::vector<unsigned char> encoded;
+      std::vector<unsigned char> shuffled;
+      std::vector<unsigned char> compressed;
+    };
+
+    /// \brief Reader of a time series written by SolutionTimeSeriesWriter (link with zlib.lib).
+    /// Steps are read by random access through the index table; the last decoded step is kept, so that reading the steps
+    /// in order decodes every step once.
+    template<typename Scalar>
+    class SolutionTimeSeriesReader : public SolutionTimeSeriesFile, public Hermes::Mixins::Loggable
+    {
+    public:
+      /// Constructor - reads the header, the description and the index.
+      SolutionTimeSeriesReader(const char* filename) : filename(filename), decoded_step(-1)
+      {
+        this->file = fopen(filename, "rb");
+        if (this->file == nullptr)
+          throw Exceptions::Exception("SolutionTimeSeriesReader: could not open %s.", filename);
+
+        try
+        {
+          this->read(&this->header, sizeof(SolutionTimeSeriesHeader));
+          if (memcmp(this->header.magic, "H2DTSERS", 8) != 0)
+            throw Exceptions::Exception("SolutionTimeSeriesReader: %s is not a solution time series.", filename);
+          if (this->header.version != version)
+            throw Exceptions::Exception("SolutionTimeSeriesReader: %s has the version %i, %i is supported.", filename, this->header.version, version);
+          if (this->header.scalar_size != sizeof(Scalar))
+            throw Exceptions::Exception("SolutionTimeSeriesReader: %s was written with another Scalar type.", filename);
+
+          std::vector<char> description(this->header.description_size);
+          seek(this->file, this->header.description_offset);
+          this->read(description.data(), description.size());
+          const char* position = description.data();
+          const char* end = position + description.size();
+          int mesh_count = this->take_value<int>(position, end);
+          for (int i = 0; i < mesh_count; i++)
+          {
+            unsigned long long size = this->take_value<unsigned long long>(position, end);
+            if (size > (unsigned long long)(end - position))
+              throw Exceptions::Exception("SolutionTimeSeriesReader: %s is truncated.", filename);
+            this->meshes.push_back(std::vector<char>(position, position + size));
+            position += size;
+          }
+          int space_count = this->take_value<int>(position, end);
+          for (int i = 0; i < space_count; i++)
+          {
+            SpaceDescription<Scalar> space;
+            space.type = this->take_value<int>(position, end);
+            space.mesh = this->take_value<int>(position, end);
+            int order_count = this->take_value<int>(position, end);
+            if (space.mesh < 0 || space.mesh >= mesh_count || order_count < 0 || order_count * sizeof(int) > (size_t)(end - position))
+              throw Exceptions::Exception("SolutionTimeSeriesReader: %s has an invalid space description.", filename);
+            space.orders.assign((const int*)position, (const int*)position + order_count);
+            position += order_count * sizeof(int);
+            this->spaces.push_back(space);
+          }
+
+          this->index.resize(this->header.step_count);
+          seek(this->file, this->header.index_offset);
+          this->read(this->index.data(), this->index.size() * sizeof(SolutionTimeSeriesIndexEntry));
+        }
+        catch (std::exception&)
+        {
+          fclose(this->file);
+          throw;
+        }
+      }
+
+      virtual ~SolutionTimeSeriesReader()
+      {
+        fclose(this->file);
+      }
+
+      /// Number of the steps.
+      int get_step_count() const { return this->index.size(); }
+      /// Time of a step.
+      double get_time(int step) const
+      {
+        this->check_step(step);
+        return this->index[step].time;
+      }
+      /// Number of DOFs of all spaces.
+      int get_num_dofs() const { return this->header.ndof; }
+
+      /// Loads the meshes (as many as there are distinct meshes of the spaces).
+      void load_meshes(std::vector<MeshSharedPtr> meshes)
+      {
+        if (meshes.size() != this->meshes.size())
+          throw Exceptions::LengthException(1, meshes.size(), this->meshes.size());
+        MeshReaderH2DBinary reader;
+        for (unsigned int i = 0; i < meshes.size(); i++)
+          reader.load(this->meshes[i].data(), this->meshes[i].size(), meshes[i], this->filename.c_str());
+      }
+
+      /// Loads the spaces.
+      /// \param[in] meshes The meshes loaded by load_meshes().
+      /// \param[in] essential_bcs Either empty, or one (possibly nullptr) per space.
+      /// \param[in] shapesets Either empty, or one (possibly nullptr) per space.
+      std::vector<SpaceSharedPtr<Scalar> > load_spaces(std::vector<MeshSharedPtr> meshes, std::vector<EssentialBCs<Scalar>*> essential_bcs = std::vector<EssentialBCs<Scalar>*>(), std::vector<Shapeset*> shapesets = std::vector<Shapeset*>())
+      {
+        if (meshes.size() != this->meshes.size())
+          throw Exceptions::LengthException(1, meshes.size(), this->meshes.size());
+        if (!essential_bcs.empty() && essential_bcs.size() != this->spaces.size())
+          throw Exceptions::LengthException(2, essential_bcs.size(), this->spaces.size());
+        if (!shapesets.empty() && shapesets.size() != this->spaces.size())
+          throw Exceptions::LengthException(3, shapesets.size(), this->spaces.size());
+
+        std::vector<SpaceSharedPtr<Scalar> > loaded_spaces;
+        for (unsigned int i = 0; i < this->spaces.size(); i++)
+        {
+          EssentialBCs<Scalar>* bcs = essential_bcs.empty() ? nullptr : essential_bcs[i];
+          Shapeset* shapeset = shapesets.empty() ? nullptr : shapesets[i];
+          loaded_spaces.push_back(this->spaces[i].create_space(meshes[this->spaces[i].mesh], bcs, shapeset));
+        }
+        if (Space<Scalar>::get_num_dofs(loaded_spaces) != this->header.ndof)
+          throw Exceptions::Exception("SolutionTimeSeriesReader: the loaded spaces have %i DOFs instead of %i (different essential boundary conditions?).", Space<Scalar>::get_num_dofs(loaded_spaces), this->header.ndof);
+        return loaded_spaces;
+      }
+
+      /// Loads the coefficient vector of a step.
+      /// The returned vector is valid until the next call.
+      const std::vector<Scalar>& load_coefficient_vector(int step)
+      {
+        this->check_step(step);
+        // The closest keyframe, or the last decoded step if it is closer.
+        int first = step;
+        while (first > 0 && (this->index[first].encoding & SolutionTimeSeriesDelta))
+          first--;
+        if (this->decoded_step >= first && this->decoded_step <= step)
+          first = this->decoded_step + 1;
+        for (int i = first; i <= step; i++)
+          this->decode(i);
+        return this->coefficients;
+      }
+
+      /// Loads the solutions of a step.
+      void load_solutions(int step, std::vector<SpaceSharedPtr<Scalar> > spaces, std::vector<MeshFunctionSharedPtr<Scalar> > solutions)
+      {
+        const std::vector<Scalar>& coefficients = this->load_coefficient_vector(step);
+        Solution<Scalar>::vector_to_solutions(coefficients.data(), spaces, solutions);
+      }
+      /// Loads the solution of a step (one space).
+      void load_solution(int step, SpaceSharedPtr<Scalar> space, MeshFunctionSharedPtr<Scalar> solution)
+      {
+        this->load_solutions(step, std::vector<SpaceSharedPtr<Scalar> >(1, space), std::vector<MeshFunctionSharedPtr<Scalar> >(1, solution));
+      }
+
+      inline std::string getClassName() const { return "SolutionTimeSeriesReader"; }
+
+    protected:
+      void check_step(int step) const
+      {
+        if (step < 0 || step >= (int)this->index.size())
+          throw Exceptions::ValueException("step", step, 0, (int)this->index.size() - 1);
+      }
+
+      /// Decodes the step, the previous one has to be decoded if the step is a delta.
+      void decode(int step)
+      {
+        const SolutionTimeSeriesIndexEntry& entry = this->index[step];
+        size_t size = this->header.ndof * sizeof(Scalar);
+        size_t words = size / 8;
+
+        this->stored.resize(entry.size);
+        seek(this->file, entry.offset);
+        this->read(this->stored.data(), entry.size);
+
+        const unsigned char* data = this->stored.data();
+        if (entry.encoding & SolutionTimeSeriesZlib)
+        {
+          this->shuffled.resize(size);
+          uLongf uncompressed_size = (uLongf)size;
+          if (uncompress(this->shuffled.data(), &uncompressed_size, data, (uLong)entry.size) != Z_OK || uncompressed_size != size)
+            throw Exceptions::Exception("SolutionTimeSeriesReader: the step %i of %s is corrupted.", step, this->filename.c_str());
+          data = this->shuffled.data();
+        }
+        else if (entry.size != size)
+          throw Exceptions::Exception("SolutionTimeSeriesReader: the step %i of %s is corrupted.", step, this->filename.c_str());
+
+        std::vector<Scalar> decoded(this->header.ndof);
+        if (entry.encoding & SolutionTimeSeriesShuffle)
+          unshuffle(data, (unsigned char*)decoded.data(), words);
+        else if (size > 0)
+          memcpy(decoded.data(), data, size);
+
+        if (entry.encoding & SolutionTimeSeriesDelta)
+        {
+          const unsigned long long* previous = (const unsigned long long*)this->coefficients.data();
+          unsigned long long* current = (unsigned long long*)decoded.data();
+          for (size_t i = 0; i < words; i++)
+            current[i] ^= previous[i];
+        }
+        this->coefficients.swap(decoded);
+        this->decoded_step = step;
+      }
+
+      template<typename T>
+      T take_value(const char*& position, const char* end)
+      {
+        if ((size_t)(end - position) < sizeof(T))
+          throw Exceptions::Exception("SolutionTimeSeriesReader: %s is truncated.", this->filename.c_str());
+        T value;
+        memcpy(&value, position, sizeof(T));
+        position += sizeof(T);
+        return value;
+      }
+
+      void read(void* data, size_t size)
+      {
+        if (size > 0 && fread(data, 1, size, this->file) != size)
+          throw Exceptions::Exception("SolutionTimeSeriesReader: %s is truncated.", this->filename.c_str());
+      }
+
+      std::string filename;
+      FILE* file;
+      SolutionTimeSeriesHeader header;
+      std::vector<std::vector<char> > meshes;
+      std::vector<SpaceDescription<Scalar> > spaces;
+      std::vector<SolutionTimeSeriesIndexEntry> index;
+
+      /// The last decoded step.
+      int decoded_step;
+      std::vector<Scalar> coefficients;
+      std::vector<unsigned char> stored;
+      std::vector<unsigned char> shuffled;
+    };
+  }
+}
+#endif
@@ -0,0 +1,64 @@
+// This file is part of Hermes2D
+//
+// Copyright (c) 2009 hp-FEM group at the University of Nevada, Reno (UNR).
+// Email: hpfem-group@unr.edu, home page: http://hpfem.org/.
+//
+// Hermes2D is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published
+// by the Free Software Foundation; either version 2 of the License,
+// or (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+/*! \file hdf5_mutex.h
+\brief The monitor of all HDF5 calls of Hermes2D.
+*/
+#ifndef __H2D_HDF5_MUTEX_H
+#define __H2D_HDF5_MUTEX_H
+
+#include <pthread.h>
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    /// The HDF5 library of this bundle is built without H5_HAVE_THREADSAFE, so all HDF5 calls
+    /// (CalculationContinuityHDF5, Views::LinearizerXDMFWriter) are serialized by one process-wide monitor, hdf5_monitor().
+    class HDF5Monitor
+    {
+      pthread_mutex_t mutex; ///< Mutex that protects monitor.
+
+    public:
+      /// Constructor. Creates a mutex.
+      HDF5Monitor()
+      {
+        pthread_mutex_init(&mutex, nullptr);
+      };
+      /// Destructor. Deletes a mutex.
+      ~HDF5Monitor()
+      {
+        pthread_mutex_destroy(&mutex);
+      };
+
+      /// Enters protected section.
+      void enter() { pthread_mutex_lock(&mutex); };
+
+      /// Leaves protected section.
+      void leave() { pthread_mutex_unlock(&mutex); };
+    };
+
+    /// The monitor of all HDF5 calls.
+    inline HDF5Monitor& hdf5_monitor()
+    {
+      static HDF5Monitor monitor;
+      return monitor;
+    }
+  }
+}
+#endif
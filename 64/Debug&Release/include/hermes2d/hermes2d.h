@@ -21,6 +21,9 @@
 #include "global.h"
 
 #include "solver/newton_solver.h"
+#include "solver/inexact_newton_solver.h"
+#include "solver/jacobian_free_newton_solver.h"
+#include "solver/factorization_reuse_newton_solver.h"
 #include "solver/picard_solver.h"
 #include "solver/linear_solver.h"
 #include "solver/nox_solver.h"
@@ -36,7 +39,9 @@
 #include "mesh/mesh_reader.h"
 #include "mesh/mesh_reader_h2d.h"
 #include "mesh/mesh_reader_h2d_xml.h"
+#include "mesh/mesh_reader_h2d_xml_stream.h"
 #include "mesh/mesh_reader_h2d_bson.h"
+#include "mesh/mesh_reader_h2d_binary.h"
 #include "mesh/mesh_reader_h1d_xml.h"
 #include "mesh/mesh_reader_exodusii.h"
 
@@ -47,6 +52,7 @@
 #include "space/space_hcurl.h"
 #include "space/space_l2.h"
 #include "space/space_hdiv.h"
+#include "space/space_description.h"
 
 #include "shapeset/shapeset_h1_all.h"
 #include "shapeset/shapeset_hc_all.h"
@@ -75,6 +81,9 @@
 #include "views/scalar_view.h"
 #include "views/vector_base_view.h"
 #include "views/vector_view.h"
+#include "views/solution_output_queue.h"
+#include "views/linearizer_merged_mesh.h"
+#include "views/budgeted_linearizer.h"
 
 #include "refinement_selectors/element_to_refine.h"
 #include "refinement_selectors/selector.h"
@@ -84,17 +93,25 @@
 #include "refinement_selectors/l2_proj_based_selector.h"
 #include "refinement_selectors/h1_proj_based_selector.h"
 #include "refinement_selectors/hcurl_proj_based_selector.h"
+#include "refinement_selectors/smoothness_selector.h"
 
 #include "adapt/adapt.h"
 #include "adapt/adapt_solver.h"
 #include "adapt/error_calculator.h"
 #include "adapt/error_thread_calculator.h"
 #include "adapt/kelly_type_adapt.h"
+#include "adapt/kelly_error_calculator.h"
+#include "adapt/kelly_adapt_solver.h"
 #include "neighbor_search.h"
+#include "interface_edge_cache.h"
+#include "discrete_problem/dg/dg_connectivity.h"
+#include "discrete_problem/dg/discrete_problem_face_dg_assembler.h"
 #include "projections/ogprojection.h"
 #include "projections/ogprojection_nox.h"
 
 #include "solver/runge_kutta.h"
+#include "solver/runge_kutta_stage_solver.h"
+#include "solver/adaptive_runge_kutta.h"
 #include "spline.h"
 
 #if defined (AGROS)
@@ -0,0 +1,496 @@
+// This file is part of Hermes2D
+//
+// Hermes2D is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D; if not, see <http://www.gnu.prg/licenses/>.
+
+#ifndef _MESH_READER_H2D_XML_STREAM_H_
+#define _MESH_READER_H2D_XML_STREAM_H_
+
+#include "mesh_reader.h"
+
+// Xerces' ErrorHandler has a method error() (overridden below), therefore the macro has to be undefined here.
+#ifdef error
+#undef error
+#endif
+
+#include <xercesc/sax2/SAX2XMLReader.hpp>
+#include <xercesc/sax2/XMLReaderFactory.hpp>
+#include <xercesc/sax2/DefaultHandler.hpp>
+#include <xercesc/sax2/Attributes.hpp>
+#include <xercesc/sax/SAXParseException.hpp>
+#include <xercesc/util/PlatformUtils.hpp>
+#include <xercesc/util/TransService.hpp>
+#include <xercesc/util/XMLUni.hpp>
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    /// Streaming mesh reader from Hermes2D XML format
+    ///
+    /// Reads the same files as MeshReaderH2DXML::load(const char*, MeshSharedPtr) and produces the same mesh,
+    /// but instead of building the whole document tree (XMLMesh::mesh) first, the file is read by a SAX parser
+    /// and the vertex nodes and elements are created while the file is being read.
+    /// Only the variables, the curves and the refinements (all small) are kept until the end of the file.
+    /// Subdomain files (XMLSubdomains::domain) are not supported, these have to be loaded by MeshReaderH2DXML.
+    ///
+    /// Typical usage:
+    /// MeshSharedPtr mesh(new Mesh);
+    /// Hermes::Hermes2D::MeshReaderH2DXMLStream mloader;
+    /// try
+    /// {
+    ///&nbsp;mloader.load("mesh.xml", mesh);
+    /// }
+    /// catch(Exceptions::MeshLoadFailureException& e)
+    /// {
+    ///&nbsp;e.print_msg();
+    ///&nbsp;return -1;
+    /// }
+    ///
+    class MeshReaderH2DXMLStream : public MeshReader, public Hermes::Hermes2D::Mixins::XMLParsing
+    {
+    public:
+      MeshReaderH2DXMLStream() {}
+      virtual ~MeshReaderH2DXMLStream() {}
+
+      /// This method loads a single mesh from a file.
+      virtual void load(const char *filename, MeshSharedPtr mesh)
+      {
+        if (!mesh)
+          throw Exceptions::NullException(1);
+
+        // The number of vertices is not known before reading them, the hash table is sized by the file size instead
+        // (a vertex with its share of elements and edges takes more than 16 bytes of XML).
+        FILE* f = fopen(filename, "rb");
+        if (f == nullptr)
+          throw Exceptions::MeshLoadFailureException("Mesh file %s could not be opened.", filename);
+        fseek(f, 0, SEEK_END);
+        long file_size = ftell(f);
+        fclose(f);
+        int hash_size = HashTable::H2D_DEFAULT_HASH_SIZE;
+        while (hash_size < file_size / 16 && hash_size < (1 << 28))
+          hash_size *= 2;
+
+        mesh->free();
+        mesh->init(hash_size);
+
+        xercesc::XMLPlatformUtils::Initialize();
+        xercesc::SAX2XMLReader* parser = xercesc::XMLReaderFactory::createXMLReader();
+        parser->setFeature(xercesc::XMLUni::fgSAX2CoreNameSpaces, true);
+        parser->setFeature(xercesc::XMLUni::fgSAX2CoreValidation, this->validate);
+        parser->setFeature(xercesc::XMLUni::fgXercesSchema, this->validate);
+        parser->setFeature(xercesc::XMLUni::fgXercesLoadSchema, this->validate);
+
+        MeshXMLStreamHandler handler(this, mesh, filename);
+        parser->setContentHandler(&handler);
+        parser->setErrorHandler(&handler);
+
+        try
+        {
+          parser->parse(filename);
+        }
+        catch (const xercesc::SAXParseException& e)
+        {
+          delete parser;
+          throw Exceptions::MeshLoadFailureException("Mesh file %s, line %i: %s", filename, (int)e.getLineNumber(), transcode(e.getMessage()).c_str());
+        }
+        catch (...)
+        {
+          delete parser;
+          throw;
+        }
+        delete parser;
+
+        handler.finish();
+      }
+
+    protected:
+      /// UTF-8 string of a Xerces string (as XSD does for the DOM loader).
+      static std::string transcode(const XMLCh* value)
+      {
+        xercesc::TranscodeToStr transcoded(value, "UTF-8");
+        return std::string((const char*)transcoded.str(), transcoded.length());
+      }
+
+      /// Compares a Xerces string with an ASCII name, without allocation.
+      static bool equals(const XMLCh* value, const char* name)
+      {
+        while (*name && *value == (XMLCh)*name)
+        {
+          value++;
+          name++;
+        }
+        return *name == 0 && *value == 0;
+      }
+
+      /// Copies a numeric attribute to a char buffer (numbers are ASCII).
+      static const char* narrow(const XMLCh* value, char* buffer, int buffer_size)
+      {
+        int i = 0;
+        for (; value[i] && i < buffer_size - 1; i++)
+          buffer[i] = (char)value[i];
+        buffer[i] = 0;
+        return buffer;
+      }
+
+      /// SAX handler creating the mesh.
+      class MeshXMLStreamHandler : public xercesc::DefaultHandler
+      {
+      public:
+        MeshXMLStreamHandler(MeshReaderH2DXMLStream* reader, MeshSharedPtr mesh, const char* filename) : reader(reader), mesh(mesh), filename(filename),
+          section(None), vertex_count(0), element_count(0), edge_count(0), current_nurbs(nullptr)
+        {
+        }
+
+        ~MeshXMLStreamHandler()
+        {
+          delete this->current_nurbs;
+          for (unsigned int i = 0; i < this->curves.size(); i++)
+            delete this->curves[i].curve;
+        }
+
+        virtual void startElement(const XMLCh* const, const XMLCh* const localname, const XMLCh* const, const xercesc::Attributes& attrs)
+        {
+          if (equals(localname, "variables"))
+            this->section = Variables;
+          else if (equals(localname, "vertices"))
+            this->section = Vertices;
+          else if (equals(localname, "elements"))
+            this->section = Elements;
+          else if (equals(localname, "edges"))
+            this->section = Edges;
+          else if (equals(localname, "curves"))
+            this->section = Curves;
+          else if (equals(localname, "refinements"))
+            this->section = Refinements;
+          else
+          {
+            switch (this->section)
+            {
+            case Variables:
+              this->variables[transcode(this->attribute(attrs, "name"))] = this->number(attrs, "value");
+              break;
+            case Vertices:
+              this->add_vertex(attrs);
+              break;
+            case Elements:
+              this->add_element(attrs);
+              break;
+            case Edges:
+              this->add_edge(attrs);
+              break;
+            case Curves:
+              this->add_curve(localname, attrs);
+              break;
+            case Refinements:
+              this->refinements.push_back(std::pair<int, int>(this->integer(attrs, "element_id"), this->integer(attrs, "refinement_type")));
+              break;
+            default:
+              break;
+            }
+          }
+        }
+
+        virtual void endElement(const XMLCh* const, const XMLCh* const localname, const XMLCh* const)
+        {
+          if (equals(localname, "vertices"))
+            this->mesh->ntopvert = this->vertex_count;
+          else if (equals(localname, "elements"))
+            this->mesh->nbase = this->mesh->nactive = this->mesh->ninitial = this->element_count;
+          else if (equals(localname, "NURBS"))
+            this->finish_nurbs();
+
+          if (equals(localname, "variables") || equals(localname, "vertices") || equals(localname, "elements") || equals(localname, "edges") || equals(localname, "curves") || equals(localname, "refinements"))
+            this->section = None;
+        }
+
+        virtual void fatalError(const xercesc::SAXParseException& e)
+        {
+          throw e;
+        }
+
+        virtual void error(const xercesc::SAXParseException& e)
+        {
+          throw e;
+        }
+
+        /// The remaining steps of MeshReaderH2DXML::load(), after the whole file has been read.
+        void finish()
+        {
+          Node* en;
+          for_all_edge_nodes(en, this->mesh)
+            if (en->ref < 2 && en->marker == 0)
+              this->reader->warn("Boundary edge node does not have a boundary marker.");
+
+          // Curves.
+          for (unsigned int curve_i = 0; curve_i < this->curves.size(); curve_i++)
+          {
+            int p1 = this->curves[curve_i].p1, p2 = this->curves[curve_i].p2;
+            Curve* curve;
+            if (this->curves[curve_i].curve == nullptr)
+              curve = MeshUtil::load_arc(this->mesh, curve_i, &en, p1, p2, this->curves[curve_i].angle);
+            else
+            {
+              en = this->mesh->peek_edge_node(p1, p2);
+              if (en == nullptr)
+                throw Exceptions::MeshLoadFailureException("Curve #%d: edge %d-%d does not exist.", curve_i, p1, p2);
+              Nurbs* nurbs = this->curves[curve_i].curve;
+              this->curves[curve_i].curve = nullptr;
+              // Edge endpoints are also control points, with weight 1.0.
+              nurbs->pt[0][0] = this->mesh->get_node(p1)->x;
+              nurbs->pt[0][1] = this->mesh->get_node(p1)->y;
+              nurbs->pt[0][2] = 1.0;
+              nurbs->pt[nurbs->np - 1][0] = this->mesh->get_node(p2)->x;
+              nurbs->pt[nurbs->np - 1][1] = this->mesh->get_node(p2)->y;
+              nurbs->pt[nurbs->np - 1][2] = 1.0;
+              curve = nurbs;
+            }
+            MeshUtil::assign_curve(en, curve, p1, p2);
+          }
+
+          if (this->curves.size() > 0)
+          {
+            Element* e;
+            for_all_used_elements(e, this->mesh)
+              if (e->cm != nullptr)
+                e->cm->update_refmap_coeffs(e);
+          }
+
+          this->mesh->seq = g_mesh_seq++;
+          this->mesh->initial_single_check();
+
+          // Refinements.
+          for (unsigned int i = 0; i < this->refinements.size(); i++)
+          {
+            if (this->refinements[i].second == -1)
+              this->mesh->unrefine_element_id(this->refinements[i].first);
+            else
+              this->mesh->refine_element_id(this->refinements[i].first, this->refinements[i].second);
+          }
+        }
+
+      protected:
+        enum Section
+        {
+          None,
+          Variables,
+          Vertices,
+          Elements,
+          Edges,
+          Curves,
+          Refinements
+        };
+
+        void add_vertex(const xercesc::Attributes& attrs)
+        {
+          Node* node = this->mesh->get_nodes().add();
+          node->ref = TOP_LEVEL_REF;
+          node->type = HERMES_TYPE_VERTEX;
+          node->bnd = 0;
+          node->p1 = node->p2 = -1;
+          node->next_hash = nullptr;
+          node->x = this->coordinate(attrs, "x");
+          node->y = this->coordinate(attrs, "y");
+          this->vertex_count++;
+        }
+
+        void add_element(const xercesc::Attributes& attrs)
+        {
+          std::string marker = transcode(this->attribute(attrs, "m"));
+          // Trim whitespaces.
+          size_t begin = marker.find_first_not_of(" \t\n");
+          size_t end = marker.find_last_not_of(" \t\n");
+          marker = begin == std::string::npos ? std::string() : marker.substr(begin, end - begin + 1);
+          int internal_marker = this->mesh->element_markers_conversion.insert_marker(marker);
+
+          Node* v0 = this->vertex(attrs, "v1");
+          Node* v1 = this->vertex(attrs, "v2");
+          Node* v2 = this->vertex(attrs, "v3");
+          if (this->find(attrs, "v4") != nullptr)
+          {
+            Node* v3 = this->vertex(attrs, "v4");
+            Mesh::check_quad(this->element_count, v0, v1, v2, v3);
+            this->mesh->create_quad(internal_marker, v0, v1, v2, v3, nullptr);
+          }
+          else
+          {
+            Mesh::check_triangle(this->element_count, v0, v1, v2);
+            this->mesh->create_triangle(internal_marker, v0, v1, v2, nullptr);
+          }
+          this->element_count++;
+        }
+
+        void add_edge(const xercesc::Attributes& attrs)
+        {
+          int v1 = this->integer(attrs, "v1");
+          int v2 = this->integer(attrs, "v2");
+          Node* en = this->mesh->peek_edge_node(v1, v2);
+          if (en == nullptr)
+            throw Exceptions::MeshLoadFailureException("Boundary data #%d: edge %d-%d does not exist.", this->edge_count, v1, v2);
+
+          std::string edge_marker = transcode(this->attribute(attrs, "m"));
+          int marker = this->mesh->boundary_markers_conversion.insert_marker(edge_marker);
+          en->marker = marker;
+          // This is extremely important, as in DG, it is assumed that negative boundary markers are reserved
+          // for the inner edges.
+          if (marker > 0)
+          {
+            this->mesh->get_node(v1)->bnd = 1;
+            this->mesh->get_node(v2)->bnd = 1;
+            en->bnd = 1;
+          }
+          this->edge_count++;
+        }
+
+        void add_curve(const XMLCh* localname, const xercesc::Attributes& attrs)
+        {
+          if (equals(localname, "arc"))
+          {
+            CurveData curve = { this->integer(attrs, "v1"), this->integer(attrs, "v2"), this->number(attrs, "angle"), nullptr };
+            this->curves.push_back(curve);
+          }
+          else if (equals(localname, "NURBS"))
+          {
+            this->current_nurbs = new Nurbs;
+            this->current_nurbs->degree = this->integer(attrs, "deg");
+            this->nurbs_p1 = this->integer(attrs, "v1");
+            this->nurbs_p2 = this->integer(attrs, "v2");
+            this->inner_points.clear();
+            this->knots.clear();
+          }
+          else if (equals(localname, "inner_point"))
+          {
+            double3 point = { this->number(attrs, "x"), this->number(attrs, "y"), this->number(attrs, "weight") };
+            this->inner_points.push_back(std::vector<double>(point, point + 3));
+          }
+          else if (equals(localname, "knot"))
+            this->knots.push_back(this->number(attrs, "value"));
+        }
+
+        /// Control points and knots as in MeshReaderH2DXML::load_nurbs(), the end points are filled in by finish().
+        void finish_nurbs()
+        {
+          Nurbs* nurbs = this->current_nurbs;
+          int inner = this->inner_points.size();
+          nurbs->np = inner + 2;
+          nurbs->pt = new double3[nurbs->np];
+          for (int i = 0; i < inner; i++)
+            for (int j = 0; j < 3; j++)
+              nurbs->pt[i + 1][j] = this->inner_points[i][j];
+
+          inner = this->knots.size();
+          nurbs->nk = nurbs->degree + nurbs->np + 1;
+          int outer = nurbs->nk - inner;
+          if ((outer & 1) == 1)
+            throw Exceptions::MeshLoadFailureException("Curve #%d: incorrect number of knot points.", (int)this->curves.size());
+
+          // The knot vector is completed by 0.0 on the left and by 1.0 on the right.
+          nurbs->kv = new double[nurbs->nk];
+          for (int i = 0; i < outer / 2; i++)
+            nurbs->kv[i] = 0.0;
+          for (int i = outer / 2; i < inner + outer / 2; i++)
+            nurbs->kv[i] = this->knots[i - (outer / 2)];
+          for (int i = outer / 2 + inner; i < nurbs->nk; i++)
+            nurbs->kv[i] = 1.0;
+
+          CurveData curve = { this->nurbs_p1, this->nurbs_p2, 0., nurbs };
+          this->curves.push_back(curve);
+          this->current_nurbs = nullptr;
+        }
+
+        const XMLCh* find(const xercesc::Attributes& attrs, const char* name)
+        {
+          for (XMLSize_t i = 0; i < attrs.getLength(); i++)
+            if (equals(attrs.getLocalName(i), name))
+              return attrs.getValue(i);
+          return nullptr;
+        }
+
+        const XMLCh* attribute(const xercesc::Attributes& attrs, const char* name)
+        {
+          const XMLCh* value = this->find(attrs, name);
+          if (value == nullptr)
+            throw Exceptions::MeshLoadFailureException("Mesh file %s: the attribute '%s' is missing.", this->filename, name);
+          return value;
+        }
+
+        double number(const xercesc::Attributes& attrs, const char* name)
+        {
+          char buffer[64];
+          return std::strtod(narrow(this->attribute(attrs, name), buffer, 64), nullptr);
+        }
+
+        int integer(const xercesc::Attributes& attrs, const char* name)
+        {
+          char buffer[64];
+          return std::atoi(narrow(this->attribute(attrs, name), buffer, 64));
+        }
+
+        /// A vertex coordinate may be given by a variable.
+        double coordinate(const xercesc::Attributes& attrs, const char* name)
+        {
+          const XMLCh* value = this->attribute(attrs, name);
+          if (!this->variables.empty())
+          {
+            std::map<std::string, double>::iterator it = this->variables.find(transcode(value));
+            if (it != this->variables.end())
+              return it->second;
+          }
+          char buffer[64];
+          return std::strtod(narrow(value, buffer, 64), nullptr);
+        }
+
+        Node* vertex(const xercesc::Attributes& attrs, const char* name)
+        {
+          int index = this->integer(attrs, name);
+          if (index < 0 || index >= this->vertex_count)
+            throw Exceptions::MeshLoadFailureException("Mesh file %s: element #%d refers to the vertex %d, there are %d vertices.", this->filename, this->element_count, index, this->vertex_count);
+          return &this->mesh->get_nodes()[index];
+        }
+
+        MeshReaderH2DXMLStream* reader;
+        MeshSharedPtr mesh;
+        const char* filename;
+
+        Section section;
+        int vertex_count;
+        int element_count;
+        int edge_count;
+        std::map<std::string, double> variables;
+
+        /// Curves, applied in finish().
+        struct CurveData
+        {
+          int p1;
+          int p2;
+          double angle;
+          /// nullptr for arcs.
+          Nurbs* curve;
+        };
+        std::vector<CurveData> curves;
+        Nurbs* current_nurbs;
+        int nurbs_p1, nurbs_p2;
+        std::vector<std::vector<double> > inner_points;
+        std::vector<double> knots;
+
+        std::vector<std::pair<int, int> > refinements;
+      };
+    };
+  }
+}
+
+// Xerces' ErrorHandler has a method error(), therefore the macro had to be undefined in this file.
+#ifndef error
+#define error(...) hermes_exit_if(hermes_log_message_if(true, HERMES_BUILD_LOG_INFO(HERMES_EC_ERROR), __VA_ARGS__))
+#endif
+#endif
@@ -0,0 +1,257 @@
+// This file is part of Hermes2D
+//
+// Copyright (c) 2009 hp-FEM group at the University of Nevada, Reno (UNR).
+// Email: hpfem-group@unr.edu, home page: http://www.hpfem.org/.
+//
+// Hermes2D is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published
+// by the Free Software Foundation; either version 2 of the License,
+// or (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+/*! \file adaptive_runge_kutta.h
+\brief Runge-Kutta methods with adaptive time step control.
+*/
+#ifndef __H2D_ADAPTIVE_RUNGE_KUTTA_H
+#define __H2D_ADAPTIVE_RUNGE_KUTTA_H
+
+#include "runge_kutta_stage_solver.h"
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    /// Time integration with embedded Runge-Kutta methods and an adaptive time step.<br>
+    /// The error of a step is measured by the embedded estimate in the weighted root mean square norm of the coefficient vectors,<br>
+    /// err = sqrt(1/ndof \sum_k (e_k / (atol + rtol * max(|Y_k|, |Y_new_k|)))^2),<br>
+    /// the step is accepted if err <= 1, and the next step length is given by the PI controller (Gustafsson)<br>
+    /// h_new = h * safety * err^(-0.7 / (q + 1)) * err_prev^(0.4 / (q + 1)),<br>
+    /// where q is the lower of the orders of the embedded pair, bounded by [min_factor, max_factor] * h and [h_min, h_max].
+    /// Rejected steps (and steps where Newton's method fails) are repeated with a shorter step, reusing the mass matrix,
+    /// the projection of the previous solution, and the Jacobian, so that only the stage matrices are refactorized.<br>
+    /// Typical usage:<br>
+    /// ButcherTable bt(Implicit_SDIRK_CASH_3_23_embedded);<br>
+    /// AdaptiveRungeKutta<double> runge_kutta(wf, space, &bt, 2);<br>
+    /// runge_kutta.set_time_step(initial_time_step);<br>
+    /// while (runge_kutta.time < end_time)<br>
+    /// {<br>
+    ///   runge_kutta.rk_time_step_adaptive(sln_time_prev, sln_time_new, end_time);<br>
+    ///   sln_time_prev->copy(sln_time_new);<br>
+    /// }<br>
+    template<typename Scalar>
+    class AdaptiveRungeKutta : public RungeKuttaStageSolver < Scalar >
+    {
+    public:
+      /// Constructor.
+      /// \param[in] order The lower of the orders of the embedded pair (e.g. 2 for *_23_embedded tables).
+      AdaptiveRungeKutta(WeakFormSharedPtr<Scalar> wf, std::vector<SpaceSharedPtr<Scalar> > spaces, ButcherTable* bt, unsigned int order) : RungeKuttaStageSolver<Scalar>(wf, spaces, bt)
+      {
+        this->init_adaptive(order);
+      }
+
+      /// Constructor for one equation.
+      AdaptiveRungeKutta(WeakFormSharedPtr<Scalar> wf, SpaceSharedPtr<Scalar> space, ButcherTable* bt, unsigned int order) : RungeKuttaStageSolver<Scalar>(wf, space, bt)
+      {
+        this->init_adaptive(order);
+      }
+
+      /// Set the tolerances of the error estimate.
+      /// Default: 1e-4, 1e-6.
+      void set_tolerances(double relative_tolerance, double absolute_tolerance)
+      {
+        if (relative_tolerance < 0. || absolute_tolerance < 0. || relative_tolerance + absolute_tolerance == 0.)
+          throw Exceptions::ValueException("relative_tolerance", relative_tolerance, 0.);
+        this->relative_tolerance = relative_tolerance;
+        this->absolute_tolerance = absolute_tolerance;
+      }
+
+      /// Set the bounds of the time step length.
+      /// Default: 1e-12, unbounded.
+      void set_time_step_bounds(double min_time_step, double max_time_step)
+      {
+        if (min_time_step <= 0. || min_time_step > max_time_step)
+          throw Exceptions::ValueException("min_time_step", min_time_step, 0., max_time_step);
+        this->min_time_step = min_time_step;
+        this->max_time_step = max_time_step;
+      }
+
+      /// Set the parameters of the controller.
+      /// Default: 0.9, 0.2, 5.0.
+      void set_controller_parameters(double safety, double min_factor, double max_factor)
+      {
+        if (safety <= 0. || safety > 1.)
+          throw Exceptions::ValueException("safety", safety, 0., 1.);
+        if (min_factor <= 0. || min_factor >= 1.)
+          throw Exceptions::ValueException("min_factor", min_factor, 0., 1.);
+        if (max_factor <= 1.)
+          throw Exceptions::ValueException("max_factor", max_factor, 1.);
+        this->safety = safety;
+        this->min_factor = min_factor;
+        this->max_factor = max_factor;
+      }
+
+      /// Set the maximum number of rejections of one step.
+      /// Default: 20.
+      void set_max_rejections(unsigned int max_rejections)
+      {
+        this->max_rejections = max_rejections;
+      }
+
+      unsigned int get_num_accepted_steps() const { return this->accepted_steps; }
+      unsigned int get_num_rejected_steps() const { return this->rejected_steps; }
+      /// The error of the last accepted step (relative to the tolerances).
+      double get_error_norm() const { return this->error_norm_previous; }
+
+      /// One accepted time step from this->time, starting with the step length this->time_step.<br>
+      /// On return, this->time is the new time level, and this->time_step is the proposed length of the next step.
+      /// \param[in] end_time The step does not go beyond this time.
+      /// \return The length of the accepted step.
+      double rk_time_step_adaptive(std::vector<MeshFunctionSharedPtr<Scalar> > slns_time_prev, std::vector<MeshFunctionSharedPtr<Scalar> > slns_time_new, double end_time = std::numeric_limits<double>::max())
+      {
+        if (slns_time_prev.size() != this->spaces.size())
+          throw Exceptions::LengthException(1, slns_time_prev.size(), this->spaces.size());
+        if (slns_time_new.size() != this->spaces.size())
+          throw Exceptions::LengthException(2, slns_time_new.size(), this->spaces.size());
+        if (end_time <= this->time)
+          throw Exceptions::ValueException("end_time", end_time, this->time);
+
+        this->tick();
+        double exponent = 1. / (this->order + 1.);
+        double time_step = std::max(std::min(this->time_step, this->max_time_step), this->min_time_step);
+        bool last_step = false;
+        unsigned int rejections = 0;
+        this->repeat_step = false;
+
+        while (true)
+        {
+          if (this->time + time_step >= end_time)
+          {
+            time_step = end_time - this->time;
+            last_step = true;
+          }
+          this->time_step = time_step;
+
+          double error_norm = std::numeric_limits<double>::max();
+          bool newton_converged = true;
+          try
+          {
+            this->compute_step(slns_time_prev);
+            error_norm = this->calculate_error_norm();
+          }
+          catch (Exceptions::NonlinearException&)
+          {
+            newton_converged = false;
+            this->K.clear();
+          }
+          this->repeat_step = true;
+
+          if (newton_converged && error_norm <= 1.)
+          {
+            // PI controller, only a decrease after rejections.
+            double factor = this->max_factor;
+            if (error_norm > 0.)
+            {
+              factor = this->safety * std::pow(error_norm, -0.7 * exponent);
+              if (this->accepted_steps > 0)
+                factor *= std::pow(this->error_norm_previous, 0.4 * exponent);
+            }
+            factor = std::max(this->min_factor, std::min(factor, rejections > 0 ? 1. : this->max_factor));
+
+            Solution<Scalar>::vector_to_solutions(this->Y_new.data(), this->spaces, slns_time_new);
+            this->time = last_step ? end_time : this->time + time_step;
+            this->time_step = std::max(std::min(time_step * factor, this->max_time_step), this->min_time_step);
+            this->error_norm_previous = std::max(error_norm, 1e-4);
+            this->accepted_steps++;
+            this->repeat_step = false;
+
+            this->tick();
+            this->info("\tAdaptiveRungeKutta: step %g accepted (error %g), next step %g (%s).", time_step, error_norm, this->time_step, this->last_str().c_str());
+            return time_step;
+          }
+
+          this->rejected_steps++;
+          double factor = newton_converged ? std::max(this->min_factor, this->safety * std::pow(error_norm, -exponent)) : this->min_factor;
+          this->info("\tAdaptiveRungeKutta: step %g rejected (error %g).", time_step, error_norm);
+
+          time_step *= std::min(factor, this->safety);
+          last_step = false;
+          if (++rejections > this->max_rejections || time_step < this->min_time_step)
+          {
+            this->repeat_step = false;
+            throw Exceptions::Exception("AdaptiveRungeKutta: step rejected %i times, the step length %g is below the minimum %g or the maximum number of rejections was reached.", rejections, time_step, this->min_time_step);
+          }
+        }
+      }
+
+      double rk_time_step_adaptive(MeshFunctionSharedPtr<Scalar> sln_time_prev, MeshFunctionSharedPtr<Scalar> sln_time_new, double end_time = std::numeric_limits<double>::max())
+      {
+        return this->rk_time_step_adaptive(std::vector<MeshFunctionSharedPtr<Scalar> >(1, sln_time_prev), std::vector<MeshFunctionSharedPtr<Scalar> >(1, sln_time_new), end_time);
+      }
+
+      inline std::string getClassName() const { return "AdaptiveRungeKutta"; }
+
+    protected:
+      void init_adaptive(unsigned int order)
+      {
+        if (!this->bt->is_embedded())
+          throw Exceptions::Exception("AdaptiveRungeKutta: the Butcher's table has to be embedded (with the B2 row).");
+        if (order == 0)
+          throw Exceptions::ValueException("order", order, 1.);
+        this->order = order;
+        this->relative_tolerance = 1e-4;
+        this->absolute_tolerance = 1e-6;
+        this->min_time_step = 1e-12;
+        this->max_time_step = std::numeric_limits<double>::max();
+        this->safety = 0.9;
+        this->min_factor = 0.2;
+        this->max_factor = 5.0;
+        this->max_rejections = 20;
+        this->accepted_steps = 0;
+        this->rejected_steps = 0;
+        this->error_norm_previous = 1.;
+      }
+
+      /// Weighted root mean square norm of the error estimate.
+      double calculate_error_norm()
+      {
+        int ndof = this->Y.size();
+        if (ndof == 0)
+          return 0.;
+        double sum = 0.;
+        for (int k = 0; k < ndof; k++)
+        {
+          double scale = this->absolute_tolerance + this->relative_tolerance * std::max(std::abs(this->Y[k]), std::abs(this->Y_new[k]));
+          double ratio = std::abs(this->error_vector[k]) / scale;
+          sum += ratio * ratio;
+        }
+        return std::sqrt(sum / ndof);
+      }
+
+      /// The lower order of the embedded pair.
+      unsigned int order;
+
+      /// Settings.
+      double relative_tolerance;
+      double absolute_tolerance;
+      double min_time_step;
+      double max_time_step;
+      double safety;
+      double min_factor;
+      double max_factor;
+      unsigned int max_rejections;
+
+      /// State and statistics.
+      double error_norm_previous;
+      unsigned int accepted_steps;
+      unsigned int rejected_steps;
+    };
+  }
+}
+#endif
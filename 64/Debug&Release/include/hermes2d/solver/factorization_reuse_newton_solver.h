@@ -0,0 +1,248 @@
+// This file is part of Hermes2D
+//
+// Copyright (c) 2009 hp-FEM group at the University of Nevada, Reno (UNR).
+// Email: hpfem-group@unr.edu, home page: http://www.hpfem.org/.
+//
+// Hermes2D is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published
+// by the Free Software Foundation; either version 2 of the License,
+// or (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+/*! \file factorization_reuse_newton_solver.h
+\brief Newton's method reusing the factorizations of direct solvers.
+*/
+#ifndef __H2D_SOLVER_FACTORIZATION_REUSE_NEWTON_H_
+#define __H2D_SOLVER_FACTORIZATION_REUSE_NEWTON_H_
+
+#include "newton_solver.h"
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    /// Newton's method with a factorization reuse pipeline for direct solvers (UMFPACK, MUMPS, ...).<br>
+    /// The MatrixStructureReuseScheme of the linear matrix solver is chosen in each Newton step:
+    /// - HERMES_CREATE_STRUCTURE_FROM_SCRATCH only in the first step after the spaces changed (their seq numbers, or the number of DOFs),
+    /// - HERMES_REUSE_MATRIX_REORDERING (or HERMES_REUSE_MATRIX_REORDERING_AND_SCALING, see set_reuse_scaling()) otherwise,
+    ///   i.e. the UMFPACK symbolic object and the MUMPS analysis are kept across Newton steps and across time steps
+    ///   (the instance of the solver is reused) and only the numerical factorization is done,
+    /// - HERMES_REUSE_MATRIX_STRUCTURE_COMPLETELY if the Jacobian was not reassembled.<br>
+    /// Optionally (set_numeric_factorization_reuse()), the whole numerical factorization is reused for several Newton steps:
+    /// the new Jacobian is only assembled and the step is solved by iterative refinement preconditioned by the old factorization,<br>
+    /// x_0 = M^-1 b, x_k+1 = x_k + M^-1 (b - J x_k),<br>
+    /// until the relative residual drops below the refinement tolerance. If it does not in the allowed number of refinement iterations,
+    /// the Jacobian is factorized again.<br>
+    /// For iterative linear matrix solvers, the solver is identical to NewtonSolver.
+    template<typename Scalar>
+    class FactorizationReuseNewtonSolver : public NewtonSolver < Scalar >
+    {
+    public:
+      FactorizationReuseNewtonSolver() : NewtonSolver<Scalar>()
+      {
+        this->init_factorization_reuse();
+      }
+      FactorizationReuseNewtonSolver(DiscreteProblem<Scalar>* dp) : NewtonSolver<Scalar>(dp)
+      {
+        this->init_factorization_reuse();
+      }
+      FactorizationReuseNewtonSolver(WeakFormSharedPtr<Scalar> wf, SpaceSharedPtr<Scalar> space) : NewtonSolver<Scalar>(wf, space)
+      {
+        this->init_factorization_reuse();
+      }
+      FactorizationReuseNewtonSolver(WeakFormSharedPtr<Scalar> wf, std::vector<SpaceSharedPtr<Scalar> > spaces) : NewtonSolver<Scalar>(wf, spaces)
+      {
+        this->init_factorization_reuse();
+      }
+
+      /// Reuse also the scaling (HERMES_REUSE_MATRIX_REORDERING_AND_SCALING).
+      /// Default: false.
+      void set_reuse_scaling(bool to_set = true)
+      {
+        this->reuse_scaling = to_set;
+      }
+
+      /// Reuse the numerical factorization for up to max_steps Newton steps.
+      /// \param[in] max_steps Zero turns the reuse off (default).
+      /// \param[in] refinement_tolerance Relative residual of the linear system for the iterative refinement to stop.
+      /// \param[in] max_refinement_iterations Maximum number of the refinement iterations (solves with the old factorization), if the refinement does not converge in them, the Jacobian is factorized again.
+      void set_numeric_factorization_reuse(unsigned int max_steps, double refinement_tolerance = 1e-8, unsigned int max_refinement_iterations = 10)
+      {
+        if (refinement_tolerance <= 0.)
+          throw Exceptions::ValueException("refinement_tolerance", refinement_tolerance, 0.);
+        this->max_steps_with_reused_factorization = max_steps;
+        this->refinement_tolerance = refinement_tolerance;
+        this->max_refinement_iterations = max_refinement_iterations;
+      }
+
+      /// Numbers of (symbolic + numeric, numeric only) factorizations and refinement iterations since the creation of this instance.
+      unsigned int get_symbolic_factorizations() const { return this->symbolic_factorizations; }
+      unsigned int get_numeric_factorizations() const { return this->numeric_factorizations; }
+      unsigned int get_refinement_iterations() const { return this->refinement_iterations; }
+
+      virtual bool assemble_jacobian(bool store_previous_jacobian)
+      {
+        this->jacobian_assembled = true;
+        return NewtonSolver<Scalar>::assemble_jacobian(store_previous_jacobian);
+      }
+
+      virtual bool assemble(bool store_previous_jacobian, bool store_previous_residual)
+      {
+        this->jacobian_assembled = true;
+        return NewtonSolver<Scalar>::assemble(store_previous_jacobian, store_previous_residual);
+      }
+
+      inline std::string getClassName() const { return "FactorizationReuseNewtonSolver"; }
+
+    protected:
+      void init_factorization_reuse()
+      {
+        this->reuse_scaling = false;
+        this->max_steps_with_reused_factorization = 0;
+        this->refinement_tolerance = 1e-8;
+        this->max_refinement_iterations = 10;
+        this->factorization_valid = false;
+        this->jacobian_assembled = false;
+        this->steps_with_reused_factorization = 0;
+        this->factorized_size = -1;
+        this->symbolic_factorizations = 0;
+        this->numeric_factorizations = 0;
+        this->refinement_iterations = 0;
+      }
+
+      /// True if the spaces did not change since the last factorization.
+      bool spaces_unchanged()
+      {
+        std::vector<SpaceSharedPtr<Scalar> > spaces = this->get_spaces();
+        bool unchanged = (this->factorized_size == this->problem_size && this->space_seqs.size() == spaces.size());
+        for (unsigned int i = 0; unchanged && i < spaces.size(); i++)
+          unchanged = (this->space_seqs[i] == spaces[i]->get_seq());
+
+        this->space_seqs.resize(spaces.size());
+        for (unsigned int i = 0; i < spaces.size(); i++)
+          this->space_seqs[i] = spaces[i]->get_seq();
+        this->factorized_size = this->problem_size;
+        return unchanged;
+      }
+
+      virtual void solve_linear_system()
+      {
+        if (!dynamic_cast<DirectSolver<Scalar>*>(this->linear_matrix_solver))
+        {
+          NewtonSolver<Scalar>::solve_linear_system();
+          return;
+        }
+
+        bool jacobian_assembled = this->jacobian_assembled;
+        this->jacobian_assembled = false;
+
+        bool spaces_unchanged = this->spaces_unchanged();
+        if (!this->factorization_valid || !spaces_unchanged)
+        {
+          this->factorize(HERMES_CREATE_STRUCTURE_FROM_SCRATCH);
+          this->symbolic_factorizations++;
+          return;
+        }
+
+        if (!jacobian_assembled)
+        {
+          this->linear_matrix_solver->set_reuse_scheme(HERMES_REUSE_MATRIX_STRUCTURE_COMPLETELY);
+          NewtonSolver<Scalar>::solve_linear_system();
+          return;
+        }
+
+        if (this->steps_with_reused_factorization < this->max_steps_with_reused_factorization && this->refine())
+        {
+          this->steps_with_reused_factorization++;
+          return;
+        }
+
+        this->factorize(this->reuse_scaling ? HERMES_REUSE_MATRIX_REORDERING_AND_SCALING : HERMES_REUSE_MATRIX_REORDERING);
+      }
+
+      /// Solve with a new numerical factorization.
+      void factorize(MatrixStructureReuseScheme reuse_scheme)
+      {
+        this->linear_matrix_solver->set_reuse_scheme(reuse_scheme);
+        NewtonSolver<Scalar>::solve_linear_system();
+        this->factorization_valid = true;
+        this->steps_with_reused_factorization = 0;
+        this->numeric_factorizations++;
+      }
+
+      /// Iterative refinement with the old factorization.
+      /// \return True if it converged, the solution is then in the linear matrix solver's sln vector.
+      bool refine()
+      {
+        int n = this->problem_size;
+        memcpy(this->previous_sln_vector, this->sln_vector, sizeof(Scalar)* n);
+
+        Vector<Scalar>* residual = this->get_residual();
+        std::vector<Scalar> b(n), x(n), r(n), Jx(n);
+        residual->extract(b.data());
+        double b_norm = get_l2_norm(b.data(), n);
+
+        this->linear_matrix_solver->set_reuse_scheme(HERMES_REUSE_MATRIX_STRUCTURE_COMPLETELY);
+        bool converged = false;
+        unsigned int iterations = 0;
+        r = b;
+        while (iterations < this->max_refinement_iterations)
+        {
+          residual->set_vector(r.data());
+          this->linear_matrix_solver->solve();
+          Scalar* correction = this->linear_matrix_solver->get_sln_vector();
+          for (int i = 0; i < n; i++)
+            x[i] += correction[i];
+
+          Scalar* Jx_data = Jx.data();
+          this->get_jacobian()->multiply_with_vector(x.data(), Jx_data, true);
+          for (int i = 0; i < n; i++)
+            r[i] = b[i] - Jx[i];
+          iterations++;
+          if (get_l2_norm(r.data(), n) <= this->refinement_tolerance * b_norm)
+          {
+            converged = true;
+            break;
+          }
+        }
+
+        residual->set_vector(b.data());
+        this->refinement_iterations += iterations;
+        if (converged)
+        {
+          memcpy(this->linear_matrix_solver->get_sln_vector(), x.data(), sizeof(Scalar)* n);
+          this->info("\tFactorizationReuseNewtonSolver: factorization reused, %i refinement iterations.", iterations);
+        }
+        else
+          this->info("\tFactorizationReuseNewtonSolver: refinement did not converge, factorizing.");
+        return converged;
+      }
+
+      /// Settings.
+      bool reuse_scaling;
+      unsigned int max_steps_with_reused_factorization;
+      double refinement_tolerance;
+      unsigned int max_refinement_iterations;
+
+      /// State.
+      bool factorization_valid;
+      bool jacobian_assembled;
+      unsigned int steps_with_reused_factorization;
+      std::vector<int> space_seqs;
+      int factorized_size;
+
+      /// Statistics.
+      unsigned int symbolic_factorizations;
+      unsigned int numeric_factorizations;
+      unsigned int refinement_iterations;
+    };
+  }
+}
+#endif
@@ -0,0 +1,414 @@
+// This file is part of Hermes2D
+//
+// Copyright (c) 2009 hp-FEM group at the University of Nevada, Reno (UNR).
+// Email: hpfem-group@unr.edu, home page: http://www.hpfem.org/.
+//
+// Hermes2D is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published
+// by the Free Software Foundation; either version 2 of the License,
+// or (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+/*! \file jacobian_free_newton_solver.h
+\brief Jacobian-free Newton-Krylov method.
+*/
+#ifndef __H2D_SOLVER_JACOBIAN_FREE_NEWTON_H_
+#define __H2D_SOLVER_JACOBIAN_FREE_NEWTON_H_
+
+#include "inexact_newton_solver.h"
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    /// Choice of the finite difference perturbation in the Jacobian-vector products.
+    /// (see Knoll, Keyes: Jacobian-free Newton-Krylov methods: a survey of approaches and applications)
+    enum JFNKPerturbationType
+    {
+      /// epsilon = b.
+      JFNKPerturbationConstant,
+      /// epsilon = b * (1 + ||u||) / ||v||.
+      JFNKPerturbationSolutionNorm,
+      /// epsilon = b / (n * ||v||) * sum_i |u_i| + b.
+      JFNKPerturbationComponentWise
+    };
+
+    /// Newton's method with the Jacobian-free Newton-Krylov (JFNK) mode.<br>
+    /// In the JFNK mode, the linear system of each Newton step is solved by the restarted flexible GMRES,
+    /// with the Jacobian-vector products approximated by finite differences of the residual:<br>
+    /// J(u) v = (F(u + epsilon v) - F(u)) / epsilon,<br>
+    /// so that one product costs one residual assembling. The Jacobian is assembled only every few Newton steps
+    /// (see set_jfnk_preconditioner_refresh()) and it is used as the right preconditioner - it is solved
+    /// by the linear matrix solver of this instance (the factorization of a direct solver is kept
+    /// for all Krylov iterations of all Newton steps until the next refresh, an iterative solver such as
+    /// IterativeParalutionLinearMatrixSolver is run with its own settings - the flexible variant of GMRES allows for that).<br>
+    /// The relative tolerance of GMRES is the forcing term of InexactNewtonSolver, or a fixed one if the adaptive
+    /// linear tolerance is turned off (see set_jfnk_krylov_parameters()).
+    /// Damping, convergence measurement and all other settings are those of NewtonSolver.
+    /// Without the JFNK mode (set_jfnk(false)), the solver is identical to InexactNewtonSolver.<br>
+    /// Typical usage:<br>
+    /// Hermes::Hermes2D::JacobianFreeNewtonSolver<double> newton_solver(wf, space);<br>
+    /// newton_solver.set_jfnk_preconditioner_refresh(5);<br>
+    /// newton_solver.set_jfnk_krylov_parameters(1e-4, 200, 30);<br>
+    /// newton_solver.solve();<br>
+    template<typename Scalar>
+    class JacobianFreeNewtonSolver : public InexactNewtonSolver < Scalar >
+    {
+    public:
+      JacobianFreeNewtonSolver() : InexactNewtonSolver<Scalar>()
+      {
+        this->init_jfnk();
+      }
+      JacobianFreeNewtonSolver(DiscreteProblem<Scalar>* dp) : InexactNewtonSolver<Scalar>(dp)
+      {
+        this->init_jfnk();
+      }
+      JacobianFreeNewtonSolver(WeakFormSharedPtr<Scalar> wf, SpaceSharedPtr<Scalar> space) : InexactNewtonSolver<Scalar>(wf, space)
+      {
+        this->init_jfnk();
+      }
+      JacobianFreeNewtonSolver(WeakFormSharedPtr<Scalar> wf, std::vector<SpaceSharedPtr<Scalar> > spaces) : InexactNewtonSolver<Scalar>(wf, spaces)
+      {
+        this->init_jfnk();
+      }
+      virtual ~JacobianFreeNewtonSolver()
+      {
+        delete this->perturbed_residual;
+      }
+
+      /// Turn the JFNK mode on / off.
+      /// Default: on.
+      void set_jfnk(bool to_set = true)
+      {
+        this->jfnk = to_set;
+      }
+
+      /// Set the finite difference perturbation.
+      /// Default: JFNKPerturbationSolutionNorm, HermesSqrtEpsilon.
+      /// \param[in] b The parameter b of the formulas in JFNKPerturbationType.
+      void set_jfnk_perturbation(JFNKPerturbationType type, double b = HermesSqrtEpsilon)
+      {
+        if (b <= 0.)
+          throw Exceptions::ValueException("b", b, 0.);
+        this->perturbation_type = type;
+        this->perturbation_b = b;
+      }
+
+      /// Set how many Newton steps use one (preconditioner) Jacobian.
+      /// Default: 5.
+      void set_jfnk_preconditioner_refresh(unsigned int steps)
+      {
+        if (steps == 0)
+          throw Exceptions::ValueException("steps", steps, 1);
+        this->preconditioner_refresh = steps;
+      }
+
+      /// Set the Krylov solver parameters.
+      /// Default: 1e-4, 500, 30.
+      /// \param[in] relative_tolerance Tolerance of the linear residual relative to the Newton residual, used if the adaptive linear tolerance is turned off.
+      /// \param[in] max_iterations Maximum number of Krylov iterations in one Newton step.
+      /// \param[in] restart Krylov subspace dimension.
+      void set_jfnk_krylov_parameters(double relative_tolerance, unsigned int max_iterations, unsigned int restart)
+      {
+        if (relative_tolerance <= 0.)
+          throw Exceptions::ValueException("relative_tolerance", relative_tolerance, 0.);
+        if (restart == 0)
+          throw Exceptions::ValueException("restart", restart, 1);
+        this->krylov_tolerance = relative_tolerance;
+        this->krylov_max_iterations = max_iterations;
+        this->krylov_restart = restart;
+      }
+
+      /// Residual assemblings done for Jacobian-vector products in the last solve().
+      unsigned int get_jfnk_residual_evaluations() const
+      {
+        return this->residual_evaluations;
+      }
+
+      /// Jacobian assemblings done in the last solve().
+      unsigned int get_jfnk_jacobian_evaluations() const
+      {
+        return this->jacobian_evaluations;
+      }
+
+      virtual void init_solving(Scalar* coeff_vec)
+      {
+        InexactNewtonSolver<Scalar>::init_solving(coeff_vec);
+        this->preconditioner_ready = false;
+        this->residual_evaluations = 0;
+        this->jacobian_evaluations = 0;
+        if (!this->perturbed_residual)
+          this->perturbed_residual = new SimpleVector<Scalar>(this->problem_size);
+        else if ((int)this->perturbed_residual->get_size() != this->problem_size)
+          this->perturbed_residual->alloc(this->problem_size);
+      }
+
+      /// In the JFNK mode, the Jacobian is assembled only when the preconditioner is due.
+      virtual bool assemble_jacobian(bool store_previous_jacobian)
+      {
+        if (this->jfnk && !this->preconditioner_due())
+          return true;
+        this->on_preconditioner_assembled();
+        return NewtonSolver<Scalar>::assemble_jacobian(store_previous_jacobian);
+      }
+
+      /// In the JFNK mode, the Jacobian is assembled only when the preconditioner is due.
+      virtual bool assemble(bool store_previous_jacobian, bool store_previous_residual)
+      {
+        if (this->jfnk && !this->preconditioner_due())
+        {
+          this->assemble_residual(store_previous_residual);
+          return true;
+        }
+        this->on_preconditioner_assembled();
+        return NewtonSolver<Scalar>::assemble(store_previous_jacobian, store_previous_residual);
+      }
+
+      inline std::string getClassName() const { return "JacobianFreeNewtonSolver"; }
+
+    protected:
+      void init_jfnk()
+      {
+        this->jfnk = true;
+        this->perturbation_type = JFNKPerturbationSolutionNorm;
+        this->perturbation_b = HermesSqrtEpsilon;
+        this->preconditioner_refresh = 5;
+        this->krylov_tolerance = 1e-4;
+        this->krylov_max_iterations = 500;
+        this->krylov_restart = 30;
+        this->perturbed_residual = nullptr;
+        this->preconditioner_ready = false;
+        this->residual_evaluations = 0;
+        this->jacobian_evaluations = 0;
+      }
+
+      bool preconditioner_due() const
+      {
+        return !this->preconditioner_ready || this->steps_with_preconditioner >= this->preconditioner_refresh;
+      }
+
+      void on_preconditioner_assembled()
+      {
+        this->preconditioner_ready = true;
+        this->preconditioner_factorized = false;
+        this->steps_with_preconditioner = 0;
+        this->jacobian_evaluations++;
+      }
+
+      /// The Newton step by FGMRES.
+      virtual void solve_linear_system()
+      {
+        if (!this->jfnk)
+        {
+          InexactNewtonSolver<Scalar>::solve_linear_system();
+          return;
+        }
+
+        int n = this->problem_size;
+        memcpy(this->previous_sln_vector, this->sln_vector, sizeof(Scalar)* n);
+
+        // The residual vector is the right-hand side of the Newton step and also the rhs of the linear matrix solver - it is overwritten
+        // when the preconditioner is applied.
+        Vector<Scalar>* residual = this->get_residual();
+        this->minus_F.resize(n);
+        residual->extract(this->minus_F.data());
+        std::vector<Scalar> b(this->minus_F);
+
+        std::vector<Scalar> x(n, Scalar(0.));
+        double tolerance = this->adaptive_linear_tolerance ? this->update_forcing_term() : this->krylov_tolerance;
+        unsigned int iterations = this->fgmres(b.data(), x.data(), tolerance);
+        this->linear_iterations_value.push_back(iterations);
+        this->steps_with_preconditioner++;
+        this->info("\tJacobianFreeNewtonSolver: %i Krylov iterations.", iterations);
+
+        // The Newton update is taken from the linear matrix solver.
+        if (!this->linear_matrix_solver->get_sln_vector())
+          this->apply_preconditioner(b.data(), x.data());
+        memcpy(this->linear_matrix_solver->get_sln_vector(), x.data(), sizeof(Scalar)* n);
+        residual->set_vector(this->minus_F.data());
+      }
+
+      /// Solves J x = b, x is zero on input.
+      /// \return Number of iterations.
+      unsigned int fgmres(Scalar* b, Scalar* x, double tolerance)
+      {
+        int n = this->problem_size;
+        unsigned int m = this->krylov_restart;
+        std::vector<std::vector<Scalar> > V(m + 1, std::vector<Scalar>(n)), Z(m, std::vector<Scalar>(n));
+        std::vector<std::vector<Scalar> > H(m + 1, std::vector<Scalar>(m, Scalar(0.)));
+        std::vector<double> cs(m);
+        std::vector<Scalar> sn(m), g(m + 1), y(m), r(b, b + n);
+
+        double beta = get_l2_norm(b, n);
+        double target = tolerance * beta;
+        unsigned int iterations = 0;
+
+        while (beta > target && beta > 0. && iterations < this->krylov_max_iterations)
+        {
+          for (int i = 0; i < n; i++)
+            V[0][i] = r[i] / beta;
+          std::fill(g.begin(), g.end(), Scalar(0.));
+          g[0] = beta;
+
+          unsigned int k = 0;
+          while (k < m && iterations < this->krylov_max_iterations)
+          {
+            // Arnoldi with the modified Gram-Schmidt.
+            this->apply_preconditioner(V[k].data(), Z[k].data());
+            this->jacobian_vector_product(Z[k].data(), V[k + 1].data());
+            for (unsigned int i = 0; i <= k; i++)
+            {
+              H[i][k] = dot(V[i].data(), V[k + 1].data(), n);
+              for (int l = 0; l < n; l++)
+                V[k + 1][l] -= H[i][k] * V[i][l];
+            }
+            double h = get_l2_norm(V[k + 1].data(), n);
+            H[k + 1][k] = h;
+            if (h > 0.)
+              for (int l = 0; l < n; l++)
+                V[k + 1][l] /= h;
+
+            // Givens rotations.
+            for (unsigned int i = 0; i < k; i++)
+            {
+              Scalar temp = cs[i] * H[i][k] + sn[i] * H[i + 1][k];
+              H[i + 1][k] = -conj(sn[i]) * H[i][k] + cs[i] * H[i + 1][k];
+              H[i][k] = temp;
+            }
+            double a = std::abs(H[k][k]);
+            double denominator = std::sqrt(a * a + h * h);
+            if (a == 0.)
+            {
+              cs[k] = 0.;
+              sn[k] = 1.;
+            }
+            else
+            {
+              cs[k] = a / denominator;
+              sn[k] = (H[k][k] / a) * h / denominator;
+            }
+            H[k][k] = cs[k] * H[k][k] + sn[k] * h;
+            H[k + 1][k] = 0.;
+            g[k + 1] = -conj(sn[k]) * g[k];
+            g[k] = cs[k] * g[k];
+
+            k++;
+            iterations++;
+            if (std::abs(g[k]) <= target || h == 0.)
+              break;
+          }
+
+          // x += Z y, H y = g.
+          for (int i = k - 1; i >= 0; i--)
+          {
+            y[i] = g[i];
+            for (unsigned int j = i + 1; j < k; j++)
+              y[i] -= H[i][j] * y[j];
+            y[i] /= H[i][i];
+          }
+          for (unsigned int i = 0; i < k; i++)
+            for (int l = 0; l < n; l++)
+              x[l] += y[i] * Z[i][l];
+
+          if (std::abs(g[k]) <= target)
+            break;
+
+          // Restart - the true residual.
+          this->jacobian_vector_product(x, r.data());
+          for (int i = 0; i < n; i++)
+            r[i] = b[i] - r[i];
+          beta = get_l2_norm(r.data(), n);
+        }
+
+        return iterations;
+      }
+
+      /// Jv by the finite difference of the residual.
+      void jacobian_vector_product(Scalar* v, Scalar* Jv)
+      {
+        int n = this->problem_size;
+        double v_norm = get_l2_norm(v, n);
+        if (v_norm == 0.)
+        {
+          std::fill(Jv, Jv + n, Scalar(0));
+          return;
+        }
+
+        double epsilon = this->perturbation_b;
+        if (this->perturbation_type == JFNKPerturbationSolutionNorm)
+          epsilon = this->perturbation_b * (1. + get_l2_norm(this->previous_sln_vector, n)) / v_norm;
+        else if (this->perturbation_type == JFNKPerturbationComponentWise)
+        {
+          double sum = 0.;
+          for (int i = 0; i < n; i++)
+            sum += std::abs(this->previous_sln_vector[i]);
+          epsilon = this->perturbation_b * sum / (n * v_norm) + this->perturbation_b;
+        }
+
+        Scalar* perturbed = new Scalar[n];
+        for (int i = 0; i < n; i++)
+          perturbed[i] = this->previous_sln_vector[i] + epsilon * v[i];
+        this->perturbed_residual->zero();
+        this->dp->assemble(perturbed, this->perturbed_residual);
+        delete[] perturbed;
+        this->residual_evaluations++;
+
+        // (F(u + epsilon v) - F(u)) / epsilon.
+        for (int i = 0; i < n; i++)
+          Jv[i] = (this->perturbed_residual->get(i) + this->minus_F[i]) / epsilon;
+      }
+
+      /// z = M^-1 r by the linear matrix solver with the last assembled Jacobian.
+      void apply_preconditioner(Scalar* r, Scalar* z)
+      {
+        this->get_residual()->set_vector(r);
+        this->linear_matrix_solver->set_reuse_scheme(this->preconditioner_factorized ? HERMES_REUSE_MATRIX_STRUCTURE_COMPLETELY : HERMES_CREATE_STRUCTURE_FROM_SCRATCH);
+        this->linear_matrix_solver->solve();
+        this->preconditioner_factorized = true;
+        memcpy(z, this->linear_matrix_solver->get_sln_vector(), sizeof(Scalar)* this->problem_size);
+      }
+
+      /// (x, y) = sum conj(x_i) y_i.
+      static Scalar dot(Scalar* x, Scalar* y, int n)
+      {
+        Scalar result = 0.;
+        for (int i = 0; i < n; i++)
+          result += conj(x[i]) * y[i];
+        return result;
+      }
+
+      /// JFNK mode.
+      bool jfnk;
+      JFNKPerturbationType perturbation_type;
+      double perturbation_b;
+
+      /// Preconditioner.
+      unsigned int preconditioner_refresh;
+      unsigned int steps_with_preconditioner;
+      bool preconditioner_ready;
+      bool preconditioner_factorized;
+
+      /// Krylov solver.
+      double krylov_tolerance;
+      unsigned int krylov_max_iterations;
+      unsigned int krylov_restart;
+
+      /// Residual at the perturbed solution.
+      SimpleVector<Scalar>* perturbed_residual;
+      /// The residual vector of NewtonSolver at the current solution (it holds -F(u)).
+      std::vector<Scalar> minus_F;
+
+      /// Statistics.
+      unsigned int residual_evaluations;
+      unsigned int jacobian_evaluations;
+    };
+  }
+}
+#endif
@@ -0,0 +1,528 @@
+// This file is part of Hermes2D
+//
+// Copyright (c) 2009 hp-FEM group at the University of Nevada, Reno (UNR).
+// Email: hpfem-group@unr.edu, home page: http://www.hpfem.org/.
+//
+// Hermes2D is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published
+// by the Free Software Foundation; either version 2 of the License,
+// or (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+/*! \file runge_kutta_stage_solver.h
+\brief Runge-Kutta methods with Kronecker-structured stage systems.
+*/
+#ifndef __H2D_RUNGE_KUTTA_STAGE_SOLVER_H
+#define __H2D_RUNGE_KUTTA_STAGE_SOLVER_H
+
+#include "runge_kutta.h"
+#include "discrete_problem/discrete_problem.h"
+#include "projections/ogprojection.h"
+#include "weakform_library/weakforms_h1.h"
+#include "weakform_library/weakforms_hcurl.h"
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    /// Runge-Kutta methods for M\dot{Y} = F(t, Y), with the same weak formulation (of F) and Butcher's tables as RungeKutta.<br>
+    /// Unlike RungeKutta, the num_stages*ndof stage weak formulation is never created (items 4 - 7 of the TODO list in runge_kutta.h):
+    /// - the mass matrix M is assembled once per change of the spaces, the Jacobian J = dF/dY once per time step
+    ///   (at the previous time level, i.e. a simplified Newton's method), or only once if it is constant (set_constant_jacobian()),
+    /// - the stage matrices are formed from M and J by the Kronecker product I x M - h A x J without any assembling,
+    /// - explicit and diagonally implicit tables are solved stage by stage, with the ndof times ndof matrices M - h a_ii J,
+    ///   so an s-stage step costs s spatial solves (one Newton's loop per stage) instead of one solve of a (s * ndof)^2 system,
+    ///   and the factorizations are reused across the stages (SDIRK tables have a single one), the Newton's iterations,
+    ///   and the time steps (until the time step length or J change),
+    /// - fully implicit tables are solved with the Kronecker system, whose factorization is reused in the same way.
+    /// M is the L2 mass matrix of the spaces (u v for H1 and L2 spaces, E \cdot F for Hcurl spaces), Hdiv spaces are not supported.
+    template<typename Scalar>
+    class RungeKuttaStageSolver :
+      public Hermes::Mixins::Loggable,
+      public Hermes::Mixins::TimeMeasurable,
+      public Hermes::Mixins::SettableComputationTime
+    {
+    public:
+      /// Constructor.
+      RungeKuttaStageSolver(WeakFormSharedPtr<Scalar> wf, std::vector<SpaceSharedPtr<Scalar> > spaces, ButcherTable* bt) : wf(wf), spaces(spaces), bt(bt)
+      {
+        this->init();
+      }
+
+      /// Constructor for one equation.
+      RungeKuttaStageSolver(WeakFormSharedPtr<Scalar> wf, SpaceSharedPtr<Scalar> space, ButcherTable* bt) : wf(wf), bt(bt)
+      {
+        this->spaces.push_back(space);
+        this->init();
+      }
+
+      virtual ~RungeKuttaStageSolver()
+      {
+        this->free_stage_systems();
+        delete this->dp;
+        delete this->dp_mass;
+        delete this->mass_matrix;
+        delete this->jacobian;
+        delete this->residual;
+      }
+
+      /// The Jacobian of F depends neither on the time nor on the solution (linear autonomous problems).
+      /// It is then assembled only after the spaces change.
+      void set_constant_jacobian(bool to_set = true)
+      {
+        this->constant_jacobian = to_set;
+      }
+
+      void set_start_from_zero_K_vector(bool to_set = true)
+      {
+        this->start_from_zero_K_vector = to_set;
+      }
+
+      void set_newton_tolerance(double newton_tol)
+      {
+        this->newton_tol = newton_tol;
+      }
+
+      /// If Newton's method does not converge in these iterations, Exceptions::NonlinearException is thrown.
+      void set_newton_max_allowed_iterations(int newton_max_iter)
+      {
+        this->newton_max_iter = newton_max_iter;
+      }
+
+      void set_spaces(std::vector<SpaceSharedPtr<Scalar> > spaces)
+      {
+        this->spaces = spaces;
+      }
+
+      void set_space(SpaceSharedPtr<Scalar> space)
+      {
+        this->spaces.clear();
+        this->spaces.push_back(space);
+      }
+
+      std::vector<SpaceSharedPtr<Scalar> > get_spaces()
+      {
+        return this->spaces;
+      }
+
+      /// Numbers of the stage matrix factorizations and of the spatial solves since the creation of this instance.
+      unsigned int get_num_factorizations() const { return this->num_factorizations; }
+      unsigned int get_num_solves() const { return this->num_solves; }
+
+      /// One time step from this->time with the length this->time_step.
+      /// If error_fns are provided, they are filled with the error estimate from the second B-row of the Butcher's table.
+      void rk_time_step_newton(std::vector<MeshFunctionSharedPtr<Scalar> > slns_time_prev, std::vector<MeshFunctionSharedPtr<Scalar> > slns_time_new, std::vector<MeshFunctionSharedPtr<Scalar> > error_fns)
+      {
+        if (slns_time_prev.size() != this->spaces.size())
+          throw Exceptions::LengthException(1, slns_time_prev.size(), this->spaces.size());
+        if (slns_time_new.size() != this->spaces.size())
+          throw Exceptions::LengthException(2, slns_time_new.size(), this->spaces.size());
+        if (!error_fns.empty() && !this->bt->is_embedded())
+          throw Exceptions::Exception("RungeKuttaStageSolver: error estimate requested, but the Butcher's table is not embedded.");
+
+        this->tick();
+        this->compute_step(slns_time_prev);
+
+        Solution<Scalar>::vector_to_solutions(this->Y_new.data(), this->spaces, slns_time_new);
+        if (!error_fns.empty())
+        {
+          std::vector<bool> add_dir_lift(this->spaces.size(), false);
+          Solution<Scalar>::vector_to_solutions(this->error_vector.data(), this->spaces, error_fns, add_dir_lift);
+        }
+
+        this->tick();
+        this->info("\tRungeKuttaStageSolver: time step done (%s).", this->last_str().c_str());
+      }
+
+      void rk_time_step_newton(MeshFunctionSharedPtr<Scalar> sln_time_prev, MeshFunctionSharedPtr<Scalar> sln_time_new, MeshFunctionSharedPtr<Scalar> error_fn)
+      {
+        this->rk_time_step_newton(std::vector<MeshFunctionSharedPtr<Scalar> >(1, sln_time_prev), std::vector<MeshFunctionSharedPtr<Scalar> >(1, sln_time_new), std::vector<MeshFunctionSharedPtr<Scalar> >(1, error_fn));
+      }
+
+      void rk_time_step_newton(std::vector<MeshFunctionSharedPtr<Scalar> > slns_time_prev, std::vector<MeshFunctionSharedPtr<Scalar> > slns_time_new)
+      {
+        this->rk_time_step_newton(slns_time_prev, slns_time_new, std::vector<MeshFunctionSharedPtr<Scalar> >());
+      }
+
+      void rk_time_step_newton(MeshFunctionSharedPtr<Scalar> sln_time_prev, MeshFunctionSharedPtr<Scalar> sln_time_new)
+      {
+        this->rk_time_step_newton(std::vector<MeshFunctionSharedPtr<Scalar> >(1, sln_time_prev), std::vector<MeshFunctionSharedPtr<Scalar> >(1, sln_time_new), std::vector<MeshFunctionSharedPtr<Scalar> >());
+      }
+
+      inline std::string getClassName() const { return "RungeKuttaStageSolver"; }
+
+    protected:
+      /// A stage matrix with its (factorizing) solver.
+      struct StageSystem
+      {
+        SparseMatrix<Scalar>* matrix;
+        Vector<Scalar>* rhs;
+        LinearMatrixSolver<Scalar>* solver;
+        bool factorized;
+      };
+
+      void init()
+      {
+        if (!this->bt)
+          throw Exceptions::NullException(3);
+        this->dp = new DiscreteProblem<Scalar>(this->wf, this->spaces);
+
+        this->wf_mass = this->create_mass_weakform();
+        this->dp_mass = new DiscreteProblem<Scalar>(this->wf_mass, this->spaces, true);
+
+        this->mass_matrix = new CSCMatrix<Scalar>;
+        this->jacobian = new CSCMatrix<Scalar>;
+        this->residual = new SimpleVector<Scalar>;
+
+        this->constant_jacobian = false;
+        this->start_from_zero_K_vector = false;
+        this->newton_tol = 1e-6;
+        this->newton_max_iter = 20;
+        this->ndof = -1;
+        this->jacobian_valid = false;
+        this->repeat_step = false;
+        this->factorized_time_step = -1.;
+        this->coupled_system.matrix = nullptr;
+        this->num_factorizations = 0;
+        this->num_solves = 0;
+      }
+
+      /// The mass forms, by the types of the spaces.
+      WeakFormSharedPtr<Scalar> create_mass_weakform() const
+      {
+        WeakForm<Scalar>* wf_mass = new WeakForm<Scalar>(this->spaces.size());
+        for (unsigned int i = 0; i < this->spaces.size(); i++)
+        {
+          switch (this->spaces[i]->get_type())
+          {
+          case HERMES_H1_SPACE:
+          case HERMES_L2_SPACE:
+          case HERMES_L2_MARKERWISE_CONST_SPACE:
+            wf_mass->add_matrix_form(new WeakFormsH1::DefaultMatrixFormVol<Scalar>(i, i));
+            break;
+          case HERMES_HCURL_SPACE:
+            wf_mass->add_matrix_form(new WeakFormsHcurl::DefaultMatrixFormVol<Scalar>(i, i));
+            break;
+          default:
+            delete wf_mass;
+            throw Exceptions::Exception("RungeKuttaStageSolver: the mass form of the space type of component %i is not available.", i);
+          }
+        }
+        return WeakFormSharedPtr<Scalar>(wf_mass);
+      }
+
+      /// Computes Y_new (and error_vector for embedded tables) from slns_time_prev, this->time and this->time_step.
+      void compute_step(std::vector<MeshFunctionSharedPtr<Scalar> > slns_time_prev)
+      {
+        if (this->time_step <= 0.)
+          throw Exceptions::ValueException("time_step", this->time_step, 0.);
+
+        this->prepare_step();
+
+        int ndof = this->ndof;
+        unsigned int num_stages = this->bt->get_size();
+        if (!this->repeat_step || (int)this->Y.size() != ndof)
+        {
+          this->Y.resize(ndof);
+          OGProjection<Scalar>::project_global(this->spaces, slns_time_prev, this->Y.data());
+        }
+
+        // Jacobian of F, and the stage systems depending on it.
+        if (!this->jacobian_valid || !(this->constant_jacobian || this->repeat_step))
+        {
+          this->wf->set_current_time(this->time);
+          this->wf->set_current_time_step(this->time_step);
+          Scalar* Y_data = this->Y.data();
+          this->dp->assemble(Y_data, this->jacobian);
+          this->jacobian_valid = true;
+          this->free_stage_systems();
+        }
+        if (this->time_step != this->factorized_time_step)
+        {
+          this->free_stage_systems();
+          this->factorized_time_step = this->time_step;
+        }
+
+        if (this->start_from_zero_K_vector || this->K.size() != ndof * num_stages)
+          this->K.assign(ndof * num_stages, Scalar(0.));
+
+        if (this->bt->is_fully_implicit())
+          this->solve_stages_coupled(this->Y);
+        else
+          this->solve_stages_sequentially(this->Y);
+
+        // Y_new = Y + h \sum_i b_i K_i, error = h \sum_i (b_i - b2_i) K_i.
+        this->Y_new = this->Y;
+        this->error_vector.assign(this->bt->is_embedded() ? ndof : 0, Scalar(0.));
+        for (unsigned int i = 0; i < num_stages; i++)
+        {
+          double coef = this->time_step * this->bt->get_B(i);
+          if (coef != 0.)
+          {
+            for (int k = 0; k < ndof; k++)
+              this->Y_new[k] += coef * this->K[i * ndof + k];
+          }
+          if (this->bt->is_embedded())
+          {
+            double error_coef = this->time_step * (this->bt->get_B(i) - this->bt->get_B2(i));
+            for (int k = 0; k < ndof; k++)
+              this->error_vector[k] += error_coef * this->K[i * ndof + k];
+          }
+        }
+      }
+
+      /// (Re)assembles M if the spaces changed.
+      void prepare_step()
+      {
+        bool spaces_changed = (this->spaces_seqs.size() != this->spaces.size());
+        for (unsigned int i = 0; !spaces_changed && i < this->spaces.size(); i++)
+          spaces_changed = (this->spaces_seqs[i] != this->spaces[i]->get_seq());
+        if (!spaces_changed)
+          return;
+
+        this->spaces_seqs.resize(this->spaces.size());
+        for (unsigned int i = 0; i < this->spaces.size(); i++)
+          this->spaces_seqs[i] = this->spaces[i]->get_seq();
+        this->ndof = Space<Scalar>::get_num_dofs(this->spaces);
+
+        this->dp->set_spaces(this->spaces);
+        this->dp_mass->set_spaces(this->spaces);
+        this->wf_mass = this->create_mass_weakform();
+        this->dp_mass->set_weak_formulation(this->wf_mass);
+        this->dp_mass->assemble(this->mass_matrix);
+        this->jacobian_valid = false;
+        this->K.clear();
+        this->Y.clear();
+        this->free_stage_systems();
+      }
+
+      void free_stage_systems()
+      {
+        for (typename std::map<double, StageSystem>::iterator it = this->diagonal_systems.begin(); it != this->diagonal_systems.end(); it++)
+          this->free_stage_system(it->second);
+        this->diagonal_systems.clear();
+        if (this->coupled_system.matrix)
+          this->free_stage_system(this->coupled_system);
+        this->coupled_system.matrix = nullptr;
+      }
+
+      void free_stage_system(StageSystem& system)
+      {
+        delete system.solver;
+        delete system.matrix;
+        delete system.rhs;
+      }
+
+      /// Fills the matrix I x M - h A x J (restricted to the rows / columns of the stages in stages).
+      void create_stage_system(StageSystem& system, const std::vector<unsigned int>& stages)
+      {
+        int n = this->ndof;
+        unsigned int size = stages.size();
+        system.matrix = create_matrix<Scalar>();
+        system.rhs = create_vector<Scalar>();
+        system.matrix->prealloc(n * size);
+        for (int pass = 0; pass < 2; pass++)
+        {
+          if (pass == 1)
+          {
+            system.matrix->alloc();
+            system.matrix->zero();
+          }
+          for (unsigned int bi = 0; bi < size; bi++)
+          {
+            for (unsigned int bj = 0; bj < size; bj++)
+            {
+              double a = this->bt->get_A(stages[bi], stages[bj]);
+              if (bi == bj)
+                this->add_block(system.matrix, this->mass_matrix, bi * n, bj * n, Scalar(1.), pass == 0);
+              if (a != 0.)
+                this->add_block(system.matrix, this->jacobian, bi * n, bj * n, Scalar(-this->time_step * a), pass == 0);
+            }
+          }
+        }
+        system.matrix->finish();
+        system.rhs->alloc(n * size);
+        system.solver = create_linear_solver<Scalar>(system.matrix, system.rhs);
+        system.factorized = false;
+      }
+
+      void add_block(SparseMatrix<Scalar>* target, CSCMatrix<Scalar>* block, int row_offset, int col_offset, Scalar coef, bool structure_only)
+      {
+        int* Ap = block->get_Ap();
+        int* Ai = block->get_Ai();
+        Scalar* Ax = block->get_Ax();
+        for (unsigned int col = 0; col < block->get_size(); col++)
+        {
+          for (int k = Ap[col]; k < Ap[col + 1]; k++)
+          {
+            if (structure_only)
+              target->pre_add_ij(row_offset + Ai[k], col_offset + col);
+            else
+              target->add(row_offset + Ai[k], col_offset + col, coef * Ax[k]);
+          }
+        }
+      }
+
+      /// Solves the stage system with the right-hand side rhs, into rhs.
+      void solve_stage_system(StageSystem& system, Scalar* rhs)
+      {
+        system.rhs->set_vector(rhs);
+        system.solver->set_reuse_scheme(system.factorized ? HERMES_REUSE_MATRIX_STRUCTURE_COMPLETELY : HERMES_CREATE_STRUCTURE_FROM_SCRATCH);
+        system.solver->solve();
+        if (!system.factorized)
+          this->num_factorizations++;
+        system.factorized = true;
+        this->num_solves++;
+        memcpy(rhs, system.solver->get_sln_vector(), sizeof(Scalar) * system.matrix->get_size());
+      }
+
+      /// R_i = F(t + c_i h, Y + h \sum_j a_ij K_j) - M K_i.
+      void stage_residual(const std::vector<Scalar>& Y, unsigned int i, Scalar* R)
+      {
+        int n = this->ndof;
+        unsigned int num_stages = this->bt->get_size();
+        std::vector<Scalar> Y_stage(Y);
+        for (unsigned int j = 0; j < num_stages; j++)
+        {
+          double coef = this->time_step * this->bt->get_A(i, j);
+          if (coef != 0.)
+          {
+            for (int k = 0; k < n; k++)
+              Y_stage[k] += coef * this->K[j * n + k];
+          }
+        }
+
+        this->wf->set_current_time(this->time + this->bt->get_C(i) * this->time_step);
+        this->wf->set_current_time_step(this->time_step);
+        Scalar* Y_stage_data = Y_stage.data();
+        this->dp->assemble(Y_stage_data, this->residual);
+        this->residual->extract(R);
+
+        std::vector<Scalar> MK(n);
+        Scalar* MK_data = MK.data();
+        this->mass_matrix->multiply_with_vector(&this->K[i * n], MK_data, true);
+        for (int k = 0; k < n; k++)
+          R[k] -= MK[k];
+      }
+
+      /// Explicit and diagonally implicit tables: one Newton's loop with (M - h a_ii J) per stage.
+      void solve_stages_sequentially(const std::vector<Scalar>& Y)
+      {
+        int n = this->ndof;
+        std::vector<Scalar> R(n);
+        for (unsigned int i = 0; i < this->bt->get_size(); i++)
+        {
+          double a_ii = this->bt->get_A(i, i);
+          if (this->diagonal_systems.find(a_ii) == this->diagonal_systems.end())
+            this->create_stage_system(this->diagonal_systems[a_ii], std::vector<unsigned int>(1, i));
+          StageSystem& system = this->diagonal_systems[a_ii];
+
+          int it = 1;
+          while (true)
+          {
+            this->stage_residual(Y, i, R.data());
+            double residual_norm = get_l2_norm(R.data(), n);
+            // Explicit stages are linear in K_i, one solve is exact.
+            if ((a_ii == 0. && it > 1) || residual_norm < this->newton_tol)
+              break;
+            if (it > this->newton_max_iter)
+            {
+              this->info("\tRungeKuttaStageSolver: Newton's method did not converge in stage %i, residual norm %g.", i, residual_norm);
+              throw Exceptions::NonlinearException(Solvers::AboveMaxIterations);
+            }
+
+            this->solve_stage_system(system, R.data());
+            for (int k = 0; k < n; k++)
+              this->K[i * n + k] += R[k];
+            it++;
+          }
+        }
+      }
+
+      /// Fully implicit tables: Newton's loop with the Kronecker system I x M - h A x J.
+      void solve_stages_coupled(const std::vector<Scalar>& Y)
+      {
+        int n = this->ndof;
+        unsigned int num_stages = this->bt->get_size();
+        if (!this->coupled_system.matrix)
+        {
+          std::vector<unsigned int> stages;
+          for (unsigned int i = 0; i < num_stages; i++)
+            stages.push_back(i);
+          this->create_stage_system(this->coupled_system, stages);
+        }
+
+        std::vector<Scalar> R(n * num_stages);
+        int it = 1;
+        while (true)
+        {
+          for (unsigned int i = 0; i < num_stages; i++)
+            this->stage_residual(Y, i, &R[i * n]);
+          double residual_norm = get_l2_norm(R.data(), n * num_stages);
+          if (residual_norm < this->newton_tol)
+            break;
+          if (it > this->newton_max_iter)
+          {
+            this->info("\tRungeKuttaStageSolver: Newton's method did not converge, residual norm %g.", residual_norm);
+            throw Exceptions::NonlinearException(Solvers::AboveMaxIterations);
+          }
+
+          this->solve_stage_system(this->coupled_system, R.data());
+          for (int k = 0; k < n * (int)num_stages; k++)
+            this->K[k] += R[k];
+          it++;
+        }
+      }
+
+      /// Weak formulation of F.
+      WeakFormSharedPtr<Scalar> wf;
+      /// Weak formulation of M.
+      WeakFormSharedPtr<Scalar> wf_mass;
+      std::vector<SpaceSharedPtr<Scalar> > spaces;
+      std::vector<int> spaces_seqs;
+      ButcherTable* bt;
+
+      DiscreteProblem<Scalar>* dp;
+      DiscreteProblem<Scalar>* dp_mass;
+      CSCMatrix<Scalar>* mass_matrix;
+      CSCMatrix<Scalar>* jacobian;
+      SimpleVector<Scalar>* residual;
+      int ndof;
+
+      /// Settings.
+      bool constant_jacobian;
+      bool start_from_zero_K_vector;
+      double newton_tol;
+      int newton_max_iter;
+
+      /// Stage systems, for the diagonal entries of the Butcher's table (stage by stage solves),
+      /// or the whole Butcher's table (coupled solves).
+      std::map<double, StageSystem> diagonal_systems;
+      StageSystem coupled_system;
+      bool jacobian_valid;
+      double factorized_time_step;
+
+      /// The K_i vectors of the usual R-K notation, num_stages * ndof.
+      std::vector<Scalar> K;
+      /// Coefficient vectors of the previous and the new time level, and of the error estimate.
+      std::vector<Scalar> Y;
+      std::vector<Scalar> Y_new;
+      std::vector<Scalar> error_vector;
+      /// The step is repeated from the same time level and solution (e.g. after a rejection),
+      /// the projected previous solution and the Jacobian of the last attempt are reused.
+      bool repeat_step;
+
+      /// Statistics.
+      unsigned int num_factorizations;
+      unsigned int num_solves;
+    };
+  }
+}
+#endif
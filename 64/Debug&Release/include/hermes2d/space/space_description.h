@@ -0,0 +1,105 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __H2D_SPACE_DESCRIPTION_H
+#define __H2D_SPACE_DESCRIPTION_H
+
+#include "space_h1.h"
+#include "space_hcurl.h"
+#include "space_hdiv.h"
+#include "space_l2.h"
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    /// \brief Plain description of a space - its type and element orders - for storing it without the XML / BSON files of Space::save().
+    /// The mesh is referenced by an index (the meshes are stored separately, e.g. by MeshReaderH2DBinary).
+    template<typename Scalar>
+    class SpaceDescription
+    {
+    public:
+      SpaceDescription() : type(-1), mesh(-1)
+      {
+      }
+
+      /// Describes the space.
+      /// \param[in] mesh_index The index of the mesh of the space among the stored meshes.
+      SpaceDescription(SpaceSharedPtr<Scalar> space, int mesh_index) : type(space->get_type()), mesh(mesh_index)
+      {
+        MeshSharedPtr space_mesh = space->get_mesh();
+        this->orders.assign(space_mesh->get_max_element_id(), -1);
+        Element* e;
+        for_all_active_elements(e, space_mesh)
+          this->orders[e->id] = space->get_element_order(e->id);
+      }
+
+      /// Creates the described space on the (loaded) mesh.
+      /// The orders are set without assigning DOFs for every element, DOFs are assigned once at the end.
+      SpaceSharedPtr<Scalar> create_space(MeshSharedPtr mesh, EssentialBCs<Scalar>* essential_bcs = nullptr, Shapeset* shapeset = nullptr) const
+      {
+        SpaceSharedPtr<Scalar> space;
+        switch (this->type)
+        {
+        case HERMES_H1_SPACE:
+          space = new H1Space<Scalar>(mesh, essential_bcs, 1, shapeset);
+          break;
+        case HERMES_HCURL_SPACE:
+          space = new HcurlSpace<Scalar>(mesh, essential_bcs, 1, shapeset);
+          break;
+        case HERMES_HDIV_SPACE:
+          space = new HdivSpace<Scalar>(mesh, essential_bcs, 1, shapeset);
+          break;
+        case HERMES_L2_SPACE:
+          space = new L2Space<Scalar>(mesh, 0, shapeset);
+          break;
+        case HERMES_L2_MARKERWISE_CONST_SPACE:
+          return new L2MarkerWiseConstSpace<Scalar>(mesh);
+        default:
+          throw Exceptions::ValueException("space type", this->type, HERMES_H1_SPACE, HERMES_L2_MARKERWISE_CONST_SPACE);
+        }
+
+        if (this->orders.size() != (unsigned int)mesh->get_max_element_id())
+          throw Exceptions::LengthException(1, this->orders.size(), mesh->get_max_element_id());
+        Element* e;
+        for_all_active_elements(e, mesh)
+        {
+          int order = this->orders[e->id];
+          if (order < 0)
+            throw Exceptions::Exception("SpaceDescription: no order stored for the active element %d.", e->id);
+          (space.get()->*OrderSetter::set_order())(e->id, H2D_GET_H_ORDER(order), e->is_triangle() ? -1 : H2D_GET_V_ORDER(order));
+        }
+        space->assign_dofs();
+        return space;
+      }
+
+      /// SpaceType.
+      int type;
+      /// Index of the mesh.
+      int mesh;
+      /// Encoded orders indexed by element id, -1 for inactive elements.
+      std::vector<int> orders;
+
+    private:
+      /// Access to the protected Space::set_element_order_internal(), which (unlike set_element_order()) does not assign DOFs.
+      struct OrderSetter : public Space < Scalar >
+      {
+        typedef void (Space<Scalar>::*Setter)(int, int, int);
+        static Setter set_order() { return &OrderSetter::set_element_order_internal; }
+      };
+    };
+  }
+}
+#endif
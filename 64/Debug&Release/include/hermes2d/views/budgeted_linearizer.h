@@ -0,0 +1,352 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __H2D_BUDGETED_LINEARIZER_H
+#define __H2D_BUDGETED_LINEARIZER_H
+
+#include "linearizer.h"
+#include "../mesh/refmap.h"
+#include "../quadrature/quad_all.h"
+#include <queue>
+#include <map>
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    namespace Views
+    {
+      /// \brief Linearizer with a maximum number of triangles.
+      ///
+      /// Unlike LinearizerMultidimensional (recursive splitting per element until LinearizerCriterion is met), the triangles are split
+      /// globally in the order of their estimated interpolation error, until the budget of triangles is exhausted,
+      /// or the error falls below a tolerance. The output is thus the best approximation (in the sense of the estimate) of the given size,
+      /// and the time and memory needed are bounded by the budget.<br>
+      /// The estimate of a triangle (the same one split_decision() is based on) is the largest difference between the value
+      /// at an edge midpoint and the mean of the values at the edge end points; for curved elements, the difference between the physical
+      /// midpoint and the mean of the physical end points, scaled by (value range / domain size), is also taken into account.
+      /// A split is the standard split into four triangles in the reference domain of the element; neighboring triangles
+      /// of different levels therefore meet in hanging vertices.<br>
+      /// Vertices are shared between triangles (and elements) with equal coordinates and values.
+      /// Only Solution instances are supported (values are evaluated by Solution::get_ref_value_transformed()).
+      class BudgetedLinearizer : public Hermes::Mixins::TimeMeasurable, public Hermes::Mixins::Loggable
+      {
+      public:
+        /// Constructor.
+        /// \param[in] max_triangles The budget. If the mesh has more (two per quad) triangles, no splitting is done.
+        /// \param[in] max_level Maximum number of successive splits of an element.
+        /// \param[in] tolerance Triangles with the estimate below this value are not split.
+        BudgetedLinearizer(int max_triangles, int max_level = 10, double tolerance = 0.) : max_triangles(max_triangles), max_level(max_level), tolerance(tolerance),
+          min_value(0.), max_value(0.), max_remaining_error(0.)
+        {
+          if (max_triangles < 1)
+            throw Exceptions::ValueException("max_triangles", max_triangles, 1);
+        }
+
+        /// Main method - processes the solution.
+        /// \param[in] component The component of the solution.
+        /// \param[in] item 0 - value, 1 - dx, 2 - dy (as in Solution::get_ref_value_transformed()).
+        void process_solution(MeshFunctionSharedPtr<double> sln, int component = 0, int item = 0)
+        {
+          this->tick();
+          Solution<double>* solution = dynamic_cast<Solution<double>*>(sln.get());
+          if (solution == nullptr)
+            throw Exceptions::Exception("BudgetedLinearizer: only Solution instances are supported.");
+          this->solution = solution;
+          this->component = component;
+          this->item = item;
+          this->current_element = nullptr;
+          this->refmap.set_quad_2d(&g_quad_2d_std);
+
+          this->candidates.clear();
+          this->vertices.clear();
+          this->triangles.clear();
+          this->triangle_markers.clear();
+          this->vertex_indices.clear();
+
+          // Initial triangles.
+          static const double triangle_vertices[3][2] = { { -1., -1. }, { 1., -1. }, { -1., 1. } };
+          static const double quad_vertices[4][2] = { { -1., -1. }, { 1., -1. }, { 1., 1. }, { -1., 1. } };
+          Element* e;
+          for_all_active_elements(e, solution->get_mesh())
+          {
+            if (e->is_triangle())
+              this->add_candidate(e, triangle_vertices[0], triangle_vertices[1], triangle_vertices[2], 0);
+            else
+            {
+              this->add_candidate(e, quad_vertices[0], quad_vertices[1], quad_vertices[2], 0);
+              this->add_candidate(e, quad_vertices[0], quad_vertices[2], quad_vertices[3], 0);
+            }
+          }
+          int triangle_count = this->candidates.size();
+          if (triangle_count > this->max_triangles)
+            this->warn("BudgetedLinearizer: the mesh itself has %i triangles, more than the budget of %i.", triangle_count, this->max_triangles);
+
+          // Scaling of the geometric deviation to the units of the values.
+          double min_x = std::numeric_limits<double>::max(), max_x = -min_x, min_y = min_x, max_y = -min_x;
+          double min_v = min_x, max_v = -min_x;
+          for (unsigned int i = 0; i < this->candidates.size(); i++)
+          {
+            for (int j = 0; j < 3; j++)
+            {
+              min_x = std::min(min_x, this->candidates[i].x[j]);
+              max_x = std::max(max_x, this->candidates[i].x[j]);
+              min_y = std::min(min_y, this->candidates[i].y[j]);
+              max_y = std::max(max_y, this->candidates[i].y[j]);
+              min_v = std::min(min_v, this->candidates[i].values[j]);
+              max_v = std::max(max_v, this->candidates[i].values[j]);
+            }
+          }
+          double diameter = std::sqrt((max_x - min_x) * (max_x - min_x) + (max_y - min_y) * (max_y - min_y));
+          this->geometry_scale = diameter > 0. ? std::max(max_v - min_v, 1e-12) / diameter : 0.;
+
+          // Greedy splitting.
+          std::priority_queue<std::pair<double, int> > queue;
+          for (unsigned int i = 0; i < this->candidates.size(); i++)
+            queue.push(std::pair<double, int>(this->error(this->candidates[i]), -(int)i));
+          while (!queue.empty() && triangle_count + 3 <= this->max_triangles)
+          {
+            int index = -queue.top().second;
+            double error = queue.top().first;
+            if (error <= this->tolerance)
+              break;
+            queue.pop();
+            if (this->candidates[index].level >= this->max_level)
+              continue;
+
+            this->split(index);
+            this->candidates[index].split = true;
+            triangle_count += 3;
+            for (unsigned int i = this->candidates.size() - 4; i < this->candidates.size(); i++)
+              queue.push(std::pair<double, int>(this->error(this->candidates[i]), -(int)i));
+          }
+          this->max_remaining_error = 0.;
+          while (!queue.empty())
+          {
+            if (this->candidates[-queue.top().second].level < this->max_level)
+            {
+              this->max_remaining_error = queue.top().first;
+              break;
+            }
+            queue.pop();
+          }
+
+          // Output - the leaves.
+          this->min_value = std::numeric_limits<double>::max();
+          this->max_value = -std::numeric_limits<double>::max();
+          for (unsigned int i = 0; i < this->candidates.size(); i++)
+          {
+            const Candidate& candidate = this->candidates[i];
+            if (candidate.split)
+              continue;
+            for (int j = 0; j < 3; j++)
+              this->triangles.push_back(this->get_vertex(candidate.x[j], candidate.y[j], candidate.values[j]));
+            this->triangle_markers.push_back(candidate.element->marker);
+          }
+          if (this->vertices.empty())
+            this->min_value = this->max_value = 0.;
+
+          this->candidates.clear();
+          this->vertex_indices.clear();
+          this->tick();
+          this->info("BudgetedLinearizer: %i triangles, %i vertices, largest remaining error estimate %g, %s.", this->get_triangle_count(), this->get_vertex_count(), this->max_remaining_error, this->last_str().c_str());
+        }
+
+        /// Vertices: (x, y, value) triplets.
+        const double3* get_vertices() const { return (const double3*)this->vertices.data(); }
+        int get_vertex_count() const { return this->vertices.size() / 3; }
+        /// Triangles: vertex index triplets.
+        const int3* get_triangles() const { return (const int3*)this->triangles.data(); }
+        int get_triangle_count() const { return this->triangles.size() / 3; }
+        /// Element markers of the triangles.
+        const int* get_triangle_markers() const { return this->triangle_markers.data(); }
+
+        double get_min_value() const { return this->min_value; }
+        double get_max_value() const { return this->max_value; }
+        /// The largest estimate of a triangle that was not split (because of the budget or the tolerance).
+        double get_max_remaining_error() const { return this->max_remaining_error; }
+
+        /// Save the output in the (legacy ASCII) VTK format, the same one as LinearizerMultidimensional::save_solution_vtk().
+        void save_solution_vtk(const char* filename, const char* quantity_name, bool mode_3D = true) const
+        {
+          FILE* f = fopen(filename, "wb");
+          if (f == nullptr)
+            throw Exceptions::Exception("BudgetedLinearizer: could not open %s for writing.", filename);
+
+          const double3* vertices = this->get_vertices();
+          const int3* triangles = this->get_triangles();
+          fprintf(f, "# vtk DataFile Version 2.0\n");
+          fprintf(f, "\n");
+          fprintf(f, "ASCII\n\n");
+          fprintf(f, "DATASET UNSTRUCTURED_GRID\n");
+          fprintf(f, "POINTS %d %s\n", this->get_vertex_count(), "float");
+          for (int i = 0; i < this->get_vertex_count(); i++)
+            fprintf(f, "%g %g %g\n", vertices[i][0], vertices[i][1], mode_3D ? vertices[i][2] : 0.);
+          fprintf(f, "\n");
+          fprintf(f, "CELLS %d %d\n", this->get_triangle_count(), 4 * this->get_triangle_count());
+          for (int i = 0; i < this->get_triangle_count(); i++)
+            fprintf(f, "3 %d %d %d\n", triangles[i][0], triangles[i][1], triangles[i][2]);
+          fprintf(f, "\n");
+          fprintf(f, "CELL_TYPES %d\n", this->get_triangle_count());
+          for (int i = 0; i < this->get_triangle_count(); i++)
+            fprintf(f, "5\n");
+          fprintf(f, "\n");
+          fprintf(f, "POINT_DATA %d\n", this->get_vertex_count());
+          fprintf(f, "SCALARS %s %s %d\n", quantity_name, "float", 1);
+          fprintf(f, "LOOKUP_TABLE %s\n", "default");
+          for (int i = 0; i < this->get_vertex_count(); i++)
+            fprintf(f, "%g\n", vertices[i][2]);
+          fclose(f);
+        }
+
+        inline std::string getClassName() const { return "BudgetedLinearizer"; }
+
+      protected:
+        /// A triangle in the reference domain of an element; the values at the edge midpoints are evaluated with the estimate
+        /// and reused for the children.
+        struct Candidate
+        {
+          Element* element;
+          /// Reference coordinates of the vertices, and of the edge midpoints (edge i is between the vertices i and i + 1).
+          double xi[6][2];
+          double x[6], y[6];
+          double values[6];
+          int level;
+          bool split;
+          double value_deviation;
+          double geometry_deviation;
+        };
+
+        void add_candidate(Element* e, const double* xi0, const double* xi1, const double* xi2, int level)
+        {
+          Candidate candidate;
+          candidate.element = e;
+          candidate.level = level;
+          candidate.split = false;
+          const double* xi[3] = { xi0, xi1, xi2 };
+          for (int i = 0; i < 3; i++)
+          {
+            candidate.xi[i][0] = xi[i][0];
+            candidate.xi[i][1] = xi[i][1];
+          }
+          this->evaluate(candidate, 0);
+          this->candidates.push_back(candidate);
+        }
+
+        /// Evaluates the points of the candidate starting with from (the vertices are known for children), and its estimate.
+        void evaluate(Candidate& candidate, int from)
+        {
+          for (int i = 3; i < 6; i++)
+          {
+            candidate.xi[i][0] = (candidate.xi[i - 3][0] + candidate.xi[(i - 2) % 3][0]) / 2.;
+            candidate.xi[i][1] = (candidate.xi[i - 3][1] + candidate.xi[(i - 2) % 3][1]) / 2.;
+          }
+          if (candidate.element != this->current_element)
+          {
+            this->refmap.set_active_element(candidate.element);
+            this->current_element = candidate.element;
+          }
+          for (int i = from; i < 6; i++)
+          {
+            double2x2 m;
+            this->refmap.inv_ref_map_at_point(candidate.xi[i][0], candidate.xi[i][1], candidate.x[i], candidate.y[i], m);
+            candidate.values[i] = this->solution->get_ref_value_transformed(candidate.element, candidate.xi[i][0], candidate.xi[i][1], this->component, this->item);
+          }
+
+          candidate.value_deviation = 0.;
+          candidate.geometry_deviation = 0.;
+          for (int i = 0; i < 3; i++)
+          {
+            int j = (i + 1) % 3;
+            candidate.value_deviation = std::max(candidate.value_deviation, std::abs(candidate.values[3 + i] - (candidate.values[i] + candidate.values[j]) / 2.));
+            if (candidate.element->is_curved())
+            {
+              double dx = candidate.x[3 + i] - (candidate.x[i] + candidate.x[j]) / 2.;
+              double dy = candidate.y[3 + i] - (candidate.y[i] + candidate.y[j]) / 2.;
+              candidate.geometry_deviation = std::max(candidate.geometry_deviation, std::sqrt(dx * dx + dy * dy));
+            }
+          }
+        }
+
+        double error(const Candidate& candidate) const
+        {
+          return std::max(candidate.value_deviation, candidate.geometry_deviation * this->geometry_scale);
+        }
+
+        /// Splits the candidate to four, the vertices of the children are the known points of the parent.
+        void split(int index)
+        {
+          static const int children[4][3] = { { 0, 3, 5 }, { 3, 1, 4 }, { 5, 4, 2 }, { 3, 4, 5 } };
+          for (int child = 0; child < 4; child++)
+          {
+            const Candidate& parent = this->candidates[index];
+            Candidate candidate;
+            candidate.element = parent.element;
+            candidate.level = parent.level + 1;
+            candidate.split = false;
+            for (int i = 0; i < 3; i++)
+            {
+              int point = children[child][i];
+              candidate.xi[i][0] = parent.xi[point][0];
+              candidate.xi[i][1] = parent.xi[point][1];
+              candidate.x[i] = parent.x[point];
+              candidate.y[i] = parent.y[point];
+              candidate.values[i] = parent.values[point];
+            }
+            this->evaluate(candidate, 3);
+            this->candidates.push_back(candidate);
+          }
+        }
+
+        int get_vertex(double x, double y, double value)
+        {
+          std::pair<std::pair<double, double>, double> key(std::pair<double, double>(x, y), value);
+          std::map<std::pair<std::pair<double, double>, double>, int>::iterator it = this->vertex_indices.find(key);
+          if (it != this->vertex_indices.end())
+            return it->second;
+          int index = this->vertices.size() / 3;
+          this->vertices.push_back(x);
+          this->vertices.push_back(y);
+          this->vertices.push_back(value);
+          this->vertex_indices.insert(std::pair<std::pair<std::pair<double, double>, double>, int>(key, index));
+          this->min_value = std::min(this->min_value, value);
+          this->max_value = std::max(this->max_value, value);
+          return index;
+        }
+
+        int max_triangles;
+        int max_level;
+        double tolerance;
+
+        /// Processing.
+        Solution<double>* solution;
+        int component, item;
+        RefMap refmap;
+        Element* current_element;
+        double geometry_scale;
+        std::vector<Candidate> candidates;
+        std::map<std::pair<std::pair<double, double>, double>, int> vertex_indices;
+
+        /// Output.
+        std::vector<double> vertices;
+        std::vector<int> triangles;
+        std::vector<int> triangle_markers;
+        double min_value, max_value;
+        double max_remaining_error;
+      };
+    }
+  }
+}
+#endif
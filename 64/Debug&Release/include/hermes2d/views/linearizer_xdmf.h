@@ -0,0 +1,298 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __H2D_LINEARIZER_XDMF_H
+#define __H2D_LINEARIZER_XDMF_H
+
+#include "linearizer.h"
+#include "../hdf5_mutex.h"
+#include <hdf5.h>
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    namespace Views
+    {
+      /// \brief XDMF + HDF5 time series output of a LinearizerMultidimensional (link with hdf5.lib).
+      ///
+      /// All steps go to one HDF5 file <base>.h5, one group "/step_<n>" per step, with the datasets
+      /// points (x, y, z; z is the value in the 3D mode for scalars), triangles (vertex indices), values (the value, or the vector padded by zero),
+      /// and markers (triangle markers). The XDMF file <base>.xmf describes them as a temporal collection, and is rewritten after each step,
+      /// so that it is valid also during the calculation.<br>
+      /// The data is read by the iterators of the linearizer, i.e. directly from the buffers of its threads,
+      /// and written by hyperslabs of a fixed number of rows - nothing of the size of the output is allocated.<br>
+      /// The linearizer has to be created with the FileExport output type.
+      template<typename LinearizerDataDimensions>
+      class LinearizerXDMFWriter : public Hermes::Mixins::Loggable
+      {
+      public:
+        /// Constructor.
+        /// \param[in] base The file names without the extension.
+        /// \param[in] compress Chunked, deflate-compressed datasets.
+        /// \param[in] mode_3D For scalars, the value is used as the z-coordinate.
+        /// \param[in] rows Number of rows written at once (and the chunk size).
+        LinearizerXDMFWriter(const char* base, bool compress = false, bool mode_3D = false, unsigned int rows = 1 << 16) : compress(compress), mode_3D(mode_3D), rows(rows)
+        {
+          this->h5_filename = std::string(base) + ".h5";
+          this->xdmf_filename = std::string(base) + ".xmf";
+          // The XDMF file references the HDF5 one relative to its directory.
+          size_t separator = this->h5_filename.find_last_of("/\\");
+          this->h5_reference = separator == std::string::npos ? this->h5_filename : this->h5_filename.substr(separator + 1);
+        }
+
+        /// Adds a step - the data of a processed linearizer.
+        void add(const LinearizerMultidimensional<LinearizerDataDimensions>& linearizer, double time, const char* quantity_name)
+        {
+          hdf5_monitor().enter();
+          try
+          {
+            this->add_step(linearizer, time, quantity_name);
+          }
+          catch (std::exception&)
+          {
+            hdf5_monitor().leave();
+            throw;
+          }
+          hdf5_monitor().leave();
+          this->write_xdmf();
+        }
+
+        /// Process one MeshFunction (Solution, Filter) and add it as a step.
+        /// Scalar linearizers only.
+        void add_solution(MeshFunctionSharedPtr<double> sln, double time, const char* quantity_name, int item = H2D_FN_VAL_0)
+        {
+          LinearizerMultidimensional<LinearizerDataDimensions> linearizer(FileExport);
+          linearizer.process_solution(sln, item);
+          this->add(linearizer, time, quantity_name);
+        }
+
+        inline std::string getClassName() const { return "LinearizerXDMFWriter"; }
+
+      protected:
+        typedef typename LinearizerDataDimensions::vertex_t vertex_t;
+        typedef typename LinearizerMultidimensional<LinearizerDataDimensions>::template Iterator<vertex_t> VertexIterator;
+        typedef typename LinearizerMultidimensional<LinearizerDataDimensions>::template Iterator<triangle_indices_t> TriangleIterator;
+
+        struct Step
+        {
+          double time;
+          std::string quantity_name;
+          std::string group;
+          int vertex_count;
+          int triangle_count;
+        };
+
+        /// Writes the HDF5 group of one step, called within hdf5_monitor().
+        void add_step(const LinearizerMultidimensional<LinearizerDataDimensions>& linearizer, double time, const char* quantity_name)
+        {
+          hid_t file = this->steps.empty() ? H5Fcreate(this->h5_filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT) : H5Fopen(this->h5_filename.c_str(), H5F_ACC_RDWR, H5P_DEFAULT);
+          if (file < 0)
+            throw Exceptions::Exception("LinearizerXDMFWriter: could not open %s for writing.", this->h5_filename.c_str());
+
+          Step step;
+          step.time = time;
+          step.quantity_name = quantity_name;
+          char group_name[32];
+          sprintf(group_name, "step_%u", (unsigned int)this->steps.size());
+          step.group = group_name;
+
+          hid_t group = H5Gcreate2(file, group_name, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+          if (group < 0)
+          {
+            H5Fclose(file);
+            throw Exceptions::Exception("LinearizerXDMFWriter: could not create the group %s in %s.", group_name, this->h5_filename.c_str());
+          }
+          linearizer.lock_data();
+          try
+          {
+            this->write(linearizer, group, step);
+          }
+          catch (std::exception&)
+          {
+            linearizer.unlock_data();
+            H5Gclose(group);
+            H5Fclose(file);
+            throw;
+          }
+          linearizer.unlock_data();
+          H5Gclose(group);
+          if (H5Fclose(file) < 0)
+            throw Exceptions::Exception("LinearizerXDMFWriter: writing %s failed.", this->h5_filename.c_str());
+
+          this->steps.push_back(step);
+        }
+
+        /// Writes a two-dimensional dataset row by row, through a buffer of a fixed number of rows.
+        template<typename T>
+        class RowWriter
+        {
+        public:
+          RowWriter(hid_t group, const char* name, hid_t type, hsize_t row_count, hsize_t columns, unsigned int rows, bool compress) : type(type), columns(columns), rows(rows), row(0)
+          {
+            hsize_t dims[2] = { row_count, columns };
+            this->file_space = H5Screate_simple(2, dims, nullptr);
+            hid_t properties = H5Pcreate(H5P_DATASET_CREATE);
+            if (compress && row_count > 0)
+            {
+              hsize_t chunk[2] = { std::min<hsize_t>(row_count, rows), columns };
+              H5Pset_chunk(properties, 2, chunk);
+              H5Pset_shuffle(properties);
+              H5Pset_deflate(properties, 4);
+            }
+            this->dataset = H5Dcreate2(group, name, type, this->file_space, H5P_DEFAULT, properties, H5P_DEFAULT);
+            H5Pclose(properties);
+            if (this->dataset < 0)
+            {
+              H5Sclose(this->file_space);
+              throw Exceptions::Exception("LinearizerXDMFWriter: the dataset %s could not be created.", name);
+            }
+            this->buffer.reserve(rows * columns);
+          }
+
+          ~RowWriter()
+          {
+            H5Dclose(this->dataset);
+            H5Sclose(this->file_space);
+          }
+
+          void append(T value)
+          {
+            this->buffer.push_back(value);
+            if (this->buffer.size() == this->rows * this->columns)
+              this->flush();
+          }
+
+          void flush()
+          {
+            if (this->buffer.empty())
+              return;
+            hsize_t start[2] = { this->row, 0 };
+            hsize_t count[2] = { this->buffer.size() / this->columns, this->columns };
+            H5Sselect_hyperslab(this->file_space, H5S_SELECT_SET, start, nullptr, count, nullptr);
+            hid_t memory_space = H5Screate_simple(2, count, nullptr);
+            herr_t status = H5Dwrite(this->dataset, this->type, memory_space, this->file_space, H5P_DEFAULT, this->buffer.data());
+            H5Sclose(memory_space);
+            if (status < 0)
+              throw Exceptions::Exception("LinearizerXDMFWriter: writing a dataset failed.");
+            this->row += count[0];
+            this->buffer.clear();
+          }
+
+        private:
+          hid_t dataset;
+          hid_t file_space;
+          hid_t type;
+          hsize_t columns;
+          unsigned int rows;
+          hsize_t row;
+          std::vector<T> buffer;
+        };
+
+        void write(const LinearizerMultidimensional<LinearizerDataDimensions>& linearizer, hid_t group, Step& step)
+        {
+          step.vertex_count = linearizer.get_vertex_count();
+          step.triangle_count = linearizer.get_triangle_index_count();
+          int value_components = LinearizerDataDimensions::dimension == 1 ? 1 : 3;
+
+          {
+            RowWriter<double> points(group, "points", H5T_NATIVE_DOUBLE, step.vertex_count, 3, this->rows, this->compress);
+            RowWriter<double> values(group, "values", H5T_NATIVE_DOUBLE, step.vertex_count, value_components, this->rows, this->compress);
+            for (VertexIterator it = linearizer.vertices_begin(); !it.end; ++it)
+            {
+              vertex_t& vertex = it.get();
+              points.append(vertex[0]);
+              points.append(vertex[1]);
+              points.append(this->mode_3D && LinearizerDataDimensions::dimension == 1 ? vertex[2] : 0.);
+              values.append(vertex[2]);
+              if (value_components == 3)
+              {
+                values.append(vertex[LinearizerDataDimensions::dimension + 1]);
+                values.append(0.);
+              }
+            }
+            points.flush();
+            values.flush();
+          }
+
+          {
+            // The indices given by the iterator are global (the same ones the legacy VTK output writes).
+            RowWriter<int> triangles(group, "triangles", H5T_NATIVE_INT, step.triangle_count, 3, this->rows, this->compress);
+            RowWriter<int> markers(group, "markers", H5T_NATIVE_INT, step.triangle_count, 1, this->rows, this->compress);
+            for (TriangleIterator it = linearizer.triangle_indices_begin(); !it.end; ++it)
+            {
+              triangle_indices_t& triangle = it.get();
+              triangles.append(triangle[0]);
+              triangles.append(triangle[1]);
+              triangles.append(triangle[2]);
+              markers.append(it.get_marker());
+            }
+            triangles.flush();
+            markers.flush();
+          }
+        }
+
+        void write_xdmf()
+        {
+          FILE* f = fopen(this->xdmf_filename.c_str(), "w");
+          if (f == nullptr)
+            throw Exceptions::Exception("LinearizerXDMFWriter: could not open %s for writing.", this->xdmf_filename.c_str());
+
+          const char* h5 = this->h5_reference.c_str();
+          bool vector = LinearizerDataDimensions::dimension > 1;
+          fprintf(f, "<?xml version=\"1.0\" ?>\n");
+          fprintf(f, "<!DOCTYPE Xdmf SYSTEM \"Xdmf.dtd\" []>\n");
+          fprintf(f, "<Xdmf Version=\"2.0\">\n");
+          fprintf(f, "  <Domain>\n");
+          fprintf(f, "    <Grid Name=\"TimeSeries\" GridType=\"Collection\" CollectionType=\"Temporal\">\n");
+          for (unsigned int i = 0; i < this->steps.size(); i++)
+          {
+            const Step& step = this->steps[i];
+            const char* group = step.group.c_str();
+            fprintf(f, "      <Grid Name=\"%s\" GridType=\"Uniform\">\n", group);
+            fprintf(f, "        <Time Value=\"%.17g\"/>\n", step.time);
+            fprintf(f, "        <Topology TopologyType=\"Triangle\" NumberOfElements=\"%i\">\n", step.triangle_count);
+            fprintf(f, "          <DataItem Dimensions=\"%i 3\" NumberType=\"Int\" Precision=\"4\" Format=\"HDF\">%s:/%s/triangles</DataItem>\n", step.triangle_count, h5, group);
+            fprintf(f, "        </Topology>\n");
+            fprintf(f, "        <Geometry GeometryType=\"XYZ\">\n");
+            fprintf(f, "          <DataItem Dimensions=\"%i 3\" NumberType=\"Float\" Precision=\"8\" Format=\"HDF\">%s:/%s/points</DataItem>\n", step.vertex_count, h5, group);
+            fprintf(f, "        </Geometry>\n");
+            fprintf(f, "        <Attribute Name=\"%s\" AttributeType=\"%s\" Center=\"Node\">\n", step.quantity_name.c_str(), vector ? "Vector" : "Scalar");
+            fprintf(f, "          <DataItem Dimensions=\"%i %i\" NumberType=\"Float\" Precision=\"8\" Format=\"HDF\">%s:/%s/values</DataItem>\n", step.vertex_count, vector ? 3 : 1, h5, group);
+            fprintf(f, "        </Attribute>\n");
+            fprintf(f, "        <Attribute Name=\"marker\" AttributeType=\"Scalar\" Center=\"Cell\">\n");
+            fprintf(f, "          <DataItem Dimensions=\"%i 1\" NumberType=\"Int\" Precision=\"4\" Format=\"HDF\">%s:/%s/markers</DataItem>\n", step.triangle_count, h5, group);
+            fprintf(f, "        </Attribute>\n");
+            fprintf(f, "      </Grid>\n");
+          }
+          fprintf(f, "    </Grid>\n");
+          fprintf(f, "  </Domain>\n");
+          fprintf(f, "</Xdmf>\n");
+          fclose(f);
+        }
+
+        bool compress;
+        bool mode_3D;
+        unsigned int rows;
+
+        std::string h5_filename;
+        std::string xdmf_filename;
+        std::string h5_reference;
+        std::vector<Step> steps;
+      };
+    }
+  }
+}
+#endif
@@ -0,0 +1,294 @@
+// This file is part of HermesCommon
+//
+// Copyright (c) 2009 hp-FEM group at the University of Nevada, Reno (UNR).
+// Email: hpfem-group@unr.edu, home page: http://www.hpfem.org/.
+//
+// Hermes2D is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published
+// by the Free Software Foundation; either version 2 of the License,
+// or (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+/*! \file mumps_mixed_precision_solver.h
+\brief Mixed-precision MUMPS solver interface.
+*/
+#ifndef __HERMES_COMMON_MUMPS_MIXED_PRECISION_SOLVER_H_
+#define __HERMES_COMMON_MUMPS_MIXED_PRECISION_SOLVER_H_
+#include "config.h"
+#ifdef WITH_MUMPS
+#include "solvers/linear_matrix_solver.h"
+#include "algebra/cs_matrix.h"
+#include "util/memory_handling.h"
+
+extern "C"
+{
+#include <mumps_c_types.h>
+#include <smumps_c.h>
+#include <cmumps_c.h>
+}
+
+namespace Hermes
+{
+  namespace Algebra
+  {
+    /** Single precision counterparts of the types in mumps_type */
+    template <typename Scalar> struct mumps_single_type;
+
+    /** Single precision MUMPS for real matrices */
+    template <>
+    struct mumps_single_type < double >
+    {
+      typedef SMUMPS_STRUC_C mumps_struct;
+      typedef float mumps_Scalar;
+      static void mumps_c(mumps_struct* param) { smumps_c(param); }
+      static mumps_Scalar to_single(double value) { return (float)value; }
+      static double to_double(mumps_Scalar value) { return value; }
+    };
+
+    /** Single precision MUMPS for complex matrices */
+    template <>
+    struct mumps_single_type < std::complex<double> >
+    {
+      typedef CMUMPS_STRUC_C mumps_struct;
+      typedef CMUMPS_COMPLEX mumps_Scalar;
+      static void mumps_c(mumps_struct* param) { cmumps_c(param); }
+      static mumps_Scalar to_single(std::complex<double> value) { mumps_Scalar result; result.r = (float)value.real(); result.i = (float)value.imag(); return result; }
+      static std::complex<double> to_double(mumps_Scalar value) { return std::complex<double>(value.r, value.i); }
+    };
+  }
+
+  namespace Solvers
+  {
+    /// \brief Mixed-precision direct solver.
+    ///
+    /// The matrix is factorized by MUMPS in single precision (half of the memory and of the memory bandwidth of the factorization),
+    /// and the double precision accuracy is recovered by iterative refinement with residuals computed in double precision:<br>
+    /// x_0 = 0, x_k+1 = x_k + (LU)^-1 (b - A x_k),<br>
+    /// until ||b - A x_k|| <= tolerance * ||b|| (see set_refinement_parameters()).
+    /// For matrices that are too ill-conditioned for single precision (condition number close to 1e7 and above) the refinement does not converge,
+    /// a warning is issued then and the iterate with the smallest residual is returned.<br>
+    /// The matrix has to be a plain CSCMatrix (as created for UMFPACK), not a MumpsMatrix.
+    /// Reuse schemes: HERMES_CREATE_STRUCTURE_FROM_SCRATCH - analysis and factorization, HERMES_REUSE_MATRIX_REORDERING(_AND_SCALING) - factorization only,
+    /// HERMES_REUSE_MATRIX_STRUCTURE_COMPLETELY - the factorization is reused (the refinement is done with the current matrix).
+    /// The solver is opt-in, it has to be created directly: it cannot be selected by matrixSolverType, since create_linear_solver()
+    /// and create_matrix() are compiled into the shipped hermes_common library.
+    template <typename Scalar>
+    class MixedPrecisionMumpsSolver : public DirectSolver < Scalar >
+    {
+    public:
+      /// Constructor.
+      /// @param[in] m matrix pointer
+      /// @param[in] rhs right hand side pointer
+      MixedPrecisionMumpsSolver(CSCMatrix<Scalar> *m, SimpleVector<Scalar> *rhs) : DirectSolver<Scalar>(m, rhs), m(m), rhs(rhs),
+        inited(false), factorized(false), refinement_tolerance(1e-12), max_refinement_iterations(20), refinement_iterations(0), final_residual(0.)
+      {
+        memset(&this->param, 0, sizeof(this->param));
+      }
+
+      virtual ~MixedPrecisionMumpsSolver()
+      {
+        this->free();
+      }
+
+      /// Set the iterative refinement parameters.
+      /// Default: 1e-12, 20.
+      void set_refinement_parameters(double tolerance, unsigned int max_iterations)
+      {
+        if (tolerance <= 0.)
+          throw Exceptions::ValueException("tolerance", tolerance, 0.);
+        this->refinement_tolerance = tolerance;
+        this->max_refinement_iterations = max_iterations;
+      }
+
+      /// Refinement iterations in the last solve().
+      unsigned int get_num_refinement_iterations() const
+      {
+        return this->refinement_iterations;
+      }
+
+      /// Relative residual after the last solve().
+      virtual double get_residual_norm()
+      {
+        return this->final_residual;
+      }
+
+      virtual int get_matrix_size()
+      {
+        return this->m->get_size();
+      }
+
+      virtual void free()
+      {
+        if (this->inited)
+        {
+          this->param.job = -2;
+          mumps_single_type<Scalar>::mumps_c(&this->param);
+          this->inited = false;
+        }
+        this->factorized = false;
+        this->irn.clear();
+        this->jcn.clear();
+        this->a.clear();
+      }
+
+      virtual void solve()
+      {
+        this->tick();
+        int n = this->m->get_size();
+
+        if (!this->factorized || this->reuse_scheme != HERMES_REUSE_MATRIX_STRUCTURE_COMPLETELY)
+          this->factorize();
+
+        free_with_check(this->sln);
+        this->sln = malloc_with_check<MixedPrecisionMumpsSolver<Scalar>, Scalar>(n, this);
+        std::fill(this->sln, this->sln + n, Scalar(0));
+
+        std::vector<Scalar> b(n), r(n), Ax(n);
+        this->rhs->extract(b.data());
+        r = b;
+        double b_norm = get_l2_norm(b.data(), n);
+        double r_norm = b_norm;
+        // The iterate with the smallest residual - the refinement need not decrease the residual monotonically.
+        std::vector<Scalar> best_sln(this->sln, this->sln + n);
+        double best_r_norm = r_norm;
+        std::vector<typename mumps_single_type<Scalar>::mumps_Scalar> correction(n);
+
+        this->refinement_iterations = 0;
+        while (r_norm > this->refinement_tolerance * b_norm && this->refinement_iterations < this->max_refinement_iterations)
+        {
+          for (int i = 0; i < n; i++)
+            correction[i] = mumps_single_type<Scalar>::to_single(r[i]);
+          this->param.rhs = correction.data();
+          this->param.job = 3;
+          mumps_single_type<Scalar>::mumps_c(&this->param);
+          this->check_status();
+
+          for (int i = 0; i < n; i++)
+            this->sln[i] += mumps_single_type<Scalar>::to_double(correction[i]);
+
+          Scalar* Ax_data = Ax.data();
+          this->m->multiply_with_vector(this->sln, Ax_data, true);
+          for (int i = 0; i < n; i++)
+            r[i] = b[i] - Ax[i];
+          r_norm = get_l2_norm(r.data(), n);
+          this->refinement_iterations++;
+          if (r_norm < best_r_norm)
+          {
+            best_r_norm = r_norm;
+            std::copy(this->sln, this->sln + n, best_sln.begin());
+          }
+        }
+
+        if (best_r_norm < r_norm)
+          std::copy(best_sln.begin(), best_sln.end(), this->sln);
+
+        this->final_residual = b_norm > 0. ? best_r_norm / b_norm : 0.;
+        if (this->final_residual > this->refinement_tolerance)
+          this->warn("MixedPrecisionMumpsSolver: iterative refinement did not converge, relative residual %g after %i iterations.", this->final_residual, this->refinement_iterations);
+
+        this->tick();
+        this->time = this->accumulated();
+      }
+
+      /// Matrix to solve.
+      CSCMatrix<Scalar> *m;
+      /// Right hand side.
+      SimpleVector<Scalar> *rhs;
+
+    protected:
+      /// Converts the matrix to single precision and factorizes it.
+      void factorize()
+      {
+        int n = this->m->get_size();
+        int nnz = this->m->get_nnz();
+        int* Ap = this->m->get_Ap();
+        int* Ai = this->m->get_Ai();
+        Scalar* Ax = this->m->get_Ax();
+
+        bool analyze = !this->inited || this->reuse_scheme == HERMES_CREATE_STRUCTURE_FROM_SCRATCH || (int)this->a.size() != nnz || this->param.n != n;
+        if (analyze)
+        {
+          this->free();
+          this->param.job = -1;
+          this->param.par = 1;
+          this->param.sym = 0;
+          this->param.comm_fortran = -987654;
+          mumps_single_type<Scalar>::mumps_c(&this->param);
+          this->inited = true;
+
+          // No output.
+          this->param.icntl[0] = -1;
+          this->param.icntl[1] = -1;
+          this->param.icntl[2] = -1;
+          this->param.icntl[3] = 0;
+          // Assembled matrix, centralized on the host.
+          this->param.icntl[4] = 0;
+          this->param.icntl[17] = 0;
+          // Memory relaxation.
+          this->param.icntl[13] = 50;
+
+          // MUMPS indexes from 1.
+          this->irn.resize(nnz);
+          this->jcn.resize(nnz);
+          for (int col = 0; col < n; col++)
+          {
+            for (int k = Ap[col]; k < Ap[col + 1]; k++)
+            {
+              this->irn[k] = Ai[k] + 1;
+              this->jcn[k] = col + 1;
+            }
+          }
+          this->param.n = n;
+          this->param.nz = nnz;
+          this->param.irn = this->irn.data();
+          this->param.jcn = this->jcn.data();
+        }
+
+        this->a.resize(nnz);
+        for (int k = 0; k < nnz; k++)
+          this->a[k] = mumps_single_type<Scalar>::to_single(Ax[k]);
+        this->param.a = this->a.data();
+
+        this->param.job = analyze ? 4 : 2;
+        mumps_single_type<Scalar>::mumps_c(&this->param);
+        this->check_status();
+        this->factorized = true;
+      }
+
+      void check_status()
+      {
+        if (this->param.infog[0] < 0)
+        {
+          int error = this->param.infog[0];
+          this->factorized = false;
+          throw Exceptions::LinearMatrixSolverException("MixedPrecisionMumpsSolver: MUMPS error INFOG(1) = %i, INFOG(2) = %i.", error, this->param.infog[1]);
+        }
+      }
+
+      /// MUMPS structure.
+      typename mumps_single_type<Scalar>::mumps_struct param;
+      bool inited;
+      bool factorized;
+
+      /// The matrix in the single precision coordinate format.
+      std::vector<int> irn;
+      std::vector<int> jcn;
+      std::vector<typename mumps_single_type<Scalar>::mumps_Scalar> a;
+
+      /// Refinement.
+      double refinement_tolerance;
+      unsigned int max_refinement_iterations;
+      unsigned int refinement_iterations;
+      double final_residual;
+    };
+  }
+}
+#endif
+#endif
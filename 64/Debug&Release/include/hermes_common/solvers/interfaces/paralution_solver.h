@@ -93,6 +93,123 @@ namespace Hermes
     private:
       paralution::LocalVector<Scalar>* paralutionVector;
     };
+
+    /// \brief Paralution matrix sharing its CSR arrays with the PARALUTION matrix.
+    /// The arrays Ap, Ai, Ax allocated by alloc() are handed to the PARALUTION matrix (LocalMatrix::SetDataPtrCSR) without any copy,
+    /// so the values assembled by Hermes are directly those PARALUTION works with and nothing is copied per solve.
+    /// The arrays are taken back (LocalMatrix::LeaveDataPtrCSR) in free(), or before the structure is reallocated.
+    /// Values computed elsewhere for the same structure are set by update_values() (LocalMatrix::UpdateValuesCSR).
+    /// While shared, the arrays are owned by PARALUTION: LocalMatrix::Clear() frees them by free_host() (delete[], the way
+    /// Hermes allocates them without WITH_PJLIB), ConvertTo() and Permute() replace them by arrays of their own.
+    /// The PARALUTION matrix has to stay on the host in the CSR format (no MoveToAccelerator(), ConvertTo(), Permute(), Clear()),
+    /// update_values() and the solvers reusing the matrix check that by verify_data().
+    template <typename Scalar>
+    class SharedParalutionMatrix : public ParalutionMatrix < Scalar >
+    {
+    public:
+      SharedParalutionMatrix() : ParalutionMatrix<Scalar>(ParalutionMatrixTypeCSR), shared(false)
+      {
+      }
+
+      virtual ~SharedParalutionMatrix()
+      {
+        this->free();
+      }
+
+      virtual void free()
+      {
+        this->leave_data();
+        CSRMatrix<Scalar>::free();
+      }
+
+      virtual void zero()
+      {
+        CSRMatrix<Scalar>::zero();
+      }
+
+      virtual void alloc()
+      {
+        this->leave_data();
+        CSRMatrix<Scalar>::alloc();
+        this->set_data();
+      }
+
+      virtual void alloc_data()
+      {
+        this->leave_data();
+        CSRMatrix<Scalar>::alloc_data();
+        this->set_data();
+      }
+
+      /// Value-only update for the unchanged structure.
+      /// \param[in] values nnz values ordered as Ax.
+      void update_values(Scalar* values)
+      {
+        if (!this->shared)
+          throw Exceptions::Exception("SharedParalutionMatrix::update_values() called before alloc().");
+        this->verify_data();
+        this->get_paralutionMatrix().UpdateValuesCSR(values);
+      }
+
+      /// True if the arrays are shared with the PARALUTION matrix.
+      bool is_shared() const
+      {
+        return this->shared;
+      }
+
+      /// Checks that the PARALUTION matrix still works with the Hermes arrays (takes them back and hands them over again).
+      /// \throws Exceptions::Exception if PARALUTION freed or replaced them, the matrix has to be allocated again then.
+      void verify_data()
+      {
+        if (!this->shared)
+          return;
+        if (!this->leave_data())
+          throw Exceptions::Exception("SharedParalutionMatrix: the PARALUTION matrix freed or replaced the shared arrays (Clear(), ConvertTo(), Permute()).");
+        this->set_data();
+      }
+
+    protected:
+      /// Hands the arrays to PARALUTION.
+      void set_data()
+      {
+        if (this->shared || !this->Ap || !this->Ai || !this->Ax)
+          return;
+        // Copies of the members are passed, SetDataPtrCSR() of this PARALUTION version leaves the pointers as they are,
+        // but the members must not depend on that.
+        int* Ap = this->Ap;
+        int* Ai = this->Ai;
+        Scalar* Ax = this->Ax;
+        this->get_paralutionMatrix().SetDataPtrCSR(&Ap, &Ai, &Ax, "paralutionMatrix", this->nnz, this->size, this->size);
+        this->shared = true;
+      }
+
+      /// Takes the arrays back from PARALUTION.
+      /// If PARALUTION freed the Hermes arrays (Clear()), the members are nulled; if it replaced them (ConvertTo(), Permute()),
+      /// its arrays are taken over (allocated by allocate_host(), i.e. new[], as well), so that nothing is freed twice.
+      /// \return False in both these cases.
+      bool leave_data()
+      {
+        if (!this->shared)
+          return true;
+        this->shared = false;
+
+        // LeaveDataPtrCSR() asserts null pointers and a nonempty matrix.
+        int* Ap = nullptr;
+        int* Ai = nullptr;
+        Scalar* Ax = nullptr;
+        if (this->get_paralutionMatrix().get_nnz() > 0)
+          this->get_paralutionMatrix().LeaveDataPtrCSR(&Ap, &Ai, &Ax);
+
+        bool intact = (Ap == this->Ap && Ai == this->Ai && Ax == this->Ax);
+        this->Ap = Ap;
+        this->Ai = Ai;
+        this->Ax = Ax;
+        this->nnz = Ap ? Ap[this->size] : 0;
+        return intact;
+      }
+
+      bool shared;
+    };
   }
 
   namespace Preconditioners
@@ -262,6 +379,372 @@ namespace Hermes
       /// Set internal solver for the current solution.
       virtual void init_internal_solver();
     };
+
+    /// \brief Reuse of the PARALUTION preconditioner (and of the AMG hierarchy) across solves with changing matrices.
+    /// The policy is chosen by LinearMatrixSolver::set_reuse_scheme():
+    /// - \c HERMES_CREATE_STRUCTURE_FROM_SCRATCH - the solver and the preconditioner are built for each solve (the default),
+    /// - \c HERMES_REUSE_MATRIX_REORDERING, \c HERMES_REUSE_MATRIX_REORDERING_AND_SCALING - the Krylov solver is kept, only the preconditioner
+    ///   recomputes its numerical values by its ReBuildNumeric() (the multicolored preconditioners keep the coloring and the sparsity pattern,
+    ///   the others are factorized anew); the AMG hierarchy is kept as built, PARALUTION cannot refresh it numerically,
+    /// - \c HERMES_REUSE_MATRIX_STRUCTURE_COMPLETELY - the preconditioner is reused as it is, the Krylov method works with the new matrix.
+    ///
+    /// With reuse, the preconditioner is built from scratch anyway after max_solves solves (set_preconditioner_reuse_limits()),
+    /// when the number of iterations grows by more than max_iteration_growth relative to the first solve with the current preconditioner,
+    /// or when the size or the number of nonzeros of the matrix changes.
+    template <typename Scalar>
+    class ParalutionPreconditionerReuse
+    {
+    public:
+      ParalutionPreconditionerReuse() : max_solves(10), max_iteration_growth(0.5), built(false), solves_since_build(0), iterations_after_build(0), built_size(0), built_nnz(0), num_builds(0)
+      {
+      }
+
+      /// Limits of the reuse.
+      /// Default: 10, 0.5.
+      /// \param[in] max_solves Solves with one preconditioner.
+      /// \param[in] max_iteration_growth Relative growth of the iterations count (0.5 = 50%).
+      void set_preconditioner_reuse_limits(unsigned int max_solves, double max_iteration_growth)
+      {
+        if (max_iteration_growth < 0.)
+          throw Exceptions::ValueException("max_iteration_growth", max_iteration_growth, 0.);
+        this->max_solves = max_solves;
+        this->max_iteration_growth = max_iteration_growth;
+      }
+
+      /// Number of the preconditioner builds from scratch.
+      unsigned int get_num_preconditioner_builds() const
+      {
+        return this->num_builds;
+      }
+
+    protected:
+      /// Solves with the reused (or numerically refreshed) preconditioner.
+      /// \param[in] preconditioner The preconditioner set to paralutionSolver, nullptr if there is none (AMG).
+      /// \return False if the preconditioner has to be built from scratch.
+      bool solve_with_reused_preconditioner(MatrixStructureReuseScheme reuse_scheme, ParalutionMatrix<Scalar>* matrix, ParalutionVector<Scalar>* rhs,
+        paralution::IterativeLinearSolver<paralution::LocalMatrix<Scalar>, paralution::LocalVector<Scalar>, Scalar>* paralutionSolver,
+        paralution::Preconditioner<paralution::LocalMatrix<Scalar>, paralution::LocalVector<Scalar>, Scalar>* preconditioner,
+        double tolerance, LoopSolverToleranceType toleranceType, int max_iters, Scalar* initial_guess, Scalar* sln)
+      {
+        if (reuse_scheme == HERMES_CREATE_STRUCTURE_FROM_SCRATCH || !this->built || !paralutionSolver)
+          return false;
+        if (this->built_size != matrix->get_size() || this->built_nnz != matrix->get_nnz())
+          return false;
+        if (this->solves_since_build >= this->max_solves)
+          return false;
+
+        // Values of a matrix that does not share its arrays with PARALUTION.
+        SharedParalutionMatrix<Scalar>* shared_matrix = dynamic_cast<SharedParalutionMatrix<Scalar>*>(matrix);
+        if (shared_matrix && shared_matrix->is_shared())
+          shared_matrix->verify_data();
+        else
+        {
+          if (matrix->get_paralutionMatrix().get_nnz() != (int)matrix->get_nnz())
+            return false;
+          matrix->get_paralutionMatrix().UpdateValuesCSR(matrix->get_Ax());
+        }
+
+        // ReBuildNumeric() of the Krylov solver itself would be Clear() + Build(), which drops its preconditioner.
+        if (reuse_scheme != HERMES_REUSE_MATRIX_STRUCTURE_COMPLETELY && preconditioner)
+          preconditioner->ReBuildNumeric();
+        paralutionSolver->ResetOperator(matrix->get_paralutionMatrix());
+
+        // Both vectors (the right-hand side array itself, the solution array of the caller) are handed to PARALUTION
+        // without copies and taken back after the solve.
+        int n = matrix->get_size();
+        Scalar* rhs_values = rhs->v;
+        if (initial_guess)
+          std::copy(initial_guess, initial_guess + n, sln);
+        else
+          std::fill(sln, sln + n, Scalar(0));
+        Scalar* sln_values = sln;
+        paralution::LocalVector<Scalar> b, x;
+        b.SetDataPtr(&rhs_values, "b", n);
+        x.SetDataPtr(&sln_values, "x", n);
+
+        paralutionSolver->Init(toleranceType == AbsoluteTolerance ? tolerance : 0.,
+          toleranceType == RelativeTolerance ? tolerance : 0.,
+          toleranceType == DivergenceTolerance ? tolerance : 1e8,
+          max_iters);
+        paralutionSolver->Solve(b, &x);
+
+        b.LeaveDataPtr(&rhs_values);
+        x.LeaveDataPtr(&sln_values);
+
+        this->solves_since_build++;
+        return true;
+      }
+
+      /// Records a solve, the preconditioner is built from scratch for the next solve if the iterations grew too much.
+      void record_solve(int iterations)
+      {
+        if (this->solves_since_build == 1)
+          this->iterations_after_build = iterations;
+        else if (iterations > (1. + this->max_iteration_growth) * this->iterations_after_build)
+          this->built = false;
+      }
+
+      /// Records a build from scratch.
+      void record_build(ParalutionMatrix<Scalar>* matrix)
+      {
+        this->built = true;
+        this->solves_since_build = 1;
+        this->built_size = matrix->get_size();
+        this->built_nnz = matrix->get_nnz();
+        this->num_builds++;
+      }
+
+      /// Settings.
+      unsigned int max_solves;
+      double max_iteration_growth;
+
+      /// State.
+      bool built;
+      unsigned int solves_since_build;
+      int iterations_after_build;
+      unsigned int built_size;
+      unsigned int built_nnz;
+      unsigned int num_builds;
+    };
+
+    /// \brief PARALUTION iterative linear solver with the preconditioner reuse (see ParalutionPreconditionerReuse).
+    template <typename Scalar>
+    class ReusingIterativeParalutionLinearMatrixSolver : public IterativeParalutionLinearMatrixSolver<Scalar>, public ParalutionPreconditionerReuse < Scalar >
+    {
+    public:
+      ReusingIterativeParalutionLinearMatrixSolver(ParalutionMatrix<Scalar> *m, ParalutionVector<Scalar> *rhs) : LoopSolver<Scalar>(m, rhs), IterSolver<Scalar>(m, rhs), IterativeParalutionLinearMatrixSolver<Scalar>(m, rhs), reused_preconditioner(nullptr)
+      {
+      }
+
+      virtual void set_precond(Precond<Scalar> *pc)
+      {
+        IterativeParalutionLinearMatrixSolver<Scalar>::set_precond(pc);
+        this->reused_preconditioner = dynamic_cast<Preconditioners::ParalutionPrecond<Scalar>*>(pc);
+      }
+
+      virtual void solve()
+      {
+        this->solve(nullptr);
+      }
+
+      virtual void solve(Scalar* initial_guess)
+      {
+        this->tick();
+        free_with_check(this->sln);
+        this->sln = malloc_with_check<ReusingIterativeParalutionLinearMatrixSolver<Scalar>, Scalar>(this->get_matrix_size(), this);
+
+        if (this->solve_with_reused_preconditioner(this->reuse_scheme, this->matrix, this->rhs, this->paralutionSolver,
+          this->reused_preconditioner ? &this->reused_preconditioner->get_paralutionPreconditioner() : nullptr,
+          this->tolerance, this->toleranceType, this->max_iters, initial_guess, this->sln))
+        {
+          this->num_iters = this->paralutionSolver->GetIterationCount();
+          this->final_residual = this->paralutionSolver->GetCurrentResidual();
+          this->tick();
+          this->time = this->accumulated();
+        }
+        else
+        {
+          MatrixStructureReuseScheme reuse_scheme = this->reuse_scheme;
+          this->reuse_scheme = HERMES_CREATE_STRUCTURE_FROM_SCRATCH;
+          IterativeParalutionLinearMatrixSolver<Scalar>::solve(initial_guess);
+          this->reuse_scheme = reuse_scheme;
+          this->record_build(this->matrix);
+        }
+        this->record_solve(this->num_iters);
+      }
+
+    protected:
+      /// The preconditioner passed to set_precond(), refreshed numerically on reuse.
+      Preconditioners::ParalutionPrecond<Scalar>* reused_preconditioner;
+    };
+
+    /// \brief PARALUTION AMG linear solver with the preconditioner reuse (see ParalutionPreconditionerReuse).
+    /// The AMG hierarchy (coarse operators and smoothers) is kept until it is built from scratch, only the finest level uses the new matrix.
+    template <typename Scalar>
+    class ReusingAMGParalutionLinearMatrixSolver : public AMGParalutionLinearMatrixSolver<Scalar>, public ParalutionPreconditionerReuse < Scalar >
+    {
+    public:
+      ReusingAMGParalutionLinearMatrixSolver(ParalutionMatrix<Scalar> *m, ParalutionVector<Scalar> *rhs) : LoopSolver<Scalar>(m, rhs), AMGSolver<Scalar>(m, rhs), AMGParalutionLinearMatrixSolver<Scalar>(m, rhs)
+      {
+      }
+
+      virtual void solve()
+      {
+        this->solve(nullptr);
+      }
+
+      virtual void solve(Scalar* initial_guess)
+      {
+        this->tick();
+        free_with_check(this->sln);
+        this->sln = malloc_with_check<ReusingAMGParalutionLinearMatrixSolver<Scalar>, Scalar>(this->get_matrix_size(), this);
+
+        if (this->solve_with_reused_preconditioner(this->reuse_scheme, this->matrix, this->rhs, this->paralutionSolver, nullptr,
+          this->tolerance, this->toleranceType, this->max_iters, initial_guess, this->sln))
+        {
+          this->num_iters = this->paralutionSolver->GetIterationCount();
+          this->final_residual = this->paralutionSolver->GetCurrentResidual();
+          this->tick();
+          this->time = this->accumulated();
+        }
+        else
+        {
+          MatrixStructureReuseScheme reuse_scheme = this->reuse_scheme;
+          this->reuse_scheme = HERMES_CREATE_STRUCTURE_FROM_SCRATCH;
+          AMGParalutionLinearMatrixSolver<Scalar>::solve(initial_guess);
+          this->reuse_scheme = reuse_scheme;
+          this->record_build(this->matrix);
+        }
+        this->record_solve(this->num_iters);
+      }
+    };
+
+    /// Block preconditioners for multi-field systems (see BlockParalutionLinearMatrixSolver).
+    enum ParalutionBlockPreconditionerType
+    {
+      ParalutionBlockJacobi,          ///< Block diagonal, the fields are preconditioned independently.
+      ParalutionBlockGaussSeidel,     ///< Block lower triangular, the couplings to the previous fields are used.
+      ParalutionBlockSchurComplement  ///< Two fields with a zero second diagonal block (saddle point problems),
+      ///< the first block and the approximate Schur complement with diag(K)^-1 are preconditioned.
+      ///< PARALUTION finds the second block from the rows without a stored diagonal entry, the block sizes must match it.
+    };
+
+    /// \brief PARALUTION iterative linear solver for multi-field systems with a field-split preconditioner.
+    /// The rows / columns of the monolithic matrix are split to blocks (fields) of the given sizes, in the order of the unknowns
+    /// (for Hermes2D problems, the blocks are the spaces, see Hermes::Hermes2D::get_block_sizes()).
+    /// Each diagonal block is preconditioned by its own PARALUTION preconditioner (PreconditionerType, default ILU),
+    /// and the blocks are combined according to ParalutionBlockPreconditionerType.
+    /// For coupled problems this typically needs far fewer iterations than ILU of the monolithic matrix.
+    template <typename Scalar>
+    class BlockParalutionLinearMatrixSolver : public IterativeParalutionLinearMatrixSolver < Scalar >
+    {
+    public:
+      /// Constructor.
+      /// @param[in] m pointer to matrix
+      /// @param[in] rhs pointer to right hand side vector
+      /// @param[in] block_sizes sizes of the blocks, summing up to the matrix size
+      BlockParalutionLinearMatrixSolver(ParalutionMatrix<Scalar> *m, ParalutionVector<Scalar> *rhs, std::vector<int> block_sizes, ParalutionBlockPreconditionerType block_preconditioner_type = ParalutionBlockGaussSeidel)
+        : LoopSolver<Scalar>(m, rhs), IterSolver<Scalar>(m, rhs), IterativeParalutionLinearMatrixSolver<Scalar>(m, rhs),
+        block_sizes(block_sizes), block_preconditioner_type(block_preconditioner_type), block_preconditioner(nullptr)
+      {
+        if (block_preconditioner_type == ParalutionBlockSchurComplement && block_sizes.size() != 2)
+          throw Exceptions::LengthException(3, block_sizes.size(), 2);
+        this->block_solver_types.resize(block_sizes.size(), ILU);
+      }
+
+      virtual ~BlockParalutionLinearMatrixSolver()
+      {
+        // The internal solver refers to the block preconditioner.
+        this->reset_internal_solver();
+        this->free_block_preconditioner();
+      }
+
+      /// Set the preconditioner of one block.
+      /// For ParalutionBlockSchurComplement, block 1 is the Schur complement.
+      void set_block_preconditioner(unsigned int block, PreconditionerType preconditionerType)
+      {
+        if (block >= this->block_solver_types.size())
+          throw Exceptions::ValueException("block", block, 0., this->block_solver_types.size() - 1.);
+        this->block_solver_types[block] = preconditionerType;
+      }
+
+      /// Set the block sizes (e.g. after the spaces changed).
+      void set_block_sizes(std::vector<int> block_sizes)
+      {
+        if (this->block_preconditioner_type == ParalutionBlockSchurComplement && block_sizes.size() != 2)
+          throw Exceptions::LengthException(1, block_sizes.size(), 2);
+        this->block_sizes = block_sizes;
+        this->block_solver_types.resize(block_sizes.size(), ILU);
+      }
+
+      /// Creates the internal solver and replaces its preconditioner by the block one.
+      virtual void init_internal_solver()
+      {
+        IterativeParalutionLinearMatrixSolver<Scalar>::init_internal_solver();
+
+        int size = 0;
+        for (unsigned int i = 0; i < this->block_sizes.size(); i++)
+          size += this->block_sizes[i];
+        if (size != this->get_matrix_size())
+          throw Exceptions::Exception("BlockParalutionLinearMatrixSolver: the block sizes sum up to %i, the matrix size is %i.", size, this->get_matrix_size());
+
+        if (this->block_preconditioner_type == ParalutionBlockSchurComplement)
+          this->check_zero_block();
+
+        this->free_block_preconditioner();
+        for (unsigned int i = 0; i < this->block_solver_types.size(); i++)
+          this->block_solvers.push_back(Preconditioners::ParalutionPrecond<Scalar>::return_paralutionPreconditioner(this->block_solver_types[i]));
+
+        if (this->block_preconditioner_type == ParalutionBlockSchurComplement)
+        {
+          paralution::DiagJacobiSaddlePointPrecond<paralution::LocalMatrix<Scalar>, paralution::LocalVector<Scalar>, Scalar>* saddle_point
+            = new paralution::DiagJacobiSaddlePointPrecond<paralution::LocalMatrix<Scalar>, paralution::LocalVector<Scalar>, Scalar>();
+          saddle_point->Set(*this->block_solvers[0], *this->block_solvers[1]);
+          this->block_preconditioner = saddle_point;
+        }
+        else
+        {
+          OwningBlockPreconditioner* block = new OwningBlockPreconditioner();
+          block->Set(this->block_sizes.size(), this->block_sizes.data(), this->block_solvers.data());
+          if (this->block_preconditioner_type == ParalutionBlockJacobi)
+            block->SetDiagonalSolver();
+          else
+            block->SetLSolver();
+          this->block_preconditioner = block;
+        }
+
+        this->paralutionSolver->SetPreconditioner(*this->block_preconditioner);
+      }
+
+    protected:
+      /// BlockPreconditioner deletes the block solvers in Clear() once it has been built, this tells whether it has been.
+      class OwningBlockPreconditioner : public paralution::BlockPreconditioner < paralution::LocalMatrix<Scalar>, paralution::LocalVector<Scalar>, Scalar >
+      {
+      public:
+        bool owns_block_solvers() const { return this->build_; }
+      };
+
+      /// DiagJacobiSaddlePointPrecond does not take the block sizes, it permutes the rows without a stored diagonal entry to the end.
+      /// Checks that these rows are exactly the second block.
+      void check_zero_block()
+      {
+        int* Ap = this->matrix->get_Ap();
+        int* Ai = this->matrix->get_Ai();
+        for (int row = 0; row < this->get_matrix_size(); row++)
+        {
+          bool has_diagonal = false;
+          for (int i = Ap[row]; i < Ap[row + 1] && !has_diagonal; i++)
+            has_diagonal = (Ai[i] == row);
+          if (has_diagonal != (row < this->block_sizes[0]))
+            throw Exceptions::Exception("BlockParalutionLinearMatrixSolver: the Schur complement preconditioner needs a zero second diagonal block of size %i, row %i %s a diagonal entry.",
+            this->block_sizes[1], row, has_diagonal ? "has" : "lacks");
+        }
+      }
+
+      void free_block_preconditioner()
+      {
+        // The saddle point preconditioner only clears the block solvers, they stay ours.
+        bool block_solvers_owned = false;
+        if (this->block_preconditioner)
+        {
+          if (this->block_preconditioner_type != ParalutionBlockSchurComplement)
+            block_solvers_owned = static_cast<OwningBlockPreconditioner*>(this->block_preconditioner)->owns_block_solvers();
+          delete this->block_preconditioner;
+          this->block_preconditioner = nullptr;
+        }
+        if (!block_solvers_owned)
+          for (unsigned int i = 0; i < this->block_solvers.size(); i++)
+            delete this->block_solvers[i];
+        this->block_solvers.clear();
+      }
+
+      std::vector<int> block_sizes;
+      std::vector<PreconditionerType> block_solver_types;
+      ParalutionBlockPreconditionerType block_preconditioner_type;
+
+      paralution::Preconditioner<paralution::LocalMatrix<Scalar>, paralution::LocalVector<Scalar>, Scalar>* block_preconditioner;
+      std::vector<paralution::Solver<paralution::LocalMatrix<Scalar>, paralution::LocalVector<Scalar>, Scalar>*> block_solvers;
+    };
   }
 }
 #endif
@@ -0,0 +1,423 @@
+// *************************************************************************
+//
+//    PARALUTION   www.paralution.com
+//
+//    Copyright (C) 2012-2014 Dimitar Lukarski
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// *************************************************************************
+
+
+
+// PARALUTION version 0.7.0b 
+
+
+#include "ascii_io.hpp"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// the default OS is Linux
+
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32) || defined(__WIN64) && !defined(__CYGWIN__)
+// Windows
+#include <windows.h>
+
+#else
+// Linux
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#endif
+
+
+namespace paralution {
+
+ParalutionMappedFile::ParalutionMappedFile() {
+
+  this->data_ = NULL;
+  this->size_ = 0;
+  this->copy_on_write_ = false;
+  this->buffer_ = NULL;
+
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32) || defined(__WIN64) && !defined(__CYGWIN__)
+  this->file_handle_ = NULL;
+  this->mapping_handle_ = NULL;
+#else
+  this->mapped_ = false;
+#endif
+
+}
+
+ParalutionMappedFile::~ParalutionMappedFile() {
+
+  this->Close();
+
+}
+
+bool ParalutionMappedFile::Open(const std::string filename, const bool copy_on_write) {
+
+  this->Close();
+
+  this->copy_on_write_ = copy_on_write;
+
+  unsigned long long file_size = 0;
+
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32) || defined(__WIN64) && !defined(__CYGWIN__)
+  // Windows
+
+  HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    CloseHandle(file);
+    return false;
+  }
+  file_size = size.QuadPart;
+
+  if (file_size == 0) {
+    CloseHandle(file);
+    return true;
+  }
+
+  if (file_size <= (unsigned long long)((size_t)-1)) {
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, copy_on_write ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL);
+
+    if (mapping != NULL) {
+
+      const void *view = MapViewOfFile(mapping, copy_on_write ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+
+      if (view != NULL) {
+        this->file_handle_ = file;
+        this->mapping_handle_ = mapping;
+        this->data_ = static_cast<const char*>(view);
+        this->size_ = size_t(file_size);
+        return true;
+      }
+
+      CloseHandle(mapping);
+    }
+  }
+
+  CloseHandle(file);
+
+#else
+// Linux
+
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+  file_size = st.st_size;
+
+  if (file_size == 0) {
+    close(fd);
+    return true;
+  }
+
+  if (file_size <= (unsigned long long)((size_t)-1)) {
+
+    void *view = mmap(NULL, size_t(file_size), copy_on_write ? (PROT_READ | PROT_WRITE) : PROT_READ,
+                      MAP_PRIVATE, fd, 0);
+
+    if (view != MAP_FAILED) {
+      madvise(view, size_t(file_size), MADV_SEQUENTIAL);
+      close(fd);
+
+      this->mapped_ = true;
+      this->data_ = static_cast<const char*>(view);
+      this->size_ = size_t(file_size);
+      return true;
+    }
+  }
+
+  close(fd);
+
+#endif
+
+  // Can not be mapped - read it in one block
+  if (file_size > (unsigned long long)((size_t)-1))
+    return false;
+
+  FILE *f = fopen(filename.c_str(), "rb");
+  if (f == NULL)
+    return false;
+
+  this->buffer_ = static_cast<char*>(malloc(size_t(file_size)));
+  if (this->buffer_ == NULL) {
+    fclose(f);
+    return false;
+  }
+
+  this->size_ = fread(this->buffer_, 1, size_t(file_size), f);
+  this->data_ = this->buffer_;
+  fclose(f);
+
+  return true;
+
+}
+
+void ParalutionMappedFile::Close(void) {
+
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32) || defined(__WIN64) && !defined(__CYGWIN__)
+  // Windows
+
+  if (this->mapping_handle_ != NULL) {
+    UnmapViewOfFile(this->data_);
+    CloseHandle(this->mapping_handle_);
+    CloseHandle(this->file_handle_);
+
+    this->mapping_handle_ = NULL;
+    this->file_handle_ = NULL;
+  }
+
+#else
+// Linux
+
+  if (this->mapped_ == true) {
+    munmap(const_cast<char*>(this->data_), this->size_);
+    this->mapped_ = false;
+  }
+
+#endif
+
+  if (this->buffer_ != NULL) {
+    free(this->buffer_);
+    this->buffer_ = NULL;
+  }
+
+  this->data_ = NULL;
+  this->size_ = 0;
+
+}
+
+void split_ascii_lines(const char *data, const size_t begin, const size_t end,
+                       const int num_chunks, size_t *bounds) {
+
+  assert(num_chunks > 0);
+  assert(begin <= end);
+
+  const size_t length = end - begin;
+
+  bounds[0] = begin;
+  bounds[num_chunks] = end;
+
+  for (int i=1; i<num_chunks; ++i) {
+
+    size_t pos = begin + size_t((double(length) * i) / num_chunks);
+
+    if (pos < bounds[i-1])
+      pos = bounds[i-1];
+
+    // move to the beginning of the next line
+    if ((pos > begin) && (data[pos-1] != '\n')) {
+      const char *nl = static_cast<const char*>(memchr(data + pos, '\n', end - pos));
+      pos = (nl == NULL) ? end : size_t(nl - data) + 1;
+    }
+
+    bounds[i] = pos;
+  }
+
+}
+
+const char *ascii_line_end(const char *pos, const char *end) {
+
+  const char *nl = static_cast<const char*>(memchr(pos, '\n', end - pos));
+
+  return (nl == NULL) ? end : nl;
+
+}
+
+const char *ascii_next_line(const char *pos, const char *end) {
+
+  const char *line_end = ascii_line_end(pos, end);
+
+  return (line_end < end) ? line_end + 1 : end;
+
+}
+
+const char *skip_ascii_blanks(const char *pos, const char *end) {
+
+  while ((pos < end) && ((*pos == ' ') || (*pos == '\t') || (*pos == '\r') ||
+                         (*pos == '\v') || (*pos == '\f')))
+    ++pos;
+
+  return pos;
+
+}
+
+// End of a token (the next blank or line end)
+static const char *ascii_token_end(const char *pos, const char *end) {
+
+  while ((pos < end) && (*pos != ' ') && (*pos != '\t') && (*pos != '\r') &&
+         (*pos != '\n') && (*pos != '\v') && (*pos != '\f'))
+    ++pos;
+
+  return pos;
+
+}
+
+bool parse_ascii_int(const char **pos, const char *end, int *val) {
+
+  const char *p = skip_ascii_blanks(*pos, end);
+  const char *token = p;
+
+  bool neg = false;
+  if ((p < end) && ((*p == '+') || (*p == '-'))) {
+    neg = (*p == '-');
+    ++p;
+  }
+
+  const char *digits = p;
+  long long v = 0;
+  while ((p < end) && (*p >= '0') && (*p <= '9') && (p - digits < 18)) {
+    v = 10*v + (*p - '0');
+    ++p;
+  }
+
+  if ((p > digits) && (ascii_token_end(p, end) == p)) {
+    *val = int(neg ? -v : v);
+    *pos = p;
+    return true;
+  }
+
+  // Not a plain decimal number - let strtol() decide
+  const char *token_end = ascii_token_end(token, end);
+  std::string str(token, token_end);
+  char *str_end;
+  long lv = strtol(str.c_str(), &str_end, 10);
+
+  if (str_end == str.c_str())
+    return false;
+
+  *val = int(lv);
+  *pos = token + (str_end - str.c_str());
+  return true;
+
+}
+
+bool parse_ascii_double(const char **pos, const char *end, double *val) {
+
+  // Exactly representable powers of ten
+  static const double pow10[] = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                  1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                  1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+  const char *p = skip_ascii_blanks(*pos, end);
+  const char *token = p;
+
+  bool neg = false;
+  if ((p < end) && ((*p == '+') || (*p == '-'))) {
+    neg = (*p == '-');
+    ++p;
+  }
+
+  unsigned long long mantissa = 0;
+  int sig_digits = 0;
+  int num_digits = 0;
+  int exponent = 0;
+
+  while ((p < end) && (*p >= '0') && (*p <= '9')) {
+    if ((mantissa > 0) || (*p != '0'))
+      ++sig_digits;
+    mantissa = 10*mantissa + (*p - '0');
+    ++num_digits;
+    ++p;
+    if (sig_digits > 19)
+      break;
+  }
+
+  if ((p < end) && (*p == '.') && (sig_digits <= 19)) {
+    ++p;
+    while ((p < end) && (*p >= '0') && (*p <= '9')) {
+      if ((mantissa > 0) || (*p != '0'))
+        ++sig_digits;
+      mantissa = 10*mantissa + (*p - '0');
+      ++num_digits;
+      --exponent;
+      ++p;
+      if (sig_digits > 19)
+        break;
+    }
+  }
+
+  bool valid_exp = true;
+  if ((p < end) && ((*p == 'e') || (*p == 'E')) && (num_digits > 0)) {
+    ++p;
+
+    bool neg_exp = false;
+    if ((p < end) && ((*p == '+') || (*p == '-'))) {
+      neg_exp = (*p == '-');
+      ++p;
+    }
+
+    const char *exp_digits = p;
+    int e = 0;
+    while ((p < end) && (*p >= '0') && (*p <= '9')) {
+      if (e < 100000)
+        e = 10*e + (*p - '0');
+      ++p;
+    }
+
+    valid_exp = (p > exp_digits);
+    exponent += neg_exp ? -e : e;
+  }
+
+  // Clinger's fast path - the mantissa and the power of ten are exact,
+  // one correctly rounded operation gives the strtod() result
+  if ((num_digits > 0) && (valid_exp == true) && (sig_digits <= 19) &&
+      (ascii_token_end(p, end) == p) &&
+      (mantissa <= (1ULL << 53)) && (exponent >= -22) && (exponent <= 22)) {
+
+    double v = double(mantissa);
+    if (exponent < 0)
+      v /= pow10[-exponent];
+    else
+      v *= pow10[exponent];
+
+    *val = neg ? -v : v;
+    *pos = p;
+    return true;
+  }
+
+  // Long mantissa, large exponent, inf, nan, hex, ... - let strtod() decide
+  const char *token_end = ascii_token_end(token, end);
+  std::string str(token, token_end);
+  char *str_end;
+  double v = strtod(str.c_str(), &str_end);
+
+  if (str_end == str.c_str())
+    return false;
+
+  *val = v;
+  *pos = token + (str_end - str.c_str());
+  return true;
+
+}
+
+}
@@ -0,0 +1,105 @@
+// *************************************************************************
+//
+//    PARALUTION   www.paralution.com
+//
+//    Copyright (C) 2012-2014 Dimitar Lukarski
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// *************************************************************************
+
+
+
+// PARALUTION version 0.7.0b 
+
+
+#ifndef PARALUTION_UTILS_ASCII_IO_HPP_
+#define PARALUTION_UTILS_ASCII_IO_HPP_
+
+#include <string>
+#include <assert.h>
+#include <stddef.h>
+
+namespace paralution {
+
+/// View of a whole file - memory-mapped (read-only or copy-on-write),
+/// or read in one block if the file can not be mapped
+class ParalutionMappedFile {
+
+public:
+
+  ParalutionMappedFile();
+  ~ParalutionMappedFile();
+
+  /// Open the file, return false if it can not be read;
+  /// a copy-on-write view can be modified without changing the file
+  bool Open(const std::string filename, const bool copy_on_write=false);
+  /// Release the view
+  void Close(void);
+
+  /// Return the content of the file (not null-terminated)
+  const char *get_data(void) const { return this->data_; }
+  /// Return the content of a copy-on-write view
+  char *get_writable_data(void) { assert(this->copy_on_write_ == true); return const_cast<char*>(this->data_); }
+  /// Return the size of the file in bytes
+  size_t get_size(void) const { return this->size_; }
+
+private:
+
+  // Not copyable
+  ParalutionMappedFile(const ParalutionMappedFile&);
+  ParalutionMappedFile &operator=(const ParalutionMappedFile&);
+
+  const char *data_;
+  size_t size_;
+  bool copy_on_write_;
+
+  // Block read fallback
+  char *buffer_;
+
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32) || defined(__WIN64) && !defined(__CYGWIN__)
+  void *file_handle_;
+  void *mapping_handle_;
+#else
+  bool mapped_;
+#endif
+
+};
+
+/// Split [begin, end) into num_chunks ranges of (roughly) the same size,
+/// each starting at the beginning of a line; bounds has num_chunks+1 entries
+void split_ascii_lines(const char *data, const size_t begin, const size_t end,
+                       const int num_chunks, size_t *bounds);
+
+/// Return the end of the line starting at pos (the position of '\n' or end)
+const char *ascii_line_end(const char *pos, const char *end);
+
+/// Return the beginning of the line following the one starting at pos (or end)
+const char *ascii_next_line(const char *pos, const char *end);
+
+/// Skip spaces, tabs and carriage returns
+const char *skip_ascii_blanks(const char *pos, const char *end);
+
+/// Parse an integer at pos (after blanks) as strtol() does,
+/// return false if there is no number; pos is moved behind the number
+bool parse_ascii_int(const char **pos, const char *end, int *val);
+
+/// Parse a floating point number at pos (after blanks) with the same
+/// (correctly rounded) result as strtod(), return false if there is no number;
+/// short decimal numbers are converted directly, the rest by strtod()
+bool parse_ascii_double(const char **pos, const char *end, double *val);
+
+}
+
+#endif // PARALUTION_UTILS_ASCII_IO_HPP_
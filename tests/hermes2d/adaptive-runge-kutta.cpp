@@ -0,0 +1,129 @@
+// AdaptiveRungeKutta on u' = -u, u(0) = 1 (the p = 1 coefficients are u(t) = exp(-t) in all the vertices):
+// the error at the end time has to follow the tolerance, the step lengths have to stay within the bounds, the last step
+// has to end exactly at the end time, and a step in which Newton's method does not converge has to be rejected
+// and repeated shorter.
+#include "test_problem.h"
+
+static const double end_time = 1.;
+
+// Adds fault * u v to the residual (not to the Jacobian) for steps longer than max_time_step - the simplified
+// Newton's method then diverges.
+class NewtonFaultForm : public VectorFormVol<double>
+{
+public:
+  NewtonFaultForm(double max_time_step, double fault) : VectorFormVol<double>(0), max_time_step(max_time_step), fault(fault) {}
+
+  virtual double value(int n, double *wt, Func<double> **u_ext, Func<double> *v, GeomVol<double> *, Func<double> **) const
+  {
+    if (this->wf->get_current_time_step() <= this->max_time_step)
+      return 0.;
+    double result = 0.;
+    for (int i = 0; i < n; i++)
+      result += wt[i] * this->fault * u_ext[0]->val[i] * v->val[i];
+    return result;
+  }
+
+  virtual Ord ord(int, double *, Func<Ord> **u_ext, Func<Ord> *v, GeomVol<Ord> *, Func<Ord> **) const
+  {
+    return u_ext[0]->val[0] * v->val[0];
+  }
+
+  virtual VectorFormVol<double>* clone() const
+  {
+    return new NewtonFaultForm(*this);
+  }
+
+  double max_time_step;
+  double fault;
+};
+
+// F(u) = -u.
+static WeakFormSharedPtr<double> decay_weakform(NewtonFaultForm* fault_form = nullptr)
+{
+  WeakForm<double>* wf = new WeakForm<double>(1);
+  wf->add_matrix_form(new WeakFormsH1::DefaultMatrixFormVol<double>(0, 0, HERMES_ANY, new Hermes2DFunction<double>(-1.0)));
+  wf->add_vector_form(new WeakFormsH1::DefaultResidualVol<double>(0, HERMES_ANY, new Hermes2DFunction<double>(-1.0)));
+  if (fault_form)
+    wf->add_vector_form(fault_form);
+  return WeakFormSharedPtr<double>(wf);
+}
+
+struct Run
+{
+  double error;
+  double min_step, max_step;
+  unsigned int accepted, rejected;
+  bool ended_exactly;
+};
+
+// Integrates to end_time, records the accepted step lengths (except for the last one, shortened to end at end_time).
+static Run run(WeakFormSharedPtr<double> wf, double tolerance, double initial_time_step, double min_time_step, double max_time_step)
+{
+  SpaceSharedPtr<double> space(new H1Space<double>(load_square_mesh(1), 1));
+  ButcherTable bt(Implicit_SDIRK_CASH_3_23_embedded);
+  AdaptiveRungeKutta<double> runge_kutta(wf, space, &bt, 2);
+  runge_kutta.set_verbose_output(false);
+  runge_kutta.set_newton_tolerance(1e-12);
+  runge_kutta.set_newton_max_allowed_iterations(5);
+  runge_kutta.set_tolerances(tolerance, tolerance);
+  runge_kutta.set_time_step_bounds(min_time_step, max_time_step);
+  runge_kutta.set_time(0.);
+  runge_kutta.set_time_step(initial_time_step);
+
+  Run result = { 0., std::numeric_limits<double>::max(), 0., 0, 0, false };
+  MeshFunctionSharedPtr<double> sln_prev(new ConstantSolution<double>(space->get_mesh(), 1.));
+  MeshFunctionSharedPtr<double> sln_new;
+  while (runge_kutta.time < end_time)
+  {
+    sln_new = MeshFunctionSharedPtr<double>(new Solution<double>);
+    double time_step = runge_kutta.rk_time_step_adaptive(sln_prev, sln_new, end_time);
+    if (runge_kutta.time < end_time)
+      result.min_step = std::min(result.min_step, time_step);
+    result.max_step = std::max(result.max_step, time_step);
+    sln_prev = sln_new;
+  }
+  result.ended_exactly = (runge_kutta.time == end_time);
+  result.accepted = runge_kutta.get_num_accepted_steps();
+  result.rejected = runge_kutta.get_num_rejected_steps();
+
+  std::vector<double> coefficients(space->get_num_dofs());
+  OGProjection<double>::project_global(space, sln_new, coefficients.data());
+  for (unsigned int i = 0; i < coefficients.size(); i++)
+    result.error = std::max(result.error, std::abs(coefficients[i] - std::exp(-end_time)));
+  return result;
+}
+
+static void print(const char* name, const Run& result)
+{
+  printf("%s: error %g, %u accepted and %u rejected steps, step lengths %g - %g, %s at the end time.\n", name, result.error,
+    result.accepted, result.rejected, result.min_step, result.max_step, result.ended_exactly ? "ended" : "did not end");
+}
+
+int main()
+{
+  bool success = true;
+  double unbounded = std::numeric_limits<double>::max();
+
+  // Error versus tolerance.
+  Run loose = run(decay_weakform(), 1e-4, 1e-3, 1e-12, unbounded);
+  Run tight = run(decay_weakform(), 1e-7, 1e-3, 1e-12, unbounded);
+  print("Tolerance 1e-4", loose);
+  print("Tolerance 1e-7", tight);
+  success = success && loose.ended_exactly && tight.ended_exactly;
+  success = success && loose.error < 1e-2 && tight.error < 1e-5 && tight.error < loose.error && tight.accepted > loose.accepted;
+
+  // The step length bounds.
+  Run bounded_above = run(decay_weakform(), 1e-2, 1e-3, 1e-12, 0.1);
+  print("Maximum step 0.1", bounded_above);
+  success = success && bounded_above.ended_exactly && bounded_above.max_step <= 0.1;
+  Run bounded_below = run(decay_weakform(), 1e-2, 1e-3, 0.05, unbounded);
+  print("Minimum step 0.05", bounded_below);
+  success = success && bounded_below.ended_exactly && bounded_below.min_step >= 0.05;
+
+  // Newton's method diverges for steps longer than 0.05: the first step (0.5) is rejected until it is short enough.
+  Run newton_fault = run(decay_weakform(new NewtonFaultForm(0.05, 1e4)), 1e-4, 0.5, 1e-12, unbounded);
+  print("Newton's method failing for steps over 0.05", newton_fault);
+  success = success && newton_fault.ended_exactly && newton_fault.rejected >= 2 && newton_fault.max_step <= 0.05;
+
+  return test_result(success);
+}
@@ -0,0 +1,61 @@
+// BudgetedLinearizer: the output has to stay within the budget of triangles, the largest remaining error estimate must
+// not grow with the budget, and with a tolerance the splitting has to stop at the tolerance before the budget runs out.
+// The solution is bilinear on the elements (order 1), so that the estimate of a split triangle is a quarter of that of
+// its parent, and the greedy splitting removes the largest estimates first.
+#include "test_problem.h"
+#include "views/budgeted_linearizer.h"
+
+using namespace Hermes::Hermes2D::Views;
+
+static bool valid_output(const BudgetedLinearizer& linearizer)
+{
+  for (int i = 0; i < linearizer.get_triangle_count(); i++)
+    for (int j = 0; j < 3; j++)
+      if (linearizer.get_triangles()[i][j] < 0 || linearizer.get_triangles()[i][j] >= linearizer.get_vertex_count())
+        return false;
+  return linearizer.get_triangle_count() > 0 && linearizer.get_min_value() <= linearizer.get_max_value();
+}
+
+int main()
+{
+  MeshSharedPtr mesh = load_square_mesh(3);
+  WeakFormSharedPtr<double> wf = peak_poisson_weakform();
+  SpaceSharedPtr<double> space = peak_poisson_space(mesh, 1);
+
+  NewtonSolver<double> newton(wf, space);
+  newton.set_verbose_output(false);
+  newton.solve();
+  MeshFunctionSharedPtr<double> sln(new Solution<double>);
+  Solution<double>::vector_to_solution(newton.get_sln_vector(), space, sln);
+
+  // The mesh has 64 quads, i.e. 128 initial triangles.
+  bool success = true;
+  int budgets[5] = { 200, 400, 800, 1600, 3200 };
+  int triangle_counts[5];
+  double remaining_errors[5];
+  for (int i = 0; i < 5; i++)
+  {
+    BudgetedLinearizer linearizer(budgets[i]);
+    linearizer.set_verbose_output(false);
+    linearizer.process_solution(sln);
+    triangle_counts[i] = linearizer.get_triangle_count();
+    remaining_errors[i] = linearizer.get_max_remaining_error();
+    printf("Budget %i: %i triangles, %i vertices, largest remaining error estimate %g.\n", budgets[i], triangle_counts[i], linearizer.get_vertex_count(), remaining_errors[i]);
+    success = success && valid_output(linearizer) && triangle_counts[i] <= budgets[i] && triangle_counts[i] > budgets[i] - 4;
+    success = success && remaining_errors[i] > 0. && (i == 0 || remaining_errors[i] <= remaining_errors[i - 1]);
+  }
+
+  // The tolerance of the budget of 800 with a budget it cannot exhaust: it stops no later than the budget of 800 did.
+  int large_budget = 1000000;
+  double tolerance = remaining_errors[2];
+  BudgetedLinearizer tolerance_linearizer(large_budget, 10, tolerance);
+  tolerance_linearizer.set_verbose_output(false);
+  tolerance_linearizer.process_solution(sln);
+  int tolerance_count = tolerance_linearizer.get_triangle_count();
+  double tolerance_error = tolerance_linearizer.get_max_remaining_error();
+  printf("Tolerance %g: %i triangles, largest remaining error estimate %g.\n", tolerance, tolerance_count, tolerance_error);
+  success = success && valid_output(tolerance_linearizer) && tolerance_count <= triangle_counts[2] && tolerance_count + 3 <= large_budget;
+  success = success && tolerance_error > 0. && tolerance_error <= tolerance && tolerance_error >= remaining_errors[3];
+
+  return test_result(success);
+}
@@ -0,0 +1,56 @@
+// CalculationContinuityHDF5: a record written by the background thread loads back with the same mesh, space,
+// coefficients (real and complex) and scalar data.
+#include "test_problem.h"
+#include "calculation_continuity_hdf5.h"
+
+template<typename Scalar>
+bool roundtrip(const char* filename, Scalar coefficient_unit)
+{
+  remove(filename);
+
+  MeshSharedPtr mesh = load_square_mesh(2);
+  mesh->refine_element_id(5);
+  SpaceSharedPtr<Scalar> space(new H1Space<Scalar>(mesh, 2));
+  space->set_element_order(6, 4);
+  space->assign_dofs();
+  std::vector<Scalar> coefficients(space->get_num_dofs());
+  for (unsigned int i = 0; i < coefficients.size(); i++)
+    coefficients[i] = (0.5 + i) * coefficient_unit;
+
+  {
+    CalculationContinuityHDF5<Scalar> continuity(filename);
+    for (unsigned int number = 0; number < 3; number++)
+    {
+      typename CalculationContinuityHDF5<Scalar>::Record* record = new typename CalculationContinuityHDF5<Scalar>::Record(0.5 * number, number);
+      record->save_mesh(mesh);
+      record->save_space(space);
+      record->save_coefficient_vector(coefficients.data(), coefficients.size());
+      record->save_time_step_length(0.5);
+      record->save_error(1e-3 * number);
+      continuity.add_record(record);
+    }
+  }
+
+  CalculationContinuityHDF5<Scalar> continuity(filename, false);
+  if (!continuity.have_record_available())
+    return false;
+  typename CalculationContinuityHDF5<Scalar>::Record* record = continuity.load_last_record();
+  MeshSharedPtr loaded_mesh(new Mesh);
+  record->load_mesh(loaded_mesh);
+  SpaceSharedPtr<Scalar> loaded_space = record->load_spaces(std::vector<MeshSharedPtr>(1, loaded_mesh))[0];
+  double time_step, error;
+  record->load_time_step_length(time_step);
+  record->load_error(error);
+
+  bool success = record->get_number() == 2 && record->get_time() == 1.0 && time_step == 0.5 && error == 2e-3;
+  success = success && same_mesh(mesh, loaded_mesh) && loaded_space->get_num_dofs() == space->get_num_dofs();
+  Element* e;
+  for_all_active_elements(e, mesh)
+    success = success && loaded_space->get_element_order(e->id) == space->get_element_order(e->id);
+  return success && record->load_coefficient_vector() == coefficients;
+}
+
+int main()
+{
+  return test_result(roundtrip<double>("continuity-real.h5", 1.0) && roundtrip<std::complex<double> >("continuity-complex.h5", std::complex<double>(1.0, -2.0)));
+}
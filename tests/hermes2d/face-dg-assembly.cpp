@@ -0,0 +1,115 @@
+// DG forms assembled face by face (DiscreteProblemFaceDGAssembler) have to give the same matrix and right-hand side
+// as the element-based assembling of DiscreteProblem, sequentially and in parallel.
+#include "test_problem.h"
+
+// Interior penalty of the jumps, sigma [u] [v].
+class JumpPenaltyForm : public MatrixFormDG<double>
+{
+public:
+  JumpPenaltyForm(double sigma) : MatrixFormDG<double>(0, 0), sigma(sigma) {}
+
+  virtual double value(int n, double *wt, DiscontinuousFunc<double> **, DiscontinuousFunc<double> *u, DiscontinuousFunc<double> *v,
+    InterfaceGeom<double> *, DiscontinuousFunc<double> **) const
+  {
+    double result = 0.;
+    for (int i = 0; i < n; i++)
+    {
+      double jump_u = (u->fn_central ? u->val[i] : 0.) - (u->fn_neighbor ? u->val_neighbor[i] : 0.);
+      double jump_v = (v->fn_central ? v->val[i] : 0.) - (v->fn_neighbor ? v->val_neighbor[i] : 0.);
+      result += wt[i] * this->sigma * jump_u * jump_v;
+    }
+    return result;
+  }
+
+  virtual Ord ord(int, double *, DiscontinuousFunc<Ord> **, DiscontinuousFunc<Ord> *u, DiscontinuousFunc<Ord> *v,
+    InterfaceGeom<Ord> *, DiscontinuousFunc<Ord> **) const
+  {
+    return u->val * v->val;
+  }
+
+  virtual MatrixFormDG<double>* clone() const
+  {
+    return new JumpPenaltyForm(*this);
+  }
+
+  double sigma;
+};
+
+// Interface load (x + 2y) v.
+class InterfaceLoadForm : public VectorFormDG<double>
+{
+public:
+  InterfaceLoadForm() : VectorFormDG<double>(0) {}
+
+  virtual double value(int n, double *wt, DiscontinuousFunc<double> **, Func<double> *v, InterfaceGeom<double> *e, DiscontinuousFunc<double> **) const
+  {
+    double result = 0.;
+    for (int i = 0; i < n; i++)
+      result += wt[i] * (e->x[i] + 2. * e->y[i]) * v->val[i];
+    return result;
+  }
+
+  virtual Ord ord(int, double *, DiscontinuousFunc<Ord> **, Func<Ord> *v, InterfaceGeom<Ord> *e, DiscontinuousFunc<Ord> **) const
+  {
+    return e->x[0] * v->val[0];
+  }
+
+  virtual VectorFormDG<double>* clone() const
+  {
+    return new InterfaceLoadForm(*this);
+  }
+};
+
+static bool compare(CSCMatrix<double>& element_matrix, SimpleVector<double>& element_rhs, CSCMatrix<double>& face_matrix, SimpleVector<double>& face_rhs, int ndof)
+{
+  double max_difference = 0., max_value = 0.;
+  for (int i = 0; i < ndof; i++)
+  {
+    for (int j = 0; j < ndof; j++)
+    {
+      max_difference = std::max(max_difference, std::abs(element_matrix.get(i, j) - face_matrix.get(i, j)));
+      max_value = std::max(max_value, std::abs(element_matrix.get(i, j)));
+    }
+    max_difference = std::max(max_difference, std::abs(element_rhs.get(i) - face_rhs.get(i)));
+    max_value = std::max(max_value, std::abs(element_rhs.get(i)));
+  }
+  printf("Maximum difference of the face and element assembling: %g (maximum entry %g)\n", max_difference, max_value);
+  return max_value > 0. && max_difference <= 1e-12 * max_value;
+}
+
+int main()
+{
+  // Unequal refinements, so that some faces are shared by elements of different levels.
+  MeshSharedPtr mesh = load_square_mesh(2);
+  mesh->refine_element_id(0);
+  mesh->refine_element_id(5);
+  SpaceSharedPtr<double> space(new L2Space<double>(mesh, 2));
+  int ndof = space->get_num_dofs();
+
+  WeakFormSharedPtr<double> wf(new WeakForm<double>(1));
+  JumpPenaltyForm* penalty = new JumpPenaltyForm(10.);
+  penalty->setScalingFactor(0.5);
+  wf->add_matrix_form_DG(penalty);
+  wf->add_vector_form_DG(new InterfaceLoadForm);
+
+  CSCMatrix<double> element_matrix;
+  SimpleVector<double> element_rhs;
+  DiscreteProblem<double> dp(wf, space, true);
+  dp.assemble(&element_matrix, &element_rhs);
+
+  bool success = true;
+  int thread_counts[2] = { 1, 4 };
+  for (int i = 0; i < 2; i++)
+  {
+    HermesCommonApi.set_integral_param_value(numThreads, thread_counts[i]);
+    CSCMatrix<double> face_matrix;
+    SimpleVector<double> face_rhs(ndof);
+    face_rhs.zero();
+    DiscreteProblemFaceDGAssembler<double> face_assembler(wf, space);
+    face_assembler.create_sparse_structure(&face_matrix);
+    face_assembler.assemble(nullptr, &face_matrix, &face_rhs);
+    success = compare(element_matrix, element_rhs, face_matrix, face_rhs, ndof) && success;
+  }
+
+  return test_result(success);
+}
@@ -0,0 +1,88 @@
+// The meshes and the DOFs KellyAdaptSolver arrives at have to be those of the same loop written with Adapt
+// (solve, estimate by KellyErrorCalculator, Adapt::adapt() with a SmoothnessSelector).
+#include "test_problem.h"
+#include "adapt/kelly_adapt_solver.h"
+
+static const unsigned short adapt_steps = 4;
+
+// Stops after adapt_steps refinements.
+class FixedStepsCriterion : public AdaptSolverCriterion
+{
+public:
+  FixedStepsCriterion() : AdaptSolverCriterion() {}
+
+  virtual bool done(double, unsigned short iteration)
+  {
+    return iteration > adapt_steps;
+  }
+};
+
+// Same orders and assembly lists on the active elements (the meshes are compared by same_mesh()).
+static bool same_dofs(SpaceSharedPtr<double> a, SpaceSharedPtr<double> b)
+{
+  if (a->get_num_dofs() != b->get_num_dofs())
+    return false;
+  AsmList<double> al_a, al_b;
+  Element* e;
+  for_all_active_elements(e, a->get_mesh())
+  {
+    if (a->get_element_order(e->id) != b->get_element_order(e->id))
+      return false;
+    a->get_element_assembly_list(e, &al_a);
+    b->get_element_assembly_list(b->get_mesh()->get_element(e->id), &al_b);
+    if (al_a.cnt != al_b.cnt)
+      return false;
+    for (unsigned short i = 0; i < al_a.cnt; i++)
+      if (al_a.idx[i] != al_b.idx[i] || al_a.dof[i] != al_b.dof[i] || al_a.coef[i] != al_b.coef[i])
+        return false;
+  }
+  return true;
+}
+
+int main()
+{
+  bool success = true;
+  AdaptivityType adaptivity_types[2] = { hAdaptivity, hpAdaptivity };
+  for (int type = 0; type < 2; type++)
+  {
+    // KellyAdaptSolver.
+    SpaceSharedPtr<double> solver_space = peak_poisson_space(load_square_mesh(1), 2);
+    KellyErrorCalculator<double> solver_error_calculator(AbsoluteError, 1);
+    AdaptStoppingCriterionSingleElement<double> solver_stopping_criterion(0.5);
+    FixedStepsCriterion global_criterion;
+    KellyAdaptSolver<double, LinearSolver<double> > adapt_solver(solver_space, peak_poisson_weakform(), &solver_error_calculator, &solver_stopping_criterion, &global_criterion);
+    adapt_solver.set_verbose_output(false);
+    adapt_solver.solve(adaptivity_types[type]);
+
+    // The same loop with Adapt.
+    SpaceSharedPtr<double> space = peak_poisson_space(load_square_mesh(1), 2);
+    KellyErrorCalculator<double> error_calculator(AbsoluteError, 1);
+    AdaptStoppingCriterionSingleElement<double> stopping_criterion(0.5);
+    Adapt<double> adaptivity(space, &error_calculator, &stopping_criterion);
+    adaptivity.set_verbose_output(false);
+    RefinementSelectors::HOnlySelector<double> h_selector;
+    RefinementSelectors::SmoothnessSelector<double> smoothness_selector(space);
+    for (unsigned short step = 0; step < adapt_steps; step++)
+    {
+      LinearSolver<double> solver(peak_poisson_weakform(), space);
+      solver.set_verbose_output(false);
+      solver.solve();
+      MeshFunctionSharedPtr<double> sln(new Solution<double>);
+      Solution<double>::vector_to_solution(solver.get_sln_vector(), space, sln);
+      error_calculator.calculate_errors(sln, true);
+      smoothness_selector.set_coefficient_vector(solver.get_sln_vector());
+      if (adaptivity_types[type] == hAdaptivity)
+        adaptivity.adapt(&h_selector);
+      else
+        adaptivity.adapt(&smoothness_selector);
+    }
+
+    bool mesh_same = same_mesh(solver_space->get_mesh(), space->get_mesh());
+    bool dofs_same = mesh_same && same_dofs(solver_space, space);
+    printf("%s: %i elements, %i DOFs, mesh %s, DOFs %s.\n", type == 0 ? "h" : "hp", space->get_mesh()->get_num_active_elements(),
+      space->get_num_dofs(), mesh_same ? "same" : "differs", dofs_same ? "same" : "differ");
+    success = success && mesh_same && dofs_same;
+  }
+
+  return test_result(success);
+}
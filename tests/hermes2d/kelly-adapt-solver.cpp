@@ -0,0 +1,172 @@
+// KellyAdaptSolver has to converge without any reference space: the estimated error has to fall below the threshold
+// and the error against an overkill solution has to fall with it. SmoothnessSelector has to p-refine an element
+// on which the solution is analytic and h-refine the element at a corner singularity.
+#include "test_problem.h"
+#include "adapt/kelly_adapt_solver.h"
+
+// Stops at the threshold or after max_steps, records the estimated errors.
+class RecordingCriterion : public AdaptSolverCriterion
+{
+public:
+  RecordingCriterion(double threshold, unsigned short max_steps) : AdaptSolverCriterion(), threshold(threshold), max_steps(max_steps) {}
+
+  virtual bool done(double error, unsigned short iteration)
+  {
+    errors.push_back(error);
+    return error < threshold || iteration >= max_steps;
+  }
+
+  double threshold;
+  unsigned short max_steps;
+  std::vector<double> errors;
+};
+
+// exp(x + y) - analytic.
+class SmoothFunction : public ExactSolutionScalar<double>
+{
+public:
+  SmoothFunction(MeshSharedPtr mesh) : ExactSolutionScalar<double>(mesh) {}
+
+  virtual double value(double x, double y) const
+  {
+    return std::exp(x + y);
+  }
+
+  virtual void derivatives(double x, double y, double& dx, double& dy) const
+  {
+    dx = dy = std::exp(x + y);
+  }
+
+  virtual Ord ord(double, double) const
+  {
+    return Ord(10);
+  }
+
+  virtual MeshFunction<double>* clone() const
+  {
+    return new SmoothFunction(this->mesh);
+  }
+};
+
+// r^(2/3) - singular at the corner (0, 0).
+class CornerFunction : public ExactSolutionScalar<double>
+{
+public:
+  CornerFunction(MeshSharedPtr mesh) : ExactSolutionScalar<double>(mesh) {}
+
+  virtual double value(double x, double y) const
+  {
+    return std::pow(x * x + y * y, 1. / 3.);
+  }
+
+  virtual void derivatives(double x, double y, double& dx, double& dy) const
+  {
+    double r2 = std::max(x * x + y * y, 1e-300);
+    dx = 2. / 3. * x * std::pow(r2, -2. / 3.);
+    dy = 2. / 3. * y * std::pow(r2, -2. / 3.);
+  }
+
+  virtual Ord ord(double, double) const
+  {
+    return Ord(10);
+  }
+
+  virtual MeshFunction<double>* clone() const
+  {
+    return new CornerFunction(this->mesh);
+  }
+};
+
+// Exposes the refinement decision.
+class TestSmoothnessSelector : public RefinementSelectors::SmoothnessSelector<double>
+{
+public:
+  TestSmoothnessSelector(SpaceSharedPtr<double> space) : RefinementSelectors::SmoothnessSelector<double>(space) {}
+
+  int decide(Element* e)
+  {
+    ElementToRefine refinement(e->id, 0);
+    this->select_refinement(e, this->space->get_element_order(e->id), nullptr, refinement);
+    return refinement.split;
+  }
+};
+
+static MeshFunctionSharedPtr<double> solve(SpaceSharedPtr<double> space)
+{
+  LinearSolver<double> solver(peak_poisson_weakform(), space);
+  solver.set_verbose_output(false);
+  solver.solve();
+  MeshFunctionSharedPtr<double> sln(new Solution<double>);
+  Solution<double>::vector_to_solution(solver.get_sln_vector(), space, sln);
+  return sln;
+}
+
+static double h1_error(MeshFunctionSharedPtr<double> sln, MeshFunctionSharedPtr<double> reference)
+{
+  DefaultErrorCalculator<double, HERMES_H1_NORM> calculator(AbsoluteError, 1);
+  calculator.calculate_errors(sln, reference, false);
+  return std::sqrt(calculator.get_total_error_squared());
+}
+
+static bool check_adapt_loop()
+{
+  MeshFunctionSharedPtr<double> overkill = solve(peak_poisson_space(load_square_mesh(5), 5));
+
+  SpaceSharedPtr<double> space = peak_poisson_space(load_square_mesh(1), 2);
+  double initial_error = h1_error(solve(space), overkill);
+
+  KellyErrorCalculator<double> error_calculator(AbsoluteError, 1);
+  error_calculator.calculate_errors(solve(space), false);
+  double initial_estimate = std::sqrt(error_calculator.get_total_error_squared());
+
+  AdaptStoppingCriterionSingleElement<double> stopping_criterion(0.5);
+  RecordingCriterion global_criterion(0.1 * initial_estimate, 30);
+  KellyAdaptSolver<double, LinearSolver<double> > adapt_solver(space, peak_poisson_weakform(), &error_calculator, &stopping_criterion, &global_criterion);
+  adapt_solver.set_verbose_output(false);
+  adapt_solver.solve(hpAdaptivity);
+
+  double final_estimate = global_criterion.errors.back();
+  double final_error = h1_error(adapt_solver.get_sln(0), overkill);
+  printf("Adapt loop: %u steps, estimate %g -> %g, error against the overkill solution %g -> %g.\n",
+    (unsigned int)global_criterion.errors.size(), initial_estimate, final_estimate, initial_error, final_error);
+
+  return final_estimate < global_criterion.threshold && final_error < 0.5 * initial_error;
+}
+
+static bool check_selector()
+{
+  MeshSharedPtr mesh = load_square_mesh(2);
+  SpaceSharedPtr<double> space(new H1Space<double>(mesh, 4));
+  Element* corner = nullptr;
+  Element* e;
+  for_all_active_elements(e, mesh)
+    for (unsigned char i = 0; i < e->get_nvert(); i++)
+      if (e->vn[i]->x == 0. && e->vn[i]->y == 0.)
+        corner = e;
+
+  TestSmoothnessSelector selector(space);
+  std::vector<double> coefficients(space->get_num_dofs());
+
+  MeshFunctionSharedPtr<double> smooth(new SmoothFunction(mesh));
+  OGProjection<double>::project_global(space, smooth, &coefficients[0]);
+  selector.set_coefficient_vector(&coefficients[0]);
+  bool smooth_p = true;
+  for_all_active_elements(e, mesh)
+    smooth_p = smooth_p && selector.decide(e) == H2D_REFINEMENT_P;
+
+  MeshFunctionSharedPtr<double> singular(new CornerFunction(mesh));
+  OGProjection<double>::project_global(space, singular, &coefficients[0]);
+  double corner_smoothness = selector.get_smoothness(corner);
+  bool corner_h = selector.decide(corner) == H2D_REFINEMENT_H;
+
+  printf("Selector: analytic solution %s, corner singularity (decay %g) %s.\n", smooth_p ? "p-refined" : "h-refined somewhere",
+    corner_smoothness, corner_h ? "h-refined" : "p-refined");
+  return smooth_p && corner_h;
+}
+
+int main()
+{
+  bool success = check_adapt_loop();
+  success = check_selector() && success;
+  return test_result(success);
+}
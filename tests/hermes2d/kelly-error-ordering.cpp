@@ -0,0 +1,74 @@
+// The Kelly estimates have to order the elements the same way as the reference-space errors do.
+#include "test_problem.h"
+#include "adapt/kelly_error_calculator.h"
+#include <algorithm>
+
+// Ranks of the values (0 = smallest).
+static std::vector<double> ranks(const std::vector<double>& values)
+{
+  std::vector<int> order(values.size());
+  for (unsigned int i = 0; i < order.size(); i++)
+    order[i] = i;
+  std::sort(order.begin(), order.end(), [&values](int a, int b) { return values[a] < values[b]; });
+  std::vector<double> result(values.size());
+  for (unsigned int i = 0; i < order.size(); i++)
+    result[order[i]] = i;
+  return result;
+}
+
+static double rank_correlation(const std::vector<double>& a, const std::vector<double>& b)
+{
+  std::vector<double> ra = ranks(a), rb = ranks(b);
+  double n = a.size(), d2 = 0.;
+  for (unsigned int i = 0; i < ra.size(); i++)
+    d2 += (ra[i] - rb[i]) * (ra[i] - rb[i]);
+  return 1. - 6. * d2 / (n * (n * n - 1.));
+}
+
+int main()
+{
+  MeshSharedPtr mesh = load_square_mesh(3);
+  WeakFormSharedPtr<double> wf = peak_poisson_weakform();
+  SpaceSharedPtr<double> space = peak_poisson_space(mesh, 2);
+
+  NewtonSolver<double> newton(wf, space);
+  newton.set_verbose_output(false);
+  newton.solve();
+  MeshFunctionSharedPtr<double> sln(new Solution<double>);
+  Solution<double>::vector_to_solution(newton.get_sln_vector(), space, sln);
+
+  Mesh::ReferenceMeshCreator ref_mesh_creator(mesh);
+  MeshSharedPtr ref_mesh = ref_mesh_creator.create_ref_mesh();
+  Space<double>::ReferenceSpaceCreator ref_space_creator(space, ref_mesh);
+  SpaceSharedPtr<double> ref_space = ref_space_creator.create_ref_space();
+
+  NewtonSolver<double> ref_newton(wf, ref_space);
+  ref_newton.set_verbose_output(false);
+  ref_newton.solve();
+  MeshFunctionSharedPtr<double> ref_sln(new Solution<double>);
+  Solution<double>::vector_to_solution(ref_newton.get_sln_vector(), ref_space, ref_sln);
+
+  DefaultErrorCalculator<double, HERMES_H1_NORM> reference_calculator(AbsoluteError, 1);
+  reference_calculator.calculate_errors(sln, ref_sln, false);
+  KellyErrorCalculator<double> kelly_calculator(AbsoluteError, 1);
+  kelly_calculator.calculate_errors(sln, false);
+
+  std::vector<double> reference_errors, kelly_errors;
+  Element* e;
+  for_all_active_elements(e, mesh)
+  {
+    reference_errors.push_back(reference_calculator.get_element_error_squared(0, e->id));
+    kelly_errors.push_back(kelly_calculator.get_element_error_squared(0, e->id));
+  }
+
+  // The element with the largest estimate has to be among the worst quarter of the elements.
+  std::vector<double> reference_ranks = ranks(reference_errors);
+  int kelly_max = std::max_element(kelly_errors.begin(), kelly_errors.end()) - kelly_errors.begin();
+  bool success = reference_ranks[kelly_max] >= 0.75 * (reference_errors.size() - 1);
+
+  double correlation = rank_correlation(kelly_errors, reference_errors);
+  printf("Rank correlation of the Kelly estimates and the reference errors: %g\n", correlation);
+  success = success && correlation > 0.5;
+
+  return test_result(success);
+}
@@ -0,0 +1,66 @@
+// LinearizerMergedMesh: the vertices duplicated on the boundaries between the linearizer threads are removed,
+// so that the merged mesh does not depend on the number of threads. With one thread there are no duplicates,
+// with more threads there are some, and all of them are removed.
+#include "test_problem.h"
+#include <algorithm>
+
+using namespace Hermes::Hermes2D::Views;
+
+struct MergedMeshSummary
+{
+  int raw_vertex_count;
+  int duplicate_count;
+  int vertex_count;
+  int triangle_count;
+  double min_value, max_value;
+  std::vector<std::vector<double> > sorted_vertices;
+};
+
+static MergedMeshSummary merge(MeshFunctionSharedPtr<double> sln, int num_threads)
+{
+  HermesCommonApi.set_integral_param_value(numThreads, num_threads);
+  Linearizer linearizer(FileExport);
+  linearizer.process_solution(sln);
+  LinearizerMergedMesh<ScalarLinearizerDataDimensions<LINEARIZER_DATA_TYPE> > merged_mesh;
+  merged_mesh.merge(linearizer);
+
+  MergedMeshSummary summary;
+  summary.raw_vertex_count = linearizer.get_vertex_count();
+  summary.duplicate_count = merged_mesh.get_duplicate_count();
+  summary.vertex_count = merged_mesh.get_vertex_count();
+  summary.triangle_count = merged_mesh.get_triangle_count();
+  summary.min_value = merged_mesh.get_min_value();
+  summary.max_value = merged_mesh.get_max_value();
+  for (int i = 0; i < summary.vertex_count; i++)
+    summary.sorted_vertices.push_back(std::vector<double>(merged_mesh.get_vertices()[i], merged_mesh.get_vertices()[i] + 3));
+  std::sort(summary.sorted_vertices.begin(), summary.sorted_vertices.end());
+  return summary;
+}
+
+int main()
+{
+  MeshSharedPtr mesh = load_square_mesh(3);
+  WeakFormSharedPtr<double> wf = peak_poisson_weakform();
+  SpaceSharedPtr<double> space = peak_poisson_space(mesh, 2);
+
+  NewtonSolver<double> newton(wf, space);
+  newton.set_verbose_output(false);
+  newton.solve();
+  MeshFunctionSharedPtr<double> sln(new Solution<double>);
+  Solution<double>::vector_to_solution(newton.get_sln_vector(), space, sln);
+
+  MergedMeshSummary reference = merge(sln, 1);
+  printf("1 thread: %i vertices, %i duplicates.\n", reference.vertex_count, reference.duplicate_count);
+  bool success = reference.vertex_count > 0 && reference.duplicate_count == 0 && reference.vertex_count == reference.raw_vertex_count;
+  int thread_counts[3] = { 2, 3, 8 };
+  for (int i = 0; i < 3; i++)
+  {
+    MergedMeshSummary summary = merge(sln, thread_counts[i]);
+    printf("%i threads: %i vertices of the linearizer, %i duplicates, %i merged.\n", thread_counts[i], summary.raw_vertex_count, summary.duplicate_count, summary.vertex_count);
+    success = success && summary.duplicate_count > 0 && summary.raw_vertex_count - summary.duplicate_count == summary.vertex_count;
+    success = success && summary.vertex_count == reference.vertex_count && summary.triangle_count == reference.triangle_count
+      && summary.min_value == reference.min_value && summary.max_value == reference.max_value && summary.sorted_vertices == reference.sorted_vertices;
+  }
+
+  return test_result(success);
+}
@@ -0,0 +1,169 @@
+// LinearizerVTUWriter: the appended data has to lie where the offsets of the XML part say, each array as its UInt64 size
+// followed by the data, or compressed as the vtkZLibDataCompressor header (number of blocks, block size, size of the last
+// block, compressed sizes) followed by the blocks. The decoded arrays and the point and cell counts have to be those of
+// the linearizer.
+#include "test_problem.h"
+#include "views/linearizer_vtu.h"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+using namespace Hermes::Hermes2D::Views;
+
+typedef ScalarLinearizerDataDimensions<LINEARIZER_DATA_TYPE> Dimensions;
+
+static const char* filename = "linearizer-vtu.vtu";
+
+template<typename T>
+static void put(std::vector<char>& bytes, T value)
+{
+  const char* data = (const char*)&value;
+  bytes.insert(bytes.end(), data, data + sizeof(T));
+}
+
+// The arrays in the order of the file: values, markers, points, connectivity, offsets, types.
+static std::vector<std::vector<char> > expected_arrays(Linearizer& linearizer, bool mode_3D)
+{
+  std::vector<std::vector<char> > arrays(6);
+  for (Linearizer::Iterator<Dimensions::vertex_t> it = linearizer.vertices_begin(); !it.end; ++it)
+  {
+    Dimensions::vertex_t& vertex = it.get();
+    put<double>(arrays[0], vertex[2]);
+    put<double>(arrays[2], vertex[0]);
+    put<double>(arrays[2], vertex[1]);
+    put<double>(arrays[2], mode_3D ? vertex[2] : 0.);
+  }
+  int triangle = 0;
+  for (Linearizer::Iterator<triangle_indices_t> it = linearizer.triangle_indices_begin(); !it.end; ++it)
+  {
+    put<int>(arrays[1], it.get_marker());
+    for (int i = 0; i < 3; i++)
+      put<int>(arrays[3], it.get()[i]);
+    put<int>(arrays[4], 3 * ++triangle);
+    put<unsigned char>(arrays[5], 5);
+  }
+  return arrays;
+}
+
+static std::string read_file(const char* name)
+{
+  std::ifstream file(name, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// The integer attribute name="..." of the first element at or after position.
+static unsigned long long attribute(const std::string& content, size_t position, const char* name)
+{
+  size_t start = content.find(std::string(" ") + name + "=\"", position);
+  if (start == std::string::npos)
+    return (unsigned long long)-1;
+  return strtoull(content.c_str() + start + strlen(name) + 3, nullptr, 10);
+}
+
+static unsigned long long read_uint64(const std::string& content, size_t position)
+{
+  unsigned long long value = 0;
+  if (position + sizeof(value) <= content.size())
+    memcpy(&value, content.data() + position, sizeof(value));
+  return value;
+}
+
+// Decodes the array at position into data, returns the position after it (0 if the layout is broken).
+static size_t decode_array(const std::string& content, size_t position, bool compressed, unsigned int block_size, size_t expected_size, std::vector<char>& data)
+{
+  if (!compressed)
+  {
+    unsigned long long size = read_uint64(content, position);
+    position += sizeof(unsigned long long);
+    if (size != expected_size || position + size > content.size())
+      return 0;
+    data.assign(content.begin() + position, content.begin() + position + size);
+    return position + size;
+  }
+
+  unsigned long long blocks = read_uint64(content, position), header_block_size = read_uint64(content, position + 8), last_size = read_uint64(content, position + 16);
+  if (header_block_size != block_size || blocks != (expected_size + block_size - 1) / block_size || last_size != expected_size % block_size)
+    return 0;
+  size_t block_position = position + (3 + blocks) * sizeof(unsigned long long);
+  data.clear();
+  for (unsigned long long i = 0; i < blocks; i++)
+  {
+    unsigned long long compressed_size = read_uint64(content, position + (3 + i) * sizeof(unsigned long long));
+    if (block_position + compressed_size > content.size())
+      return 0;
+    uLongf size = (i == blocks - 1 && last_size != 0) ? (uLongf)last_size : (uLongf)block_size;
+    std::vector<char> block(size);
+    uLongf decoded_size = size;
+    if (uncompress((Bytef*)block.data(), &decoded_size, (const Bytef*)content.data() + block_position, (uLong)compressed_size) != Z_OK || decoded_size != size)
+      return 0;
+    data.insert(data.end(), block.begin(), block.end());
+    block_position += compressed_size;
+  }
+  return block_position;
+}
+
+static bool check(Linearizer& linearizer, bool compressed, bool mode_3D, unsigned int block_size)
+{
+  LinearizerVTUWriter<Dimensions> writer(compressed, mode_3D, block_size);
+  writer.save(linearizer, filename, "u");
+  std::string content = read_file(filename);
+  std::vector<std::vector<char> > expected = expected_arrays(linearizer, mode_3D);
+
+  int vertex_count = linearizer.get_vertex_count(), triangle_count = linearizer.get_triangle_index_count();
+  size_t piece = content.find("<Piece ");
+  bool success = piece != std::string::npos && vertex_count > 0 && triangle_count > 0;
+  success = success && attribute(content, piece, "NumberOfPoints") == (unsigned long long)vertex_count && attribute(content, piece, "NumberOfCells") == (unsigned long long)triangle_count;
+  success = success && (content.find("compressor=\"vtkZLibDataCompressor\"") != std::string::npos) == compressed;
+
+  const char* appended_tag = "<AppendedData encoding=\"raw\">\n_";
+  size_t appended_start = content.find(appended_tag);
+  success = success && appended_start != std::string::npos;
+  appended_start += strlen(appended_tag);
+
+  // The arrays follow each other without gaps, the last one is followed by the closing tag.
+  size_t element = 0, position = appended_start;
+  for (int i = 0; i < 6 && success; i++)
+  {
+    element = content.find("<DataArray ", element + 1);
+    unsigned long long offset = attribute(content, element, "offset");
+    std::vector<char> data;
+    success = element < appended_start && appended_start + offset == position;
+    position = success ? decode_array(content, position, compressed, block_size, expected[i].size(), data) : 0;
+    success = success && position != 0 && data == expected[i];
+  }
+  success = success && content.compare(position, 18, "\n  </AppendedData>") == 0;
+
+  // The indices refer to the points of the file.
+  for (Linearizer::Iterator<triangle_indices_t> it = linearizer.triangle_indices_begin(); !it.end && success; ++it)
+    for (int i = 0; i < 3; i++)
+      success = success && it.get()[i] >= 0 && it.get()[i] < vertex_count;
+
+  printf("VTU (%s, %s, blocks of %u B): %i points, %i cells, %s.\n", compressed ? "compressed" : "raw", mode_3D ? "3D" : "2D", block_size,
+    vertex_count, triangle_count, success ? "decoded as the linearizer data" : "not decoded as the linearizer data");
+  std::remove(filename);
+  return success;
+}
+
+int main()
+{
+  MeshSharedPtr mesh = load_square_mesh(3);
+  WeakFormSharedPtr<double> wf = peak_poisson_weakform();
+  SpaceSharedPtr<double> space = peak_poisson_space(mesh, 2);
+
+  NewtonSolver<double> newton(wf, space);
+  newton.set_verbose_output(false);
+  newton.solve();
+  MeshFunctionSharedPtr<double> sln(new Solution<double>);
+  Solution<double>::vector_to_solution(newton.get_sln_vector(), space, sln);
+
+  Linearizer linearizer(FileExport);
+  linearizer.process_solution(sln);
+
+  // Small blocks: several blocks per array, the last one partial.
+  bool success = check(linearizer, false, false, 1 << 20);
+  success = check(linearizer, false, true, 4096) && success;
+  success = check(linearizer, true, true, 4096) && success;
+  success = check(linearizer, true, false, 1 << 20) && success;
+
+  return test_result(success);
+}
@@ -0,0 +1,140 @@
+// LinearizerXDMFWriter: every step has to read back from the HDF5 file as the points, values, triangles and markers
+// of its linearizer (also when the datasets are written in several row blocks and compressed), and the XDMF file has
+// to describe the datasets with the counts of the linearizer.
+#include "test_problem.h"
+#include "views/linearizer_xdmf.h"
+#include <fstream>
+#include <iterator>
+
+using namespace Hermes::Hermes2D::Views;
+
+typedef ScalarLinearizerDataDimensions<LINEARIZER_DATA_TYPE> Dimensions;
+
+static const char* base = "linearizer-xdmf";
+
+struct StepData
+{
+  int vertex_count, triangle_count;
+  std::vector<double> points, values;
+  std::vector<int> triangles, markers;
+};
+
+static StepData expected_step(Linearizer& linearizer, bool mode_3D)
+{
+  StepData step;
+  step.vertex_count = linearizer.get_vertex_count();
+  step.triangle_count = linearizer.get_triangle_index_count();
+  for (Linearizer::Iterator<Dimensions::vertex_t> it = linearizer.vertices_begin(); !it.end; ++it)
+  {
+    Dimensions::vertex_t& vertex = it.get();
+    step.points.push_back(vertex[0]);
+    step.points.push_back(vertex[1]);
+    step.points.push_back(mode_3D ? vertex[2] : 0.);
+    step.values.push_back(vertex[2]);
+  }
+  for (Linearizer::Iterator<triangle_indices_t> it = linearizer.triangle_indices_begin(); !it.end; ++it)
+  {
+    for (int i = 0; i < 3; i++)
+      step.triangles.push_back(it.get()[i]);
+    step.markers.push_back(it.get_marker());
+  }
+  return step;
+}
+
+// Reads the two-dimensional dataset group/name, empty if it is missing or its dimensions are not rows x columns.
+template<typename T>
+static std::vector<T> read_dataset(hid_t file, const std::string& group, const char* name, hid_t type, int rows, int columns)
+{
+  std::vector<T> data;
+  hid_t dataset = H5Dopen2(file, (group + "/" + name).c_str(), H5P_DEFAULT);
+  if (dataset < 0)
+    return data;
+  hid_t space = H5Dget_space(dataset);
+  hsize_t dims[2] = { 0, 0 };
+  if (H5Sget_simple_extent_ndims(space) == 2 && H5Sget_simple_extent_dims(space, dims, nullptr) == 2 && dims[0] == (hsize_t)rows && dims[1] == (hsize_t)columns)
+  {
+    data.resize(rows * columns);
+    if (H5Dread(dataset, type, H5S_ALL, H5S_ALL, H5P_DEFAULT, data.data()) < 0)
+      data.clear();
+  }
+  H5Sclose(space);
+  H5Dclose(dataset);
+  return data;
+}
+
+static bool contains(const std::string& content, const std::string& text)
+{
+  return content.find(text) != std::string::npos;
+}
+
+static bool check(const std::vector<Linearizer*>& linearizers, bool compress, bool mode_3D, unsigned int rows)
+{
+  std::vector<StepData> steps;
+  {
+    LinearizerXDMFWriter<Dimensions> writer(base, compress, mode_3D, rows);
+    for (unsigned int i = 0; i < linearizers.size(); i++)
+    {
+      writer.add(*linearizers[i], 0.5 * i, "u");
+      steps.push_back(expected_step(*linearizers[i], mode_3D));
+    }
+  }
+
+  hid_t file = H5Fopen((std::string(base) + ".h5").c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+  bool success = file >= 0;
+  std::ifstream xdmf_file((std::string(base) + ".xmf").c_str());
+  std::string xdmf((std::istreambuf_iterator<char>(xdmf_file)), std::istreambuf_iterator<char>());
+  for (unsigned int i = 0; i < steps.size() && success; i++)
+  {
+    const StepData& step = steps[i];
+    char group[32], dimensions[64];
+    sprintf(group, "step_%u", i);
+    success = step.vertex_count > 0 && step.triangle_count > 0;
+    success = success && read_dataset<double>(file, group, "points", H5T_NATIVE_DOUBLE, step.vertex_count, 3) == step.points;
+    success = success && read_dataset<double>(file, group, "values", H5T_NATIVE_DOUBLE, step.vertex_count, 1) == step.values;
+    success = success && read_dataset<int>(file, group, "triangles", H5T_NATIVE_INT, step.triangle_count, 3) == step.triangles;
+    success = success && read_dataset<int>(file, group, "markers", H5T_NATIVE_INT, step.triangle_count, 1) == step.markers;
+
+    sprintf(dimensions, "NumberOfElements=\"%i\"", step.triangle_count);
+    success = success && contains(xdmf, dimensions);
+    sprintf(dimensions, "Dimensions=\"%i 3\" NumberType=\"Float\"", step.vertex_count);
+    success = success && contains(xdmf, dimensions) && contains(xdmf, std::string(base) + ".h5:/" + group + "/points");
+  }
+  if (file >= 0)
+    H5Fclose(file);
+
+  printf("XDMF (%s, %s, rows of %u): %u steps %s.\n", compress ? "compressed" : "raw", mode_3D ? "3D" : "2D", rows, (unsigned int)steps.size(),
+    success ? "read back as the linearizer data" : "not read back as the linearizer data");
+  std::remove((std::string(base) + ".h5").c_str());
+  std::remove((std::string(base) + ".xmf").c_str());
+  return success;
+}
+
+static MeshFunctionSharedPtr<double> solve(int refinements)
+{
+  MeshSharedPtr mesh = load_square_mesh(refinements);
+  SpaceSharedPtr<double> space = peak_poisson_space(mesh, 2);
+  NewtonSolver<double> newton(peak_poisson_weakform(), space);
+  newton.set_verbose_output(false);
+  newton.solve();
+  MeshFunctionSharedPtr<double> sln(new Solution<double>);
+  Solution<double>::vector_to_solution(newton.get_sln_vector(), space, sln);
+  return sln;
+}
+
+int main()
+{
+  // Two steps of different sizes.
+  Linearizer coarse(FileExport), fine(FileExport);
+  coarse.process_solution(solve(2));
+  fine.process_solution(solve(3));
+  std::vector<Linearizer*> linearizers;
+  linearizers.push_back(&coarse);
+  linearizers.push_back(&fine);
+
+  // Few rows: several hyperslabs per dataset, the last one partial.
+  bool success = check(linearizers, false, false, 1 << 16);
+  success = check(linearizers, false, true, 100) && success;
+  success = check(linearizers, true, false, 100) && success;
+
+  return test_result(success);
+}
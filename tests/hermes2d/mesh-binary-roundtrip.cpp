@@ -0,0 +1,22 @@
+// MeshReaderH2DBinary: a mesh saved in the binary format (to a file and to a memory buffer)
+// loads back to the mesh the text reader produced, including the refinements.
+#include "test_problem.h"
+
+int main()
+{
+  MeshSharedPtr mesh = load_square_mesh(1);
+  mesh->refine_element_id(1);
+  mesh->refine_element_id(2, 1);
+  mesh->refine_element_id(5);
+
+  MeshReaderH2DBinary binary_loader;
+  std::vector<char> buffer;
+  binary_loader.save(mesh, buffer);
+  binary_loader.save("square.h2db", mesh);
+
+  MeshSharedPtr from_buffer(new Mesh), from_file(new Mesh);
+  binary_loader.load(buffer.data(), buffer.size(), from_buffer);
+  binary_loader.load("square.h2db", from_file);
+
+  return test_result(same_mesh(mesh, from_buffer) && same_mesh(mesh, from_file));
+}
@@ -0,0 +1,23 @@
+// MeshReaderH2DXMLStream: an XML mesh file loads to the same mesh as with the DOM reader (MeshReaderH2DXML)
+// and as the text mesh the file was saved from, including the refinements.
+#include "test_problem.h"
+
+int main()
+{
+  MeshSharedPtr mesh = load_square_mesh(1);
+  mesh->refine_element_id(1);
+  mesh->refine_element_id(2, 1);
+  mesh->refine_element_id(5);
+
+  MeshReaderH2DXML xml_loader;
+  xml_loader.set_validation(false);
+  xml_loader.save("square.xml", mesh);
+
+  MeshSharedPtr dom_mesh(new Mesh), stream_mesh(new Mesh);
+  xml_loader.load("square.xml", dom_mesh);
+  MeshReaderH2DXMLStream stream_loader;
+  stream_loader.set_validation(false);
+  stream_loader.load("square.xml", stream_mesh);
+
+  return test_result(same_mesh(mesh, stream_mesh) && same_mesh(dom_mesh, stream_mesh));
+}
@@ -0,0 +1,137 @@
+// JacobianFreeNewtonSolver, InexactNewtonSolver and FactorizationReuseNewtonSolver have to converge to the solution
+// of NewtonSolver on the same nonlinear problem. InexactNewtonSolver (with an iterative linear solver) has to keep
+// its forcing terms within the bounds and need fewer linear iterations than with the tight tolerance in all steps.
+#include "test_problem.h"
+
+// Thermal conductivity 1 + u^2.
+class NonlinearConductivity : public Hermes1DFunction<double>
+{
+public:
+  NonlinearConductivity() : Hermes1DFunction<double>() {}
+
+  virtual double value(double u) const
+  {
+    return 1. + u * u;
+  }
+
+  virtual Ord value(Ord u) const
+  {
+    return u * u;
+  }
+
+  virtual double derivative(double u) const
+  {
+    return 2. * u;
+  }
+
+  virtual Ord derivative(Ord u) const
+  {
+    return u;
+  }
+};
+
+static const double tolerance = 1e-10;
+
+template<typename SolverType>
+static void configure(SolverType& solver)
+{
+  solver.set_verbose_output(false);
+  solver.set_tolerance(tolerance, ResidualNormAbsolute);
+  solver.set_max_allowed_iterations(50);
+}
+
+static const double eta_min = 1e-8, eta_max = 0.5;
+
+static void configure_iterative(InexactNewtonSolver<double>& solver)
+{
+  IterSolver<double>* iterative_solver = dynamic_cast<IterSolver<double>*>(solver.get_linear_matrix_solver());
+  iterative_solver->set_solver_type(GMRES);
+  iterative_solver->set_max_iters(10000);
+}
+
+static unsigned int sum(const std::vector<unsigned int>& values)
+{
+  unsigned int result = 0;
+  for (unsigned int i = 0; i < values.size(); i++)
+    result += values[i];
+  return result;
+}
+
+// One forcing term and one linear iterations count per Newton step, the forcing terms within the bounds.
+static bool check_forcing_terms(const InexactNewtonSolver<double>& solver)
+{
+  const std::vector<double>& forcing_terms = solver.get_forcing_terms();
+  const std::vector<unsigned int>& linear_iterations = solver.get_linear_iterations();
+  bool success = !forcing_terms.empty() && forcing_terms.size() == linear_iterations.size();
+  for (unsigned int i = 0; i < forcing_terms.size(); i++)
+  {
+    printf("InexactNewtonSolver: step %u, forcing term %g, %u linear iterations\n", i + 1, forcing_terms[i], linear_iterations[i]);
+    success = success && forcing_terms[i] >= eta_min && forcing_terms[i] <= eta_max && linear_iterations[i] > 0;
+  }
+  return success;
+}
+
+static bool compare(const char* name, const double* solution, const double* reference, int ndof)
+{
+  double max_difference = 0., max_value = 0.;
+  for (int i = 0; i < ndof; i++)
+  {
+    max_difference = std::max(max_difference, std::abs(solution[i] - reference[i]));
+    max_value = std::max(max_value, std::abs(reference[i]));
+  }
+  printf("%s: maximum difference from NewtonSolver %g (maximum coefficient %g)\n", name, max_difference, max_value);
+  return max_value > 0. && max_difference <= 1e-6 * max_value;
+}
+
+int main()
+{
+  MeshSharedPtr mesh = load_square_mesh(3);
+  WeakFormSharedPtr<double> wf(new WeakFormsH1::DefaultWeakFormPoisson<double>(HERMES_ANY, new NonlinearConductivity, new PeakSource));
+  SpaceSharedPtr<double> space = peak_poisson_space(mesh, 2);
+  int ndof = space->get_num_dofs();
+
+  NewtonSolver<double> newton(wf, space);
+  configure(newton);
+  newton.solve();
+  std::vector<double> reference(newton.get_sln_vector(), newton.get_sln_vector() + ndof);
+
+  bool success = true;
+
+  JacobianFreeNewtonSolver<double> jfnk(wf, space);
+  configure(jfnk);
+  jfnk.set_jfnk_preconditioner_refresh(3);
+  jfnk.set_jfnk_krylov_parameters(1e-8, 500, 50);
+  jfnk.solve();
+  success = compare("JacobianFreeNewtonSolver", jfnk.get_sln_vector(), reference.data(), ndof) && success;
+
+  // The forcing terms are applied only to an iterative linear solver.
+  int matrix_solver_type = HermesCommonApi.get_integral_param_value(matrixSolverType);
+  HermesCommonApi.set_integral_param_value(matrixSolverType, SOLVER_PARALUTION_ITERATIVE);
+  InexactNewtonSolver<double> inexact(wf, space);
+  configure(inexact);
+  configure_iterative(inexact);
+  inexact.set_forcing_term_bounds(eta_min, eta_max);
+  inexact.solve();
+  success = compare("InexactNewtonSolver", inexact.get_sln_vector(), reference.data(), ndof) && success;
+  success = check_forcing_terms(inexact) && success;
+
+  // The same with the tight linear tolerance in all steps.
+  InexactNewtonSolver<double> exact(wf, space);
+  configure(exact);
+  configure_iterative(exact);
+  exact.set_adaptive_linear_tolerance(false);
+  dynamic_cast<LoopSolver<double>*>(exact.get_linear_matrix_solver())->set_tolerance(eta_min, RelativeTolerance);
+  exact.solve();
+  HermesCommonApi.set_integral_param_value(matrixSolverType, matrix_solver_type);
+  unsigned int inexact_iterations = sum(inexact.get_linear_iterations()), exact_iterations = sum(exact.get_linear_iterations());
+  printf("InexactNewtonSolver: %u linear iterations, %u with the tolerance %g in all steps\n", inexact_iterations, exact_iterations, eta_min);
+  success = success && inexact_iterations > 0 && inexact_iterations < exact_iterations;
+
+  FactorizationReuseNewtonSolver<double> reuse(wf, space);
+  configure(reuse);
+  reuse.set_numeric_factorization_reuse(3);
+  reuse.solve();
+  success = compare("FactorizationReuseNewtonSolver", reuse.get_sln_vector(), reference.data(), ndof) && success;
+
+  return test_result(success);
+}
@@ -0,0 +1,95 @@
+// RungeKuttaStageSolver has to reproduce RungeKutta on the heat equation u' = \Delta u + 1, for a diagonally implicit
+// and a fully implicit table. The stage matrix has to be factorized once per time step for the SDIRK table (all stages
+// share a_ii), once per step for the coupled Radau IIA system, and only once at all with a constant Jacobian.
+// The problem is linear, so the Newton loops of both solvers converge in one iteration.
+#include "test_problem.h"
+
+static const int steps = 5;
+static const double time_step = 0.01;
+static const double newton_tolerance = 1e-10;
+
+// F(u) = \Delta u + 1, i.e. the residual of -div(-1 grad u) - (-1) = 0.
+static WeakFormSharedPtr<double> heat_weakform()
+{
+  return WeakFormSharedPtr<double>(new WeakFormsH1::DefaultWeakFormPoisson<double>(HERMES_ANY, new Hermes1DFunction<double>(-1.0), new Hermes2DFunction<double>(-1.0)));
+}
+
+static std::vector<double> coefficients(SpaceSharedPtr<double> space, MeshFunctionSharedPtr<double> sln)
+{
+  std::vector<double> result(space->get_num_dofs());
+  OGProjection<double>::project_global(space, sln, result.data());
+  return result;
+}
+
+static std::vector<double> run_runge_kutta(SpaceSharedPtr<double> space, ButcherTable& bt)
+{
+  RungeKutta<double> runge_kutta(heat_weakform(), space, &bt);
+  runge_kutta.set_verbose_output(false);
+  runge_kutta.set_time_step(time_step);
+
+  MeshFunctionSharedPtr<double> sln_prev(new ZeroSolution<double>(space->get_mesh()));
+  for (int step = 0; step < steps; step++)
+  {
+    MeshFunctionSharedPtr<double> sln_new(new Solution<double>);
+    runge_kutta.set_time(step * time_step);
+    runge_kutta.rk_time_step_newton(sln_prev, sln_new);
+    sln_prev = sln_new;
+  }
+  return coefficients(space, sln_prev);
+}
+
+static std::vector<double> run_stage_solver(SpaceSharedPtr<double> space, ButcherTable& bt, bool constant_jacobian, unsigned int& num_factorizations)
+{
+  RungeKuttaStageSolver<double> stage_solver(heat_weakform(), space, &bt);
+  stage_solver.set_verbose_output(false);
+  stage_solver.set_newton_tolerance(newton_tolerance);
+  stage_solver.set_constant_jacobian(constant_jacobian);
+  stage_solver.set_time_step(time_step);
+
+  MeshFunctionSharedPtr<double> sln_prev(new ZeroSolution<double>(space->get_mesh()));
+  for (int step = 0; step < steps; step++)
+  {
+    MeshFunctionSharedPtr<double> sln_new(new Solution<double>);
+    stage_solver.set_time(step * time_step);
+    stage_solver.rk_time_step_newton(sln_prev, sln_new);
+    sln_prev = sln_new;
+  }
+  num_factorizations = stage_solver.get_num_factorizations();
+  return coefficients(space, sln_prev);
+}
+
+static bool compare(const char* name, const std::vector<double>& solution, const std::vector<double>& reference)
+{
+  double max_difference = 0., max_value = 0.;
+  for (unsigned int i = 0; i < reference.size(); i++)
+  {
+    max_difference = std::max(max_difference, std::abs(solution[i] - reference[i]));
+    max_value = std::max(max_value, std::abs(reference[i]));
+  }
+  printf("%s: maximum difference from RungeKutta %g (maximum coefficient %g)\n", name, max_difference, max_value);
+  return max_value > 0. && max_difference <= 1e-6 * max_value;
+}
+
+int main()
+{
+  SpaceSharedPtr<double> space = peak_poisson_space(load_square_mesh(3), 2);
+  bool success = true;
+
+  ButcherTable sdirk(Implicit_SDIRK_2_2);
+  std::vector<double> reference = run_runge_kutta(space, sdirk);
+  unsigned int num_factorizations;
+  success = compare("SDIRK-2-2", run_stage_solver(space, sdirk, false, num_factorizations), reference) && success;
+  printf("SDIRK-2-2: %u factorizations in %i steps\n", num_factorizations, steps);
+  success = success && num_factorizations == (unsigned int)steps;
+  success = compare("SDIRK-2-2, constant Jacobian", run_stage_solver(space, sdirk, true, num_factorizations), reference) && success;
+  printf("SDIRK-2-2, constant Jacobian: %u factorizations in %i steps\n", num_factorizations, steps);
+  success = success && num_factorizations == 1;
+
+  ButcherTable radau(Implicit_Radau_IIA_3_5);
+  reference = run_runge_kutta(space, radau);
+  success = compare("Radau IIA-3-5", run_stage_solver(space, radau, false, num_factorizations), reference) && success;
+  printf("Radau IIA-3-5: %u factorizations in %i steps\n", num_factorizations, steps);
+  success = success && num_factorizations == (unsigned int)steps;
+
+  return test_result(success);
+}
@@ -0,0 +1,180 @@
+// SolutionOutputQueue: add() has to block while the pending snapshots fill the buffer (in number or in bytes) and
+// continue once a snapshot is written, flush() has to return only after all snapshots are written, and an error of
+// a background thread (an exception while writing, a space or mesh changed before the output was written) has to be
+// thrown by the next flush() without stopping the queue.
+#include "test_problem.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Holds the background threads in write() until open() is called, throws from write() if failing is set.
+class GatedQueue : public Views::SolutionOutputQueue<double>
+{
+public:
+  GatedQueue(int max_pending, size_t max_pending_bytes) : Views::SolutionOutputQueue<double>(1, max_pending, max_pending_bytes), failing(false), opened(false) {}
+
+  virtual ~GatedQueue()
+  {
+    this->open();
+    try
+    {
+      this->flush();
+    }
+    catch (Exceptions::Exception&)
+    {
+    }
+  }
+
+  void open()
+  {
+    {
+      std::lock_guard<std::mutex> lock(this->gate_mutex);
+      this->opened = true;
+    }
+    this->gate.notify_all();
+  }
+
+  std::atomic<bool> failing;
+
+protected:
+  virtual void write(Snapshot* snapshot)
+  {
+    {
+      std::unique_lock<std::mutex> lock(this->gate_mutex);
+      this->gate.wait(lock, [this]() { return this->opened; });
+    }
+    if (this->failing)
+      throw Exceptions::Exception("Failing on purpose.");
+    Views::SolutionOutputQueue<double>::write(snapshot);
+  }
+
+  std::mutex gate_mutex;
+  std::condition_variable gate;
+  bool opened;
+};
+
+static bool exists(const char* filename)
+{
+  FILE* file = fopen(filename, "r");
+  if (file)
+    fclose(file);
+  return file != nullptr;
+}
+
+static std::string filename(int i)
+{
+  char buffer[64];
+  sprintf(buffer, "output-queue-%i.xml", i);
+  return buffer;
+}
+
+static void remove_files()
+{
+  for (int i = 0; i < 5; i++)
+    std::remove(filename(i).c_str());
+}
+
+// The third add() has to wait for the gate, the limit being max_pending = 2 or max_pending_bytes of two snapshots.
+static bool check_back_pressure(SpaceSharedPtr<double> space, const std::vector<double>& coefficients, bool bytes_limit)
+{
+  remove_files();
+  size_t snapshot_bytes = coefficients.size() * sizeof(double);
+  GatedQueue queue(bytes_limit ? 10 : 2, bytes_limit ? 2 * snapshot_bytes : 256 * 1024 * 1024);
+  queue.add(space, coefficients.data(), Views::SolutionOutputXML, filename(0).c_str());
+  queue.add(space, coefficients.data(), Views::SolutionOutputXML, filename(1).c_str());
+  bool free_adds = queue.get_num_blocked_adds() == 0;
+
+  std::atomic<bool> third_added(false);
+  std::string third = filename(2);
+  std::thread adding([&]() {
+    queue.add(space, coefficients.data(), Views::SolutionOutputXML, third.c_str());
+    third_added = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  bool blocked = !third_added && queue.get_num_written() == 0;
+
+  queue.open();
+  adding.join();
+  queue.flush();
+  bool written = queue.get_num_written() == 3 && queue.get_num_blocked_adds() == 1;
+  for (int i = 0; i < 3; i++)
+    written = written && exists(filename(i).c_str());
+
+  printf("Back-pressure (%s limit): %s, %s, %s.\n", bytes_limit ? "bytes" : "snapshots", free_adds ? "two adds free" : "two adds blocked",
+    blocked ? "the third one blocked" : "the third one not blocked", written ? "all written after flush()" : "not all written after flush()");
+  return free_adds && blocked && written;
+}
+
+static bool flush_throws(Views::SolutionOutputQueue<double>& queue)
+{
+  try
+  {
+    queue.flush();
+  }
+  catch (Exceptions::Exception& e)
+  {
+    printf("  flush(): %s\n", e.what());
+    return true;
+  }
+  return false;
+}
+
+// Errors of the background threads: thrown once by flush(), the other snapshots written.
+static bool check_errors(MeshSharedPtr mesh, SpaceSharedPtr<double> space, const std::vector<double>& coefficients)
+{
+  remove_files();
+  GatedQueue queue(4, 256 * 1024 * 1024);
+  queue.open();
+
+  // An exception in write().
+  queue.failing = true;
+  queue.add(space, coefficients.data(), Views::SolutionOutputXML, filename(0).c_str());
+  bool thrown = flush_throws(queue);
+  queue.failing = false;
+  queue.add(space, coefficients.data(), Views::SolutionOutputXML, filename(1).c_str());
+  bool cleared = !flush_throws(queue) && exists(filename(1).c_str());
+
+  // A file that cannot be created, next to one that can.
+  queue.add(space, coefficients.data(), Views::SolutionOutputVTK, "no-such-directory/output-queue.vtk", "u");
+  queue.add(space, coefficients.data(), Views::SolutionOutputXML, filename(2).c_str());
+  bool io_thrown = flush_throws(queue) && exists(filename(2).c_str());
+
+  printf("Errors: exception in write() %s and %s, unwritable file %s.\n", thrown ? "thrown" : "not thrown", cleared ? "cleared" : "not cleared",
+    io_thrown ? "thrown, the other snapshot written" : "not thrown");
+  bool success = thrown && cleared && io_thrown;
+
+  // The space and the mesh changed while the snapshot was pending.
+  GatedQueue space_queue(4, 256 * 1024 * 1024);
+  space_queue.add(space, coefficients.data(), Views::SolutionOutputXML, filename(3).c_str());
+  space->set_uniform_order(3);
+  space_queue.open();
+  bool space_change = flush_throws(space_queue) && !exists(filename(3).c_str());
+
+  std::vector<double> new_coefficients(space->get_num_dofs(), 1.);
+  GatedQueue mesh_queue(4, 256 * 1024 * 1024);
+  mesh_queue.add(space, new_coefficients.data(), Views::SolutionOutputXML, filename(4).c_str());
+  mesh->refine_all_elements();
+  mesh_queue.open();
+  bool mesh_change = flush_throws(mesh_queue) && !exists(filename(4).c_str());
+
+  printf("Errors: space change %s, mesh change %s.\n", space_change ? "detected" : "not detected", mesh_change ? "detected" : "not detected");
+  return success && space_change && mesh_change;
+}
+
+int main()
+{
+  MeshSharedPtr mesh = load_square_mesh(3);
+  SpaceSharedPtr<double> space = peak_poisson_space(mesh, 2);
+  std::vector<double> coefficients(space->get_num_dofs());
+  for (unsigned int i = 0; i < coefficients.size(); i++)
+    coefficients[i] = std::sin(0.1 * i);
+
+  bool success = check_back_pressure(space, coefficients, false);
+  success = check_back_pressure(space, coefficients, true) && success;
+  success = check_errors(mesh, space, coefficients) && success;
+  remove_files();
+
+  return test_result(success);
+}
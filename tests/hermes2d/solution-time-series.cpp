@@ -0,0 +1,63 @@
+// SolutionTimeSeriesWriter / SolutionTimeSeriesReader: every step reads back bit-exactly, with and without
+// the delta and the compression, in order and by random access across the keyframes.
+#include "test_problem.h"
+#include "function/solution_time_series.h"
+
+static std::vector<double> step_coefficients(int ndof, int step)
+{
+  std::vector<double> coefficients(ndof);
+  for (int i = 0; i < ndof; i++)
+    coefficients[i] = std::sin(0.01 * i) + 1e-3 * step * std::cos(0.02 * i);
+  // Some steps repeat the previous one exactly (a zero delta).
+  if (step % 5 == 4)
+    return step_coefficients(ndof, step - 1);
+  return coefficients;
+}
+
+static bool roundtrip(SpaceSharedPtr<double> space, bool delta, bool compress)
+{
+  const char* filename = "series.h2dts";
+  const int step_count = 40, keyframe_interval = 8;
+  int ndof = space->get_num_dofs();
+  {
+    SolutionTimeSeriesWriter<double> writer(filename, std::vector<SpaceSharedPtr<double> >(1, space), delta, compress, keyframe_interval);
+    for (int step = 0; step < step_count; step++)
+    {
+      writer.add(0.1 * step, step_coefficients(ndof, step).data());
+      // New steps overwrite the index written by flush().
+      if (step == step_count / 2)
+        writer.flush();
+    }
+  }
+
+  SolutionTimeSeriesReader<double> reader(filename);
+  if (reader.get_step_count() != step_count || reader.get_num_dofs() != ndof)
+    return false;
+  MeshSharedPtr mesh(new Mesh);
+  reader.load_meshes(std::vector<MeshSharedPtr>(1, mesh));
+  if (!same_mesh(space->get_mesh(), mesh) || reader.load_spaces(std::vector<MeshSharedPtr>(1, mesh))[0]->get_num_dofs() != ndof)
+    return false;
+
+  // Random access (in the middle of a keyframe interval, backwards), then in order.
+  int steps[3] = { 37, 3, 12 };
+  for (int i = 0; i < 3; i++)
+    if (reader.load_coefficient_vector(steps[i]) != step_coefficients(ndof, steps[i]) || reader.get_time(steps[i]) != 0.1 * steps[i])
+      return false;
+  for (int step = 0; step < step_count; step++)
+    if (reader.load_coefficient_vector(step) != step_coefficients(ndof, step))
+      return false;
+  return true;
+}
+
+int main()
+{
+  MeshSharedPtr mesh = load_square_mesh(3);
+  SpaceSharedPtr<double> space = peak_poisson_space(mesh, 3);
+
+  bool success = true;
+  for (int delta = 0; delta < 2; delta++)
+    for (int compress = 0; compress < 2; compress++)
+      success = roundtrip(space, delta == 1, compress == 1) && success;
+
+  return test_result(success);
+}
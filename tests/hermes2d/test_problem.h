@@ -0,0 +1,83 @@
+// Common setup of the behavior tests: the unit square mesh and a Poisson problem with a localized source.
+#ifndef __H2D_TEST_PROBLEM_H
+#define __H2D_TEST_PROBLEM_H
+
+#include "hermes2d.h"
+#include <cstdio>
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+
+/// The unit square (tests/data/square.mesh), uniformly refined.
+inline MeshSharedPtr load_square_mesh(int refinements)
+{
+  MeshSharedPtr mesh(new Mesh);
+  MeshReaderH2D mloader;
+  mloader.load(TEST_DATA_DIR "/square.mesh", mesh);
+  for (int i = 0; i < refinements; i++)
+    mesh->refine_all_elements();
+  return mesh;
+}
+
+/// Source term peaked around (0.25, 0.25), so that the errors differ strongly between the elements.
+class PeakSource : public Hermes2DFunction<double>
+{
+public:
+  PeakSource() : Hermes2DFunction<double>() {}
+
+  virtual double value(double x, double y) const
+  {
+    return 1e3 * std::exp(-100. * ((x - 0.25) * (x - 0.25) + (y - 0.25) * (y - 0.25)));
+  }
+
+  virtual Ord value(Ord, Ord) const
+  {
+    return Ord(10);
+  }
+};
+
+/// -\Delta u = PeakSource with zero Dirichlet conditions.
+inline WeakFormSharedPtr<double> peak_poisson_weakform()
+{
+  return WeakFormSharedPtr<double>(new WeakFormsH1::DefaultWeakFormPoisson<double>(HERMES_ANY, new Hermes1DFunction<double>(1.0), new PeakSource));
+}
+
+inline SpaceSharedPtr<double> peak_poisson_space(MeshSharedPtr mesh, int p_init)
+{
+  static DefaultEssentialBCConst<double> bc("Bdy", 0.0);
+  static EssentialBCs<double> bcs(&bc);
+  return SpaceSharedPtr<double>(new H1Space<double>(mesh, &bcs, p_init));
+}
+
+/// True if both meshes have the same active elements (ids, vertices, element and boundary markers).
+inline bool same_mesh(MeshSharedPtr a, MeshSharedPtr b)
+{
+  if (a->get_num_active_elements() != b->get_num_active_elements() || a->get_max_element_id() != b->get_max_element_id())
+    return false;
+  Element* e;
+  for_all_active_elements(e, a)
+  {
+    Element* other = b->get_element(e->id);
+    if (!other->active || other->get_nvert() != e->get_nvert() || other->is_curved() != e->is_curved())
+      return false;
+    if (a->get_element_markers_conversion().get_user_marker(e->marker).marker != b->get_element_markers_conversion().get_user_marker(other->marker).marker)
+      return false;
+    for (unsigned char i = 0; i < e->get_nvert(); i++)
+    {
+      if (e->vn[i]->x != other->vn[i]->x || e->vn[i]->y != other->vn[i]->y || e->en[i]->bnd != other->en[i]->bnd)
+        return false;
+      if (e->en[i]->bnd && a->get_boundary_markers_conversion().get_user_marker(e->en[i]->marker).marker != b->get_boundary_markers_conversion().get_user_marker(other->en[i]->marker).marker)
+        return false;
+    }
+  }
+  return true;
+}
+
+/// Prints the outcome the same way as the Hermes tests do, returns the exit code.
+inline int test_result(bool success)
+{
+  printf(success ? "Success!\n" : "Failure!\n");
+  return success ? 0 : -1;
+}
+
+#endif
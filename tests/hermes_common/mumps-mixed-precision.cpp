@@ -0,0 +1,144 @@
+// MixedPrecisionMumpsSolver has to reach the solution of the double precision MUMPS solver in a few refinement
+// iterations on a well-conditioned matrix. On a matrix too ill-conditioned for the single precision factorization
+// the refinement does not converge, and the iterate with the smallest residual has to be returned.
+#include "hermes_common.h"
+#include <cstdio>
+#include <vector>
+
+using namespace Hermes;
+using namespace Hermes::Algebra;
+using namespace Hermes::Solvers;
+
+struct Entry
+{
+  int row, col;
+  double val;
+};
+
+// Five-point Laplacian on a grid x grid grid.
+static std::vector<Entry> laplacian(int grid)
+{
+  std::vector<Entry> entries;
+  for (int i = 0; i < grid; i++)
+    for (int j = 0; j < grid; j++)
+    {
+      int row = i * grid + j;
+      Entry diagonal = { row, row, 4. };
+      entries.push_back(diagonal);
+      int neighbors[4] = { i > 0 ? row - grid : -1, i < grid - 1 ? row + grid : -1, j > 0 ? row - 1 : -1, j < grid - 1 ? row + 1 : -1 };
+      for (int k = 0; k < 4; k++)
+        if (neighbors[k] >= 0)
+        {
+          Entry entry = { row, neighbors[k], -1. };
+          entries.push_back(entry);
+        }
+    }
+  return entries;
+}
+
+// Hilbert matrix - condition number 1.6e13 for n = 10.
+static std::vector<Entry> hilbert(int n)
+{
+  std::vector<Entry> entries;
+  for (int i = 0; i < n; i++)
+    for (int j = 0; j < n; j++)
+    {
+      Entry entry = { i, j, 1. / (i + j + 1) };
+      entries.push_back(entry);
+    }
+  return entries;
+}
+
+static void fill(SparseMatrix<double>* matrix, Vector<double>* rhs, int n, const std::vector<Entry>& entries)
+{
+  matrix->prealloc(n);
+  for (unsigned int i = 0; i < entries.size(); i++)
+    matrix->pre_add_ij(entries[i].row, entries[i].col);
+  matrix->alloc();
+  for (unsigned int i = 0; i < entries.size(); i++)
+    matrix->add(entries[i].row, entries[i].col, entries[i].val);
+  rhs->alloc(n);
+  for (int i = 0; i < n; i++)
+    rhs->set(i, 1. + 0.01 * i);
+}
+
+static double relative_residual(CSCMatrix<double>& matrix, SimpleVector<double>& rhs, double* sln)
+{
+  int n = matrix.get_size();
+  std::vector<double> Ax(n), b(n);
+  double* Ax_data = Ax.data();
+  matrix.multiply_with_vector(sln, Ax_data, true);
+  rhs.extract(b.data());
+  for (int i = 0; i < n; i++)
+    Ax[i] = b[i] - Ax[i];
+  return get_l2_norm(Ax.data(), n) / get_l2_norm(b.data(), n);
+}
+
+static bool check_convergence()
+{
+  int grid = 30, n = grid * grid;
+  std::vector<Entry> entries = laplacian(grid);
+
+  HermesCommonApi.set_integral_param_value(directMatrixSolverType, SOLVER_MUMPS);
+  SparseMatrix<double>* mumps_matrix = create_matrix<double>(true);
+  Vector<double>* mumps_rhs = create_vector<double>(true);
+  fill(mumps_matrix, mumps_rhs, n, entries);
+  LinearMatrixSolver<double>* mumps = create_linear_solver<double>(mumps_matrix, mumps_rhs, true);
+  mumps->solve();
+
+  CSCMatrix<double> matrix;
+  SimpleVector<double> rhs;
+  fill(&matrix, &rhs, n, entries);
+  MixedPrecisionMumpsSolver<double> solver(&matrix, &rhs);
+  solver.solve();
+
+  double max_difference = 0., max_value = 0.;
+  for (int i = 0; i < n; i++)
+  {
+    max_difference = std::max(max_difference, std::abs(solver.get_sln_vector()[i] - mumps->get_sln_vector()[i]));
+    max_value = std::max(max_value, std::abs(mumps->get_sln_vector()[i]));
+  }
+  printf("Laplacian: %u refinement iterations, relative residual %g, maximum difference from MUMPS %g (maximum value %g).\n",
+    solver.get_num_refinement_iterations(), solver.get_residual_norm(), max_difference, max_value);
+
+  bool success = solver.get_num_refinement_iterations() >= 1 && solver.get_num_refinement_iterations() <= 5;
+  success = success && solver.get_residual_norm() <= 1e-12 && max_difference <= 1e-10 * max_value;
+
+  delete mumps;
+  delete mumps_matrix;
+  delete mumps_rhs;
+  return success;
+}
+
+static bool check_non_convergence()
+{
+  int n = 10;
+  CSCMatrix<double> matrix;
+  SimpleVector<double> rhs;
+  fill(&matrix, &rhs, n, hilbert(n));
+  MixedPrecisionMumpsSolver<double> solver(&matrix, &rhs);
+
+  // The returned iterate is the best one so far, so its residual must not grow with the allowed iterations.
+  bool success = true;
+  double previous_residual = 1.;
+  for (unsigned int max_iterations = 1; max_iterations <= 10; max_iterations++)
+  {
+    solver.set_refinement_parameters(1e-12, max_iterations);
+    solver.solve();
+    double residual = relative_residual(matrix, rhs, solver.get_sln_vector());
+    printf("Hilbert matrix: %u refinement iterations, relative residual %g (reported %g).\n", solver.get_num_refinement_iterations(), residual, solver.get_residual_norm());
+    success = success && solver.get_num_refinement_iterations() == max_iterations;
+    success = success && residual <= previous_residual * (1. + 1e-6) && std::abs(residual - solver.get_residual_norm()) <= 1e-6 * residual;
+    previous_residual = residual;
+  }
+  return success && previous_residual > 1e-12;
+}
+
+int main()
+{
+  bool success = check_convergence();
+  success = check_non_convergence() && success;
+
+  printf(success ? "Success!\n" : "Failure!\n");
+  return success ? 0 : -1;
+}
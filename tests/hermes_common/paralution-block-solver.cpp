@@ -0,0 +1,170 @@
+// BlockParalutionLinearMatrixSolver on two-field systems has to reach the UMFPACK solution: the block Jacobi and
+// block Gauss-Seidel preconditioners on coupled reaction-diffusion equations, the Schur complement preconditioner
+// on a saddle point problem. The Schur complement preconditioner has to reject block sizes not matching the rows
+// without a stored diagonal entry.
+#include "hermes_common.h"
+#include <cstdio>
+#include <vector>
+
+using namespace Hermes;
+using namespace Hermes::Algebra;
+using namespace Hermes::Solvers;
+
+static const int grid = 30;
+static const int n = grid * grid;
+
+struct Entry
+{
+  int row, col;
+  double val;
+};
+
+// Five-point Laplacian plus shift * I of the field starting at offset.
+static void add_laplacian(std::vector<Entry>& entries, int offset, double shift)
+{
+  for (int i = 0; i < grid; i++)
+    for (int j = 0; j < grid; j++)
+    {
+      int row = i * grid + j;
+      Entry diagonal = { offset + row, offset + row, 4. + shift };
+      entries.push_back(diagonal);
+      int neighbors[4] = { i > 0 ? row - grid : -1, i < grid - 1 ? row + grid : -1, j > 0 ? row - 1 : -1, j < grid - 1 ? row + 1 : -1 };
+      for (int k = 0; k < 4; k++)
+        if (neighbors[k] >= 0)
+        {
+          Entry entry = { offset + row, offset + neighbors[k], -1. };
+          entries.push_back(entry);
+        }
+    }
+}
+
+// -div grad u + u - 0.5 v = f, -div grad v + 2 v - 0.5 u = g.
+static std::vector<Entry> coupled()
+{
+  std::vector<Entry> entries;
+  add_laplacian(entries, 0, 1.);
+  add_laplacian(entries, n, 2.);
+  for (int row = 0; row < n; row++)
+  {
+    Entry uv = { row, n + row, -0.5 }, vu = { n + row, row, -0.5 };
+    entries.push_back(uv);
+    entries.push_back(vu);
+  }
+  return entries;
+}
+
+// [K B^T; B 0], K the shifted Laplacian, B (n / 2 x n) sums of neighboring unknowns.
+// The zero block is not stored, unless zero_diagonal is set.
+static std::vector<Entry> saddle_point(bool zero_diagonal)
+{
+  std::vector<Entry> entries;
+  add_laplacian(entries, 0, 1.);
+  for (int k = 0; k < n / 2; k++)
+  {
+    for (int i = 0; i < 2; i++)
+    {
+      Entry b = { n + k, 2 * k + i, 1. }, b_t = { 2 * k + i, n + k, 1. };
+      entries.push_back(b);
+      entries.push_back(b_t);
+    }
+    if (zero_diagonal)
+    {
+      Entry zero = { n + k, n + k, 0. };
+      entries.push_back(zero);
+    }
+  }
+  return entries;
+}
+
+template<typename MatrixType, typename VectorType>
+static void fill(MatrixType& matrix, VectorType& rhs, int size, const std::vector<Entry>& entries)
+{
+  matrix.prealloc(size);
+  for (unsigned int i = 0; i < entries.size(); i++)
+    matrix.pre_add_ij(entries[i].row, entries[i].col);
+  matrix.alloc();
+  for (unsigned int i = 0; i < entries.size(); i++)
+    matrix.add(entries[i].row, entries[i].col, entries[i].val);
+  rhs.alloc(size);
+  for (int i = 0; i < size; i++)
+    rhs.set(i, 1. + 0.01 * (i % 17));
+}
+
+static std::vector<double> solve_direct(int size, const std::vector<Entry>& entries)
+{
+  CSCMatrix<double> matrix;
+  SimpleVector<double> rhs;
+  fill(matrix, rhs, size, entries);
+  UMFPackLinearMatrixSolver<double> solver(&matrix, &rhs);
+  solver.solve();
+  return std::vector<double>(solver.get_sln_vector(), solver.get_sln_vector() + size);
+}
+
+static bool check(const char* name, std::vector<int> block_sizes, ParalutionBlockPreconditionerType type, const std::vector<Entry>& entries)
+{
+  int size = block_sizes[0] + block_sizes[1];
+  std::vector<double> reference = solve_direct(size, entries);
+
+  SharedParalutionMatrix<double> matrix;
+  ParalutionVector<double> rhs;
+  fill(matrix, rhs, size, entries);
+  BlockParalutionLinearMatrixSolver<double> solver(&matrix, &rhs, block_sizes, type);
+  solver.set_solver_type(GMRES);
+  solver.set_tolerance(1e-12, RelativeTolerance);
+  solver.set_max_iters(1000);
+  solver.solve();
+
+  double max_difference = 0., max_value = 0.;
+  for (int i = 0; i < size; i++)
+  {
+    max_difference = std::max(max_difference, std::abs(solver.get_sln_vector()[i] - reference[i]));
+    max_value = std::max(max_value, std::abs(reference[i]));
+  }
+  printf("%s: %i iterations, maximum difference from UMFPACK %g (maximum value %g).\n", name, solver.get_num_iters(), max_difference, max_value);
+  return solver.get_num_iters() < 1000 && max_difference <= 1e-8 * max_value;
+}
+
+static bool rejected(const char* name, std::vector<int> block_sizes, const std::vector<Entry>& entries)
+{
+  int size = block_sizes[0] + block_sizes[1];
+  SharedParalutionMatrix<double> matrix;
+  ParalutionVector<double> rhs;
+  fill(matrix, rhs, size, entries);
+  BlockParalutionLinearMatrixSolver<double> solver(&matrix, &rhs, block_sizes, ParalutionBlockSchurComplement);
+  solver.set_solver_type(GMRES);
+  bool thrown = false;
+  try
+  {
+    solver.solve();
+  }
+  catch (Exceptions::Exception& e)
+  {
+    printf("%s: rejected (%s).\n", name, e.what());
+    thrown = true;
+  }
+  if (!thrown)
+    printf("%s: not rejected.\n", name);
+  return thrown;
+}
+
+int main()
+{
+  HermesCommonApi.set_integral_param_value(matrixSolverType, SOLVER_PARALUTION_ITERATIVE);
+
+  std::vector<int> coupled_sizes(2, n);
+  std::vector<int> saddle_point_sizes(1, n);
+  saddle_point_sizes.push_back(n / 2);
+
+  bool success = check("Block Jacobi", coupled_sizes, ParalutionBlockJacobi, coupled());
+  success = check("Block Gauss-Seidel", coupled_sizes, ParalutionBlockGaussSeidel, coupled()) && success;
+  success = check("Schur complement", saddle_point_sizes, ParalutionBlockSchurComplement, saddle_point(false)) && success;
+
+  // The zero block is one row larger than the block sizes say / stored with explicit zeros.
+  std::vector<int> wrong_sizes(1, n + 1);
+  wrong_sizes.push_back(n / 2 - 1);
+  success = rejected("Schur complement, wrong block sizes", wrong_sizes, saddle_point(false)) && success;
+  success = rejected("Schur complement, stored zero block", saddle_point_sizes, saddle_point(true)) && success;
+
+  printf(success ? "Success!\n" : "Failure!\n");
+  return success ? 0 : -1;
+}
@@ -0,0 +1,115 @@
+// A CSR file written by PARALUTION has to read and map back to the same matrix; a mapped file with a corrupted value
+// has to be refused when the checksum is verified (the default) and accepted when the verification is switched off.
+#include <paralution.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using namespace paralution;
+
+static const int n = 1000;
+static const char* filename = "paralution-csr-file.csr";
+
+// Tridiagonal n x n matrix, distinct values.
+static void assemble(LocalMatrix<double>& mat)
+{
+  int nnz = 3 * n - 2;
+  int* row_offset = new int[n + 1];
+  int* col = new int[nnz];
+  double* val = new double[nnz];
+  int k = 0;
+  row_offset[0] = 0;
+  for (int i = 0; i < n; i++)
+  {
+    for (int j = i - 1; j <= i + 1; j++)
+      if (j >= 0 && j < n)
+      {
+        col[k] = j;
+        val[k] = (i == j) ? 4. + i : -1. - 1e-3 * k;
+        k++;
+      }
+    row_offset[i + 1] = k;
+  }
+  mat.SetDataPtrCSR(&row_offset, &col, &val, "tridiagonal", nnz, n, n);
+}
+
+static bool same(LocalMatrix<double>& a, LocalMatrix<double>& b)
+{
+  if (a.get_nrow() != b.get_nrow() || a.get_ncol() != b.get_ncol() || a.get_nnz() != b.get_nnz())
+    return false;
+
+  int *a_row_offset = NULL, *b_row_offset = NULL;
+  int *a_col = NULL, *b_col = NULL;
+  double *a_val = NULL, *b_val = NULL;
+  a.LeaveDataPtrCSR(&a_row_offset, &a_col, &a_val);
+  b.LeaveDataPtrCSR(&b_row_offset, &b_col, &b_val);
+  int nnz = a_row_offset[n];
+  bool success = memcmp(a_row_offset, b_row_offset, (n + 1) * sizeof(int)) == 0
+    && memcmp(a_col, b_col, nnz * sizeof(int)) == 0 && memcmp(a_val, b_val, nnz * sizeof(double)) == 0;
+  delete[] a_row_offset;
+  delete[] a_col;
+  delete[] a_val;
+  delete[] b_row_offset;
+  delete[] b_col;
+  delete[] b_val;
+  return success;
+}
+
+int main(int argc, char* argv[])
+{
+  init_paralution();
+
+  // Run as a child process: FATAL_ERROR() ends the process on the checksum mismatch.
+  if (argc > 1 && strcmp(argv[1], "map-verified") == 0)
+  {
+    LocalMatrix<double> mapped;
+    mapped.MapFileCSR(filename);
+    stop_paralution();
+    return 0;
+  }
+
+  bool success = true;
+  {
+    LocalMatrix<double> mat;
+    assemble(mat);
+    mat.WriteFileCSR(filename);
+
+    LocalMatrix<double> original, read, mapped;
+    assemble(original);
+    read.ReadFileCSR(filename);
+    mapped.MapFileCSR(filename);
+    bool read_same = same(original, read);
+    assemble(original);
+    bool mapped_same = same(original, mapped);
+    printf("Read: %s, mapped: %s.\n", read_same ? "same" : "differs", mapped_same ? "same" : "differs");
+    success = read_same && mapped_same;
+  }
+
+  // The last byte of the file belongs to the last value.
+  FILE* f = fopen(filename, "r+b");
+  fseek(f, -1, SEEK_END);
+  int byte = fgetc(f);
+  fseek(f, -1, SEEK_END);
+  fputc(byte ^ 0x55, f);
+  fclose(f);
+
+  {
+    LocalMatrix<double> unverified;
+    unverified.MapFileCSR(filename, false);
+    bool accepted = unverified.get_nnz() == 3 * n - 2;
+    printf("Corrupted file mapped without verification: %s.\n", accepted ? "accepted" : "refused");
+    success = success && accepted;
+  }
+
+  std::string command = std::string("\"") + argv[0] + "\" map-verified";
+  bool refused = system(command.c_str()) != 0;
+  printf("Corrupted file mapped with verification: %s.\n", refused ? "refused" : "accepted");
+  success = success && refused;
+
+  remove(filename);
+  stop_paralution();
+
+  printf(success ? "Success!\n" : "Failure!\n");
+  return success ? 0 : -1;
+}
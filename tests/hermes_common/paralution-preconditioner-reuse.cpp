@@ -0,0 +1,215 @@
+// A reused PARALUTION preconditioner has to stay in effect when it is refreshed numerically
+// (HERMES_REUSE_MATRIX_REORDERING), i.e. the iterations count has to be that of a preconditioner built anew for the matrix,
+// not that of the unpreconditioned method. With HERMES_REUSE_MATRIX_STRUCTURE_COMPLETELY the preconditioner of the old matrix
+// has to be used as it is, and built anew after the iterations grew. The preconditioner has to be built anew after max_solves
+// solves, and ReusingAMGParalutionLinearMatrixSolver has to keep its hierarchy the same way.
+#include "hermes_common.h"
+#include <cstdio>
+#include <vector>
+
+using namespace Hermes;
+using namespace Hermes::Algebra;
+using namespace Hermes::Solvers;
+using namespace Hermes::Preconditioners;
+
+static const int grid = 60;
+
+// Finite differences of -div(a grad u) on a grid x grid grid, a = 1 + scale * x.
+static void assemble(SharedParalutionMatrix<double>& matrix, double scale, bool structure)
+{
+  int n = grid * grid;
+  if (structure)
+  {
+    matrix.prealloc(n);
+    for (int i = 0; i < grid; i++)
+      for (int j = 0; j < grid; j++)
+      {
+        int row = i * grid + j;
+        matrix.pre_add_ij(row, row);
+        if (i > 0) matrix.pre_add_ij(row, row - grid);
+        if (i < grid - 1) matrix.pre_add_ij(row, row + grid);
+        if (j > 0) matrix.pre_add_ij(row, row - 1);
+        if (j < grid - 1) matrix.pre_add_ij(row, row + 1);
+      }
+    matrix.alloc();
+  }
+  matrix.zero();
+
+  for (int i = 0; i < grid; i++)
+    for (int j = 0; j < grid; j++)
+    {
+      int row = i * grid + j;
+      double a_west = 1. + scale * (j - 0.5) / grid, a_east = 1. + scale * (j + 0.5) / grid, a_ns = 1. + scale * j / grid;
+      matrix.add(row, row, a_west + a_east + 2. * a_ns);
+      if (i > 0) matrix.add(row, row - grid, -a_ns);
+      if (i < grid - 1) matrix.add(row, row + grid, -a_ns);
+      if (j > 0) matrix.add(row, row - 1, -a_west);
+      if (j < grid - 1) matrix.add(row, row + 1, -a_east);
+    }
+}
+
+// Relative residual of the solution, computed by Hermes.
+static double residual(SharedParalutionMatrix<double>& matrix, ParalutionVector<double>& rhs, double* sln)
+{
+  int n = matrix.get_size();
+  std::vector<double> Ax(n), b(n);
+  double* Ax_data = Ax.data();
+  matrix.multiply_with_vector(sln, Ax_data, true);
+  rhs.extract(b.data());
+  for (int i = 0; i < n; i++)
+    Ax[i] = b[i] - Ax[i];
+  return get_l2_norm(Ax.data(), n) / get_l2_norm(b.data(), n);
+}
+
+// Iterations count, -1 if the solution is not accurate.
+static int solve(LoopSolver<double>& solver, SharedParalutionMatrix<double>& matrix, ParalutionVector<double>& rhs)
+{
+  solver.solve();
+  return residual(matrix, rhs, solver.get_sln_vector()) < 1e-8 ? solver.get_num_iters() : -1;
+}
+
+static void configure(ReusingIterativeParalutionLinearMatrixSolver<double>& solver, PreconditionerType preconditioner_type, bool preconditioned)
+{
+  solver.set_solver_type(CG);
+  solver.set_tolerance(1e-10, RelativeTolerance);
+  solver.set_max_iters(10000);
+  if (preconditioned)
+    solver.set_precond(new ParalutionPrecond<double>(preconditioner_type));
+}
+
+// Iterations of a preconditioner built for the matrix.
+static int fresh_iterations(double scale, PreconditionerType preconditioner_type, ParalutionVector<double>& rhs)
+{
+  SharedParalutionMatrix<double> matrix;
+  assemble(matrix, scale, true);
+  ReusingIterativeParalutionLinearMatrixSolver<double> solver(&matrix, &rhs);
+  configure(solver, preconditioner_type, true);
+  return solve(solver, matrix, rhs);
+}
+
+static bool check_refresh(ParalutionVector<double>& rhs)
+{
+  bool success = true;
+  PreconditionerType preconditioner_types[2] = { ILU, MultiColoredILU };
+  for (int type = 0; type < 2; type++)
+  {
+    // Built for the first matrix, refreshed numerically for the second one.
+    SharedParalutionMatrix<double> matrix;
+    assemble(matrix, 1., true);
+    ReusingIterativeParalutionLinearMatrixSolver<double> reusing_solver(&matrix, &rhs);
+    configure(reusing_solver, preconditioner_types[type], true);
+    solve(reusing_solver, matrix, rhs);
+    assemble(matrix, 10., false);
+    reusing_solver.set_reuse_scheme(HERMES_REUSE_MATRIX_REORDERING);
+    int reused_iterations = solve(reusing_solver, matrix, rhs);
+
+    // Built for the second matrix.
+    int built_iterations = fresh_iterations(10., preconditioner_types[type], rhs);
+
+    // No preconditioner.
+    SharedParalutionMatrix<double> plain_matrix;
+    assemble(plain_matrix, 10., true);
+    ReusingIterativeParalutionLinearMatrixSolver<double> plain_solver(&plain_matrix, &rhs);
+    configure(plain_solver, preconditioner_types[type], false);
+    int plain_iterations = solve(plain_solver, plain_matrix, rhs);
+
+    printf("Preconditioner %i: %i iterations reused, %i built anew, %i unpreconditioned, %u builds.\n", type, reused_iterations, built_iterations, plain_iterations, reusing_solver.get_num_preconditioner_builds());
+    success = success && reusing_solver.get_num_preconditioner_builds() == 1 && reused_iterations > 0 && built_iterations > 0;
+    success = success && reused_iterations <= built_iterations + 2 && reused_iterations < plain_iterations;
+  }
+  return success;
+}
+
+// The preconditioner of the matrix with a = 1 reused as it is for a = 1 + 1000 x: more iterations than with a preconditioner
+// built for the matrix, and the growth makes the next solve build it anew.
+static bool check_structure_completely(ParalutionVector<double>& rhs)
+{
+  SharedParalutionMatrix<double> matrix;
+  assemble(matrix, 0., true);
+  ReusingIterativeParalutionLinearMatrixSolver<double> solver(&matrix, &rhs);
+  configure(solver, ILU, true);
+  solver.set_reuse_scheme(HERMES_REUSE_MATRIX_STRUCTURE_COMPLETELY);
+  solver.set_preconditioner_reuse_limits(100, 0.5);
+  int initial_iterations = solve(solver, matrix, rhs);
+
+  assemble(matrix, 1000., false);
+  int reused_iterations = solve(solver, matrix, rhs);
+  unsigned int reused_builds = solver.get_num_preconditioner_builds();
+  int rebuilt_iterations = solve(solver, matrix, rhs);
+  int built_iterations = fresh_iterations(1000., ILU, rhs);
+
+  printf("Reused completely: %i iterations for the old matrix, %i reused (%u builds), %i after the growth (%u builds), %i built anew.\n",
+    initial_iterations, reused_iterations, reused_builds, rebuilt_iterations, solver.get_num_preconditioner_builds(), built_iterations);
+  bool success = initial_iterations > 0 && reused_iterations > 0 && rebuilt_iterations > 0 && built_iterations > 0;
+  success = success && reused_builds == 1 && reused_iterations > built_iterations && reused_iterations > 1.5 * initial_iterations;
+  return success && solver.get_num_preconditioner_builds() == 2 && rebuilt_iterations <= built_iterations + 2;
+}
+
+// Seven solves with at most three per preconditioner: built in the solves 1, 4 and 7.
+static bool check_max_solves(ParalutionVector<double>& rhs)
+{
+  SharedParalutionMatrix<double> matrix;
+  assemble(matrix, 1., true);
+  ReusingIterativeParalutionLinearMatrixSolver<double> solver(&matrix, &rhs);
+  configure(solver, ILU, true);
+  solver.set_reuse_scheme(HERMES_REUSE_MATRIX_REORDERING);
+  solver.set_preconditioner_reuse_limits(3, 10.);
+
+  bool success = true;
+  unsigned int expected_builds[7] = { 1, 1, 1, 2, 2, 2, 3 };
+  for (int i = 0; i < 7; i++)
+  {
+    assemble(matrix, 1. + i, false);
+    success = solve(solver, matrix, rhs) > 0 && success;
+    success = success && solver.get_num_preconditioner_builds() == expected_builds[i];
+  }
+  printf("Limit of 3 solves: %u builds in 7 solves.\n", solver.get_num_preconditioner_builds());
+  return success;
+}
+
+// AMG hierarchy of the matrix with a = 1 + x kept for a = 1 + 10 x, built anew after max_solves.
+static bool check_amg(ParalutionVector<double>& rhs)
+{
+  SharedParalutionMatrix<double> matrix;
+  assemble(matrix, 1., true);
+  ReusingAMGParalutionLinearMatrixSolver<double> solver(&matrix, &rhs);
+  solver.set_tolerance(1e-10, RelativeTolerance);
+  solver.set_max_iters(10000);
+  solver.set_reuse_scheme(HERMES_REUSE_MATRIX_REORDERING);
+  solver.set_preconditioner_reuse_limits(2, 10.);
+  int initial_iterations = solve(solver, matrix, rhs);
+
+  assemble(matrix, 10., false);
+  int reused_iterations = solve(solver, matrix, rhs);
+  unsigned int reused_builds = solver.get_num_preconditioner_builds();
+  int rebuilt_iterations = solve(solver, matrix, rhs);
+
+  SharedParalutionMatrix<double> plain_matrix;
+  assemble(plain_matrix, 10., true);
+  ReusingIterativeParalutionLinearMatrixSolver<double> plain_solver(&plain_matrix, &rhs);
+  configure(plain_solver, ILU, false);
+  int plain_iterations = solve(plain_solver, plain_matrix, rhs);
+
+  printf("AMG: %i iterations for the old matrix, %i reused (%u builds), %i after the limit (%u builds), %i unpreconditioned CG.\n",
+    initial_iterations, reused_iterations, reused_builds, rebuilt_iterations, solver.get_num_preconditioner_builds(), plain_iterations);
+  bool success = initial_iterations > 0 && reused_iterations > 0 && rebuilt_iterations > 0;
+  return success && reused_builds == 1 && solver.get_num_preconditioner_builds() == 2 && reused_iterations < plain_iterations;
+}
+
+int main()
+{
+  HermesCommonApi.set_integral_param_value(matrixSolverType, SOLVER_PARALUTION_ITERATIVE);
+
+  int n = grid * grid;
+  ParalutionVector<double> rhs(n);
+  for (int i = 0; i < n; i++)
+    rhs.set(i, 1.);
+
+  bool success = check_refresh(rhs);
+  success = check_structure_completely(rhs) && success;
+  success = check_max_solves(rhs) && success;
+  success = check_amg(rhs) && success;
+
+  printf(success ? "Success!\n" : "Failure!\n");
+  return success ? 0 : -1;
+}
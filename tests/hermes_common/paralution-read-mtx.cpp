@@ -0,0 +1,145 @@
+// The parallel Matrix Market reader of PARALUTION has to accept the files mmio accepts (blank lines before the size,
+// the size spread over lines, blank lines between the entries) and produce the matrix of the sequential mmio / fscanf()
+// reading, for any number of threads.
+#include <paralution.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace paralution;
+
+struct Entry
+{
+  int row, col;
+  double val;
+};
+
+static bool entry_less(const Entry& a, const Entry& b)
+{
+  return a.row != b.row ? a.row < b.row : a.col < b.col;
+}
+
+// The reading of mmio (mm_read_mtx_crd_size(), then fscanf() of the entries) - the entries sorted (stably) by the rows and columns.
+static bool read_reference(const char* filename, int& nrow, int& ncol, std::vector<Entry>& entries)
+{
+  FILE* f = fopen(filename, "r");
+  if (f == NULL)
+    return false;
+  char line[1025];
+  bool symmetric = false;
+  do
+  {
+    if (fgets(line, 1025, f) == NULL)
+      return false;
+    symmetric = symmetric || strstr(line, "symmetric") != NULL;
+  } while (line[0] == '%');
+  int nnz;
+  if (sscanf(line, "%d %d %d", &nrow, &ncol, &nnz) != 3)
+  {
+    int items;
+    do
+    {
+      items = fscanf(f, "%d %d %d", &nrow, &ncol, &nnz);
+      if (items == EOF)
+        return false;
+    } while (items != 3);
+  }
+
+  for (int i = 0; i < nnz; i++)
+  {
+    Entry entry;
+    if (fscanf(f, "%d %d %lg", &entry.row, &entry.col, &entry.val) != 3)
+      return false;
+    entry.row--;
+    entry.col--;
+    entries.push_back(entry);
+    if (symmetric && entry.row != entry.col)
+    {
+      std::swap(entry.row, entry.col);
+      entries.push_back(entry);
+    }
+  }
+  fclose(f);
+  std::stable_sort(entries.begin(), entries.end(), entry_less);
+  return true;
+}
+
+static bool check(const char* filename, const char* content)
+{
+  FILE* f = fopen(filename, "w");
+  fputs(content, f);
+  fclose(f);
+
+  int nrow, ncol;
+  std::vector<Entry> entries;
+  if (!read_reference(filename, nrow, ncol, entries))
+    return false;
+
+  bool success = true;
+  int thread_counts[3] = { 1, 2, 4 };
+  for (int t = 0; t < 3; t++)
+  {
+    set_omp_threads_paralution(thread_counts[t]);
+    LocalMatrix<double> mat;
+    mat.ReadFileMTX(filename);
+    success = success && mat.get_nrow() == nrow && mat.get_ncol() == ncol && mat.get_nnz() == (int)entries.size();
+    if (!success)
+      break;
+
+    int* row_offset = NULL;
+    int* col = NULL;
+    double* val = NULL;
+    mat.LeaveDataPtrCSR(&row_offset, &col, &val);
+    for (unsigned int i = 0; i < entries.size(); i++)
+      success = success && col[i] == entries[i].col && val[i] == entries[i].val
+        && row_offset[entries[i].row] <= (int)i && (int)i < row_offset[entries[i].row + 1];
+    delete[] row_offset;
+    delete[] col;
+    delete[] val;
+  }
+  printf("%s: %s\n", filename, success ? "same as mmio" : "differs from mmio");
+  return success;
+}
+
+int main()
+{
+  init_paralution();
+
+  bool success = true;
+  success = check("blank-lines.mtx",
+    "%%MatrixMarket matrix coordinate real general\n"
+    "% a comment\n"
+    "\n"
+    "   \n"
+    "3 4 5\n"
+    "1 1 1.5\n"
+    "\n"
+    "2 4 -2.25e-3\n"
+    "3 2 7\n"
+    "1 3 0.1\n"
+    "3 2 1e10\n") && success;
+  success = check("split-size.mtx",
+    "%%MatrixMarket matrix coordinate real general\n"
+    "\n"
+    "4 4\n"
+    "  3\n"
+    "4 4 1\n"
+    "1 2 2\n"
+    "2 1 3\n") && success;
+  success = check("symmetric-blank-lines.mtx",
+    "%%MatrixMarket matrix coordinate real symmetric\n"
+    "%\n"
+    "\r\n"
+    "3 3 4\r\n"
+    "1 1 4\r\n"
+    "2 1 -1\r\n"
+    "\r\n"
+    "3 2 -1\r\n"
+    "3 3 4\r\n") && success;
+
+  stop_paralution();
+
+  printf(success ? "Success!\n" : "Failure!\n");
+  return success ? 0 : -1;
+}
@@ -0,0 +1,129 @@
+// SharedParalutionMatrix through its life cycle: the PARALUTION matrix has to work with the Hermes arrays after alloc(),
+// see the values assembled by Hermes and those set by update_values(), share the new arrays after the structure is
+// allocated again, and give them back in free(). Arrays freed by PARALUTION (LocalMatrix::Clear()) have to be detected
+// by verify_data() and must not be freed again by Hermes.
+#include "hermes_common.h"
+#include <cstdio>
+#include <vector>
+
+using namespace Hermes;
+using namespace Hermes::Algebra;
+using namespace Hermes::Solvers;
+
+// Tridiagonal (-1, diagonal, -1) matrix of size n.
+static void assemble(SharedParalutionMatrix<double>& matrix, int n, double diagonal, bool structure)
+{
+  if (structure)
+  {
+    matrix.prealloc(n);
+    for (int i = 0; i < n; i++)
+    {
+      matrix.pre_add_ij(i, i);
+      if (i > 0) matrix.pre_add_ij(i, i - 1);
+      if (i < n - 1) matrix.pre_add_ij(i, i + 1);
+    }
+    matrix.alloc();
+  }
+  matrix.zero();
+  for (int i = 0; i < n; i++)
+  {
+    matrix.add(i, i, diagonal);
+    if (i > 0) matrix.add(i, i - 1, -1.);
+    if (i < n - 1) matrix.add(i, i + 1, -1.);
+  }
+}
+
+// Solves by PARALUTION, the residual is computed by Hermes from its own arrays.
+static double solve(SharedParalutionMatrix<double>& matrix)
+{
+  int n = matrix.get_size();
+  ParalutionVector<double> rhs(n);
+  for (int i = 0; i < n; i++)
+    rhs.set(i, 1. + 0.01 * i);
+
+  IterativeParalutionLinearMatrixSolver<double> solver(&matrix, &rhs);
+  solver.set_solver_type(CG);
+  solver.set_tolerance(1e-12, RelativeTolerance);
+  solver.set_max_iters(10000);
+  solver.solve();
+
+  std::vector<double> Ax(n), b(n);
+  double* Ax_data = Ax.data();
+  matrix.multiply_with_vector(solver.get_sln_vector(), Ax_data, true);
+  rhs.extract(b.data());
+  for (int i = 0; i < n; i++)
+    Ax[i] = b[i] - Ax[i];
+  return get_l2_norm(Ax.data(), n) / get_l2_norm(b.data(), n);
+}
+
+static bool shares(SharedParalutionMatrix<double>& matrix)
+{
+  return matrix.is_shared() && matrix.get_paralutionMatrix().get_nnz() == (int)matrix.get_nnz()
+    && matrix.get_paralutionMatrix().get_nrow() == (int)matrix.get_size();
+}
+
+int main()
+{
+  HermesCommonApi.set_integral_param_value(matrixSolverType, SOLVER_PARALUTION_ITERATIVE);
+  bool success = true;
+
+  SharedParalutionMatrix<double>* matrix = new SharedParalutionMatrix<double>;
+
+  // Alloc and solve.
+  assemble(*matrix, 100, 2.5, true);
+  double residual = solve(*matrix);
+  printf("Allocated: %s, residual %g.\n", shares(*matrix) ? "shared" : "not shared", residual);
+  success = success && shares(*matrix) && residual < 1e-10;
+
+  // Values assembled by Hermes into the shared arrays.
+  assemble(*matrix, 100, 4., false);
+  residual = solve(*matrix);
+  printf("Assembled anew: residual %g.\n", residual);
+  success = success && residual < 1e-10;
+
+  // Values set through PARALUTION end up in the Hermes arrays.
+  std::vector<double> values(matrix->get_Ax(), matrix->get_Ax() + matrix->get_nnz());
+  for (unsigned int i = 0; i < values.size(); i++)
+    values[i] *= 2.;
+  matrix->update_values(values.data());
+  bool updated = shares(*matrix);
+  for (unsigned int i = 0; i < values.size(); i++)
+    updated = updated && matrix->get_Ax()[i] == values[i];
+  residual = solve(*matrix);
+  printf("Values updated: %s, residual %g.\n", updated ? "in the Hermes arrays" : "not in the Hermes arrays", residual);
+  success = success && updated && residual < 1e-10;
+
+  // Structure allocated again.
+  assemble(*matrix, 250, 3., true);
+  residual = solve(*matrix);
+  printf("Reallocated: %s, %u nonzeros, residual %g.\n", shares(*matrix) ? "shared" : "not shared", matrix->get_nnz(), residual);
+  success = success && shares(*matrix) && matrix->get_nnz() == 3 * 250 - 2 && residual < 1e-10;
+
+  // Taken back by free().
+  matrix->free();
+  bool freed = !matrix->is_shared() && !matrix->get_Ap() && !matrix->get_Ax() && matrix->get_paralutionMatrix().get_nnz() == 0;
+  printf("Freed: %s.\n", freed ? "taken back" : "still shared");
+  success = success && freed;
+
+  // Freed by PARALUTION.
+  assemble(*matrix, 100, 2.5, true);
+  matrix->get_paralutionMatrix().Clear();
+  bool detected = false;
+  try
+  {
+    matrix->verify_data();
+  }
+  catch (Exceptions::Exception&)
+  {
+    detected = true;
+  }
+  detected = detected && !matrix->is_shared() && !matrix->get_Ap() && !matrix->get_Ai() && !matrix->get_Ax();
+  printf("Cleared by PARALUTION: %s.\n", detected ? "detected" : "not detected");
+  success = success && detected;
+
+  // Nothing may be freed twice.
+  delete matrix;
+
+  printf(success ? "Success!\n" : "Failure!\n");
+  return success ? 0 : -1;
+}
@@ -0,0 +1,187 @@
+// StreamingExternalSolver against the stub solver process (streaming-solver-stub): the systems have to arrive as sent
+// (the solutions have to solve them), an unchanged structure has to be sent as values only, the process has to be
+// started anew after it failed or crashed, and stop() has to kill a process not quitting within the stop timeout.
+#include "hermes_common.h"
+#include "solvers/interfaces/streaming_external_solver.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace Hermes;
+using namespace Hermes::Algebra;
+using namespace Hermes::Solvers;
+
+static const int size = 50;
+static const char* log_file = "streaming-external-solver.log";
+
+static std::string command(const char* options)
+{
+  return std::string("\"") + STREAMING_SOLVER_STUB + "\" " + options;
+}
+
+// Tridiagonal (bandwidth 1) or pentadiagonal (bandwidth 2) matrix, all zeros for diagonal = 0.
+static void assemble(CSCMatrix<double>& matrix, SimpleVector<double>& rhs, int bandwidth, double diagonal, bool structure)
+{
+  if (structure)
+  {
+    matrix.prealloc(size);
+    for (int i = 0; i < size; i++)
+      for (int j = std::max(0, i - bandwidth); j <= std::min(size - 1, i + bandwidth); j++)
+        matrix.pre_add_ij(i, j);
+    matrix.alloc();
+    rhs.alloc(size);
+  }
+  matrix.zero();
+  for (int i = 0; i < size; i++)
+  {
+    for (int j = std::max(0, i - bandwidth); j <= std::min(size - 1, i + bandwidth); j++)
+      if (diagonal != 0.)
+        matrix.add(i, j, i == j ? diagonal : -1. / (std::abs(i - j) + j % 3));
+    rhs.set(i, 1. + 0.1 * i);
+  }
+}
+
+static double residual(CSCMatrix<double>& matrix, SimpleVector<double>& rhs, double* sln)
+{
+  std::vector<double> Ax(size), b(size);
+  double* Ax_data = Ax.data();
+  matrix.multiply_with_vector(sln, Ax_data, true);
+  rhs.extract(b.data());
+  for (int i = 0; i < size; i++)
+    Ax[i] = b[i] - Ax[i];
+  return get_l2_norm(Ax.data(), size) / get_l2_norm(b.data(), size);
+}
+
+static bool solves(StreamingExternalSolver<double>& solver, CSCMatrix<double>& matrix, SimpleVector<double>& rhs, double* initial_guess = nullptr)
+{
+  try
+  {
+    solver.solve(initial_guess);
+  }
+  catch (Exceptions::LinearMatrixSolverException& e)
+  {
+    printf("  Failed: %s\n", e.what());
+    return false;
+  }
+  return residual(matrix, rhs, solver.get_sln_vector()) < 1e-12;
+}
+
+struct LogLine
+{
+  int pid, type, size, nnz, initial_guess;
+};
+
+static std::vector<LogLine> read_log()
+{
+  std::vector<LogLine> lines;
+  std::ifstream log(log_file);
+  LogLine line;
+  while (log >> line.pid >> line.type >> line.size >> line.nnz >> line.initial_guess)
+    lines.push_back(line);
+  return lines;
+}
+
+// The messages the process got have to be those sent, values only for an unchanged structure.
+static bool check_protocol()
+{
+  std::remove(log_file);
+  CSCMatrix<double> matrix;
+  SimpleVector<double> rhs;
+  bool success;
+  {
+    StreamingExternalSolver<double> solver(&matrix, &rhs, command((std::string("--log ") + log_file).c_str()));
+    assemble(matrix, rhs, 1, 4., true);
+    success = solves(solver, matrix, rhs);
+    assemble(matrix, rhs, 1, 3., false);
+    success = solves(solver, matrix, rhs) && success;
+    std::vector<double> initial_guess(size, 1.);
+    success = solves(solver, matrix, rhs, initial_guess.data()) && success;
+    assemble(matrix, rhs, 2, 6., true);
+    success = solves(solver, matrix, rhs) && success;
+    printf("Protocol: %u structure messages, %u value messages.\n", solver.get_num_structure_messages(), solver.get_num_value_messages());
+    success = success && solver.get_num_structure_messages() == 2 && solver.get_num_value_messages() == 2;
+  }
+
+  // Structure, values, values with the initial guess, new structure, quit - all to one process.
+  std::vector<LogLine> lines = read_log();
+  int expected_types[5] = { 1, 2, 2, 1, 3 };
+  int expected_nnz[5] = { 3 * size - 2, 3 * size - 2, 3 * size - 2, 5 * size - 6, 0 };
+  int expected_initial_guess[5] = { 0, 0, 1, 0, 0 };
+  success = success && lines.size() == 5;
+  for (unsigned int i = 0; i < lines.size() && success; i++)
+  {
+    success = lines[i].pid == lines[0].pid && lines[i].type == expected_types[i] && lines[i].nnz == expected_nnz[i];
+    success = success && lines[i].size == (i < 4 ? size : 0) && lines[i].initial_guess == expected_initial_guess[i];
+  }
+  printf("Protocol: %u messages logged by the process, %s.\n", (unsigned int)lines.size(), success ? "as sent" : "not as sent");
+  std::remove(log_file);
+  return success;
+}
+
+// A failed solve (a singular matrix) and a crash of the process: the next solve has to start a new process and send the structure.
+static bool check_restart()
+{
+  std::remove(log_file);
+  CSCMatrix<double> matrix;
+  SimpleVector<double> rhs;
+  StreamingExternalSolver<double> solver(&matrix, &rhs, command((std::string("--crash-after 2 --log ") + log_file).c_str()));
+  assemble(matrix, rhs, 1, 4., true);
+  bool success = solves(solver, matrix, rhs);
+  assemble(matrix, rhs, 1, 0., false);
+  bool singular_failed = !solves(solver, matrix, rhs);
+  assemble(matrix, rhs, 1, 4., false);
+  bool restarted = solves(solver, matrix, rhs);
+  success = solves(solver, matrix, rhs) && success;
+  bool crash_failed = !solves(solver, matrix, rhs);
+  bool crash_restarted = solves(solver, matrix, rhs);
+  printf("Restart: singular matrix %s, %s; crash %s, %s; %u structure messages.\n", singular_failed ? "failed" : "did not fail",
+    restarted ? "restarted" : "not restarted", crash_failed ? "failed" : "did not fail", crash_restarted ? "restarted" : "not restarted",
+    solver.get_num_structure_messages());
+  success = success && singular_failed && restarted && crash_failed && crash_restarted;
+  solver.stop();
+
+  // Processes: the first one (solve, singular, quit after the failure), the second one (solve, solve, crash), the third one (solve, quit).
+  std::vector<LogLine> lines = read_log();
+  success = success && lines.size() == 8 && solver.get_num_structure_messages() == 3;
+  if (success)
+  {
+    int expected_types[8] = { 1, 2, 3, 1, 2, 2, 1, 3 };
+    int expected_process[8] = { 0, 0, 0, 3, 3, 3, 6, 6 };
+    for (unsigned int i = 0; i < lines.size(); i++)
+      success = success && lines[i].type == expected_types[i] && lines[i].pid == lines[expected_process[i]].pid;
+    success = success && lines[0].pid != lines[3].pid && lines[3].pid != lines[6].pid;
+  }
+  std::remove(log_file);
+  return success;
+}
+
+// A process ignoring the quit message has to be killed after the stop timeout.
+static bool check_shutdown()
+{
+  CSCMatrix<double> matrix;
+  SimpleVector<double> rhs;
+  StreamingExternalSolver<double> solver(&matrix, &rhs, command("--ignore-quit"));
+  solver.set_stop_timeout(200);
+  assemble(matrix, rhs, 1, 4., true);
+  bool success = solves(solver, matrix, rhs);
+
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+  solver.stop();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  bool restarted = solves(solver, matrix, rhs);
+  printf("Shutdown: stopped in %g s with the timeout 0.2 s, %s.\n", seconds, restarted ? "restarted" : "not restarted");
+  return success && restarted && seconds >= 0.15 && seconds < 5.;
+}
+
+int main()
+{
+  bool success = check_protocol();
+  success = check_restart() && success;
+  success = check_shutdown() && success;
+
+  printf(success ? "Success!\n" : "Failure!\n");
+  return success ? 0 : -1;
+}
@@ -0,0 +1,149 @@
+// Solver process for the StreamingExternalSolver test: speaks the protocol on the standard input / output and solves
+// the systems by dense Gaussian elimination.
+// Options:
+//   --log <file>       appends a line "<pid> <message type> <size> <nnz> <initial guess>" per message,
+//   --crash-after <n>  exits without an answer when the request after n solves comes,
+//   --ignore-quit      keeps running after the quit message.
+// A singular matrix is answered by the status 1, a message violating the protocol by the status 2.
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#if defined(WIN32) || defined(_WINDOWS)
+#include <fcntl.h>
+#include <io.h>
+#include <process.h>
+#include <windows.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+static bool read(void* data, size_t length)
+{
+  return length == 0 || fread(data, 1, length, stdin) == length;
+}
+
+static void answer(int status, const std::vector<double>& sln)
+{
+  fwrite(&status, sizeof(int), 1, stdout);
+  if (status == 0)
+    fwrite(sln.data(), sizeof(double), sln.size(), stdout);
+  fflush(stdout);
+}
+
+// Dense Gaussian elimination with partial pivoting of the CSC matrix.
+static bool solve(int size, const std::vector<int>& Ap, const std::vector<int>& Ai, const std::vector<double>& Ax, std::vector<double> rhs, std::vector<double>& sln)
+{
+  std::vector<double> A(size * size, 0.);
+  for (int col = 0; col < size; col++)
+    for (int i = Ap[col]; i < Ap[col + 1]; i++)
+      A[Ai[i] * size + col] += Ax[i];
+
+  for (int k = 0; k < size; k++)
+  {
+    int pivot = k;
+    for (int row = k + 1; row < size; row++)
+      if (std::abs(A[row * size + k]) > std::abs(A[pivot * size + k]))
+        pivot = row;
+    if (A[pivot * size + k] == 0.)
+      return false;
+    for (int col = 0; col < size; col++)
+      std::swap(A[k * size + col], A[pivot * size + col]);
+    std::swap(rhs[k], rhs[pivot]);
+    for (int row = k + 1; row < size; row++)
+    {
+      double factor = A[row * size + k] / A[k * size + k];
+      for (int col = k; col < size; col++)
+        A[row * size + col] -= factor * A[k * size + col];
+      rhs[row] -= factor * rhs[k];
+    }
+  }
+
+  sln.resize(size);
+  for (int row = size - 1; row >= 0; row--)
+  {
+    double value = rhs[row];
+    for (int col = row + 1; col < size; col++)
+      value -= A[row * size + col] * sln[col];
+    sln[row] = value / A[row * size + row];
+  }
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+#if defined(WIN32) || defined(_WINDOWS)
+  _setmode(_fileno(stdin), _O_BINARY);
+  _setmode(_fileno(stdout), _O_BINARY);
+#endif
+  const char* log_file = nullptr;
+  int crash_after = -1;
+  bool ignore_quit = false;
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "--log") && i + 1 < argc)
+      log_file = argv[++i];
+    else if (!strcmp(argv[i], "--crash-after") && i + 1 < argc)
+      crash_after = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--ignore-quit"))
+      ignore_quit = true;
+  }
+
+  std::vector<int> Ap, Ai;
+  int solves = 0;
+  int header[10];
+  while (read(header, sizeof(header)))
+  {
+    int type = header[5], size = header[6], nnz = header[7], initial_guess = header[9];
+    if (log_file)
+    {
+      FILE* log = fopen(log_file, "a");
+      fprintf(log, "%i %i %i %i %i\n", (int)getpid(), type, size, nnz, initial_guess);
+      fclose(log);
+    }
+
+    if (header[0] != 'H' || header[1] != 'S' || header[2] != 'L' || header[3] != 'V' || header[4] != 2)
+    {
+      answer(2, std::vector<double>());
+      return 2;
+    }
+    if (type == 3)
+    {
+      if (!ignore_quit)
+        return 0;
+#if defined(WIN32) || defined(_WINDOWS)
+      Sleep(60000);
+#else
+      sleep(60);
+#endif
+      return 0;
+    }
+    if (crash_after >= 0 && solves >= crash_after)
+      return 3;
+
+    // The values for the structure of the last system only.
+    bool structure_error = (type == 2 && ((int)Ap.size() != size + 1 || (int)Ai.size() != nnz)) || (type != 1 && type != 2) || header[8] != 0;
+    if (type == 1)
+    {
+      Ap.resize(size + 1);
+      Ai.resize(nnz);
+      if (!read(Ap.data(), Ap.size() * sizeof(int)) || !read(Ai.data(), Ai.size() * sizeof(int)))
+        return 1;
+    }
+    std::vector<double> Ax(nnz), rhs(size), guess(initial_guess ? size : 0);
+    if (!read(Ax.data(), Ax.size() * sizeof(double)) || !read(rhs.data(), rhs.size() * sizeof(double)) || !read(guess.data(), guess.size() * sizeof(double)))
+      return 1;
+    if (structure_error)
+    {
+      answer(2, std::vector<double>());
+      continue;
+    }
+
+    std::vector<double> sln;
+    answer(solve(size, Ap, Ai, Ax, rhs, sln) ? 0 : 1, sln);
+    solves++;
+  }
+  return 0;
+}